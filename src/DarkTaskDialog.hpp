@@ -13,20 +13,18 @@
 
 #pragma comment(lib, "Msimg32.lib")
 
-#include <gdiplus.h>
-#pragma comment(lib, "gdiplus.lib")
-
 #include <Vssym32.h>
 #include <Vsstyle.h>
 
 #include <string>
-#include <memory>
 
 #include <dwmapi.h>
 #pragma comment(lib, "Dwmapi.lib")
 
 #include <set>
 
+#include "nvPixels.hpp"
+
 namespace SFTRS {
     namespace DarkTaskDialog
     {
@@ -106,15 +104,16 @@ namespace SFTRS {
                 RECT rect;
                 int width;
                 int height;
+                uint32_t* bits = nullptr; // Top-down premultiplied BGRA
                 MemoryBitmapAndDC(LPCRECT pRect)
                 {
                     width = pRect->right - pRect->left;
                     height = pRect->bottom - pRect->top;
                     rect = { 0,0,width,height };
                     DC = CreateCompatibleDC(NULL);
-                    HDC dcScreen = GetDC(NULL);
-                    hBitmap = CreateCompatibleBitmap(dcScreen, width, height);
-                    ReleaseDC(NULL, dcScreen);
+                    // A DIB section, so that we can access the pixels directly
+                    BITMAPINFO bmi = { { sizeof(BITMAPINFOHEADER), width, -height, 1, 32, BI_RGB } };
+                    hBitmap = CreateDIBSection(DC, &bmi, DIB_RGB_COLORS, (void**)&bits, NULL, 0);
                     hBmpOld = (HBITMAP)SelectObject(DC, hBitmap);
                 }
                 ~MemoryBitmapAndDC()
@@ -129,56 +128,60 @@ namespace SFTRS {
 
             };
 
-            std::unique_ptr<Gdiplus::Bitmap> GdiBitmapFromHBITMAPwithAlpha(HBITMAP source, int width, int height)
+            void AdjustBrightness(MemoryBitmapAndDC& canvas, float f)
             {
-                auto bitmap = std::make_unique<Gdiplus::Bitmap>(width, height, PixelFormat32bppARGB);
-
-                Gdiplus::BitmapData target_info;
-                Gdiplus::Rect rect(0, 0, width, height);
-
-                Gdiplus::Status result = bitmap->LockBits(&rect, Gdiplus::ImageLockModeWrite, PixelFormat32bppARGB, &target_info);
-                if (result != Gdiplus::Ok || target_info.Stride != width * 4)
-                    return NULL;
-
-                GetBitmapBits(source, width * 4 * height, target_info.Scan0);
-
-                bitmap->UnlockBits(&target_info);
-
-                return bitmap;
+                if (canvas.bits == nullptr)
+                    return;
+                GdiFlush();
+                nvPixels::AdjustBrightness(canvas.bits, (size_t)canvas.width * canvas.height, f);
             }
 
-            void AdjustBrightness(HDC hdc, LPCRECT rect, HBITMAP bitmap = NULL, float f = -0.78)
+            // When the DC has a 32-bit DIB section selected, which is what buffered painting uses,
+            // adjust its pixels in place. Since this bypasses GDI, we only do so when clipping and
+            // coordinate mapping are simple enough for us to apply them ourselves.
+            bool AdjustBrightnessInPlace(HDC hdc, LPCRECT rect, float f)
             {
-                std::unique_ptr<Gdiplus::Bitmap> bmp;
-                if (!bitmap)
+                DIBSECTION dib;
+                HGDIOBJ bitmap = GetCurrentObject(hdc, OBJ_BITMAP);
+                if (bitmap == NULL || GetObject(bitmap, sizeof(dib), &dib) != sizeof(dib) || dib.dsBm.bmBits == NULL ||
+                    dib.dsBm.bmBitsPixel != 32 || GetMapMode(hdc) != MM_TEXT || GetGraphicsMode(hdc) != GM_COMPATIBLE)
+                    return false;
+
+                RECT clip, r;
+                switch (GetClipBox(hdc, &clip))
                 {
-                    MemoryBitmapAndDC canvas(rect);
-                    AlphaBlend(canvas.DC, 0, 0, canvas.width, canvas.height, hdc, rect->left, rect->top, canvas.width, canvas.height, blend_f);
-                    bmp = GdiBitmapFromHBITMAPwithAlpha(canvas.hBitmap, canvas.width, canvas.height);
+                    case NULLREGION:
+                        return true;
+                    case SIMPLEREGION:
+                        break;
+                    default:
+                        return false;
                 }
-                else
-                    bmp = GdiBitmapFromHBITMAPwithAlpha(bitmap, rect->right, rect->bottom);
-
-                Gdiplus::Graphics graphics(hdc);
-                Gdiplus::Rect gdiRect(rect->left, rect->top, rect->right - rect->left, rect->bottom - rect->top);
-
-                Gdiplus::SolidBrush clearBrush(Gdiplus::Color::Transparent);
-                graphics.SetCompositingMode(Gdiplus::CompositingModeSourceCopy);
-                graphics.FillRectangle(&clearBrush, gdiRect);
-                graphics.SetCompositingMode(Gdiplus::CompositingModeSourceOver);
-
-                Gdiplus::ColorMatrix colorMatrix =
+                if (!IntersectRect(&r, rect, &clip))
+                    return true;
+                LPtoDP(hdc, (LPPOINT)&r, 2);
+                RECT bounds = { 0, 0, dib.dsBm.bmWidth, dib.dsBm.bmHeight };
+                if (!IntersectRect(&r, &r, &bounds))
+                    return true;
+
+                GdiFlush();
+                bool bottom_up = (dib.dsBmih.biHeight > 0);
+                for (LONG y = r.top; y < r.bottom; y++)
                 {
-                    1, 0, 0, 0, 0,
-                    0, 1, 0, 0, 0,
-                    0, 0, 1, 0, 0,
-                    0, 0, 0, 1, 0,
-                    f, f, f, 0, 1
-                };
-                Gdiplus::ImageAttributes imageAttr;
-                imageAttr.SetColorMatrix(&colorMatrix, Gdiplus::ColorMatrixFlagsDefault, Gdiplus::ColorAdjustTypeBitmap);
-                graphics.DrawImage(bmp.get(), gdiRect, 0, 0, gdiRect.Width, gdiRect.Height, Gdiplus::UnitPixel, &imageAttr);
+                    uint8_t* row = (uint8_t*)dib.dsBm.bmBits + (size_t)(bottom_up ? dib.dsBm.bmHeight - 1 - y : y) * dib.dsBm.bmWidthBytes;
+                    nvPixels::AdjustBrightness((uint32_t*)row + r.left, r.right - r.left, f);
+                }
+                return true;
+            }
 
+            void AdjustBrightness(HDC hdc, LPCRECT rect, float f = -0.78f)
+            {
+                if (AdjustBrightnessInPlace(hdc, rect, f))
+                    return;
+                MemoryBitmapAndDC canvas(rect);
+                BitBlt(canvas.DC, 0, 0, canvas.width, canvas.height, hdc, rect->left, rect->top, SRCCOPY);
+                AdjustBrightness(canvas, f);
+                BitBlt(hdc, rect->left, rect->top, canvas.width, canvas.height, canvas.DC, 0, 0, SRCCOPY);
             }
 
 
@@ -299,7 +302,7 @@ namespace SFTRS {
                 {
                     MemoryBitmapAndDC canvas(pRect);
                     result = trueDrawThemeBackground(hTheme, canvas.DC, iPartId, iStateId, &canvas.rect, NULL);
-                    AdjustBrightness(canvas.DC, &canvas.rect, canvas.hBitmap, iPartId == BP_COMMANDLINK ? 1.0f : 0.35f);
+                    AdjustBrightness(canvas, iPartId == BP_COMMANDLINK ? 1.0f : 0.35f);
                     AlphaBlend(hdc, pRect->left, pRect->top, canvas.width, canvas.height, canvas.DC, 0, 0, canvas.width, canvas.height, blend_f);
                     return result;
                 }
@@ -308,7 +311,7 @@ namespace SFTRS {
 
                 if (painting && iPartId == PP_FILL) // Progress bar color fill.
                 {
-                    AdjustBrightness(hdc, pRect, NULL, -0.2f);
+                    AdjustBrightness(hdc, pRect, -0.2f);
                 }
                 if (painting && iPartId == PP_TRANSPARENTBAR) // Progress bar background.
                 {
@@ -484,13 +487,6 @@ namespace SFTRS {
                 }
                 DetourTransactionCommit();
 
-                static ULONG_PTR gdiplusToken;
-                static Gdiplus::GdiplusStartupInput gdiplusStartupInput;
-                if (mustBeSet)
-                    GdiplusStartup(&gdiplusToken, &gdiplusStartupInput, NULL);
-                else
-                    Gdiplus::GdiplusShutdown(gdiplusToken);
-
                 isSetNow = mustBeSet;
             }
 
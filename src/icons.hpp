@@ -0,0 +1,630 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Geometry of the tray icons, generated by tools/gen_icons.py from icons/*.svg, so edit
+// these (and rerun the script) rather than this file. Coordinates are in viewBox units.
+
+#pragma once
+
+#include <stdint.h>
+
+#define ICON_VIEWBOX_X              2.0f
+#define ICON_VIEWBOX_Y              2.0f
+#define ICON_VIEWBOX_SIZE           20.0f
+// The border shade is proportional to the level, and this is its value at 100%
+#define ICON_BORDER_MAX_SHADE       0xf0
+#define ICON_BACKGROUND_COLOR       0x000000
+#define ICON_DIGIT_COLOR            0x74ba43
+#define ICON_DIGIT_Y                6.0f
+
+// Shapes
+enum {
+	isBorder = 0,
+	isBackground,
+	isDigit0,
+	isMax = isDigit0 + 10
+};
+
+// Digit layouts
+enum {
+	ilNormal = 0,               // Two digits
+	ilTeens,                    // Two digits, starting with a narrow 1
+	ilHundreds,                 // Three digits
+	ilMax
+};
+
+typedef struct {
+	uint16_t first;
+	uint16_t count;
+} icon_range_t;
+
+// Where the digits go, from left to right
+static constexpr float icon_digit_x[ilMax][3] = {
+	{ 4.37f, 11.37f },
+	{ 5.0f, 10.7f },
+	{ 3.0f, 6.7f, 12.7f },
+};
+
+// The contours of each shape
+static constexpr icon_range_t icon_shapes[isMax] = {
+	{ 0, 1 },
+	{ 1, 1 },
+	{ 2, 2 },
+	{ 4, 1 },
+	{ 5, 1 },
+	{ 6, 1 },
+	{ 7, 2 },
+	{ 9, 1 },
+	{ 10, 2 },
+	{ 12, 1 },
+	{ 13, 3 },
+	{ 16, 2 },
+};
+
+// The points of each contour
+static constexpr icon_range_t icon_contours[] = {
+	{ 0, 25 },
+	{ 25, 25 },
+	{ 50, 13 },
+	{ 63, 13 },
+	{ 76, 31 },
+	{ 107, 64 },
+	{ 171, 55 },
+	{ 226, 49 },
+	{ 275, 16 },
+	{ 291, 58 },
+	{ 349, 28 },
+	{ 377, 13 },
+	{ 390, 43 },
+	{ 433, 25 },
+	{ 458, 13 },
+	{ 471, 13 },
+	{ 484, 28 },
+	{ 512, 13 },
+};
+
+// Each contour is a start point, followed by the 2 control points and the end point of each
+// of its cubic Bézier segments
+static constexpr float icon_points[][2] = {
+	{ 5.1559f, 2.1595f },
+	{ 9.7255f, 2.1595f },
+	{ 14.2951f, 2.1595f },
+	{ 18.8647f, 2.1595f },
+	{ 20.5303f, 2.1595f },
+	{ 21.8806f, 3.5082f },
+	{ 21.8806f, 5.1718f },
+	{ 21.8806f, 9.736f },
+	{ 21.8806f, 14.3002f },
+	{ 21.8806f, 18.8643f },
+	{ 21.8806f, 20.528f },
+	{ 20.5303f, 21.8767f },
+	{ 18.8647f, 21.8767f },
+	{ 14.2951f, 21.8767f },
+	{ 9.7255f, 21.8767f },
+	{ 5.1559f, 21.8767f },
+	{ 3.4903f, 21.8767f },
+	{ 2.14f, 20.528f },
+	{ 2.14f, 18.8643f },
+	{ 2.14f, 14.3002f },
+	{ 2.14f, 9.736f },
+	{ 2.14f, 5.1718f },
+	{ 2.14f, 3.5082f },
+	{ 3.4903f, 2.1595f },
+	{ 5.1559f, 2.1595f },
+	{ 5.1559f, 3.8026f },
+	{ 4.3988f, 3.8026f },
+	{ 3.7851f, 4.4156f },
+	{ 3.7851f, 5.1718f },
+	{ 3.7851f, 9.736f },
+	{ 3.7851f, 14.3002f },
+	{ 3.7851f, 18.8643f },
+	{ 3.7851f, 19.6206f },
+	{ 4.3988f, 20.2336f },
+	{ 5.1559f, 20.2336f },
+	{ 9.7255f, 20.2336f },
+	{ 14.2951f, 20.2336f },
+	{ 18.8647f, 20.2336f },
+	{ 19.6218f, 20.2336f },
+	{ 20.2356f, 19.6206f },
+	{ 20.2356f, 18.8643f },
+	{ 20.2356f, 14.3002f },
+	{ 20.2356f, 9.736f },
+	{ 20.2356f, 5.1718f },
+	{ 20.2356f, 4.4156f },
+	{ 19.6218f, 3.8026f },
+	{ 18.8647f, 3.8026f },
+	{ 14.2951f, 3.8026f },
+	{ 9.7255f, 3.8026f },
+	{ 5.1559f, 3.8026f },
+	{ 4.0f, 11.0f },
+	{ 1.0f, 11.0f },
+	{ 1.0f, 7.4962f },
+	{ 1.0f, 6.0f },
+	{ 1.0f, 4.5038f },
+	{ 1.0f, 1.0f },
+	{ 4.0f, 1.0f },
+	{ 7.0f, 1.0f },
+	{ 7.0f, 4.5038f },
+	{ 7.0f, 6.0f },
+	{ 7.0f, 7.4962f },
+	{ 7.0f, 11.0f },
+	{ 4.0f, 11.0f },
+	{ 4.0f, 2.4834f },
+	{ 3.295f, 2.4834f },
+	{ 2.5429f, 2.7552f },
+	{ 2.5429f, 6.0f },
+	{ 2.5429f, 9.2448f },
+	{ 3.295f, 9.5166f },
+	{ 4.0f, 9.5166f },
+	{ 4.705f, 9.5166f },
+	{ 5.4571f, 9.2448f },
+	{ 5.4571f, 6.0f },
+	{ 5.4571f, 2.7552f },
+	{ 4.705f, 2.4834f },
+	{ 4.0f, 2.4834f },
+	{ 3.0f, 10.6022f },
+	{ 3.0f, 8.2564f },
+	{ 3.0f, 5.9107f },
+	{ 3.0f, 3.5649f },
+	{ 2.7359f, 3.8264f },
+	{ 2.4718f, 4.088f },
+	{ 2.2077f, 4.3495f },
+	{ 2.1115f, 4.4447f },
+	{ 1.9775f, 4.4938f },
+	{ 1.8428f, 4.4802f },
+	{ 1.0333f, 4.3982f },
+	{ 0.8448f, 3.588f },
+	{ 1.2723f, 3.1648f },
+	{ 1.9223f, 2.5211f },
+	{ 2.5723f, 1.8775f },
+	{ 3.2223f, 1.2338f },
+	{ 3.5591f, 0.9006f },
+	{ 4.1578f, 0.9351f },
+	{ 4.4437f, 1.4487f },
+	{ 4.4815f, 1.5166f },
+	{ 4.5f, 1.594f },
+	{ 4.5f, 1.6717f },
+	{ 4.5f, 4.5922f },
+	{ 4.5f, 7.5128f },
+	{ 4.5f, 10.4333f },
+	{ 4.5f, 11.0348f },
+	{ 3.7918f, 11.471f },
+	{ 3.1639f, 10.9535f },
+	{ 3.0594f, 10.8674f },
+	{ 3.0f, 10.7376f },
+	{ 3.0f, 10.6022f },
+	{ 6.1713f, 11.0f },
+	{ 4.7037f, 11.0f },
+	{ 3.236f, 11.0f },
+	{ 1.7684f, 11.0f },
+	{ 1.7328f, 11.0f },
+	{ 1.6969f, 10.9978f },
+	{ 1.6622f, 10.9903f },
+	{ 1.2792f, 10.9076f },
+	{ 1.047f, 10.5881f },
+	{ 1.0535f, 10.2484f },
+	{ 1.0589f, 9.9576f },
+	{ 1.0644f, 9.6668f },
+	{ 1.0698f, 9.376f },
+	{ 1.0821f, 8.7184f },
+	{ 1.3669f, 8.0812f },
+	{ 1.8511f, 7.6277f },
+	{ 2.9698f, 6.5802f },
+	{ 4.0884f, 5.5326f },
+	{ 5.2071f, 4.4851f },
+	{ 5.3292f, 4.3117f },
+	{ 5.4469f, 4.0968f },
+	{ 5.4469f, 3.7739f },
+	{ 5.4469f, 3.0582f },
+	{ 4.8036f, 2.476f },
+	{ 4.0129f, 2.476f },
+	{ 3.2404f, 2.476f },
+	{ 2.6111f, 3.0226f },
+	{ 2.5801f, 3.7203f },
+	{ 2.562f, 4.1275f },
+	{ 2.2134f, 4.4436f },
+	{ 1.7981f, 4.4253f },
+	{ 1.3843f, 4.4076f },
+	{ 1.0635f, 4.063f },
+	{ 1.0816f, 3.6558f },
+	{ 1.1477f, 2.1666f },
+	{ 2.4353f, 1.0f },
+	{ 4.0129f, 1.0f },
+	{ 5.6307f, 1.0f },
+	{ 6.9469f, 2.2444f },
+	{ 6.9469f, 3.7739f },
+	{ 6.9469f, 4.566f },
+	{ 6.6113f, 5.0982f },
+	{ 6.3681f, 5.4249f },
+	{ 6.3502f, 5.4489f },
+	{ 6.3311f, 5.47f },
+	{ 6.3092f, 5.4906f },
+	{ 5.9983f, 5.7817f },
+	{ 3.532f, 8.0913f },
+	{ 2.7887f, 8.7873f },
+	{ 2.6534f, 8.914f },
+	{ 2.5755f, 9.0886f },
+	{ 2.572f, 9.2723f },
+	{ 2.5704f, 9.3562f },
+	{ 2.5689f, 9.4402f },
+	{ 2.5673f, 9.5241f },
+	{ 3.8117f, 9.5241f },
+	{ 5.056f, 9.5241f },
+	{ 6.3004f, 9.5241f },
+	{ 6.4725f, 9.5241f },
+	{ 6.6349f, 9.6051f },
+	{ 6.7362f, 9.742f },
+	{ 7.1822f, 10.345f },
+	{ 6.7544f, 11.0f },
+	{ 6.1713f, 11.0f },
+	{ 4.0092f, 11.0f },
+	{ 1.9878f, 11.0f },
+	{ 1.2f, 9.5957f },
+	{ 1.1367f, 8.2814f },
+	{ 1.1171f, 7.8751f },
+	{ 1.4368f, 7.5301f },
+	{ 1.8505f, 7.5109f },
+	{ 2.265f, 7.4937f },
+	{ 2.6155f, 7.8056f },
+	{ 2.6351f, 8.2119f },
+	{ 2.6983f, 9.5269f },
+	{ 3.685f, 9.5269f },
+	{ 4.0093f, 9.5269f },
+	{ 4.9228f, 9.5269f },
+	{ 5.3861f, 9.0499f },
+	{ 5.3861f, 8.1091f },
+	{ 5.3861f, 7.4015f },
+	{ 4.8437f, 6.8834f },
+	{ 3.9352f, 6.7233f },
+	{ 3.5779f, 6.6603f },
+	{ 3.3178f, 6.3549f },
+	{ 3.3178f, 5.9983f },
+	{ 3.3178f, 5.6417f },
+	{ 3.5779f, 5.3363f },
+	{ 3.9353f, 5.2733f },
+	{ 4.898f, 5.1036f },
+	{ 5.3862f, 4.6374f },
+	{ 5.3862f, 3.8875f },
+	{ 5.3862f, 2.9467f },
+	{ 4.9229f, 2.4697f },
+	{ 4.0094f, 2.4697f },
+	{ 3.6852f, 2.4697f },
+	{ 2.6984f, 2.4697f },
+	{ 2.6352f, 3.7847f },
+	{ 2.6156f, 4.191f },
+	{ 2.2661f, 4.5036f },
+	{ 1.8506f, 4.4857f },
+	{ 1.4369f, 4.4665f },
+	{ 1.1173f, 4.1215f },
+	{ 1.1368f, 3.7152f },
+	{ 1.2f, 2.401f },
+	{ 1.9878f, 0.9967f },
+	{ 4.0092f, 0.9967f },
+	{ 6.1326f, 0.9967f },
+	{ 6.886f, 2.554f },
+	{ 6.886f, 3.8876f },
+	{ 6.886f, 4.7686f },
+	{ 6.5299f, 5.5008f },
+	{ 5.8865f, 6.0117f },
+	{ 6.5204f, 6.5307f },
+	{ 6.886f, 7.2641f },
+	{ 6.886f, 8.1092f },
+	{ 6.8861f, 9.4427f },
+	{ 6.1326f, 11.0f },
+	{ 4.0092f, 11.0f },
+	{ 5.844f, 11.1609f },
+	{ 5.3878f, 11.2164f },
+	{ 5.0f, 10.8617f },
+	{ 5.0f, 10.4166f },
+	{ 5.0f, 9.9444f },
+	{ 5.0f, 9.4722f },
+	{ 5.0f, 9.0f },
+	{ 3.95f, 9.0f },
+	{ 2.9f, 9.0f },
+	{ 1.85f, 9.0f },
+	{ 1.4366f, 9.0f },
+	{ 1.1012f, 8.6655f },
+	{ 1.1f, 8.2521f },
+	{ 1.0992f, 7.9748f },
+	{ 1.0985f, 7.6976f },
+	{ 1.0977f, 7.4203f },
+	{ 1.0956f, 6.7384f },
+	{ 1.3293f, 6.0696f },
+	{ 1.7558f, 5.5371f },
+	{ 2.8916f, 4.1186f },
+	{ 4.0275f, 2.7f },
+	{ 5.1633f, 1.2815f },
+	{ 5.3979f, 0.9883f },
+	{ 5.8208f, 0.9076f },
+	{ 6.1547f, 1.1181f },
+	{ 6.3767f, 1.2581f },
+	{ 6.5001f, 1.5125f },
+	{ 6.5001f, 1.775f },
+	{ 6.5001f, 3.6833f },
+	{ 6.5f, 5.5917f },
+	{ 6.5f, 7.5f },
+	{ 6.6016f, 7.5f },
+	{ 6.7032f, 7.5f },
+	{ 6.8048f, 7.5f },
+	{ 7.1882f, 7.5f },
+	{ 7.5313f, 7.7754f },
+	{ 7.5776f, 8.156f },
+	{ 7.6331f, 8.6122f },
+	{ 7.2784f, 9.0f },
+	{ 6.8333f, 9.0f },
+	{ 6.7222f, 9.0f },
+	{ 6.6111f, 9.0f },
+	{ 6.5f, 9.0f },
+	{ 6.5f, 9.4627f },
+	{ 6.5f, 9.9255f },
+	{ 6.5f, 10.3882f },
+	{ 6.5f, 10.7716f },
+	{ 6.2246f, 11.1147f },
+	{ 5.844f, 11.1609f },
+	{ 2.6002f, 7.5f },
+	{ 3.4001f, 7.5f },
+	{ 4.2001f, 7.5f },
+	{ 5.0f, 7.5f },
+	{ 5.0f, 6.296f },
+	{ 5.0f, 5.0921f },
+	{ 5.0f, 3.8881f },
+	{ 4.3099f, 4.7499f },
+	{ 3.6197f, 5.6118f },
+	{ 2.9296f, 6.4736f },
+	{ 2.7154f, 6.741f },
+	{ 2.5991f, 7.0737f },
+	{ 2.6f, 7.4163f },
+	{ 2.6001f, 7.4442f },
+	{ 2.6001f, 7.4721f },
+	{ 2.6002f, 7.5f },
+	{ 4.0496f, 11.0f },
+	{ 3.3203f, 11.0f },
+	{ 2.5911f, 11.0f },
+	{ 1.8618f, 11.0f },
+	{ 1.4784f, 11.0f },
+	{ 1.1353f, 10.7246f },
+	{ 1.089f, 10.344f },
+	{ 1.0336f, 9.8879f },
+	{ 1.3882f, 9.5f },
+	{ 1.8333f, 9.5f },
+	{ 2.5722f, 9.5f },
+	{ 3.3111f, 9.5f },
+	{ 4.05f, 9.5f },
+	{ 4.3919f, 9.5f },
+	{ 5.4325f, 9.6f },
+	{ 5.4325f, 8.15f },
+	{ 5.4325f, 6.7f },
+	{ 4.3919f, 6.7f },
+	{ 4.05f, 6.7f },
+	{ 3.3159f, 6.7f },
+	{ 2.5818f, 6.7f },
+	{ 1.8477f, 6.7f },
+	{ 1.7397f, 6.7f },
+	{ 1.631f, 6.6828f },
+	{ 1.5326f, 6.6382f },
+	{ 1.2184f, 6.4959f },
+	{ 1.0533f, 6.1775f },
+	{ 1.0927f, 5.8618f },
+	{ 1.2722f, 4.4589f },
+	{ 1.4517f, 3.0561f },
+	{ 1.6312f, 1.6532f },
+	{ 1.6779f, 1.28f },
+	{ 1.9951f, 1.0f },
+	{ 2.3712f, 1.0f },
+	{ 3.6268f, 1.0f },
+	{ 4.8825f, 1.0f },
+	{ 6.1381f, 1.0f },
+	{ 6.5215f, 1.0f },
+	{ 6.8646f, 1.2754f },
+	{ 6.9109f, 1.656f },
+	{ 6.9664f, 2.1122f },
+	{ 6.6117f, 2.5f },
+	{ 6.1666f, 2.5f },
+	{ 5.1227f, 2.5f },
+	{ 4.0789f, 2.5f },
+	{ 3.035f, 2.5f },
+	{ 2.9183f, 3.4f },
+	{ 2.8017f, 4.3f },
+	{ 2.685f, 5.2f },
+	{ 3.1399f, 5.2f },
+	{ 3.5947f, 5.2f },
+	{ 4.0496f, 5.2f },
+	{ 6.1778f, 5.2f },
+	{ 6.9329f, 6.7892f },
+	{ 6.9329f, 8.15f },
+	{ 6.9329f, 9.5108f },
+	{ 6.1778f, 11.0f },
+	{ 4.0496f, 11.0f },
+	{ 4.0f, 11.0f },
+	{ 1.7857f, 11.0f },
+	{ 1.0f, 9.2596f },
+	{ 1.0f, 7.7692f },
+	{ 1.0f, 6.9853f },
+	{ 1.0f, 6.2015f },
+	{ 1.0f, 5.4176f },
+	{ 1.0f, 2.4863f },
+	{ 2.6082f, 1.0f },
+	{ 5.7799f, 1.0f },
+	{ 6.2057f, 1.0f },
+	{ 6.5509f, 1.3321f },
+	{ 6.5509f, 1.7417f },
+	{ 6.5509f, 2.1513f },
+	{ 6.2057f, 2.4834f },
+	{ 5.7799f, 2.4834f },
+	{ 3.2928f, 2.4834f },
+	{ 2.6797f, 3.5606f },
+	{ 2.5647f, 4.8495f },
+	{ 2.956f, 4.6533f },
+	{ 3.4309f, 4.5383f },
+	{ 4.0f, 4.5383f },
+	{ 6.2142f, 4.5383f },
+	{ 7.0f, 6.2788f },
+	{ 7.0f, 7.7692f },
+	{ 7.0f, 9.2596f },
+	{ 6.2143f, 11.0f },
+	{ 4.0f, 11.0f },
+	{ 4.0f, 6.0215f },
+	{ 2.7949f, 6.0215f },
+	{ 2.5419f, 6.9718f },
+	{ 2.5419f, 7.7691f },
+	{ 2.5419f, 8.5663f },
+	{ 2.7949f, 9.5166f },
+	{ 4.0f, 9.5166f },
+	{ 5.2051f, 9.5166f },
+	{ 5.458f, 8.5663f },
+	{ 5.458f, 7.7691f },
+	{ 5.4581f, 6.9719f },
+	{ 5.2051f, 6.0215f },
+	{ 4.0f, 6.0215f },
+	{ 2.8685f, 11.0f },
+	{ 2.7572f, 11.0f },
+	{ 2.6441f, 10.9771f },
+	{ 2.5367f, 10.9285f },
+	{ 2.1503f, 10.7537f },
+	{ 1.9858f, 10.3137f },
+	{ 2.1693f, 9.9456f },
+	{ 3.1965f, 7.8855f },
+	{ 4.2236f, 5.8255f },
+	{ 5.2508f, 3.7654f },
+	{ 5.3811f, 3.5007f },
+	{ 5.4508f, 3.2025f },
+	{ 5.4508f, 2.9064f },
+	{ 5.4508f, 2.7627f },
+	{ 5.4508f, 2.6191f },
+	{ 5.4508f, 2.4754f },
+	{ 4.2254f, 2.4754f },
+	{ 3.0f, 2.4754f },
+	{ 1.7746f, 2.4754f },
+	{ 1.3469f, 2.4754f },
+	{ 1.0f, 2.1451f },
+	{ 1.0f, 1.7377f },
+	{ 1.0f, 1.3303f },
+	{ 1.3468f, 1.0f },
+	{ 1.7746f, 1.0f },
+	{ 3.2582f, 1.0f },
+	{ 4.7419f, 1.0f },
+	{ 6.2255f, 1.0f },
+	{ 6.6532f, 1.0f },
+	{ 7.0f, 1.3303f },
+	{ 7.0f, 1.7377f },
+	{ 7.0f, 2.1273f },
+	{ 7.0f, 2.5168f },
+	{ 7.0f, 2.9064f },
+	{ 7.0f, 3.4175f },
+	{ 6.8797f, 3.9322f },
+	{ 6.6519f, 4.395f },
+	{ 5.6242f, 6.4562f },
+	{ 4.5964f, 8.5174f },
+	{ 3.5687f, 10.5786f },
+	{ 3.4362f, 10.8445f },
+	{ 3.1582f, 11.0f },
+	{ 2.8685f, 11.0f },
+	{ 3.9692f, 11.0f },
+	{ 1.7776f, 11.0f },
+	{ 1.0f, 9.4381f },
+	{ 1.0f, 8.1007f },
+	{ 1.0f, 7.3556f },
+	{ 1.2466f, 6.54f },
+	{ 1.8532f, 5.9696f },
+	{ 1.2466f, 5.3991f },
+	{ 1.0f, 4.5835f },
+	{ 1.0f, 3.8384f },
+	{ 1.0f, 2.529f },
+	{ 1.7776f, 1.0f },
+	{ 3.9692f, 1.0f },
+	{ 6.0628f, 1.0f },
+	{ 7.0f, 2.4256f },
+	{ 7.0f, 3.8384f },
+	{ 7.0f, 4.6262f },
+	{ 6.7147f, 5.418f },
+	{ 6.1074f, 5.9695f },
+	{ 6.7147f, 6.5211f },
+	{ 7.0f, 7.3129f },
+	{ 7.0f, 8.1007f },
+	{ 7.0f, 9.5438f },
+	{ 6.0628f, 11.0f },
+	{ 3.9692f, 11.0f },
+	{ 3.9692f, 6.7072f },
+	{ 3.0228f, 6.7072f },
+	{ 2.5429f, 7.176f },
+	{ 2.5429f, 8.1006f },
+	{ 2.5429f, 9.0454f },
+	{ 3.0228f, 9.5245f },
+	{ 3.9692f, 9.5245f },
+	{ 5.2638f, 9.5245f },
+	{ 5.4571f, 8.6324f },
+	{ 5.4571f, 8.1006f },
+	{ 5.4571f, 7.5802f },
+	{ 5.2638f, 6.7072f },
+	{ 3.9692f, 6.7072f },
+	{ 3.9692f, 2.4754f },
+	{ 3.6164f, 2.4754f },
+	{ 2.5429f, 2.4754f },
+	{ 2.5429f, 3.8384f },
+	{ 2.5429f, 4.763f },
+	{ 3.0228f, 5.2318f },
+	{ 3.9692f, 5.2318f },
+	{ 5.2638f, 5.2318f },
+	{ 5.4571f, 4.3588f },
+	{ 5.4571f, 3.8384f },
+	{ 5.4571f, 3.2166f },
+	{ 5.199f, 2.4754f },
+	{ 3.9692f, 2.4754f },
+	{ 4.0f, 1.0f },
+	{ 6.2143f, 1.0f },
+	{ 7.0f, 2.7404f },
+	{ 7.0f, 4.2308f },
+	{ 7.0f, 5.0146f },
+	{ 7.0f, 5.7985f },
+	{ 7.0f, 6.5823f },
+	{ 7.0f, 9.5137f },
+	{ 5.3918f, 11.0f },
+	{ 2.2201f, 11.0f },
+	{ 1.7943f, 11.0f },
+	{ 1.4491f, 10.6679f },
+	{ 1.4491f, 10.2583f },
+	{ 1.4491f, 9.8487f },
+	{ 1.7943f, 9.5166f },
+	{ 2.2201f, 9.5166f },
+	{ 4.7072f, 9.5166f },
+	{ 5.3203f, 8.4394f },
+	{ 5.4353f, 7.1505f },
+	{ 5.044f, 7.3468f },
+	{ 4.5691f, 7.4618f },
+	{ 4.0f, 7.4618f },
+	{ 1.7858f, 7.4618f },
+	{ 1.0f, 5.7213f },
+	{ 1.0f, 4.2309f },
+	{ 1.0f, 2.7405f },
+	{ 1.7857f, 1.0f },
+	{ 4.0f, 1.0f },
+	{ 4.0f, 5.9785f },
+	{ 5.2051f, 5.9785f },
+	{ 5.4581f, 5.0282f },
+	{ 5.4581f, 4.2309f },
+	{ 5.4581f, 3.4337f },
+	{ 5.2051f, 2.4834f },
+	{ 4.0f, 2.4834f },
+	{ 2.7949f, 2.4834f },
+	{ 2.542f, 3.4337f },
+	{ 2.542f, 4.2309f },
+	{ 2.5419f, 5.0281f },
+	{ 2.7949f, 5.9785f },
+	{ 4.0f, 5.9785f },
+};
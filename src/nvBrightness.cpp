@@ -31,6 +31,7 @@
 #include <stdarg.h>
 #include <string.h>
 #include <stdlib.h>
+#include <math.h>
 #include <shlobj.h>
 #include <commctrl.h>
 #include <initguid.h>
@@ -42,8 +43,9 @@
 #include <string>
 #include <list>
 #include <format>
-#include <fstream>
 #include <chrono>
+#include <future>
+#include <atomic>
 
 using namespace std;
 
@@ -56,6 +58,19 @@ using namespace std;
 #include "nvMonitor.hpp"
 #include "nvDisplay.hpp"
 #include "nvList.hpp"
+#include "nvCache.hpp"
+#include "nvPool.hpp"
+#include "nvTiming.hpp"
+#include "nvStorage.hpp"
+#include "nvLogger.hpp"
+#include "nvEventLog.hpp"
+#include "nvLogFile.hpp"
+#include "nvCoalescer.hpp"
+#include "nvWorker.hpp"
+#include "nvIpc.hpp"
+#include "nvScheduler.hpp"
+#include "nvMenu.hpp"
+#include "nvIcons.hpp"
 
 #pragma comment(lib, "comctl32.lib")
 #pragma comment(lib, "powrprof.lib")
@@ -64,10 +79,29 @@ using namespace std;
 
 #define RESTORE_INPUT_TID       2000
 #define RESTORE_GAMMA_TID       2001
+#define UPDATE_BACKLIGHT_TID    2002
+#define FLUSH_SETTINGS_TID      2003
+#define COALESCE_HOTKEYS_TID    2004
+#define SCHEDULER_TID           2005
+
+// How long we may wait before checking the schedule, in ms, so that changes to the system
+// clock or time zone get picked up on the next check
+#define SCHEDULER_MAX_DELAY     (15 * 60 * 1000)
+
+// Processing a message for longer than this (in ms) makes the UI visibly unresponsive
+#define UI_STALL_THRESHOLD      16
+
+// What a set of IPC requests changed, for the UI thread to act upon
+#define IPC_CHANGED_BRIGHTNESS  0x01
+#define IPC_CHANGED_HYBRID      0x02
+#define IPC_CHANGED_INPUT       0x04
 #define RESTORE_INPUT_DELAY     5000
 #define RESTORE_GAMMA_DELAY     3000
 #define RESTORE_INPUT_RETRIES   8
 
+// How long each input restore attempt may spend verifying switches, for all the displays, in ms
+#define RESTORE_INPUT_VERIFY_TIME   3000
+
 // Structs
 typedef struct {
 	void* data;
@@ -83,52 +117,92 @@ typedef struct {
 	bool autostart;
 	bool use_alternate_keys;
 	bool log_to_file;
+	bool binary_log;
+	bool hybrid_brightness;
+	bool synchronous_io;
+	bool enable_ipc;
 	uint8_t last_input;
+	uint32_t log_max_size;
+	uint32_t log_generations;
 	float increment;
 	const wchar_t* active_device_id;
 } settings_t;
 
+typedef struct {
+	uint64_t calls;
+	uint64_t total_us;
+	uint32_t max_us;
+	uint32_t max_hotkey;        // The hotkey that took the longest to process
+	uint32_t stalls;            // Hotkeys that took longer than UI_STALL_THRESHOLD to process
+} stall_stats_t;
+
+typedef struct {
+	vector<ipc_request_t>* requests;
+	promise<void> done;
+} ipc_context_t;
+
 // Globals
 GLOBAL_NVAPI_INSTANCE;
 GLOBAL_TRAY_INSTANCE;
 wchar_t *APPLICATION_NAME = NULL, *COMPANY_NAME = NULL;	// Needed for registry.h
 
 static version_t version = { 0 };
-static settings_t settings = { true, false, false, false, 0, 0.5f, L"" };
-static ofstream log_file;
-static vector<struct tray_menu> submenu;
+static settings_t settings = { true, false, false, false, false, false, false, false, 0,
+	LOGFILE_DEFAULT_MAX_SIZE / 1024, LOGFILE_DEFAULT_GENERATIONS, 0.5f, L"" };
+static nvLogFile log_file;
+// The loggers must outlive anything that may log from another thread
+static nvLogger app_logger;
+nvEventLog event_log;
+// Never empty, so that the input controls can point to it before it is filled
+static vector<struct tray_menu> submenu = { { .text = NULL } };
+static nvMenu menu_model;
 static int submenu_index = 0, num_restore_attempts = 1;
 static struct tray tray = { 0 };
+static nvIcons tray_icons;
+// The probe pool must outlive the displays, whose probes it may still be running
+nvPool probe_pool;
+static nvRegistryStorage registry_storage;
+nvStorage* storage = &registry_storage;
+nvTiming switch_timing;
 static nvList displays;
+static nvCoalescer hotkey_coalescer;
+// The hardware worker uses the displays, so it must be destroyed first
+static nvWorker hw_worker;
+// The IPC server hands requests over to the hardware worker, so it must be destroyed first
+static nvIpc ipc_server;
+static nvScheduler scheduler;
+// Set when we may have missed some scheduled changes, such as after a suspend
+static atomic<bool> scheduler_resync = true;
+static int pending_display_updates = 0;
+static stall_stats_t stall_stats = { 0 };
+nvCache caps_cache;
 static wchar_t app_data_dir[MAX_PATH] = L"";
-// The following string buffers are modified to display the input names
-static wchar_t home_input[64] = L"Home input\t［⊞］［Shift］［Home］";
-static wchar_t next_input[64] = L"Next input\t［⊞］［Shift］［PgUp］";
-static wchar_t prev_input[64] = L"Prev input\t［⊞］［Shift］［PgDn］";
-static wchar_t wake_input[64] = L"Resume to Home";
-static mutex log_mutex;
-
-// Logging
+
+// Logging. Messages are only queued here, and written by the logger thread through one of the
+// sinks below, so that logging from the hotkey handlers or the probes doesn't wait on file I/O.
 void logger(const char* fmt, ...)
 {
-	static bool last_message_had_linebreak = true;
-	static char log_msg[512];
-
-	log_mutex.lock();
 	va_list argp;
 	va_start(argp, fmt);
-	vsnprintf_s(log_msg, sizeof(log_msg), _TRUNCATE, fmt, argp);
+	app_logger.Log(fmt, argp);
 	va_end(argp);
-	if (settings.log_to_file) {
-		if (last_message_had_linebreak)
-			log_file << format("{:%Y-%m-%d %X}", chrono::current_zone()->to_local(chrono::system_clock::now())) << ": ";
-		if (strlen(log_msg) >= 1)
-			last_message_had_linebreak = (log_msg[strlen(log_msg) - 1] == '\n');
-		log_file << log_msg;
-		log_file.flush();
-	} else
-		OutputDebugStringA(log_msg);
-	log_mutex.unlock();
+}
+
+static void LogToDebugger(chrono::system_clock::time_point time, const char* msg, size_t size, bool line_start)
+{
+	OutputDebugStringA(msg);
+}
+
+static void LogToFile(chrono::system_clock::time_point time, const char* msg, size_t size, bool line_start)
+{
+	static const auto zone = chrono::current_zone();
+
+	// Only let the log rotate at the start of a line, so that a message isn't split between files
+	if (line_start) {
+		string timestamp = format("{:%Y-%m-%d %X}: ", zone->to_local(time));
+		log_file.Write(timestamp.data(), timestamp.size(), true);
+	}
+	log_file.Write(msg, size, false);
 }
 
 // Helper functions
@@ -141,16 +215,40 @@ static bool IsDarkModeEnabled(void)
 	return false;
 }
 
+// The notification area uses small icons, at the DPI of the taskbar
+static void UpdateIconSize(void)
+{
+	HWND taskbar = FindWindow(L"Shell_TrayWnd", NULL);
+	UINT dpi = (taskbar != NULL) ? GetDpiForWindow(taskbar) : 0;
+	if (dpi == 0)
+		dpi = GetDpiForSystem();
+	if (tray_icons.SetSize(GetSystemMetricsForDpi(SM_CXSMICON, dpi)))
+		logger("Tray icon size: %ux%u (%u DPI), rendered in %.2f ms\n", tray_icons.GetSize(), tray_icons.GetSize(),
+			dpi, tray_icons.GetStats().atlas_us / 1000.0f);
+}
+
+static HICON GetIconForLevel(float level)
+{
+	return tray_icons.GetIcon(level);
+}
+
 static HICON GetCurrentIcon(nvDisplay* display)
 {
-	int icon_index = 20;
-	if (display != nullptr)
-		icon_index = (int)(display->GetBrightness() - 80.0f);
-	if (icon_index < 0)
-		icon_index = 0;
-	if (icon_index > 20)
-		icon_index = 20;
-	return LoadIcon(GetModuleHandle(NULL), MAKEINTRESOURCE(IDI_ICON_00 + icon_index));
+	return GetIconForLevel((display != nullptr) ? display->GetLevel() : 100.0f);
+}
+
+// Changing the icon doesn't require the menu to be recreated
+static void SetTrayIcon(HICON icon)
+{
+	tray.icon = icon;
+	tray_update_icon(&tray);
+}
+
+static void PostCommand(uint32_t command, nvDisplay* display = nullptr, float delta = 0.0f,
+	uint8_t input = 0, bool verify = false, void* context = nullptr)
+{
+	hw_worker.Post({ .command = command, .display = display, .delta = delta, .input = input,
+		.verify = verify, .context = context });
 }
 
 static void UnRegisterHotKeys(void)
@@ -187,6 +285,44 @@ static bool RegisterHotKeys(void)
 	return b;
 }
 
+// Runs on the UI thread. Scheduled changes are ignored while we are paused.
+static void ApplyScheduledLevel(const wstring& device_id, float level)
+{
+	nvDisplay* display = nullptr;
+
+	if (!settings.enabled)
+		return;
+	if (device_id != L"*") {
+		display = displays.GetDisplay(device_id.c_str());
+		if (display == nullptr) {
+			logger("Schedule: Display %S is not connected\n", device_id.c_str());
+			return;
+		}
+	}
+	logger("Schedule: Setting %S to %.1f%%\n", (display == nullptr) ? L"all displays" : display->GetDisplayName(), level);
+	hw_worker.Post({ .command = wcSetLevel, .display = display, .level = level });
+}
+
+// The schedule is driven from a single timer, which we set to the next rule that is due
+static void CALLBACK SchedulerCallback(HWND hWnd, UINT uMsg, UINT_PTR idEvent, DWORD dwTime)
+{
+	time_t now = time(NULL), next;
+	uint32_t delay = SCHEDULER_MAX_DELAY;
+
+	if (scheduler_resync.exchange(false))
+		scheduler.Resync(now, ApplyScheduledLevel);
+	else
+		scheduler.Advance(now, ApplyScheduledLevel);
+	next = scheduler.GetNextTime();
+	if (next == 0) {
+		KillTimer(hWnd, SCHEDULER_TID);
+		return;
+	}
+	if (next - now < SCHEDULER_MAX_DELAY / 1000)
+		delay = (uint32_t)max<time_t>(next - now, 0) * 1000;
+	SetTimer(hWnd, SCHEDULER_TID, delay, SchedulerCallback);
+}
+
 // Task dialogs and message boxes that do respect the user Dark Mode settings
 static __inline HRESULT ProperTaskDialogIndirect(const TASKDIALOGCONFIG* pTaskConfig, int* pnButton,
 	int* pnRadioButton, BOOL* pfVerificationFlagChecked)
@@ -270,27 +406,47 @@ static void AlternateKeysCallback(struct tray_menu* item)
 {
 	settings.use_alternate_keys = !settings.use_alternate_keys;
 	RegisterHotKeys();
-	item->checked = !item->checked;
-	WriteRegistryKey32(HKEY_CURRENT_USER, L"UseAlternateKeys", item->checked);
+	menu_model.SetChecked(item, settings.use_alternate_keys);
+	storage->Write32(L"UseAlternateKeys", item->checked);
 	if (settings.use_alternate_keys) {
-		tray.menu[0].text = L"Brightness +\t［Internet Fwd］ or ［Alt］［→］";
-		tray.menu[1].text = L"Brightness −\t［Internet Back］ or ［Alt］［←］";
+		menu_model.SetText(&tray.menu[0], L"Brightness +\t［Internet Fwd］ or ［Alt］［→］");
+		menu_model.SetText(&tray.menu[1], L"Brightness −\t［Internet Back］ or ［Alt］［←］");
 	} else {
-		tray.menu[0].text = L"Brightness +\t［⊞］［Shift］［Num +］";
-		tray.menu[1].text = L"Brightness −\t［⊞］［Shift］［Num −］";
+		menu_model.SetText(&tray.menu[0], L"Brightness +\t［⊞］［Shift］［Num +］");
+		menu_model.SetText(&tray.menu[1], L"Brightness −\t［⊞］［Shift］［Num −］");
 	}
-	tray_update(&tray);
+	menu_model.Commit();
+}
+
+static void HybridBrightnessCallback(struct tray_menu* item)
+{
+	settings.hybrid_brightness = !settings.hybrid_brightness;
+	nvDisplay::EnableHybrid(settings.hybrid_brightness);
+	menu_model.SetChecked(item, settings.hybrid_brightness);
+	storage->Write32(L"HybridBrightness", item->checked);
+	menu_model.Commit();
+	// Switch the displays now, rather than on the next brightness change, so that the backlight
+	// doesn't stay dimmed after hybrid mode is turned off
+	nvDisplay* display;
+	for (auto i = 0; (display = displays.GetDisplay(i)) != nullptr; i++)
+		PostCommand(wcChangeBrightness, display, 0.0f);
 }
 
 static void PauseCallback(struct tray_menu* item)
 {
 	settings.enabled = !settings.enabled;
-	item->checked = !item->checked;
-	if (settings.enabled)
+	menu_model.SetChecked(item, !settings.enabled);
+	if (settings.enabled) {
 		RegisterHotKeys();
-	else
+		// Apply the levels we missed while paused
+		if (scheduler.GetStats().rules != 0) {
+			scheduler_resync = true;
+			SetTimer(hwnd, SCHEDULER_TID, 0, SchedulerCallback);
+		}
+	} else {
 		UnRegisterHotKeys();
-	tray_update(&tray);
+	}
+	menu_model.Commit();
 }
 
 static void PowerOffCallback(struct tray_menu* item)
@@ -313,22 +469,18 @@ static void ResumeToLastInputCallback(struct tray_menu* item)
 		if (display != nullptr)
 			settings.last_input = display->GetHomeInput();
 	}
-	item->checked = (settings.last_input != 0);
-	WriteRegistryKey32(HKEY_CURRENT_USER, L"LastInput", settings.last_input);
-	tray_update(&tray);
+	menu_model.SetChecked(item, settings.last_input != 0);
+	storage->Write32(L"LastInput", settings.last_input);
+	menu_model.Commit();
 }
 
 static void ActiveDisplayCallback(struct tray_menu* item)
 {
-	uint32_t i;
 	wchar_t* selected_device_id = (wchar_t*)item->context;
 
 	if (item->checked)
 		return;
 
-	for (i = 1; i < submenu.size() - 5; i++)
-		submenu[i].checked = false;
-
 	auto display = displays.GetDisplay(selected_device_id);
 	if (display == nullptr) {
 		logger("ERROR: No active display!\n");
@@ -336,10 +488,9 @@ static void ActiveDisplayCallback(struct tray_menu* item)
 	}
 
 	settings.active_device_id = display->GetDeviceId();
-	WriteRegistryKeyStr(HKEY_CURRENT_USER, L"ActiveDisplay", settings.active_device_id);
+	storage->WriteStr(L"ActiveDisplay", settings.active_device_id);
 	logger("Active display: %S\n", display->GetDisplayName());
-	tray.icon = GetCurrentIcon(display);
-	item->checked = true;
+	SetTrayIcon(GetCurrentIcon(display));
 	tray_simulate_hottkey(hkUpdateSubmenu);
 }
 
@@ -348,7 +499,7 @@ static void AutoStartCallback(struct tray_menu* item)
 	wchar_t key_name[128], exe_path[MAX_PATH + 2] = { 0 };
 
 	settings.autostart = !settings.autostart;
-	item->checked = !item->checked;
+	menu_model.SetChecked(item, settings.autostart);
 	_snwprintf_s(key_name, ARRAYSIZE(key_name), _TRUNCATE,
 		L"Software\\Microsoft\\Windows\\CurrentVersion\\Run\\%s", version.ProductName);
 	GetModuleFileName(NULL, &exe_path[1], MAX_PATH);
@@ -360,7 +511,7 @@ static void AutoStartCallback(struct tray_menu* item)
 		WriteRegistryKeyStr(HKEY_CURRENT_USER, key_name, exe_path);
 	else
 		DeleteRegistryValue(HKEY_CURRENT_USER, key_name);
-	tray_update(&tray);
+	menu_model.Commit();
 }
 
 static void IncreaseBrightnessCallback(struct tray_menu* item)
@@ -393,31 +544,40 @@ static void ExitCallback(struct tray_menu* item)
 	tray_exit();
 }
 
-static void CreateSubmenu()
+// A menu label, with the name of an input
+static wstring InputLabel(const wchar_t* fmt, uint8_t input)
 {
-	nvDisplay *d, *display;
+	wchar_t label[64];
+	_snwprintf_s(label, ARRAYSIZE(label), _TRUNCATE, fmt, nvDisplay::InputToString(input));
+	return label;
+}
 
-	submenu.clear();
+// Bring the menu in line with the displays and the inputs of the active one. Only the items
+// that changed get updated, and the input names come from what we already know, since reading
+// them could block the UI thread for a while.
+static void UpdateMenu()
+{
+	nvDisplay *d, *display;
+	vector<menu_item_t> items;
+	uint8_t home, next, prev;
 
 	// Try to reselect the display, or reset to first active
 	display = displays.GetDisplayWithFallback(settings.active_device_id);
 	if (display == nullptr) {
 		logger("ERROR: No active displays!\n");
-		submenu.push_back({ .text = NULL });
-		if (tray.menu != NULL && submenu_index != 0) {
-			tray.menu[submenu_index].disabled = true;
-			tray.menu[submenu_index + 1].disabled = true;
-		}
+		menu_model.SetSubmenu(&tray.menu[submenu_index], submenu, items);
+		menu_model.SetDisabled(&tray.menu[submenu_index], true);
+		menu_model.SetDisabled(&tray.menu[submenu_index + 1], true);
+		menu_model.Commit();
 		return;
 	}
 
 	// Set the active device
 	settings.active_device_id = display->GetDeviceId();
 
-	// Create the menu data
-	submenu.push_back({ .text = L"Active display:\t［⊞］［Shift］［,］ / ［.］" });
+	items.push_back({ .text = L"Active display:\t［⊞］［Shift］［,］ / ［.］" });
 	for (size_t i = 0; (d = displays.GetDisplay(i)) != nullptr; i++) {
-		submenu.push_back({
+		items.push_back({
 			.text = d->GetDisplayName(),
 			.checked = (d->GetDeviceId() == settings.active_device_id),
 			.cb = ActiveDisplayCallback,
@@ -425,61 +585,435 @@ static void CreateSubmenu()
 		});
 	}
 
-	// Update the menu entries to add/remove the input names
-	if (display->GetHomeInput() == 0) {
-		_snwprintf_s(home_input, ARRAYSIZE(home_input), _TRUNCATE, L"Home input\t［⊞］［Shift］［Home］");
-		_snwprintf_s(wake_input, ARRAYSIZE(wake_input), _TRUNCATE, L"Resume to Home");
-	} else {
-		_snwprintf_s(home_input, ARRAYSIZE(home_input), _TRUNCATE,
-			L"Home input  (%hs)\t［⊞］［Shift］［Home］", nvDisplay::InputToString(display->GetHomeInput()));
-		_snwprintf_s(wake_input, ARRAYSIZE(wake_input), _TRUNCATE,
-			L"Resume to Home (%hs)", nvDisplay::InputToString(display->GetHomeInput()));
-	}
-	if (display->GetNumberOfInputs() <= 1) {
-		_snwprintf_s(next_input, ARRAYSIZE(next_input), _TRUNCATE, L"Next input\t［⊞］［Shift］［PgUp］");
-		_snwprintf_s(prev_input, ARRAYSIZE(prev_input), _TRUNCATE, L"Prev input\t［⊞］［Shift］［PgDn］");
-	} else {
-		_snwprintf_s(next_input, ARRAYSIZE(next_input), _TRUNCATE,
-			L"Next input    (%hs)\t［⊞］［Shift］［PgUp］", nvDisplay::InputToString(display->GetNextInput()));
-		_snwprintf_s(prev_input, ARRAYSIZE(prev_input), _TRUNCATE,
-			L"Prev input    (%hs)\t［⊞］［Shift］［PgDn］", nvDisplay::InputToString(display->GetPrevInput()));
+	// Add the input names, when we know them
+	home = display->GetHomeInput();
+	next = (display->GetNumberOfInputs() <= 1) ? 0 : display->GetNextInput();
+	prev = (display->GetNumberOfInputs() <= 1) ? 0 : display->GetPrevInput();
+	items.push_back({ .text = L"-" });
+	items.push_back({ .text = (home == 0) ? L"Home input\t［⊞］［Shift］［Home］" :
+		InputLabel(L"Home input  (%hs)\t［⊞］［Shift］［Home］", home),
+		.disabled = (home == 0), .cb = HomeInputCallback });
+	items.push_back({ .text = (next == 0) ? L"Next input\t［⊞］［Shift］［PgUp］" :
+		InputLabel(L"Next input    (%hs)\t［⊞］［Shift］［PgUp］", next),
+		.disabled = (display->GetNumberOfInputs() <= 1), .cb = NextInputCallback });
+	items.push_back({ .text = (prev == 0) ? L"Prev input\t［⊞］［Shift］［PgDn］" :
+		InputLabel(L"Prev input    (%hs)\t［⊞］［Shift］［PgDn］", prev),
+		.disabled = (display->GetNumberOfInputs() <= 1), .cb = PreviousInputCallback });
+	menu_model.SetSubmenu(&tray.menu[submenu_index], submenu, items);
+
+	// Make sure the submenu is enabled, along with resume to home
+	menu_model.SetDisabled(&tray.menu[submenu_index], false);
+	menu_model.SetText(&tray.menu[submenu_index + 1], (home == 0) ? L"Resume to Home" :
+		InputLabel(L"Resume to Home (%hs)", home));
+	menu_model.SetDisabled(&tray.menu[submenu_index + 1], home == 0);
+	menu_model.Commit();
+}
+
+// Hardware I/O, such as DDC/CI or gamma ramp updates, can take a long time, so the UI thread
+// only posts commands to the hardware worker, and gets their results through hkWorkerDone.
+static size_t GetDisplayIndex(nvDisplay* display)
+{
+	nvDisplay* d;
+	size_t i;
+	for (i = 0; (d = displays.GetDisplay(i)) != nullptr && d != display; i++);
+	return i;
+}
+
+// Let IPC clients that subscribed know about the changes
+static void NotifyBrightness(nvDisplay* display)
+{
+	ipc_server.Notify(format("brightness {} {:.1f}", GetDisplayIndex(display), display->GetLevel()));
+}
+
+static void NotifyInput(nvDisplay* display, uint8_t input)
+{
+	ipc_server.Notify(format("input {} {}", GetDisplayIndex(display), nvDisplay::InputToString(input)));
+}
+
+// An IPC display is either an index or "active"
+static nvDisplay* GetIpcDisplay(const string& arg)
+{
+	char* end;
+
+	if (arg == "active")
+		return displays.GetDisplay(settings.active_device_id);
+	size_t index = strtoul(arg.c_str(), &end, 10);
+	return (arg.empty() || *end != 0) ? nullptr : displays.GetDisplay(index);
+}
+
+// An IPC input is either a name, such as HDMI1, a VCP code, or home, next or prev
+static bool GetIpcInput(const string& arg, uint8_t* input)
+{
+	char* end;
+
+	if (arg == "home" || arg == "next" || arg == "prev") {
+		*input = (arg == "home") ? VCP_INPUT_HOME : ((arg == "next") ? VCP_INPUT_NEXT : VCP_INPUT_PREVIOUS);
+		return true;
+	}
+	unsigned long code = strtoul(arg.c_str(), &end, 0);
+	if (!arg.empty() && *end == 0 && code != 0 && code < VCP_INPUT_PREVIOUS) {
+		*input = (uint8_t)code;
+		return true;
+	}
+	for (code = 1; code < VCP_INPUT_PREVIOUS; code++) {
+		if (_stricmp(nvDisplay::InputToString((uint8_t)code), arg.c_str()) == 0 &&
+			strcmp(nvDisplay::InputToString((uint8_t)code), "????") != 0) {
+			*input = (uint8_t)code;
+			return true;
+		}
 	}
+	return false;
+}
+
+// Runs on the hardware worker thread, so that the requests are applied together, without any
+// other command getting in between. Returns what changed.
+static uint32_t RunIpcRequests(vector<ipc_request_t>& requests)
+{
+	uint32_t changed = 0;
+	nvDisplay* display;
+	char line[256];
+	float level;
+	uint8_t input;
+	char* end;
+
+	for (auto& request : requests) {
+		auto& args = request.args;
+		if (args[0] == "list") {
+			size_t i;
+			string list;
+			for (i = 0; (display = displays.GetDisplay(i)) != nullptr; i++) {
+				input = display->GetMonitorInput();
+				_snprintf_s(line, sizeof(line), _TRUNCATE, "\ndisplay %zu %.1f %s %S", i, display->GetLevel(),
+					(input == 0) ? "none" : nvDisplay::InputToString(input), display->GetDisplayName());
+				list += line;
+			}
+			request.reply = format("ok {}", i) + list;
+			continue;
+		}
+		if (args[0] != "get" && args[0] != "set" && args[0] != "input") {
+			request.reply = "error unknown request";
+			continue;
+		}
+		if (args.size() != ((args[0] == "get") ? 2 : 3)) {
+			request.reply = "error wrong number of arguments";
+			continue;
+		}
+		display = GetIpcDisplay(args[1]);
+		if (display == nullptr) {
+			request.reply = "error no such display";
+			continue;
+		}
+		if (args[0] == "get") {
+			request.reply = format("ok {:.1f}", display->GetLevel());
+		} else if (args[0] == "set") {
+			level = strtof(args[2].c_str(), &end);
+			if (*end != 0 || !isfinite(level)) {
+				request.reply = "error invalid level";
+				continue;
+			}
+			display->SetLevel(level);
+			display->UpdateGamma();
+			display->SaveColorSettings();
+			changed |= IPC_CHANGED_BRIGHTNESS | (display->IsHybrid() ? IPC_CHANGED_HYBRID : 0);
+			NotifyBrightness(display);
+			request.reply = format("ok {:.1f}", display->GetLevel());
+		} else if (!GetIpcInput(args[2], &input)) {
+			request.reply = "error invalid input";
+		} else if (!display->SupportsVCP()) {
+			request.reply = "error display does not support input switching";
+		} else {
+			input = display->SetMonitorInput(input);
+			if (input == 0) {
+				request.reply = "error input switch failed";
+				continue;
+			}
+			NotifyInput(display, input);
+			changed |= IPC_CHANGED_INPUT;
+			request.reply = format("ok {}", nvDisplay::InputToString(input));
+		}
+	}
+	return changed;
+}
+
+// Runs on the IPC connection threads
+static void HandleIpcRequests(vector<ipc_request_t>& requests)
+{
+	ipc_context_t context = { &requests };
+	auto done = context.done.get_future();
 
-	submenu.push_back({ .text = L"-" });
-	submenu.push_back({ .text = home_input, .disabled = (display->GetHomeInput() == 0), .cb = HomeInputCallback });
-	submenu.push_back({ .text = next_input, .disabled = (display->GetNumberOfInputs() <= 1), .cb = NextInputCallback });
-	submenu.push_back({ .text = prev_input, .disabled = (display->GetNumberOfInputs() <= 1), .cb = PreviousInputCallback });
-	submenu.push_back({ .text = NULL });
+	PostCommand(wcIpcRequests, nullptr, 0.0f, 0, false, &context);
+	done.wait();
+}
 
-	// Update the submenu and make sure it is enabled along resume to home
-	if (tray.menu != NULL && submenu_index != 0) {
-		tray.menu[submenu_index].submenu = submenu.data();
-		tray.menu[submenu_index].disabled = false;
-		tray.menu[submenu_index + 1].disabled = (display->GetHomeInput() == 0);
+// Runs on the hardware worker thread
+static void RunCommand(worker_command_t& cmd)
+{
+	ipc_context_t* context;
+	nvDisplay* display;
+	uint32_t delay;
+	chrono::steady_clock::time_point deadline;
+
+	switch (cmd.command) {
+	case wcChangeBrightness:
+		cmd.display->ChangeBrightness(cmd.delta);
+		cmd.display->UpdateGamma();
+		cmd.display->SaveColorSettings();
+		cmd.level = cmd.display->GetLevel();
+		cmd.result = cmd.display->IsHybrid() ? 1 : 0;
+		NotifyBrightness(cmd.display);
+		break;
+	case wcUpdateBacklight:
+		// Push pending hybrid backlight changes to the monitors, without writing to DDC more often
+		// than they can take it (the gamma ramp compensates in the meantime). The result is how long
+		// to wait before we can write the backlight of the displays that still need it.
+		cmd.result = 0;
+		for (auto i = 0; (display = displays.GetDisplay(i)) != nullptr; i++) {
+			delay = display->UpdateBacklight();
+			if (delay == 0 && display->IsHybrid())
+				display->SaveColorSettings();
+			else if (delay != 0 && (cmd.result == 0 || delay < cmd.result))
+				cmd.result = delay;
+		}
+		break;
+	case wcFlushSettings:
+		for (auto i = 0; (display = displays.GetDisplay(i)) != nullptr; i++)
+			display->FlushColorSettings();
+		break;
+	case wcRestoreGamma:
+		for (auto i = 0; (display = displays.GetDisplay(i)) != nullptr; i++) {
+			display->UpdateLuids();
+			display->UpdateGamma();
+		}
+		break;
+	case wcSetInput:
+		cmd.result = cmd.display->SetMonitorInput(cmd.input, cmd.verify);
+		if (cmd.result != 0)
+			NotifyInput(cmd.display, (uint8_t)cmd.result);
+		break;
+	case wcRestoreInput:
+		// Each switch is verified, so we are done as soon as every monitor has confirmed its home input.
+		// Monitors that confirmed on a previous attempt are left alone, and we only spend so much time
+		// verifying per attempt, so that a monitor that is slow to wake up doesn't hold the worker.
+		cmd.result = 1;
+		deadline = chrono::steady_clock::now() + chrono::milliseconds(RESTORE_INPUT_VERIFY_TIME);
+		for (auto i = 0; (display = displays.GetDisplay(i)) != nullptr; i++) {
+			if (display->GetHomeInput() == 0 || display->GetConfirmedInput() == display->GetHomeInput())
+				continue;
+			auto now = chrono::steady_clock::now();
+			if (now >= deadline || display->SetMonitorInput(VCP_INPUT_HOME, true,
+				(uint32_t)chrono::duration_cast<chrono::milliseconds>(deadline - now).count()) == 0)
+				cmd.result = 0;
+		}
+		break;
+	case wcUpdateDisplays:
+		// Don't lose pending changes for a display that might be going away
+		for (auto i = 0; (display = displays.GetDisplay(i)) != nullptr; i++)
+			display->FlushColorSettings();
+		cmd.result = displays.Update() ? 1 : 0;
+		ipc_server.Notify(format("displays {}", GetDisplayIndex(nullptr)));
+		break;
+	case wcSetLevel:
+		cmd.result = 0;
+		for (auto i = 0; (display = displays.GetDisplay(i)) != nullptr; i++) {
+			if (cmd.display != nullptr && display != cmd.display)
+				continue;
+			display->SetLevel(cmd.level);
+			display->UpdateGamma();
+			display->SaveColorSettings();
+			cmd.result |= display->IsHybrid() ? 1 : 0;
+			NotifyBrightness(display);
+		}
+		break;
+	case wcRestoreBacklight:
+		for (auto i = 0; (display = displays.GetDisplay(i)) != nullptr; i++)
+			display->RestoreBacklight();
+		break;
+	case wcIpcRequests:
+		context = (ipc_context_t*)cmd.context;
+		cmd.result = RunIpcRequests(*context->requests);
+		// The requester may be gone as soon as it has been signaled
+		cmd.context = nullptr;
+		context->done.set_value();
+		break;
+	default:
+		break;
 	}
 }
 
 static void CALLBACK RestoreGammaCallback(HWND hWnd, UINT uMsg, UINT_PTR idEvent, DWORD dwTime)
 {
-	nvDisplay* display;
 	KillTimer(hWnd, RESTORE_GAMMA_TID);
-	for (auto i = 0; (display = displays.GetDisplay(i)) != nullptr; i++) {
-		display->UpdateLuids();
-		display->UpdateGamma();
+	PostCommand(wcRestoreGamma);
+}
+
+static void FlushColorSettings(void)
+{
+	KillTimer(hwnd, FLUSH_SETTINGS_TID);
+	PostCommand(wcFlushSettings);
+}
+
+static void CALLBACK FlushSettingsCallback(HWND hWnd, UINT uMsg, UINT_PTR idEvent, DWORD dwTime)
+{
+	FlushColorSettings();
+}
+
+// Color settings are only written once the user has stopped changing the brightness for a
+// while, since resetting the timer on each call is all we need to coalesce the writes.
+static void ScheduleFlush(void)
+{
+	SetTimer(hwnd, FLUSH_SETTINGS_TID, FLUSH_SETTINGS_DELAY, FlushSettingsCallback);
+}
+
+static void CALLBACK UpdateBacklightCallback(HWND hWnd, UINT uMsg, UINT_PTR idEvent, DWORD dwTime)
+{
+	KillTimer(hWnd, UPDATE_BACKLIGHT_TID);
+	PostCommand(wcUpdateBacklight);
+}
+
+static void CALLBACK RestoreInputCallback(HWND hWnd, UINT uMsg, UINT_PTR idEvent, DWORD dwTime)
+{
+	KillTimer(hWnd, RESTORE_INPUT_TID);
+	PostCommand(wcRestoreInput);
+}
+
+// Apply the brightness changes that have accumulated since the last frame
+static void ApplyBrightnessChanges(void)
+{
+	nvDisplay* display;
+
+	for (auto& [device_id, delta] : hotkey_coalescer.Take()) {
+		display = displays.GetDisplay(device_id.c_str());
+		if (display != nullptr)
+			PostCommand(wcChangeBrightness, display, delta);
 	}
 }
 
-// Callback for keyboard hotkeys
-static bool HotkeyCallback(WPARAM wparam, LPARAM lparam)
+static void CALLBACK CoalesceHotkeysCallback(HWND hWnd, UINT uMsg, UINT_PTR idEvent, DWORD dwTime)
+{
+	auto now = chrono::steady_clock::now();
+	uint32_t delay, events_per_sec, applies_per_sec;
+
+	if (hotkey_coalescer.HasPending())
+		ApplyBrightnessChanges();
+	if (hotkey_coalescer.GetRates(now, &events_per_sec, &applies_per_sec))
+		logger("Hotkeys: %u event(s)/s, %u update(s)/s\n", events_per_sec, applies_per_sec);
+	delay = hotkey_coalescer.GetNextDelay(now);
+	if (delay == 0)
+		KillTimer(hWnd, COALESCE_HOTKEYS_TID);
+	else
+		SetTimer(hWnd, COALESCE_HOTKEYS_TID, delay, CoalesceHotkeysCallback);
+}
+
+// Process the results of the commands that the hardware worker has completed
+static void ProcessCompletedCommands(void)
+{
+	worker_command_t cmd;
+	nvDisplay* display;
+
+	while (hw_worker.GetCompleted(&cmd)) {
+		switch (cmd.command) {
+		case wcChangeBrightness:
+			ScheduleFlush();
+			if (cmd.result != 0)
+				SetTimer(hwnd, UPDATE_BACKLIGHT_TID, 0, UpdateBacklightCallback);
+			if (cmd.display->GetDeviceId() == settings.active_device_id) {
+				SetTrayIcon(GetIconForLevel(cmd.level));
+			}
+			break;
+		case wcSetLevel:
+			ScheduleFlush();
+			if (cmd.result != 0)
+				SetTimer(hwnd, UPDATE_BACKLIGHT_TID, 0, UpdateBacklightCallback);
+			SetTrayIcon(GetCurrentIcon(displays.GetDisplay(settings.active_device_id)));
+			break;
+		case wcIpcRequests:
+			if (cmd.result & IPC_CHANGED_BRIGHTNESS) {
+				ScheduleFlush();
+				SetTrayIcon(GetCurrentIcon(displays.GetDisplay(settings.active_device_id)));
+			}
+			if (cmd.result & IPC_CHANGED_HYBRID)
+				SetTimer(hwnd, UPDATE_BACKLIGHT_TID, 0, UpdateBacklightCallback);
+			if (cmd.result & IPC_CHANGED_INPUT)
+				UpdateMenu();
+			break;
+		case wcUpdateBacklight:
+			ScheduleFlush();
+			if (cmd.result != 0)
+				SetTimer(hwnd, UPDATE_BACKLIGHT_TID, cmd.result, UpdateBacklightCallback);
+			break;
+		case wcSetInput:
+			// The next and previous inputs have changed
+			if (cmd.result != 0)
+				UpdateMenu();
+			if (cmd.input != VCP_INPUT_NEXT && cmd.input != VCP_INPUT_PREVIOUS)
+				break;
+			if (cmd.result != 0)
+				logger("Display %S switched to input: %s\n", cmd.display->GetDisplayName(), nvDisplay::InputToString((uint8_t)cmd.result));
+			else
+				logger("Display %S failed to switch inputs\n", cmd.display->GetDisplayName());
+			break;
+		case wcRestoreInput:
+			if (cmd.result != 0) {
+				logger("Restored monitor input after %d attempts\n", num_restore_attempts);
+				UpdateMenu();
+			} else if (num_restore_attempts++ > RESTORE_INPUT_RETRIES)
+				logger("Failed to restore monitor input\n");
+			else
+				SetTimer(hwnd, RESTORE_INPUT_TID, RESTORE_INPUT_DELAY, RestoreInputCallback);
+			break;
+		case wcUpdateDisplays:
+			// Wait for the last update if there were more display changes in the meantime. Changes
+			// that came while this update was still queued were folded into it.
+			pending_display_updates -= 1 + (int)cmd.merged;
+			if (pending_display_updates != 0)
+				break;
+			display = displays.GetDisplay(settings.active_device_id);
+			if (display != nullptr)
+				display->SetProbePriority(POOL_PRIORITY_HIGH);
+			UpdateMenu();
+			// The nVidia driver is crap when it comes to re-applying color settings on display update
+			// because it can apply them before the display is fully ready, especially if a display uses
+			// HDR or Dolby-Vision. This can result in the display jumping to 100% brightness if you
+			// happen to turn your eARC amp on or off. We compensate for that by re-applying gammma
+			// after a sensible delay.
+			SetTimer(hwnd, RESTORE_GAMMA_TID, RESTORE_GAMMA_DELAY, RestoreGammaCallback);
+			// The taskbar may have moved to a display with a different DPI
+			UpdateIconSize();
+			SetTrayIcon(GetCurrentIcon(displays.GetDisplay(settings.active_device_id)));
+			if (settings.enabled)
+				RegisterHotKeys();
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+static bool HandleHotkey(WPARAM wparam, LPARAM lparam)
 {
-	bool is_enabled;
 	float delta = 0.0f;
-	uint8_t input = 0;
 	nvDisplay* display;
 
+	// Completions must be picked up even when we are paused
+	if (wparam == hkWorkerDone) {
+		ProcessCompletedCommands();
+		return true;
+	}
+
+	// Posted by the power callback on resume
+	if (wparam == hkSchedulerResync) {
+		if (scheduler.GetStats().rules != 0)
+			SetTimer(hwnd, SCHEDULER_TID, RESTORE_INPUT_DELAY, SchedulerCallback);
+		return true;
+	}
+
 	if (!settings.enabled)
 		return false;
 
+	// Until the display list has been updated, the only thing we process are other display changes
+	if (pending_display_updates != 0 && wparam != WM_DEVICECHANGE)
+		return false;
+
 	switch (wparam) {
 	case hkDecreaseBrightness:
 	case hkDecreaseBrightnessAlt:
@@ -490,11 +1024,11 @@ static bool HotkeyCallback(WPARAM wparam, LPARAM lparam)
 		display = displays.GetDisplay(settings.active_device_id);
 		if (display != nullptr) {
 			delta += settings.increment;
-			display->ChangeBrightness(delta);
-			display->UpdateGamma();
-			display->SaveColorSettings();
-			tray.icon = GetCurrentIcon(display);
-			tray_update(&tray);
+			// These hotkeys auto-repeat, so we just accumulate the changes and apply them at most
+			// once per frame. If we haven't applied anything for a frame, we apply them right away.
+			hotkey_coalescer.Add(display->GetDeviceId(), delta);
+			if (hotkey_coalescer.IsFrameDue())
+				CoalesceHotkeysCallback(hwnd, WM_TIMER, COALESCE_HOTKEYS_TID, 0);
 		}
 		break;
 	case hkPowerOffMonitor:
@@ -503,18 +1037,14 @@ static bool HotkeyCallback(WPARAM wparam, LPARAM lparam)
 	case hkHomeInput:
 		display = displays.GetDisplay(settings.active_device_id);
 		if (display != nullptr)
-			display->SetMonitorInput(VCP_INPUT_HOME);
+			PostCommand(wcSetInput, display, 0.0f, VCP_INPUT_HOME);
 		break;
 	case hkNextInput:
 	case hkPreviousInput:
 		display = displays.GetDisplay(settings.active_device_id);
-		if (display != nullptr && display->SupportsVCP()) {
-			input = display->SetMonitorInput((wparam == hkNextInput) ? VCP_INPUT_NEXT : VCP_INPUT_PREVIOUS);
-			if (input != 0)
-				logger("Display %S switched to input: %s\n", display->GetDisplayName(), nvDisplay::InputToString(input));
-			else
-				logger("Display %S failed to switch inputs\n", display->GetDisplayName());
-		} else
+		if (display != nullptr && display->SupportsVCP())
+			PostCommand(wcSetInput, display, 0.0f, (wparam == hkNextInput) ? VCP_INPUT_NEXT : VCP_INPUT_PREVIOUS);
+		else
 			logger("Display %S does not support input switching\n", display->GetDisplayName());
 		break;
 	case hkNextMonitor:
@@ -523,32 +1053,23 @@ static bool HotkeyCallback(WPARAM wparam, LPARAM lparam)
 			displays.GetPrevDisplay(settings.active_device_id);
 		if (display != nullptr) {
 			settings.active_device_id = display->GetDeviceId();
-			WriteRegistryKeyStr(HKEY_CURRENT_USER, L"ActiveDisplay", settings.active_device_id);
+			storage->WriteStr(L"ActiveDisplay", settings.active_device_id);
 			logger("Active display: %S\n", display->GetDisplayName());
-			tray.icon = GetCurrentIcon(display);
+			display->SetProbePriority(POOL_PRIORITY_HIGH);
+			SetTrayIcon(GetCurrentIcon(display));
 		}
 		[[fallthrough]];
 	case hkUpdateSubmenu:
-		CreateSubmenu();
-		tray_update(&tray);
+		UpdateMenu();
 		break;
 	case WM_DEVICECHANGE:	// Converted WM_ message
-		is_enabled = settings.enabled;
-		settings.enabled = false;
 		logger("Display configuration has changed: Updating display list.\n");
-		UnRegisterHotKeys();
-		displays.Update();
-		CreateSubmenu();
-		// The nVidia driver is crap when it comes to re-applying color settings on display update
-		// because it can apply them before the display is fully ready, especially if a display uses
-		// HDR or Dolby-Vision. This can result in the display jumping to 100% brightness if you
-		// happen to turn your eARC amp on or off. We compensate for that by re-applying gammma
-		// after a sensible delay.
-		SetTimer(hwnd, RESTORE_GAMMA_TID, RESTORE_GAMMA_DELAY, RestoreGammaCallback);
-		tray.icon = GetCurrentIcon(displays.GetDisplay(settings.active_device_id));
-		tray_update(&tray);
-		RegisterHotKeys();
-		settings.enabled = is_enabled;
+		if (pending_display_updates++ == 0)
+			UnRegisterHotKeys();
+		// Don't lose pending changes for a display that might be going away
+		ApplyBrightnessChanges();
+		KillTimer(hwnd, FLUSH_SETTINGS_TID);
+		PostCommand(wcUpdateDisplays);
 		break;
 	default:
 		logger("Unhandled Hot Key 0x%08x!\n", wparam);
@@ -558,28 +1079,40 @@ static bool HotkeyCallback(WPARAM wparam, LPARAM lparam)
 	return true;
 }
 
-static void CALLBACK RestoreInputCallback(HWND hWnd, UINT uMsg, UINT_PTR idEvent, DWORD dwTime)
+// Callback for keyboard hotkeys. We measure how long each one takes to process, since the UI
+// thread can't respond to anything else in the meantime.
+static bool HotkeyCallback(WPARAM wparam, LPARAM lparam)
 {
-	bool restored = false;
-
-	nvDisplay* display;
-	for (auto i = 0; (display = displays.GetDisplay(i)) != nullptr; i++) {
-		auto r = display->SetMonitorInput(VCP_INPUT_HOME);
-		if (r != 0)
-			restored = true;
-	}
-	if (restored || num_restore_attempts++ > RESTORE_INPUT_RETRIES) {
-		KillTimer(hWnd, RESTORE_INPUT_TID);
-		if (restored)
-			logger("Restored monitor input after %d attempts\n", num_restore_attempts);
-		else
-			logger("Failed to restore monitor input");
+	auto start = chrono::steady_clock::now();
+	bool ret = HandleHotkey(wparam, lparam);
+	uint32_t us = (uint32_t)chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+
+	stall_stats.calls++;
+	stall_stats.total_us += us;
+	if (us > stall_stats.max_us) {
+		stall_stats.max_us = us;
+		stall_stats.max_hotkey = (uint32_t)wparam;
 	}
+	if (us >= UI_STALL_THRESHOLD * 1000)
+		stall_stats.stalls++;
+	return ret;
 }
 
 // Callback for power events
 static ULONG CALLBACK PowerEventCallback(PVOID Context, ULONG Type, PVOID Setting)
 {
+	nvDisplay* display;
+
+	// Whatever VCP values we cached may no longer be valid once the monitors have been asleep
+	if (Type == PBT_APMRESUMESUSPEND) {
+		for (auto i = 0; (display = displays.GetDisplay(i)) != nullptr; i++)
+			display->InvalidateVcp();
+		// The scheduled changes that were due while we were suspended need to be applied. The
+		// scheduler belongs to the UI thread, so leave it to that thread to set the timer.
+		scheduler_resync = true;
+		tray_post_hotkey(hkSchedulerResync);
+	}
+
 	if (!settings.enabled || !settings.last_input)
 		return 0;
 
@@ -696,12 +1229,25 @@ int WINAPI WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _
 {
 	static wchar_t mutex_name[64];
 	int ret = 1;
-	wchar_t key_name[128];
+	wchar_t key_name[128], saved_device_id[128];
 	GUID guid = TRAY_ICON_GUID;
 	HANDLE mutex = NULL, power_handle = NULL;
 	DEVICE_NOTIFY_SUBSCRIBE_PARAMETERS power_params;
+	pool_stats_t pool_stats;
+	save_stats_t save_stats;
+	storage_stats_t storage_stats;
+	logger_stats_t logger_stats;
+	logfile_stats_t logfile_stats;
+	coalesce_stats_t coalesce_stats;
+	worker_stats_t worker_stats;
+	ipc_stats_t ipc_stats;
+	schedule_stats_t schedule_stats;
+	menu_stats_t menu_stats;
+	icon_stats_t icon_stats;
+	wheel_stats_t wheel_stats;
 	nvDisplay* display;
 
+	app_logger.Start(LogToDebugger);
 	SetProcessDpiAwareness(PROCESS_PER_MONITOR_DPI_AWARE);
 
 	if (!PopulateVersionData()) {
@@ -732,16 +1278,52 @@ int WINAPI WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _
 	}
 
 	// Read the settings
-	settings.use_alternate_keys = (ReadRegistryKey32(HKEY_CURRENT_USER, L"UseAlternateKeys") != 0);
-	settings.last_input = ReadRegistryKey32(HKEY_CURRENT_USER, L"LastInput");
-	_snwprintf_s(key_name, ARRAYSIZE(key_name), _TRUNCATE, L"Software\\Microsoft\\Windows\\CurrentVersion\\Run\\%s", version.ProductName);
-	settings.autostart = (ReadRegistryKeyStr(HKEY_CURRENT_USER, key_name)[0] != 0);
-	settings.active_device_id = ReadRegistryKeyStr(HKEY_CURRENT_USER, L"ActiveDisplay");
+	{
+		nvStorageBatch batch(storage);
+		settings.use_alternate_keys = (storage->Read32(L"UseAlternateKeys") != 0);
+		settings.last_input = storage->Read32(L"LastInput");
+		settings.hybrid_brightness = (storage->Read32(L"HybridBrightness") != 0);
+		wcscpy_s(saved_device_id, ARRAYSIZE(saved_device_id), storage->ReadStr(L"ActiveDisplay").c_str());
 #if !defined(_DEBUG)
-	settings.log_to_file = (ReadRegistryKey32(HKEY_CURRENT_USER, L"LogToFile") != 0);
+		settings.log_to_file = (storage->Read32(L"LogToFile") != 0);
 #endif
-	if (settings.log_to_file && SHGetSpecialFolderPathW(NULL, app_data_dir, CSIDL_LOCAL_APPDATA, FALSE))
-		log_file.open(wstring(app_data_dir) + L"\\nvBrightness.log", ofstream::out | ios::app);
+		settings.binary_log = (storage->Read32(L"BinaryLog") != 0);
+		// Unset values read as 0, in which case we keep the defaults
+		int32_t value = storage->Read32(L"LogMaxSize");
+		if (value > 0)
+			settings.log_max_size = value;
+		value = storage->Read32(L"LogGenerations");
+		if (value > 0)
+			settings.log_generations = value;
+		settings.synchronous_io = (storage->Read32(L"SynchronousIO") != 0);
+		settings.enable_ipc = (storage->Read32(L"EnableIPC") != 0);
+		value = storage->Read32(L"HotkeyAcceleration");
+		if (value > 0)
+			hotkey_coalescer.SetAcceleration(value);
+		// Coordinates are in decimal degrees, with north and east being positive
+		wstring latitude = storage->ReadStr(L"Latitude"), longitude = storage->ReadStr(L"Longitude");
+		if (!latitude.empty() && !longitude.empty())
+			scheduler.SetLocation(wcstod(latitude.c_str(), NULL), wcstod(longitude.c_str(), NULL));
+		scheduler.Parse(storage->ReadStr(L"Schedule"));
+	}
+	nvDisplay::EnableHybrid(settings.hybrid_brightness);
+	_snwprintf_s(key_name, ARRAYSIZE(key_name), _TRUNCATE, L"Software\\Microsoft\\Windows\\CurrentVersion\\Run\\%s", version.ProductName);
+	settings.autostart = (ReadRegistryKeyStr(HKEY_CURRENT_USER, key_name)[0] != 0);
+	settings.active_device_id = saved_device_id;
+	if (SHGetSpecialFolderPathW(NULL, app_data_dir, CSIDL_LOCAL_APPDATA, FALSE)) {
+		if (settings.log_to_file) {
+			// Older logs are kept as nvBrightness.1.log, nvBrightness.2.log, etc.
+			if (log_file.Open(wstring(app_data_dir) + L"\\nvBrightness.log", (uint64_t)settings.log_max_size * 1024,
+				settings.log_generations))
+				app_logger.Start(LogToFile);
+		}
+		// Decode with tools/decode_events.py
+		if (settings.binary_log)
+			event_log.Open(wstring(app_data_dir) + L"\\nvBrightness.evl", (uint64_t)settings.log_max_size * 1024,
+				settings.log_generations);
+		// Load the VCP capabilities we found in previous sessions, since these can take minutes to retrieve
+		caps_cache.Open(wstring(app_data_dir) + L"\\nvBrightness.cache");
+	}
 
 	// Build the display list
 	displays.Update();
@@ -750,26 +1332,28 @@ int WINAPI WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _
 	display = displays.GetDisplayWithFallback(settings.active_device_id);
 	if (display != nullptr) {
 		settings.active_device_id = display->GetDeviceId();
+		// Probe the active display before the others
+		display->SetProbePriority(POOL_PRIORITY_HIGH);
 		// Restore the last input if the active display hasn't changed and an input to restore was saved
-		if (wcscmp(ReadRegistryKeyStr(HKEY_CURRENT_USER, L"ActiveDisplay"), settings.active_device_id) == 0 &&
+		if (wcscmp(saved_device_id, settings.active_device_id) == 0 &&
 			settings.last_input != 0)
 			display->SetMonitorInput(settings.last_input);
 	}
 
 	// Create the tray menu
-	CreateSubmenu();
 	static struct tray_menu menu[] = {
 		{ .text = L"Brightness +\t［⊞］［Shift］［Num +］", .cb = IncreaseBrightnessCallback },
 		{ .text = L"Brightness −\t［⊞］［Shift］［Num −］", .cb = DecreaseBrightnessCallback },
 		{ .text = L"Turn off display(s)\t［⊞］［Shift］［End］", .cb = PowerOffCallback },
 		{ .text = L"-" },
 		{ .text = L"Input controls", .submenu = submenu.data()},
-		{ .text = wake_input, .disabled = (display == nullptr || display->GetHomeInput() == 0),
+		{ .text = L"Resume to Home", .disabled = true,
 			.checked = (settings.last_input != 0), .cb = ResumeToLastInputCallback },
 		{ .text = L"-" },
 		{ .text = L"Auto Start", .checked = settings.autostart, .cb = AutoStartCallback },
 		{ .text = L"Pause", .checked = 0, .cb = PauseCallback },
 		{ .text = L"Use Internet keys", .checked = settings.use_alternate_keys, .cb = AlternateKeysCallback, },
+		{ .text = L"Hybrid brightness", .checked = settings.hybrid_brightness, .cb = HybridBrightnessCallback, },
 		{ .text = L"About", .cb = AboutCallback },
 		{ .text = L"-" },
 		{ .text = L"Exit", .cb = ExitCallback },
@@ -779,11 +1363,13 @@ int WINAPI WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _
 		menu[0].text = L"Brightness +\t［Internet Fwd］ or ［Alt］［→］";
 		menu[1].text = L"Brightness −\t［Internet Back］ or ［Alt］［←］";
 	}
+	UpdateIconSize();
 	tray.icon = GetCurrentIcon(display);
 	tray.menu = menu;
 
 	// Avoid having to manually keep track of the submenu index
 	for (submenu_index = 0; menu[submenu_index].submenu == NULL; submenu_index++);
+	UpdateMenu();
 
 	if (tray_init(&tray, version.ProductName, guid, HotkeyCallback) < 0) {
 		ProperMessageBox(TD_ERROR_ICON, L"Failed to create tray application",
@@ -791,6 +1377,22 @@ int WINAPI WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _
 			"%s will now exit.\n", version.ProductName);
 		return 1;
 	}
+	// From now on, menu changes only patch the items that changed, when possible
+	menu_model.SetBackend([] { tray_update(&tray); }, tray_update_item);
+
+	// Start the hardware worker, now that it can notify the tray window
+	hw_worker.Start(RunCommand, [] { tray_post_hotkey(hkWorkerDone); }, settings.synchronous_io);
+
+	// Let local clients, such as tools/nvbctl.py, control us
+	if (settings.enable_ipc) {
+		DWORD session_id = 0;
+		ProcessIdToSessionId(GetCurrentProcessId(), &session_id);
+		ipc_server.Start(wstring(IPC_PIPE_NAME) + L"-" + to_wstring(session_id), HandleIpcRequests);
+	}
+
+	// Apply the scheduled brightness levels that should be in effect, and wait for the next ones
+	if (scheduler.GetStats().rules != 0)
+		SchedulerCallback(hwnd, WM_TIMER, SCHEDULER_TID, 0);
 
 	// Register the keyboard shortcuts
 	if (!RegisterHotKeys()) {
@@ -810,10 +1412,79 @@ int WINAPI WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _
 	// Kill any active timer we might still have.
 	KillTimer(hwnd, RESTORE_INPUT_TID);
 	KillTimer(hwnd, RESTORE_GAMMA_TID);
+	KillTimer(hwnd, UPDATE_BACKLIGHT_TID);
+	KillTimer(hwnd, COALESCE_HOTKEYS_TID);
+	KillTimer(hwnd, FLUSH_SETTINGS_TID);
+	KillTimer(hwnd, SCHEDULER_TID);
+
+	// IPC requests go through the hardware worker, so stop the IPC server first
+	ipc_server.Stop();
+	ipc_stats = ipc_server.GetStats();
+	if (settings.enable_ipc)
+		logger("IPC: %llu connection(s) (at most %u at once), %llu request(s) in %llu batch(es), %llu event(s), %llu dropped\n",
+			ipc_stats.connections, ipc_stats.max_clients, ipc_stats.requests, ipc_stats.batches,
+			ipc_stats.events, ipc_stats.events_dropped);
+
+	// Let the hardware worker complete the commands it has been given, and give the monitors
+	// their backlight back, after which we can access the displays directly
+	PostCommand(wcRestoreBacklight);
+	hw_worker.Stop();
+	worker_stats = hw_worker.GetStats();
+	logger("Hardware worker: %llu command(s), %llu merged, %llu completed, at most %u queued, "
+		"%.1f ms max wait, %.1f ms max run (command %u)\n", worker_stats.posted, worker_stats.merged,
+		worker_stats.completed, worker_stats.max_queued, worker_stats.max_wait_us / 1000.0f,
+		worker_stats.max_run_us / 1000.0f, worker_stats.max_run_command);
+	logger("UI thread: %llu hotkey message(s), %.2f ms average, %.2f ms max (hotkey 0x%x), %u over %d ms%s\n",
+		stall_stats.calls, (stall_stats.calls == 0) ? 0.0f : stall_stats.total_us / 1000.0f / stall_stats.calls,
+		stall_stats.max_us / 1000.0f, stall_stats.max_hotkey, stall_stats.stalls, UI_STALL_THRESHOLD,
+		settings.synchronous_io ? " (synchronous I/O)" : "");
+
+	schedule_stats = scheduler.GetStats();
+	wheel_stats = scheduler.GetWheelStats();
+	if (schedule_stats.rules != 0)
+		logger("Schedule: %u rule(s), %llu change(s) applied, %u resync(s), %llu timer(s) expired, %llu cascaded, %llu rebuild(s)\n",
+			schedule_stats.rules, schedule_stats.fired, schedule_stats.resyncs, wheel_stats.expired,
+			wheel_stats.cascaded, wheel_stats.rebuilds);
+
+	menu_stats = menu_model.GetStats();
+	logger("Tray menu: %llu update(s), %llu rebuild(s) in %.2f ms, %llu item(s) patched in %.2f ms\n",
+		menu_stats.commits, menu_stats.rebuilds, menu_stats.rebuild_us / 1000.0f, menu_stats.patches,
+		menu_stats.patch_us / 1000.0f);
+
+	icon_stats = tray_icons.GetStats();
+	logger("Tray icons: %llu rendered, %llu cache hit(s), %u atlas build(s)\n",
+		icon_stats.renders, icon_stats.cache_hits, icon_stats.atlas_builds);
+
+	coalesce_stats = hotkey_coalescer.GetStats();
+	logger("Hotkeys: %llu brightness event(s) applied in %llu update(s), peak of %u event(s)/s and %u update(s)/s\n",
+		coalesce_stats.events, coalesce_stats.applies, coalesce_stats.max_events_per_sec, coalesce_stats.max_applies_per_sec);
+
+	// Write any pending color settings
+	for (auto i = 0; (display = displays.GetDisplay(i)) != nullptr; i++)
+		display->FlushColorSettings();
+	save_stats = nvDisplay::GetSaveStats();
+	logger("Color settings: %u save request(s), %u flush(es), %u value(s) written\n",
+		save_stats.requests, save_stats.flushes, save_stats.values_written);
+
+	pool_stats = probe_pool.GetStats();
+	logger("Probe pool: %u thread(s), %u task(s) still running, %u queued (max %u), %llu completed, %llu cancelled, %llu failed\n",
+		pool_stats.threads, pool_stats.running, pool_stats.queued, pool_stats.max_queued,
+		pool_stats.completed, pool_stats.cancelled, pool_stats.failed);
+
+	// Report how long input switches took and, if we are logging to file, dump the raw timings
+	switch_timing.LogReport();
+	if (settings.log_to_file && app_data_dir[0] != 0)
+		switch_timing.Dump(wstring(app_data_dir) + L"\\nvBrightness-timing.json");
 
 	// Store the active display and its last input, so that we can restore it
-	WriteRegistryKeyStr(HKEY_CURRENT_USER, L"ActiveDisplay", settings.active_device_id);
-	WriteRegistryKey32(HKEY_CURRENT_USER, L"LastInput", settings.last_input);
+	{
+		nvStorageBatch batch(storage);
+		storage->WriteStr(L"ActiveDisplay", settings.active_device_id);
+		storage->Write32(L"LastInput", settings.last_input);
+	}
+	storage_stats = storage->GetStats();
+	logger("Storage: %llu read(s), %llu write(s), %llu system call(s), %llu key open(s) saved by batching\n",
+		storage_stats.reads, storage_stats.writes, storage_stats.syscalls, storage_stats.cached_opens);
 
 	ret = 0;
 
@@ -825,8 +1496,24 @@ out:
 	displays.Clear();
 	NvExit();
 	free(version.data);
-	if (settings.log_to_file)
-		log_file.close();
+	if (event_log.IsEnabled()) {
+		logger_stats = event_log.GetStats();
+		event_log.Close();
+		logger("Event log: %llu event(s), %llu dropped, %u rotation(s)\n", logger_stats.logged, logger_stats.dropped,
+			event_log.GetRotations());
+	}
+	logger_stats = app_logger.GetStats();
+	logger("Logger: %llu message(s), %llu dropped, %llu truncated, %llu batch(es) of at most %u message(s)\n",
+		logger_stats.logged, logger_stats.dropped, logger_stats.truncated, logger_stats.batches, logger_stats.max_batch);
+	if (log_file.IsOpen()) {
+		// The logger thread is the one writing the file, so these may be slightly behind
+		logfile_stats = log_file.GetStats();
+		logger("Log file: %llu byte(s) written, %u segment(s) mapped, %u rotation(s)%s\n", logfile_stats.bytes_written,
+			logfile_stats.segments_mapped, logfile_stats.rotations, (logfile_stats.recovered != 0) ? ", recovered from an unclean shutdown" : "");
+	}
+	// Make sure everything has been written before we close the log
+	app_logger.Stop();
+	log_file.Close();
 #ifdef _DEBUG
 	// NB: You don't want to use _CrtDumpMemoryLeaks() with C++.
 	// See: https://stackoverflow.com/a/5266164/1069307
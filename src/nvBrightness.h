@@ -26,6 +26,11 @@
 // VCP control code to read/switch a monitor's input source
 #define VCP_INPUT_SOURCE            0x60
 
+// Other VCP control codes we are interested in
+#define VCP_LUMINANCE               0x10
+#define VCP_CONTRAST                0x12
+#define VCP_POWER_MODE              0xd6
+
 // Custom VCP input values for previous/next
 #define VCP_INPUT_HOME              0x00
 #define VCP_INPUT_PREVIOUS          0xfe
@@ -63,6 +68,8 @@ enum {
 	hkPreviousMonitor,
 	hkNextMonitor,
 	hkUpdateSubmenu,
+	hkWorkerDone,
+	hkSchedulerResync,
 	hkMax
 };
 
@@ -0,0 +1,212 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <wchar.h>
+
+#include <chrono>
+#include <fstream>
+#include <vector>
+
+#include "nvBrightness.h"
+#include "nvCache.hpp"
+
+// The cache file is laid out as follows (little endian):
+//   header: "nvBC" magic, uint16_t version, uint16_t number of entries, uint32_t CRC of the header
+//   entry:  uint64_t key, uint64_t timestamp, uint16_t data size, uint32_t CRC of the data, data
+static const char cache_magic[4] = { 'n', 'v', 'B', 'C' };
+#define CACHE_HEADER_SIZE           12
+#define CACHE_ENTRY_HEADER_SIZE     22
+
+template <typename T> static __inline T ReadLE(const uint8_t* p)
+{
+	T val;
+	memcpy(&val, p, sizeof(T));
+	return val;
+}
+
+template <typename T> static __inline void WriteLE(vector<uint8_t>& buf, T val)
+{
+	uint8_t* p = (uint8_t*)&val;
+	buf.insert(buf.end(), p, p + sizeof(T));
+}
+
+uint32_t nvCache::Crc32(const void* buf, size_t size, uint32_t crc)
+{
+	const uint8_t* p = (const uint8_t*)buf;
+
+	crc = ~crc;
+	while (size--) {
+		crc ^= *p++;
+		for (int k = 0; k < 8; k++)
+			crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+	}
+	return ~crc;
+}
+
+// A 64-bit FNV-1a hash of the EDID data, along with the hardware ID part of the Device ID
+// (e.g. "DEL4123" in "\\?\DISPLAY#DEL4123#5&2a0f1b1&0&UID4353#{...}"), which is what the
+// monitor firmware reports to the OS and doesn't depend on the port it is connected to.
+uint64_t nvCache::Fingerprint(span<const uint8_t> edid, const wchar_t* device_id)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+
+	for (auto b : edid) {
+		hash ^= b;
+		hash *= 0x100000001b3ULL;
+	}
+	if (device_id != nullptr) {
+		const wchar_t* p = wcschr(device_id, L'#');
+		for (p = (p == nullptr) ? device_id : p + 1; *p != L'\0' && *p != L'#'; p++) {
+			hash ^= (uint8_t)*p;
+			hash *= 0x100000001b3ULL;
+		}
+	}
+	return hash;
+}
+
+bool nvCache::Open(const filesystem::path& cache_path)
+{
+	lock_guard<mutex> lock(cache_mutex);
+	error_code ec;
+
+	path = cache_path;
+	entries.clear();
+
+	auto size = filesystem::file_size(path, ec);
+	if (ec)
+		return false;
+	if (size < CACHE_HEADER_SIZE || size > CACHE_MAX_FILE_SIZE) {
+		logger("Discarding VCP cache: Invalid size (%llu bytes)\n", (unsigned long long)size);
+		return false;
+	}
+
+	vector<uint8_t> buf((size_t)size);
+	ifstream file(path, ios::binary);
+	if (!file.read((char*)buf.data(), buf.size()))
+		return false;
+
+	if (memcmp(buf.data(), cache_magic, sizeof(cache_magic)) != 0 ||
+		ReadLE<uint32_t>(&buf[8]) != Crc32(buf.data(), 8)) {
+		logger("Discarding VCP cache: Invalid header\n");
+		return false;
+	}
+	if (ReadLE<uint16_t>(&buf[4]) != CACHE_VERSION) {
+		logger("Discarding VCP cache: Version %d is not supported\n", ReadLE<uint16_t>(&buf[4]));
+		return false;
+	}
+
+	uint16_t num_entries = ReadLE<uint16_t>(&buf[6]);
+	size_t pos = CACHE_HEADER_SIZE;
+	for (uint16_t i = 0; i < num_entries && i < CACHE_MAX_ENTRIES; i++) {
+		if (pos + CACHE_ENTRY_HEADER_SIZE > buf.size())
+			break;
+		uint64_t key = ReadLE<uint64_t>(&buf[pos]);
+		uint64_t timestamp = ReadLE<uint64_t>(&buf[pos + 8]);
+		uint16_t data_size = ReadLE<uint16_t>(&buf[pos + 16]);
+		uint32_t crc = ReadLE<uint32_t>(&buf[pos + 18]);
+		pos += CACHE_ENTRY_HEADER_SIZE;
+		if (data_size > CACHE_MAX_ENTRY_SIZE || pos + data_size > buf.size())
+			break;
+		// A corrupted entry doesn't invalidate the others, since they each have their own CRC
+		if (Crc32(&buf[pos], data_size) == crc)
+			entries[key] = { timestamp, string((const char*)&buf[pos], data_size) };
+		else
+			logger("Discarding corrupted VCP cache entry %016llx\n", (unsigned long long)key);
+		pos += data_size;
+	}
+
+	return true;
+}
+
+bool nvCache::Lookup(uint64_t key, string& data)
+{
+	lock_guard<mutex> lock(cache_mutex);
+
+	auto it = entries.find(key);
+	if (it == entries.end())
+		return false;
+	data = it->second.data;
+	return true;
+}
+
+bool nvCache::Store(uint64_t key, string_view data)
+{
+	lock_guard<mutex> lock(cache_mutex);
+
+	if (path.empty() || data.size() > CACHE_MAX_ENTRY_SIZE)
+		return false;
+
+	auto now = chrono::duration_cast<chrono::seconds>(chrono::system_clock::now().time_since_epoch());
+	auto it = entries.find(key);
+	if (it != entries.end() && it->second.data == data) {
+		// Nothing new to write, but this entry should no longer be first in line for eviction
+		it->second.timestamp = (uint64_t)now.count();
+		return true;
+	}
+
+	// Evict the oldest entries if we are about to go over the limit
+	while (it == entries.end() && entries.size() >= CACHE_MAX_ENTRIES) {
+		auto oldest = entries.begin();
+		for (auto e = entries.begin(); e != entries.end(); e++)
+			if (e->second.timestamp < oldest->second.timestamp)
+				oldest = e;
+		entries.erase(oldest);
+	}
+
+	entries[key] = { (uint64_t)now.count(), string(data) };
+	return Save();
+}
+
+// Must be called with the mutex held
+bool nvCache::Save()
+{
+	vector<uint8_t> buf;
+	error_code ec;
+
+	buf.insert(buf.end(), cache_magic, cache_magic + sizeof(cache_magic));
+	WriteLE<uint16_t>(buf, CACHE_VERSION);
+	WriteLE<uint16_t>(buf, (uint16_t)entries.size());
+	WriteLE<uint32_t>(buf, Crc32(buf.data(), buf.size()));
+	for (auto& [key, e] : entries) {
+		WriteLE<uint64_t>(buf, key);
+		WriteLE<uint64_t>(buf, e.timestamp);
+		WriteLE<uint16_t>(buf, (uint16_t)e.data.size());
+		WriteLE<uint32_t>(buf, Crc32(e.data.data(), e.data.size()));
+		buf.insert(buf.end(), e.data.begin(), e.data.end());
+	}
+
+	// Write to a temporary file and then rename, so that we never leave a partial cache behind
+	auto tmp_path = path;
+	tmp_path += ".tmp";
+	{
+		ofstream file(tmp_path, ios::binary | ios::trunc);
+		if (!file.write((const char*)buf.data(), buf.size())) {
+			logger("Could not write VCP cache\n");
+			return false;
+		}
+	}
+	filesystem::rename(tmp_path, path, ec);
+	if (ec) {
+		logger("Could not update VCP cache: %s\n", ec.message().c_str());
+		filesystem::remove(tmp_path, ec);
+		return false;
+	}
+	return true;
+}
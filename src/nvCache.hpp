@@ -0,0 +1,60 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+
+// Bump this whenever the on-disk layout changes, so that older caches get discarded
+#define CACHE_VERSION               1
+#define CACHE_MAX_ENTRIES           32
+#define CACHE_MAX_ENTRY_SIZE        4096
+#define CACHE_MAX_FILE_SIZE         (CACHE_MAX_ENTRIES * (CACHE_MAX_ENTRY_SIZE + 32) + 16)
+
+using namespace std;
+
+// Persistent cache of monitor VCP capabilities strings, keyed by a fingerprint of the
+// monitor (see nvCache::Fingerprint()), so that we don't have to wait for the (very slow)
+// capabilities discovery to complete every time the application starts.
+class nvCache {
+private:
+	struct entry {
+		uint64_t timestamp;
+		string data;
+	};
+	mutex cache_mutex;
+	filesystem::path path;
+	map<uint64_t, entry> entries;
+	bool Save();
+public:
+	static uint32_t Crc32(const void* buf, size_t size, uint32_t crc = 0);
+	static uint64_t Fingerprint(span<const uint8_t> edid, const wchar_t* device_id);
+	bool Open(const filesystem::path& cache_path);
+	bool Lookup(uint64_t key, string& data);
+	bool Store(uint64_t key, string_view data);
+};
+
+extern nvCache caps_cache;
@@ -0,0 +1,185 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ctype.h>
+
+#include <algorithm>
+
+#include "nvCapabilities.hpp"
+
+static __inline bool IsHex(char c)
+{
+	return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static __inline uint8_t HexValue(char c)
+{
+	if (c >= '0' && c <= '9')
+		return (uint8_t)(c - '0');
+	return (uint8_t)((c | 0x20) - 'a' + 10);
+}
+
+static __inline void SkipSpaces(string_view& s)
+{
+	while (!s.empty() && isspace((unsigned char)s[0]))
+		s.remove_prefix(1);
+}
+
+static string_view Trim(string_view s)
+{
+	SkipSpaces(s);
+	while (!s.empty() && isspace((unsigned char)s.back()))
+		s.remove_suffix(1);
+	return s;
+}
+
+// Consume everything up to and including the ')' that closes a group we are already
+// inside of, and return the content of the group. Nested groups are skipped over, and
+// an unterminated group (which we do get from some monitors) extends to the end.
+static string_view SkipGroup(string_view& s)
+{
+	int depth = 1;
+	size_t i;
+
+	for (i = 0; i < s.size(); i++) {
+		if (s[i] == '(') {
+			depth++;
+		} else if (s[i] == ')' && --depth == 0) {
+			string_view content = s.substr(0, i);
+			s.remove_prefix(i + 1);
+			return content;
+		}
+	}
+	string_view content = s;
+	s.remove_prefix(s.size());
+	return content;
+}
+
+void nvCapabilities::Reset()
+{
+	source = protocol = type = model = mccs_ver = string_view();
+	num_cmds = 0;
+	for (auto& v : vcp)
+		v = { false, 0, 0 };
+	num_vcp = 0;
+	num_values = 0;
+}
+
+// Parse a list of hex bytes, which may or may not be separated by whitespace, since
+// some manufacturers apparently consider "cmds(01020307)" to be as good as it gets.
+// Stops on the first character that isn't part of the list. Values that don't fit in
+// dest are consumed but dropped.
+size_t nvCapabilities::ParseHexList(string_view& s, uint8_t* dest, size_t dest_size)
+{
+	size_t n = 0;
+
+	while (true) {
+		SkipSpaces(s);
+		if (s.size() < 2 || !IsHex(s[0]) || !IsHex(s[1]))
+			break;
+		if (n < dest_size)
+			dest[n++] = (HexValue(s[0]) << 4) | HexValue(s[1]);
+		s.remove_prefix(2);
+	}
+	return n;
+}
+
+// Parse the content of "vcp(...)", which is a list of codes, each optionally followed by
+// a parenthesized list of the values it accepts, e.g. "02 10 60(0F 11 1B) D6(01 04)".
+bool nvCapabilities::ParseVcp(string_view& s)
+{
+	while (true) {
+		SkipSpaces(s);
+		if (s.empty())
+			return false;
+		if (s[0] == ')') {
+			s.remove_prefix(1);
+			return true;
+		}
+		if (s.size() < 2 || !IsHex(s[0]) || !IsHex(s[1])) {
+			// Not something we know how to handle => skip the rest of the vcp() group
+			SkipGroup(s);
+			return false;
+		}
+		uint8_t code = (HexValue(s[0]) << 4) | HexValue(s[1]);
+		s.remove_prefix(2);
+		if (!vcp[code].supported) {
+			vcp[code].supported = true;
+			num_vcp++;
+		}
+		SkipSpaces(s);
+		if (!s.empty() && s[0] == '(') {
+			s.remove_prefix(1);
+			size_t max_values = min<size_t>(UINT8_MAX, CAPS_MAX_VCP_VALUES - num_values);
+			vcp[code].values_index = (uint16_t)num_values;
+			vcp[code].num_values = (uint8_t)ParseHexList(s, &values[num_values], max_values);
+			num_values += vcp[code].num_values;
+			SkipGroup(s);
+		}
+	}
+}
+
+bool nvCapabilities::Parse(string_view caps)
+{
+	Reset();
+
+	// Drop anything past a NUL terminator we may have been handed along with the string
+	source = caps.substr(0, caps.find('\0'));
+	string_view s = source;
+	SkipSpaces(s);
+	// The whole string is supposed to be enclosed in parentheses, but not all monitors do that
+	if (!s.empty() && s[0] == '(')
+		s.remove_prefix(1);
+
+	while (!s.empty()) {
+		size_t i;
+		for (i = 0; i < s.size() && (isalnum((unsigned char)s[i]) || s[i] == '_'); i++);
+		if (i == 0) {
+			// Closing parenthesis of the whole string or some junk => ignore
+			s.remove_prefix(1);
+			continue;
+		}
+		string_view name = s.substr(0, i);
+		s.remove_prefix(i);
+		SkipSpaces(s);
+		if (s.empty() || s[0] != '(')
+			continue;
+		s.remove_prefix(1);
+
+		if (name == "vcp") {
+			ParseVcp(s);
+		} else if (name == "cmds") {
+			num_cmds = ParseHexList(s, cmds, sizeof(cmds));
+			SkipGroup(s);
+		} else {
+			string_view value = Trim(SkipGroup(s));
+			if (name == "prot")
+				protocol = value;
+			else if (name == "type")
+				type = value;
+			else if (name == "model")
+				model = value;
+			else if (name == "mccs_ver")
+				mccs_ver = value;
+			// Everything else (mswhql, asset_eep, vcpname, window...) is of no interest to us
+		}
+	}
+
+	return IsValid();
+}
@@ -0,0 +1,72 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <span>
+#include <string>
+#include <string_view>
+
+// Maximum number of VCP values (e.g. the list of inputs for 0x60) we keep for a monitor
+#define CAPS_MAX_VCP_VALUES         1024
+
+using namespace std;
+
+// Structured view of an MCCS capabilities string, such as:
+// "(prot(monitor)type(lcd)model(U2720Q)cmds(01 02 03)vcp(02 10 12 60(0F 11 1B))mccs_ver(2.1))"
+// The parser does not allocate: every string we report is a view into the string we parsed,
+// which the caller must keep around for as long as it uses them, and VCP codes and values are
+// stored in a fixed pool, which can be used for as long as we are around.
+class nvCapabilities {
+private:
+	string_view source;
+	string_view protocol;
+	string_view type;
+	string_view model;
+	string_view mccs_ver;
+	uint8_t cmds[256] = { 0 };
+	size_t num_cmds = 0;
+	struct {
+		bool supported;
+		uint8_t num_values;
+		uint16_t values_index;
+	} vcp[256] = {};
+	size_t num_vcp = 0;
+	uint8_t values[CAPS_MAX_VCP_VALUES] = { 0 };
+	size_t num_values = 0;
+	void Reset();
+	bool ParseVcp(string_view& s);
+	static size_t ParseHexList(string_view& s, uint8_t* dest, size_t dest_size);
+public:
+	bool Parse(string_view caps);
+	bool IsValid() { return num_vcp != 0 || !model.empty(); };
+	string_view GetSource() { return source; };
+	string_view GetProtocol() { return protocol; };
+	string_view GetType() { return type; };
+	string_view GetModel() { return model; };
+	string_view GetMccsVersion() { return mccs_ver; };
+	span<const uint8_t> GetCommands() { return span<const uint8_t>(cmds, num_cmds); };
+	size_t GetNumberOfVcpCodes() { return num_vcp; };
+	bool SupportsVcp(uint8_t code) { return vcp[code].supported; };
+	span<const uint8_t> GetVcpValues(uint8_t code) {
+		return span<const uint8_t>(&values[vcp[code].values_index], vcp[code].num_values);
+	};
+};
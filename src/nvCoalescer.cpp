@@ -0,0 +1,106 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+
+#include "nvCoalescer.hpp"
+
+using namespace chrono;
+
+void nvCoalescer::SetAcceleration(uint32_t percent)
+{
+	acceleration = clamp<uint32_t>(percent, 100, HOTKEY_MAX_ACCELERATION) / 100.0f;
+}
+
+// The step multiplier for the current hold, which eases in so that a short hold still allows
+// fine adjustments, while a long one covers the whole range quickly.
+float nvCoalescer::GetFactor(time_point now)
+{
+	float t = (duration<float, milli>(now - hold.start).count() - HOTKEY_ACCEL_DELAY) / HOTKEY_ACCEL_RAMP;
+	t = clamp(t, 0.0f, 1.0f);
+	return 1.0f + (acceleration - 1.0f) * t * t;
+}
+
+void nvCoalescer::Add(const wstring& key, float step, time_point now)
+{
+	int direction = (step < 0.0f) ? -1 : 1;
+
+	// Changing display or direction, or letting go of the key, starts a new hold
+	if (key != hold.key || direction != hold.direction || now - hold.last >= milliseconds(HOTKEY_REPEAT_GAP)) {
+		hold.key = key;
+		hold.direction = direction;
+		hold.start = now;
+	}
+	hold.last = now;
+	pending[key] += step * GetFactor(now);
+	if (window_events == 0 && window_applies == 0)
+		window_start = now;
+	window_events++;
+	stats.events++;
+}
+
+// Whether a frame has elapsed since we last applied changes, in which case a new one can be
+// applied right away rather than wait for the timer.
+bool nvCoalescer::IsFrameDue(time_point now)
+{
+	return (now - last_apply >= milliseconds(HOTKEY_FRAME_INTERVAL));
+}
+
+// Return the accumulated changes, per key, and reset them
+map<wstring, float> nvCoalescer::Take(time_point now)
+{
+	map<wstring, float> changes;
+
+	if (pending.empty())
+		return changes;
+	changes.swap(pending);
+	last_apply = now;
+	window_applies++;
+	stats.applies++;
+	return changes;
+}
+
+// Returns true, along with the rates, once per rate window that saw some activity
+bool nvCoalescer::GetRates(time_point now, uint32_t* events_per_sec, uint32_t* applies_per_sec)
+{
+	auto elapsed = duration_cast<milliseconds>(now - window_start).count();
+
+	if ((window_events == 0 && window_applies == 0) || elapsed < HOTKEY_RATE_WINDOW)
+		return false;
+	*events_per_sec = (uint32_t)((window_events * 1000ULL) / elapsed);
+	*applies_per_sec = (uint32_t)((window_applies * 1000ULL) / elapsed);
+	stats.max_events_per_sec = max(stats.max_events_per_sec, *events_per_sec);
+	stats.max_applies_per_sec = max(stats.max_applies_per_sec, *applies_per_sec);
+	window_events = 0;
+	window_applies = 0;
+	return true;
+}
+
+// How long until we need to be called again, in ms, or 0 if we're idle. We keep ticking at
+// the frame rate for as long as a hold may still be going on, and then until the end of the
+// rate window, so that the rates can be reported.
+uint32_t nvCoalescer::GetNextDelay(time_point now)
+{
+	if (!pending.empty() || now - hold.last < milliseconds(HOTKEY_REPEAT_GAP))
+		return HOTKEY_FRAME_INTERVAL;
+	if (window_events != 0 || window_applies != 0) {
+		auto remaining = HOTKEY_RATE_WINDOW - duration_cast<milliseconds>(now - window_start).count();
+		return (uint32_t)clamp<int64_t>(remaining, HOTKEY_FRAME_INTERVAL, HOTKEY_RATE_WINDOW);
+	}
+	return 0;
+}
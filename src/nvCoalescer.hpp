@@ -0,0 +1,76 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include <chrono>
+#include <map>
+#include <string>
+
+// Held brightness hotkeys auto-repeat, so we accumulate their steps and apply the total at most
+// once per frame. Repeats that come within HOTKEY_REPEAT_GAP of one another belong to the same
+// hold (this must be longer than the keyboard's initial repeat delay). Once a hold has lasted
+// HOTKEY_ACCEL_DELAY, its steps grow over HOTKEY_ACCEL_RAMP, up to the acceleration factor, which
+// can be set, as a percentage, with the HotkeyAcceleration registry setting (100 to disable).
+// In ms, unless noted otherwise.
+#define HOTKEY_FRAME_INTERVAL           16
+#define HOTKEY_REPEAT_GAP               600
+#define HOTKEY_ACCEL_DELAY              400
+#define HOTKEY_ACCEL_RAMP               1500
+#define HOTKEY_DEFAULT_ACCELERATION     400
+#define HOTKEY_MAX_ACCELERATION         2000
+#define HOTKEY_RATE_WINDOW              1000
+
+using namespace std;
+
+typedef struct {
+	uint64_t events;
+	uint64_t applies;
+	uint32_t max_events_per_sec;
+	uint32_t max_applies_per_sec;
+} coalesce_stats_t;
+
+// Not thread safe: this is meant to be used from the UI thread only.
+class nvCoalescer {
+private:
+	typedef chrono::steady_clock::time_point time_point;
+	map<wstring, float> pending;
+	struct {
+		wstring key;
+		int direction;
+		time_point start;
+		time_point last;
+	} hold = {};
+	float acceleration = HOTKEY_DEFAULT_ACCELERATION / 100.0f;
+	time_point last_apply = {};
+	time_point window_start = {};
+	uint32_t window_events = 0, window_applies = 0;
+	coalesce_stats_t stats = { 0 };
+public:
+	void SetAcceleration(uint32_t percent);
+	float GetFactor(time_point now);
+	void Add(const wstring& key, float step, time_point now = chrono::steady_clock::now());
+	bool HasPending() { return !pending.empty(); };
+	bool IsFrameDue(time_point now = chrono::steady_clock::now());
+	map<wstring, float> Take(time_point now = chrono::steady_clock::now());
+	bool GetRates(time_point now, uint32_t* events_per_sec, uint32_t* applies_per_sec);
+	uint32_t GetNextDelay(time_point now = chrono::steady_clock::now());
+	const coalesce_stats_t& GetStats() { return stats; };
+};
@@ -0,0 +1,230 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "nvDdc.hpp"
+
+// Per the DDC/CI standard: 40 ms before reading a VCP reply, 50 ms after a VCP set,
+// 50 ms before reading a capabilities reply and 50 ms between consecutive commands.
+const ddc_timing_t nvDdcEngine::default_timing = { 40, 50, 50, 50 };
+
+uint8_t nvDdcEngine::Checksum(uint8_t seed, span<const uint8_t> data)
+{
+	for (auto b : data)
+		seed ^= b;
+	return seed;
+}
+
+void nvDdcEngine::WaitFor(uint64_t time)
+{
+	uint64_t now = transport->Now();
+	if (now < time) {
+		stats.delay_ms += time - now;
+		transport->Delay((uint32_t)(time - now));
+	}
+}
+
+// Host to display packets are: source address, length | 0x80, payload, checksum, where
+// the checksum also covers the destination address (which is the I2C address).
+bool nvDdcEngine::SendPacket(span<const uint8_t> payload)
+{
+	uint8_t packet[DDC_MAX_PAYLOAD + 3];
+
+	if (payload.size() > DDC_MAX_PAYLOAD)
+		return false;
+	packet[0] = DDC_HOST_ADDRESS;
+	packet[1] = 0x80 | (uint8_t)payload.size();
+	memcpy(&packet[2], payload.data(), payload.size());
+	packet[payload.size() + 2] = Checksum(DDC_DEST_ADDRESS, span<const uint8_t>(packet, payload.size() + 2));
+	stats.writes++;
+	return transport->Write(DDC_I2C_ADDRESS, span<const uint8_t>(packet, payload.size() + 3));
+}
+
+// Display to host packets are: source address, length | 0x80, payload, checksum, where the
+// checksum is seeded with the virtual host address. Returns the size of the payload, or 0
+// for a null message or an invalid packet.
+size_t nvDdcEngine::ReceivePacket(uint8_t* payload, size_t payload_size)
+{
+	uint8_t packet[DDC_MAX_PAYLOAD + 3] = { 0 };
+	size_t len;
+
+	stats.reads++;
+	if (!transport->Read(DDC_I2C_ADDRESS, span<uint8_t>(packet, min(payload_size + 3, sizeof(packet)))))
+		return 0;
+	len = packet[1] & 0x7f;
+	if (packet[0] != DDC_DEST_ADDRESS || (packet[1] & 0x80) == 0 || len > payload_size)
+		return 0;
+	if (packet[len + 2] != Checksum(DDC_HOST_REPLY_ADDRESS, span<const uint8_t>(packet, len + 2))) {
+		stats.checksum_errors++;
+		return 0;
+	}
+	// A null message means "not ready yet" or "I don't have anything to say"
+	if (len == 0) {
+		stats.null_replies++;
+		return 0;
+	}
+	memcpy(payload, &packet[2], len);
+	return len;
+}
+
+// Send a request and, if a reply buffer is provided, read the reply, with retries
+// and with all the delays the DDC/CI specs mandate.
+size_t nvDdcEngine::Transaction(span<const uint8_t> request, uint32_t reply_delay, uint8_t* reply, size_t reply_size)
+{
+	for (int attempt = 0; attempt <= DDC_MAX_RETRIES; attempt++) {
+		if (attempt != 0)
+			stats.retries++;
+		WaitFor(next_command_time);
+		if (!SendPacket(request)) {
+			next_command_time = transport->Now() + timing.inter_command_delay;
+			continue;
+		}
+		if (reply == NULL) {
+			next_command_time = transport->Now() + max(reply_delay, timing.inter_command_delay);
+			return 1;
+		}
+		WaitFor(transport->Now() + reply_delay);
+		size_t size = ReceivePacket(reply, reply_size);
+		next_command_time = transport->Now() + timing.inter_command_delay;
+		if (size != 0)
+			return size;
+	}
+	return 0;
+}
+
+bool nvDdcEngine::GetVcpFeature(uint8_t code, uint16_t* current, uint16_t* max)
+{
+	const uint8_t request[] = { DDC_OP_VCP_REQUEST, code };
+	uint8_t reply[8];
+
+	// Reply is: opcode, result, VCP code, type, max (BE), current (BE)
+	if (Transaction(request, timing.vcp_reply_delay, reply, sizeof(reply)) != sizeof(reply) ||
+		reply[0] != DDC_OP_VCP_REPLY || reply[2] != code || reply[1] != 0)
+		return false;
+	if (max != NULL)
+		*max = (reply[4] << 8) | reply[5];
+	if (current != NULL)
+		*current = (reply[6] << 8) | reply[7];
+	return true;
+}
+
+bool nvDdcEngine::SetVcpFeature(uint8_t code, uint16_t value)
+{
+	const uint8_t request[] = { DDC_OP_VCP_SET, code, (uint8_t)(value >> 8), (uint8_t)value };
+
+	return Transaction(request, timing.vcp_set_delay, NULL, 0) != 0;
+}
+
+// The capabilities string is retrieved in fragments of up to 32 bytes, which we must
+// request by offset, until the monitor replies with an empty fragment.
+bool nvDdcEngine::GetCapabilities(string& caps)
+{
+	uint8_t reply[DDC_MAX_PAYLOAD];
+	uint16_t offset = 0;
+
+	caps.clear();
+	while (offset < DDC_MAX_CAPS_SIZE) {
+		const uint8_t request[] = { DDC_OP_CAPS_REQUEST, (uint8_t)(offset >> 8), (uint8_t)offset };
+		size_t size = Transaction(request, timing.caps_reply_delay, reply, sizeof(reply));
+		if (size < 3 || reply[0] != DDC_OP_CAPS_REPLY || ((reply[1] << 8) | reply[2]) != offset)
+			return false;
+		if (size == 3)
+			break;
+		caps.append((const char*)&reply[3], size - 3);
+		offset += (uint16_t)(size - 3);
+	}
+	// Some monitors NUL terminate the last fragment
+	while (!caps.empty() && caps.back() == '\0')
+		caps.pop_back();
+	return !caps.empty();
+}
+
+void nvDdcSimulator::SetReply(span<const uint8_t> payload)
+{
+	reply[0] = DDC_DEST_ADDRESS;
+	reply[1] = 0x80 | (uint8_t)payload.size();
+	memcpy(&reply[2], payload.data(), payload.size());
+	reply[payload.size() + 2] = nvDdcEngine::Checksum(DDC_HOST_REPLY_ADDRESS,
+		span<const uint8_t>(reply, payload.size() + 2));
+	reply_size = payload.size() + 3;
+}
+
+bool nvDdcSimulator::Write(uint8_t address, span<const uint8_t> data)
+{
+	if (!connected || address != DDC_I2C_ADDRESS || data.size() < 4 || data[0] != DDC_HOST_ADDRESS ||
+		(size_t)(data[1] & 0x7f) + 3 != data.size() ||
+		nvDdcEngine::Checksum(DDC_DEST_ADDRESS, data.first(data.size() - 1)) != data.back())
+		return false;
+
+	auto payload = data.subspan(2, data.size() - 3);
+	reply_size = 0;
+	reply_ready_time = clock + min_reply_delay;
+	switch (payload[0]) {
+	case DDC_OP_VCP_REQUEST:
+		if (payload.size() == 2) {
+			auto it = vcp.find(payload[1]);
+			vcp_value v = (it == vcp.end()) ? vcp_value{ 0, 0 } : it->second;
+			const uint8_t r[] = { DDC_OP_VCP_REPLY, (uint8_t)((it == vcp.end()) ? 1 : 0), payload[1], 0,
+				(uint8_t)(v.max >> 8), (uint8_t)v.max, (uint8_t)(v.current >> 8), (uint8_t)v.current };
+			SetReply(r);
+		}
+		break;
+	case DDC_OP_VCP_SET:
+		if (payload.size() == 4 && vcp.contains(payload[1]))
+			vcp[payload[1]].current = (payload[2] << 8) | payload[3];
+		break;
+	case DDC_OP_CAPS_REQUEST:
+		if (payload.size() == 3) {
+			uint8_t r[DDC_MAX_PAYLOAD] = { DDC_OP_CAPS_REPLY, payload[1], payload[2] };
+			size_t offset = (payload[1] << 8) | payload[2];
+			size_t size = (offset < caps.size()) ? min<size_t>(DDC_CAPS_FRAGMENT_SIZE, caps.size() - offset) : 0;
+			memcpy(&r[3], caps.data() + min(offset, caps.size()), size);
+			SetReply(span<const uint8_t>(r, size + 3));
+		}
+		break;
+	default:
+		break;
+	}
+	return true;
+}
+
+bool nvDdcSimulator::Read(uint8_t address, span<uint8_t> data)
+{
+	if (!connected || address != DDC_I2C_ADDRESS)
+		return false;
+
+	const uint8_t* src = reply;
+	size_t size = reply_size;
+	if (clock < reply_ready_time || reply_size == 0) {
+		// Not ready (or nothing to reply) => null message, but keep any pending reply
+		static const uint8_t null_reply[] = { DDC_DEST_ADDRESS, 0x80, DDC_DEST_ADDRESS ^ 0x80 ^ DDC_HOST_REPLY_ADDRESS };
+		src = null_reply;
+		size = sizeof(null_reply);
+	} else {
+		reply_size = 0;
+	}
+	memset(data.data(), 0, data.size());
+	memcpy(data.data(), src, min(data.size(), size));
+	if (corrupt_every != 0 && (++num_replies % corrupt_every) == 0 && size <= data.size())
+		data[size - 1] ^= 0xff;
+	return true;
+}
@@ -0,0 +1,136 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <map>
+#include <span>
+#include <string>
+
+// DDC/CI addressing. The monitor lives at 7-bit I2C address 0x37 (0x6E/0x6F in 8-bit form)
+// and the host uses 0x51 as its source address (and 0x50 when computing reply checksums).
+#define DDC_I2C_ADDRESS             0x37
+#define DDC_DEST_ADDRESS            0x6e
+#define DDC_HOST_ADDRESS            0x51
+#define DDC_HOST_REPLY_ADDRESS      0x50
+
+// DDC/CI opcodes we use
+#define DDC_OP_VCP_REQUEST          0x01
+#define DDC_OP_VCP_REPLY            0x02
+#define DDC_OP_VCP_SET              0x03
+#define DDC_OP_CAPS_REPLY           0xe3
+#define DDC_OP_CAPS_REQUEST         0xf3
+
+// Maximum size of a capabilities fragment, and of a DDC/CI message payload (which, for a
+// capabilities reply, is the opcode, the 16-bit offset and the fragment data)
+#define DDC_CAPS_FRAGMENT_SIZE      32
+#define DDC_MAX_PAYLOAD             (DDC_CAPS_FRAGMENT_SIZE + 3)
+#define DDC_MAX_CAPS_SIZE           8192
+#define DDC_MAX_RETRIES             3
+
+using namespace std;
+
+// Abstract I2C transport, so that the protocol engine can be used with the real
+// hardware as well as with a simulated monitor. Time is also provided by the
+// transport, so that a simulated monitor can run on a virtual clock.
+class nvI2cTransport {
+public:
+	virtual ~nvI2cTransport() {};
+	virtual bool Write(uint8_t address, span<const uint8_t> data) = 0;
+	virtual bool Read(uint8_t address, span<uint8_t> data) = 0;
+	virtual uint64_t Now() = 0;
+	virtual void Delay(uint32_t ms) = 0;
+};
+
+// Delays mandated by the DDC/CI specs, in ms. These are the values from the standard,
+// but plenty of monitors are happy with less, which is what we want to be able to measure.
+typedef struct {
+	uint32_t vcp_reply_delay;
+	uint32_t vcp_set_delay;
+	uint32_t caps_reply_delay;
+	uint32_t inter_command_delay;
+} ddc_timing_t;
+
+typedef struct {
+	uint32_t writes;
+	uint32_t reads;
+	uint32_t retries;
+	uint32_t checksum_errors;
+	uint32_t null_replies;
+	uint64_t delay_ms;
+} ddc_stats_t;
+
+class nvDdcEngine {
+private:
+	nvI2cTransport* transport;
+	ddc_timing_t timing;
+	ddc_stats_t stats = { 0 };
+	uint64_t next_command_time = 0;
+	void WaitFor(uint64_t time);
+	bool SendPacket(span<const uint8_t> payload);
+	size_t ReceivePacket(uint8_t* payload, size_t payload_size);
+	size_t Transaction(span<const uint8_t> request, uint32_t reply_delay, uint8_t* reply, size_t reply_size);
+public:
+	static const ddc_timing_t default_timing;
+	static uint8_t Checksum(uint8_t seed, span<const uint8_t> data);
+	nvDdcEngine(nvI2cTransport* transport, const ddc_timing_t& timing = default_timing)
+		: transport(transport), timing(timing) {};
+	void SetTiming(const ddc_timing_t& new_timing) { timing = new_timing; };
+	const ddc_stats_t& GetStats() { return stats; };
+	void ResetStats() { stats = { 0 }; };
+	bool GetVcpFeature(uint8_t code, uint16_t* current, uint16_t* max);
+	bool SetVcpFeature(uint8_t code, uint16_t value);
+	bool GetCapabilities(string& caps);
+};
+
+// A simulated DDC/CI monitor, which enforces the same timing rules as the engine and
+// replies with a null message when it's being polled too early, like real hardware does.
+class nvDdcSimulator : public nvI2cTransport {
+private:
+	struct vcp_value {
+		uint16_t current;
+		uint16_t max;
+	};
+	map<uint8_t, vcp_value> vcp;
+	string caps;
+	uint64_t clock = 0;
+	uint64_t reply_ready_time = 0;
+	uint32_t min_reply_delay;
+	uint32_t corrupt_every = 0;
+	uint32_t num_replies = 0;
+	bool connected = true;
+	uint8_t reply[DDC_MAX_PAYLOAD + 3] = { 0 };
+	size_t reply_size = 0;
+	void SetReply(span<const uint8_t> payload);
+public:
+	nvDdcSimulator(const string& caps, uint32_t min_reply_delay = 40)
+		: caps(caps), min_reply_delay(min_reply_delay) {};
+	void SetVcp(uint8_t code, uint16_t current, uint16_t max) { vcp[code] = { current, max }; };
+	uint16_t GetVcp(uint8_t code) { return vcp.contains(code) ? vcp[code].current : 0; };
+	// Corrupt the checksum of every n-th reply (0 to disable)
+	void SetCorruption(uint32_t n) { corrupt_every = n; };
+	// A disconnected monitor doesn't acknowledge anything on the bus
+	void SetConnected(bool c) { connected = c; };
+	bool Write(uint8_t address, span<const uint8_t> data) override;
+	bool Read(uint8_t address, span<uint8_t> data) override;
+	uint64_t Now() override { return clock; };
+	void Delay(uint32_t ms) override { clock += ms; };
+};
@@ -34,15 +34,20 @@
 
 #include <format>
 #include <list>
-#include <numeric>
+#include <algorithm>
 #include <cassert>
 
 #include "nvDisplay.hpp"
+#include "nvStorage.hpp"
+#include "nvEventLog.hpp"
 
 using namespace std::chrono;
 
 #pragma comment(lib, "synchronization.lib")
 
+bool nvDisplay::use_hybrid = false;
+save_stats_t nvDisplay::save_stats = { 0 };
+
 // Calculates a Gamma Ramp value, for a specific color, at an index in range [0-1023], for
 // use with NvAPI_DISP_SetTargetGammaCorrection() in the same way nVidia does.
 static NvF32 CalculateGamma(NvS32 index, NvF32 brightness, NvF32 contrast, NvF32 gamma)
@@ -71,38 +76,49 @@ static NvF32 CalculateGamma(NvS32 index, NvF32 brightness, NvF32 contrast, NvF32
 nvDisplay::nvDisplay(uint32_t display_id)
 :nvMonitor(display_id)
 {
-	this->display_id = display_id;
 	PopulateDisplayName();
 	active_luid = GetLuid();
 
 	// TODO: Do we want to report the GPU name/number and GPU output port here as well?
-	logger("Detected '%S' [%S]", display_name.data(), device_name[0] != 0 ? device_name : L"Unknown");
-	if (home_input != 0)
-		logger(" using input %s\n", InputToString(home_input));
-	else
-		logger("\n");
-	if (product_code != 0)
-		logger("Product Code: 0x%04X, S/N: %s, Manufactured: %s\n", product_code, serial_number.c_str(), mfg_date.c_str());
-	logger("nVidia display ID: 0x%08x, nVidia LUID: %u\n", display_id, GetLuid());
-
-	// Retrieve the list of LUIDs we have found to be associated with this display.
-	wchar_t* multi_sz = ReadRegistryKeyMultiStr(HKEY_CURRENT_USER, format(L"NVID_{:#08x}", display_id).c_str());
-	const wchar_t* p = multi_sz;
-	while (*p != L'\0') {
-		known_luids.insert(static_cast<uint32_t>(stoul(p)));
-		p += wcslen(p) + 1;
+	if (event_log.IsEnabled()) {
+		event_log.Emit(evDisplayDetected, display_id, display_name.data(), device_name[0] != 0 ? device_name : L"Unknown",
+			InputToString(home_input), product_code, serial_number.c_str(), mfg_date.c_str(), active_luid);
+	} else {
+		logger("Detected '%S' [%S]", display_name.data(), device_name[0] != 0 ? device_name : L"Unknown");
+		if (home_input != 0)
+			logger(" using input %s\n", InputToString(home_input));
+		else
+			logger("\n");
+		if (product_code != 0)
+			logger("Product Code: 0x%04X, S/N: %s, Manufactured: %s\n", product_code, serial_number.c_str(), mfg_date.c_str());
+		logger("nVidia display ID: 0x%08x, nVidia LUID: %u\n", display_id, GetLuid());
 	}
+
+	// Retrieve the LUIDs we have found to be associated with this monitor
+	identity.Open(nvIdentity::Key(GetEdid(), display_id), display_id, active_luid);
 	LoadColorSettings();
 }
 
+nvDisplay::~nvDisplay()
+{
+	// On exit, the worker has already restored the backlight, but a display can also go away
+	// while it's in hybrid mode
+	if (hybrid.IsEnabled()) {
+		ExitHybrid();
+		SaveColorSettings();
+	}
+	FlushColorSettings();
+}
+
 void nvDisplay::PopulateDisplayName()
 {
 	// If we got data from the EDID, just build the name from it and return
-	if (model_name != "" && vendor_name != "") {
+	string model = GetModelName();
+	if (model != "" && vendor_name != "") {
 		for (char c : vendor_name)
 			display_name.push_back(c);
 		display_name.push_back(L' ');
-		for (char c : model_name)
+		for (char c : model)
 			display_name.push_back(c);
 		display_name.push_back(L'\0');
 		return;
@@ -170,9 +186,9 @@ bool nvDisplay::UpdateLuids()
 	uint32_t current_luid = GetLuid();
 	bool luid_changed = (current_luid != active_luid);
 	if (luid_changed) {
-		logger("Display %S switched to LUID: %u\n", display_name.data(), current_luid);
+		event_log.Emit(evLuidChanged, display_id, display_name.data(), current_luid);
 		active_luid = current_luid;
-		known_luids.insert(active_luid);
+		identity.Touch(active_luid);
 	}
 	return luid_changed;
 }
@@ -185,8 +201,68 @@ float nvDisplay::GetBrightness()
 	return brightness / 3.0f;
 }
 
+// Return the brightness level, in percent of the range we can cover
+float nvDisplay::GetLevel()
+{
+	if (hybrid.IsEnabled())
+		return hybrid.GetLevel();
+	return (GetBrightness() - 80.0f) * 5.0f;
+}
+
+void nvDisplay::SetGammaBrightness(float brightness)
+{
+	for (auto Color = 0; Color < nvColorMax; Color++)
+		color_setting[nvAttrBrightness][Color] = brightness;
+}
+
+bool nvDisplay::GetLuminance(uint16_t* current, uint16_t* max)
+{
+	return SupportsVcpFeature(VCP_LUMINANCE) && GetVcpFeature(VCP_LUMINANCE, current, max);
+}
+
+bool nvDisplay::SetLuminance(uint16_t value)
+{
+	if (SetVcpFeature(VCP_LUMINANCE, value))
+		return true;
+	event_log.Emit(evSetLuminanceFailed, display_id, display_name.data(), GetLastError());
+	return false;
+}
+
+uint64_t nvDisplay::Now()
+{
+	return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Give the backlight back the way we found it, and carry the level over to the gamma range,
+// so that the brightness doesn't jump around when hybrid mode is turned off
+void nvDisplay::ExitHybrid()
+{
+	SetGammaBrightness(hybrid.Disable());
+}
+
+// Switch between hybrid and gamma only, if the setting changed, so that the level we get
+// and set afterwards is in the right scale
+void nvDisplay::UpdateHybridMode()
+{
+	if (use_hybrid == hybrid.IsEnabled())
+		return;
+	if (!use_hybrid)
+		ExitHybrid();
+	else if (hybrid.Enable(GetBrightness()))
+		event_log.Emit(evHybridEnabled, display_id, display_name.data(),
+			(uint16_t)lroundf(hybrid.GetBacklight() * hybrid.GetLuminanceMax() / 100.0f), hybrid.GetLuminanceMax());
+}
+
 void nvDisplay::ChangeBrightness(float delta)
 {
+	UpdateHybridMode();
+
+	if (hybrid.IsEnabled()) {
+		SetGammaBrightness(hybrid.ChangeLevel(delta));
+		event_log.Emit(evBrightnessChanged, display_id, hybrid.GetLevel());
+		return;
+	}
+
 	for (auto Color = 0; Color < nvColorMax; Color++) {
 		color_setting[nvAttrBrightness][Color] += delta;
 		if (color_setting[nvAttrBrightness][Color] < 80.0f)
@@ -194,6 +270,42 @@ void nvDisplay::ChangeBrightness(float delta)
 		if (color_setting[nvAttrBrightness][Color] > 100.0f)
 			color_setting[nvAttrBrightness][Color] = 100.0f;
 	}
+	event_log.Emit(evBrightnessChanged, display_id, color_setting[nvAttrBrightness][nvColorRed]);
+}
+
+// Set the brightness level, in percent of the range we can cover. Either way, a brightness
+// delta of 1.0 moves the level by 5%.
+void nvDisplay::SetLevel(float target)
+{
+	UpdateHybridMode();
+	ChangeBrightness((clamp(target, 0.0f, 100.0f) - GetLevel()) / 5.0f);
+}
+
+// Write the hybrid backlight target to the monitor, if needed and if we haven't written it too
+// recently. Returns 0 if the backlight is up to date, or the number of ms to wait before retrying.
+uint32_t nvDisplay::UpdateBacklight()
+{
+	float gamma_brightness;
+
+	if (!hybrid.IsPending())
+		return 0;
+
+	uint32_t delay = hybrid.Update(&gamma_brightness);
+	if (delay == 0) {
+		SetGammaBrightness(gamma_brightness);
+		UpdateGamma();
+	}
+	return delay;
+}
+
+// Give the backlight back before we exit, since nothing else would
+void nvDisplay::RestoreBacklight()
+{
+	if (!hybrid.IsEnabled())
+		return;
+	ExitHybrid();
+	UpdateGamma();
+	SaveColorSettings();
 }
 
 bool nvDisplay::UpdateGamma()
@@ -217,7 +329,7 @@ bool nvDisplay::UpdateGamma()
 
 	r = NvAPI_DISP_SetTargetGammaCorrection(display_id, &gamma_correction);
 	if (r != NVAPI_OK)
-		logger("NvAPI_DISP_SetTargetGammaCorrection failed for display 0x%08x: %d %s\n", display_id, r, NvAPI_GetErrorString(r));
+		event_log.Emit(evSetGammaFailed, display_id, display_id, r, NvAPI_GetErrorString(r));
 
 	return (r == NVAPI_OK);
 }
@@ -231,11 +343,13 @@ void nvDisplay::LoadColorSettings()
 		for (auto i = 0; i < 9; i++)
 			color_setting[i / 3][i % 3] = 100.0f;
 	} else {
+		// All the values live under the same key
+		nvStorageBatch batch(storage);
 		for (auto i = 0; i < 9; i++) {
 			_snwprintf_s(reg_color_key_str, ARRAYSIZE(reg_color_key_str), _TRUNCATE,
 				L"Software\\NVIDIA Corporation\\Global\\NVTweak\\Devices\\%u-0\\Color\\%u",
 				luid, NV_COLOR_REGISTRY_INDEX + i);
-			color_setting[i / 3][i % 3] = (float)ReadRegistryKey32(HKEY_CURRENT_USER, reg_color_key_str);
+			color_setting[i / 3][i % 3] = (float)storage->Read32(reg_color_key_str);
 			// Set the default value if we couldn't read the key or it's out of bounds
 			if (color_setting[i / 3][i % 3] < 80.0f || color_setting[i / 3][i % 3] > 120.0f)
 				color_setting[i / 3][i % 3] = 100.0f;
@@ -243,40 +357,52 @@ void nvDisplay::LoadColorSettings()
 	}
 }
 
+// Saving is deferred: we only mark the settings dirty here, and it's up to the caller to
+// call FlushColorSettings() once the user is done changing the brightness, which avoids
+// writing to the registry for every single keypress.
 void nvDisplay::SaveColorSettings()
 {
 	uint32_t current_luid = GetLuid();
-	wchar_t reg_color_key_str[128];
 
 	// I sure want to know if we get in a situation where we fail to detect LUID changes
 	assert(current_luid == active_luid);
 
-	// Update and save the LUID list if needed
-	if (!known_luids.contains(active_luid)) {
-		known_luids.insert(active_luid);
-		wstring multi_sz = accumulate(
-			known_luids.begin(), known_luids.end(), wstring{},
-			[](wstring acc, uint32_t value) {
-				acc += to_wstring(value);
-				acc.push_back(L'\0');
-				return acc;
-			}
-		);
-		multi_sz.push_back(L'\0');
-		WriteRegistryKeyMultiStr(HKEY_CURRENT_USER, format(L"NVID_{:#08x}", display_id).c_str(), multi_sz.c_str());
+	save_stats.requests++;
+	settings_dirty = true;
+}
+
+bool nvDisplay::FlushColorSettings()
+{
+	wchar_t reg_color_key_str[128], value_names[9][16];
+	storage_dword_t values[10];
+	bool r = true;
+
+	if (!settings_dirty)
+		return true;
+
+	nvStorageBatch batch(storage);
+	// Update and save the identity index if needed (this is a no-op if nothing changed)
+	identity.Touch(active_luid);
+	identity.Save();
+
+	for (auto i = 0; i < 9; i++) {
+		_snwprintf_s(value_names[i], ARRAYSIZE(value_names[i]), _TRUNCATE, L"%u", NV_COLOR_REGISTRY_INDEX + i);
+		values[i] = { value_names[i], (int32_t)color_setting[i / 3][i % 3] };
 	}
+	// Add the NvCplGammaSet key to indicate that Gamma should be restored by the nVidia driver
+	values[9] = { L"NvCplGammaSet", 1 };
 
-	// Update all the LUIDs known for this display
-	for (auto& luid : known_luids) {
-		for (auto i = 0; i < 9; i++) {
-			_snwprintf_s(reg_color_key_str, ARRAYSIZE(reg_color_key_str), _TRUNCATE,
-				L"Software\\NVIDIA Corporation\\Global\\NVTweak\\Devices\\%u-0\\Color\\%u",
-				luid, NV_COLOR_REGISTRY_INDEX + i);
-			WriteRegistryKey32(HKEY_CURRENT_USER, reg_color_key_str, (uint32_t)color_setting[i / 3][i % 3]);
-		}
-		// Add the NvCplGammaSet key to indicate that Gamma should be restored by the nVidia driver
+	// Update all the LUIDs known for this display, of which there are at most IDENTITY_MAX_LUIDS,
+	// with all the values for a LUID written in one go
+	for (auto& luid : identity.GetLuids()) {
 		_snwprintf_s(reg_color_key_str, ARRAYSIZE(reg_color_key_str), _TRUNCATE,
-			L"Software\\NVIDIA Corporation\\Global\\NVTweak\\Devices\\%u-0\\Color\\NvCplGammaSet", luid);
-		WriteRegistryKey32(HKEY_CURRENT_USER, reg_color_key_str, 1);
+			L"Software\\NVIDIA Corporation\\Global\\NVTweak\\Devices\\%u-0\\Color", luid);
+		r = storage->Write32Batch(reg_color_key_str, values) && r;
+		save_stats.values_written += ARRAYSIZE(values);
 	}
+	save_stats.flushes++;
+	// Keep the settings dirty if any write failed, so that the next flush retries them
+	if (r)
+		settings_dirty = false;
+	return r;
 }
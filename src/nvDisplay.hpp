@@ -24,29 +24,57 @@
 #include <stdint.h>
 #include <string>
 #include <future>
-#include <set>
 
 #include "nvBrightness.h"
 #include "nvMonitor.hpp"
+#include "nvIdentity.hpp"
+#include "nvHybrid.hpp"
+
+// How long we wait for brightness changes to settle before writing the color settings, in ms
+#define FLUSH_SETTINGS_DELAY        2000
 
 using namespace std;
 
-class nvDisplay : public nvMonitor {
-	uint32_t display_id;
+typedef struct {
+	uint32_t requests;          // Calls to SaveColorSettings()
+	uint32_t flushes;           // Actual writes of the color settings of a display
+	uint32_t values_written;
+} save_stats_t;
+
+class nvDisplay : public nvMonitor, public nvBacklight {
 	vector<wchar_t> display_name;
-	set<uint32_t> known_luids;
+	nvIdentity identity;
 	uint32_t active_luid;
 	float color_setting[nvAttrMax][nvColorMax];
+	bool settings_dirty = false;
+	static save_stats_t save_stats;
+	static bool use_hybrid;
+	nvHybrid hybrid{ this };
 	void PopulateDisplayName();
+	void ExitHybrid();
+	bool GetLuminance(uint16_t* current, uint16_t* max) override;
+	bool SetLuminance(uint16_t value) override;
+	uint64_t Now() override;
+	void UpdateHybridMode();
+	void SetGammaBrightness(float);
 public:
+	static void EnableHybrid(bool enable) { use_hybrid = enable; };
 	nvDisplay(uint32_t);
+	~nvDisplay();
+	static const save_stats_t& GetSaveStats() { return save_stats; };
 	uint32_t GetDisplayId() { return display_id; };
 	uint32_t GetLuid();
 	wchar_t* GetDisplayName() { return display_name.data(); };
 	float GetBrightness();
+	float GetLevel();
+	bool IsHybrid() { return hybrid.IsEnabled(); };
+	uint32_t UpdateBacklight();
+	void RestoreBacklight();
 	bool UpdateGamma();
 	bool UpdateLuids();
 	void ChangeBrightness(float);
+	void SetLevel(float);
 	void LoadColorSettings();
 	void SaveColorSettings();
+	bool FlushColorSettings();
 };
@@ -0,0 +1,228 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "nvEdid.hpp"
+
+static const uint8_t edid_header[8] = { 0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00 };
+
+// CTA-861 data block tags
+#define CTA_TAG_VSDB                3
+#define CTA_TAG_EXTENDED            7
+#define CTA_EXT_TAG_VSVDB           0x01
+#define CTA_EXT_TAG_COLORIMETRY     0x05
+#define CTA_EXT_TAG_HDR_STATIC      0x06
+
+void nvEdid::Reset()
+{
+	data = span<const uint8_t>();
+	num_blocks = 0;
+	bad_checksums = 0;
+	vendor_code = product_code = year = 0;
+	serial = 0;
+	week = version = revision = 0;
+	model = serial_string = string_view();
+	range = {};
+	cta_revision = cta_flags = 0;
+	colorimetry = 0;
+	hdr = {};
+	num_vsdb = 0;
+	displayid_version = 0;
+	num_displayid_blocks = 0;
+}
+
+// All the bytes of an EDID block (or of a DisplayID section) must add up to 0 (mod 256)
+bool nvEdid::IsChecksumValid(span<const uint8_t> block)
+{
+	uint8_t sum = 0;
+	for (auto b : block)
+		sum += b;
+	return sum == 0;
+}
+
+// Descriptor strings are up to 13 characters, terminated by 0x0a and padded with spaces
+string_view nvEdid::DescriptorString(span<const uint8_t> desc)
+{
+	string_view s((const char*)&desc[5], 13);
+	auto end = s.find('\n');
+	if (end != string_view::npos)
+		s = s.substr(0, end);
+	while (!s.empty() && (s.back() == ' ' || s.back() == '\0'))
+		s.remove_suffix(1);
+	return s;
+}
+
+// An 18 byte display descriptor, from the base block
+void nvEdid::ParseDescriptor(span<const uint8_t> desc)
+{
+	// Detailed timing descriptors have a non-zero pixel clock
+	if (desc[0] != 0x00 || desc[1] != 0x00 || desc[2] != 0x00)
+		return;
+
+	switch (desc[3]) {
+	case 0xfc:
+		model = DescriptorString(desc);
+		break;
+	case 0xff:
+		serial_string = DescriptorString(desc);
+		break;
+	case 0xfd:
+		// Byte 4 has flags for EDID 1.4, telling us to add 255 to the min/max rates
+		range.present = true;
+		range.min_vfreq = desc[5] + ((desc[4] & 0x01) ? 255 : 0);
+		range.max_vfreq = desc[6] + ((desc[4] & 0x02) ? 255 : 0);
+		range.min_hfreq = desc[7] + ((desc[4] & 0x04) ? 255 : 0);
+		range.max_hfreq = desc[8] + ((desc[4] & 0x08) ? 255 : 0);
+		range.max_pixel_clock = desc[9] * 10;
+		break;
+	default:
+		break;
+	}
+}
+
+// CTA-861 extension: a header, then a collection of data blocks, up to the offset of the
+// first detailed timing descriptor (or the end of the block when there aren't any).
+void nvEdid::ParseCta(span<const uint8_t> block)
+{
+	cta_revision = block[1];
+	cta_flags = block[3];
+	size_t end = block[2];
+	if (end < 4 || end > EDID_BLOCK_SIZE - 1)
+		end = EDID_BLOCK_SIZE - 1;
+
+	for (size_t pos = 4; pos < end; ) {
+		uint8_t tag = block[pos] >> 5;
+		size_t len = block[pos] & 0x1f;
+		if (pos + 1 + len > end)
+			break;
+		auto payload = block.subspan(pos + 1, len);
+		pos += 1 + len;
+		if (tag == CTA_TAG_VSDB && len >= 3) {
+			if (num_vsdb < EDID_MAX_VSDB)
+				vsdb[num_vsdb++] = payload[0] | (payload[1] << 8) | (payload[2] << 16);
+		} else if (tag == CTA_TAG_EXTENDED && len >= 1) {
+			switch (payload[0]) {
+			case CTA_EXT_TAG_VSVDB:
+				// Vendor specific *video* data blocks (e.g. Dolby Vision), which we report with the others
+				if (len >= 4 && num_vsdb < EDID_MAX_VSDB)
+					vsdb[num_vsdb++] = payload[1] | (payload[2] << 8) | (payload[3] << 16);
+				break;
+			case CTA_EXT_TAG_COLORIMETRY:
+				if (len >= 3)
+					colorimetry = payload[1] | ((payload[2] & 0xf0) << 4);
+				break;
+			case CTA_EXT_TAG_HDR_STATIC:
+				if (len < 3)
+					break;
+				hdr.present = true;
+				hdr.eotf = payload[1] & 0x3f;
+				hdr.metadata = payload[2];
+				// Luminance values are optional, and coded as per CTA-861-G section 7.5.13
+				if (len >= 4 && payload[3] != 0)
+					hdr.max_luminance = 50.0f * powf(2.0f, payload[3] / 32.0f);
+				if (len >= 5 && payload[4] != 0)
+					hdr.max_frame_avg = 50.0f * powf(2.0f, payload[4] / 32.0f);
+				if (len >= 6 && hdr.max_luminance != 0.0f)
+					hdr.min_luminance = hdr.max_luminance * powf(payload[5] / 255.0f, 2.0f) / 100.0f;
+				break;
+			default:
+				break;
+			}
+		}
+	}
+}
+
+// DisplayID extension: a DisplayID section (version, payload size, product type, extension
+// count) in bytes 1 to 4, data blocks (tag, revision, size) and a section checksum.
+// Returns false if the section is invalid.
+bool nvEdid::ParseDisplayId(span<const uint8_t> block)
+{
+	size_t section_size = block[2];
+	if (section_size + 5 > EDID_BLOCK_SIZE - 1 || !IsChecksumValid(block.subspan(1, section_size + 5)))
+		return false;
+	displayid_version = block[1];
+
+	for (size_t pos = 5; pos + 3 <= 5 + section_size; ) {
+		size_t len = block[pos + 2];
+		// Padding
+		if (block[pos] == 0 && len == 0)
+			break;
+		if (pos + 3 + len > 5 + section_size)
+			break;
+		if (num_displayid_blocks < EDID_MAX_DISPLAYID_BLOCKS)
+			displayid_blocks[num_displayid_blocks++] = block[pos];
+		pos += 3 + len;
+	}
+	return true;
+}
+
+bool nvEdid::Parse(span<const uint8_t> edid)
+{
+	Reset();
+
+	if (edid.size() < EDID_BLOCK_SIZE || memcmp(edid.data(), edid_header, sizeof(edid_header)) != 0)
+		return false;
+
+	data = edid;
+	auto base = edid.first(EDID_BLOCK_SIZE);
+	if (!IsChecksumValid(base))
+		bad_checksums |= 0x01;
+	vendor_code = (base[8] << 8) | base[9];	// Big endian
+	product_code = base[10] | (base[11] << 8);	// Little endian. Great consistency there!
+	serial = base[12] | (base[13] << 8) | (base[14] << 16) | ((uint32_t)base[15] << 24);
+	week = base[16];
+	year = base[17] + 1990;
+	version = base[18];
+	revision = base[19];
+	// Four 18 byte descriptors, starting at offset 54
+	for (size_t i = 0; i < 4; i++)
+		ParseDescriptor(base.subspan(54 + i * 18, 18));
+
+	num_blocks = min<size_t>(min<size_t>(1 + base[126], edid.size() / EDID_BLOCK_SIZE), EDID_MAX_BLOCKS);
+	for (size_t i = 1; i < num_blocks; i++) {
+		auto block = edid.subspan(i * EDID_BLOCK_SIZE, EDID_BLOCK_SIZE);
+		if (!IsChecksumValid(block)) {
+			bad_checksums |= (1 << i);
+			continue;
+		}
+		switch (block[0]) {
+		case EDID_EXT_CTA:
+			ParseCta(block);
+			break;
+		case EDID_EXT_DISPLAYID:
+			if (!ParseDisplayId(block))
+				bad_checksums |= (1 << i);
+			break;
+		default:
+			break;
+		}
+	}
+	return true;
+}
+
+bool nvEdid::HasVsdb(uint32_t oui)
+{
+	for (size_t i = 0; i < num_vsdb; i++)
+		if (vsdb[i] == oui)
+			return true;
+	return false;
+}
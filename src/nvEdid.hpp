@@ -0,0 +1,120 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include <span>
+#include <string_view>
+
+#define EDID_BLOCK_SIZE             128
+// Maximum number of blocks (base + extensions) we look at
+#define EDID_MAX_BLOCKS             8
+// Maximum number of CTA vendor specific data blocks and DisplayID data blocks we record
+#define EDID_MAX_VSDB               8
+#define EDID_MAX_DISPLAYID_BLOCKS   16
+
+// Extension block tags
+#define EDID_EXT_CTA                0x02
+#define EDID_EXT_DISPLAYID          0x70
+
+// IEEE OUIs of the vendor specific data blocks we know about
+#define EDID_OUI_HDMI               0x000c03
+#define EDID_OUI_HDMI_FORUM         0xc45dd8
+#define EDID_OUI_DOLBY              0x00d046
+
+using namespace std;
+
+// Display range limits (display descriptor 0xfd)
+typedef struct {
+	bool present;
+	uint16_t min_vfreq;         // Hz
+	uint16_t max_vfreq;         // Hz
+	uint16_t min_hfreq;         // kHz
+	uint16_t max_hfreq;         // kHz
+	uint16_t max_pixel_clock;   // MHz
+} edid_range_t;
+
+// CTA-861 HDR static metadata data block
+typedef struct {
+	bool present;
+	uint8_t eotf;               // Bit 0: SDR, 1: traditional HDR, 2: SMPTE ST 2084 (PQ), 3: HLG
+	uint8_t metadata;           // Bit 0: static metadata type 1
+	float max_luminance;        // cd/m², 0 if not provided
+	float max_frame_avg;        // cd/m², 0 if not provided
+	float min_luminance;        // cd/m², 0 if not provided
+} edid_hdr_t;
+
+// Bounds checked parser for an EDID and its extension blocks. Like nvCapabilities, this
+// doesn't allocate, and the strings it reports are views into the data, which the caller
+// must keep around for as long as it uses them.
+class nvEdid {
+private:
+	span<const uint8_t> data;
+	size_t num_blocks = 0;
+	uint8_t bad_checksums = 0;  // Bitmask of the blocks that failed checksum validation
+	uint16_t vendor_code = 0;
+	uint16_t product_code = 0;
+	uint32_t serial = 0;
+	uint8_t week = 0;
+	uint16_t year = 0;
+	uint8_t version = 0, revision = 0;
+	string_view model;
+	string_view serial_string;
+	edid_range_t range = {};
+	uint8_t cta_revision = 0;
+	uint8_t cta_flags = 0;
+	uint16_t colorimetry = 0;
+	edid_hdr_t hdr = {};
+	uint32_t vsdb[EDID_MAX_VSDB] = { 0 };
+	size_t num_vsdb = 0;
+	uint8_t displayid_version = 0;
+	uint8_t displayid_blocks[EDID_MAX_DISPLAYID_BLOCKS] = { 0 };
+	size_t num_displayid_blocks = 0;
+	void Reset();
+	void ParseDescriptor(span<const uint8_t> desc);
+	void ParseCta(span<const uint8_t> block);
+	bool ParseDisplayId(span<const uint8_t> block);
+	static string_view DescriptorString(span<const uint8_t> desc);
+public:
+	static bool IsChecksumValid(span<const uint8_t> block);
+	bool Parse(span<const uint8_t> edid);
+	bool IsValid() { return num_blocks != 0; };
+	bool HasValidChecksums() { return bad_checksums == 0; };
+	span<const uint8_t> GetData() { return data; };
+	size_t GetNumberOfBlocks() { return num_blocks; };
+	uint16_t GetVendorCode() { return vendor_code; };
+	uint16_t GetProductCode() { return product_code; };
+	uint32_t GetSerial() { return serial; };
+	uint8_t GetWeek() { return week; };
+	uint16_t GetYear() { return year; };
+	uint8_t GetVersion() { return version; };
+	uint8_t GetRevision() { return revision; };
+	string_view GetModel() { return model; };
+	string_view GetSerialString() { return serial_string; };
+	const edid_range_t& GetRangeLimits() { return range; };
+	bool HasCta() { return cta_revision != 0; };
+	uint8_t GetCtaFlags() { return cta_flags; };
+	uint16_t GetColorimetry() { return colorimetry; };
+	const edid_hdr_t& GetHdrMetadata() { return hdr; };
+	span<const uint32_t> GetVsdbOuis() { return span<const uint32_t>(vsdb, num_vsdb); };
+	bool HasVsdb(uint32_t oui);
+	uint8_t GetDisplayIdVersion() { return displayid_version; };
+	span<const uint8_t> GetDisplayIdBlocks() { return span<const uint8_t>(displayid_blocks, num_displayid_blocks); };
+};
@@ -0,0 +1,172 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <string.h>
+#include <wchar.h>
+
+#include <algorithm>
+
+#include "nvEventLog.hpp"
+#include "nvLogFile.hpp"
+
+static const char event_log_magic[4] = { 'n', 'v', 'E', 'V' };
+#define EVENT_LOG_HEADER_SIZE       8
+// Largest encoded numeric argument (type + 64-bit value)
+#define EVENT_MAX_NUMBER_SIZE       9
+
+#define EVENT_DEF(id, name, flags, format) { id, flags, format },
+static const event_def_t event_defs[] = {
+	EVENT_LIST(EVENT_DEF)
+};
+#undef EVENT_DEF
+
+const event_def_t* nvEventLog::GetEvent(uint16_t id)
+{
+	// IDs are allocated sequentially, so we can usually index the table directly
+	if (id >= 1 && id <= size(event_defs) && event_defs[id - 1].id == id)
+		return &event_defs[id - 1];
+	for (auto& ev : event_defs)
+		if (ev.id == id)
+			return &ev;
+	return nullptr;
+}
+
+void nvEventLog::PutRaw(uint8_t* buf, size_t& pos, const void* val, size_t size)
+{
+	memcpy(&buf[pos], val, size);
+	pos += size;
+}
+
+void nvEventLog::PutValue(uint8_t* buf, size_t& pos, uint8_t type, const void* val, size_t size)
+{
+	buf[pos++] = type;
+	PutRaw(buf, pos, val, size);
+}
+
+void nvEventLog::PutString(uint8_t* buf, size_t& pos, size_t left, const char* str)
+{
+	size_t room = LOGGER_MAX_MESSAGE - pos - 3 - left * EVENT_MAX_NUMBER_SIZE;
+	uint16_t len = (uint16_t)min({ (str == NULL) ? 0 : strlen(str), (size_t)EVENT_MAX_STRING, room });
+
+	buf[pos++] = EVENT_ARG_STRING;
+	PutRaw(buf, pos, &len, sizeof(len));
+	PutRaw(buf, pos, str, len);
+}
+
+void nvEventLog::PutString(uint8_t* buf, size_t& pos, size_t left, const wchar_t* str)
+{
+	size_t room = (LOGGER_MAX_MESSAGE - pos - 3 - left * EVENT_MAX_NUMBER_SIZE) / sizeof(uint16_t);
+	uint16_t len = (uint16_t)min({ (str == NULL) ? 0 : wcslen(str), (size_t)EVENT_MAX_STRING, room });
+
+	buf[pos++] = EVENT_ARG_WSTRING;
+	PutRaw(buf, pos, &len, sizeof(len));
+	// wchar_t is 32-bit on some platforms
+	for (uint16_t i = 0; i < len; i++) {
+		uint16_t c = (uint16_t)str[i];
+		PutRaw(buf, pos, &c, sizeof(c));
+	}
+}
+
+// Start a new log, with just the header
+bool nvEventLog::Create()
+{
+	char header[EVENT_LOG_HEADER_SIZE] = { 0 };
+	uint16_t version = EVENT_LOG_VERSION;
+
+	file.open(path, ios::binary | ios::trunc);
+	if (!file.is_open())
+		return false;
+	memcpy(header, event_log_magic, sizeof(event_log_magic));
+	memcpy(&header[4], &version, sizeof(version));
+	file.write(header, sizeof(header));
+	log_size = sizeof(header);
+	return true;
+}
+
+// Called from the logger thread only. Records are never split between logs, and we rotate
+// before writing a record that would take the log past its maximum size.
+void nvEventLog::WriteRecord(chrono::system_clock::time_point time, const char* data, size_t data_size)
+{
+	uint16_t record_size = (uint16_t)(sizeof(uint64_t) + data_size);
+	uint64_t us = (uint64_t)chrono::duration_cast<chrono::microseconds>(time.time_since_epoch()).count();
+
+	if (log_size > EVENT_LOG_HEADER_SIZE && log_size + sizeof(record_size) + record_size > max_size) {
+		file.close();
+		nvLogFile::RotateFiles(path, generations);
+		rotations++;
+		if (!Create())
+			return;
+	}
+	if (!file.is_open())
+		return;
+	file.write((const char*)&record_size, sizeof(record_size));
+	file.write((const char*)&us, sizeof(us));
+	file.write(data, data_size);
+	log_size += sizeof(record_size) + record_size;
+}
+
+// Appends to an existing log, unless it was produced by an incompatible version, or is already
+// past its maximum size, in which case it gets rotated
+bool nvEventLog::Open(const filesystem::path& log_path, uint64_t max_log_size, uint32_t num_generations)
+{
+	char header[EVENT_LOG_HEADER_SIZE] = { 0 };
+	uint16_t version = EVENT_LOG_VERSION;
+	error_code ec;
+	bool append = false;
+
+	if (enabled)
+		return true;
+	path = log_path;
+	// A log must at least be able to hold its header and one record
+	max_size = max<uint64_t>(max_log_size, EVENT_LOG_HEADER_SIZE + sizeof(uint16_t) + sizeof(uint64_t) + LOGGER_MAX_MESSAGE);
+	generations = min<uint32_t>(num_generations, LOGFILE_MAX_GENERATIONS);
+	rotations = 0;
+	{
+		ifstream existing(path, ios::binary);
+		if (existing.read(header, sizeof(header)) && memcmp(header, event_log_magic, sizeof(event_log_magic)) == 0 &&
+			memcmp(&header[4], &version, sizeof(version)) == 0)
+			append = true;
+	}
+	log_size = append ? filesystem::file_size(path, ec) : 0;
+	if (append && (ec || log_size >= max_size)) {
+		nvLogFile::RotateFiles(path, generations);
+		rotations++;
+		append = false;
+	}
+	if (append)
+		file.open(path, ios::binary | ios::app);
+	else
+		Create();
+	if (!file.is_open()) {
+		logger("Could not open binary event log\n");
+		return false;
+	}
+	queue.Start([this](chrono::system_clock::time_point time, const char* data, size_t size, bool) {
+		WriteRecord(time, data, size); }, [this] { file.flush(); });
+	enabled = true;
+	return true;
+}
+
+void nvEventLog::Close()
+{
+	if (!enabled)
+		return;
+	enabled = false;
+	queue.Stop();
+	file.close();
+}
@@ -0,0 +1,172 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+
+#include "nvBrightness.h"
+#include "nvLogger.hpp"
+
+// Event flags
+#define EVENT_TEXT                  0x00    // Written to the text log when the binary log is disabled
+#define EVENT_BINARY_ONLY           0x01    // Too frequent for the text log
+
+// Argument types, as stored in the binary log
+#define EVENT_ARG_INT32             'i'
+#define EVENT_ARG_UINT32            'u'
+#define EVENT_ARG_INT64             'I'
+#define EVENT_ARG_UINT64            'U'
+#define EVENT_ARG_FLOAT             'f'
+#define EVENT_ARG_STRING            's'
+#define EVENT_ARG_WSTRING           'S'     // Stored as 16-bit code units
+
+// Maximum length of a string argument, in characters
+#define EVENT_MAX_STRING            128
+#define EVENT_LOG_VERSION           1
+
+// The events we log. The IDs are what ends up in the binary logs, so they must never be changed
+// or reused, and the format must match the arguments, since it is used for the text log as well
+// as by tools/decode_events.py (which parses this list, so keep one event per line).
+#define EVENT_LIST(X) \
+	X(1,  evEnumGpusFailed,         EVENT_TEXT,        "NvAPI_EnumPhysicalGPUs: %d %s\n") \
+	X(2,  evGetDisplayIdsFailed,    EVENT_TEXT,        "NvAPI_GPU_GetConnectedDisplayIds[%d]: %d %s\n") \
+	X(3,  evDisplayIdsAllocFailed,  EVENT_TEXT,        "Could not allocate NV_GPU_DISPLAYIDS array\n") \
+	X(4,  evLuidChanged,            EVENT_TEXT,        "Display %S switched to LUID: %u\n") \
+	X(5,  evHybridEnabled,          EVENT_TEXT,        "Using hybrid brightness for %S (luminance: %d/%d)\n") \
+	X(6,  evSetLuminanceFailed,     EVENT_TEXT,        "Could not set luminance for %S: Error 0x%08x\n") \
+	X(7,  evSetGammaFailed,         EVENT_TEXT,        "NvAPI_DISP_SetTargetGammaCorrection failed for display 0x%08x: %d %s\n") \
+	X(8,  evBrightnessChanged,      EVENT_BINARY_ONLY, "Brightness set to %.1f\n") \
+	X(9,  evGetDisplayHandleFailed, EVENT_TEXT,        "NvAPI_DISP_GetDisplayHandleFromDisplayId(0x%08x): %d %s\n") \
+	X(10, evGetDisplayNameFailed,   EVENT_TEXT,        "NvAPI_GetAssociatedNvidiaDisplayName(0x%08x): %d %s\n") \
+	X(11, evNoPhysicalMonitor,      EVENT_TEXT,        "No physical monitor detected for %s\n") \
+	X(12, evGetHomeInputFailed,     EVENT_TEXT,        "Could not retrieve monitor input for %s: Error 0x%X\n") \
+	X(13, evVcpStats,               EVENT_TEXT,        "VCP for %S: %u DDC reads, %u saved by caching\n") \
+	X(14, evEdidReadFailed,         EVENT_TEXT,        "Failed to read EDID for %S\n") \
+	X(15, evEdidInvalid,            EVENT_TEXT,        "Invalid EDID for %S\n") \
+	X(16, evEdidChecksumMismatch,   EVENT_TEXT,        "EDID checksum mismatch for %S\n") \
+	X(17, evEdidRangeLimits,        EVENT_TEXT,        "%S range limits: %u-%u Hz, %u-%u kHz, %u MHz\n") \
+	X(18, evEdidHdr,                EVENT_TEXT,        "%S HDR: EOTF 0x%02x, %.0f cd/m² max, %.0f cd/m² max average, %.4f cd/m² min\n") \
+	X(19, evCapsParseFailed,        EVENT_TEXT,        "Could not parse VCP capabilities for %S\n") \
+	X(20, evValidInputs,            EVENT_TEXT,        "%s Valid input(s): %s\n") \
+	X(21, evCapsFromCache,          EVENT_TEXT,        "Using cached VCP capabilities for %S\n") \
+	X(22, evCapsTimeout,            EVENT_TEXT,        "Could not get VCP capabilities for %S after %d attempts: Error 0x%08x\n") \
+	X(23, evCapsRetrieved,          EVENT_TEXT,        "Retrieved %S VCP capabilities in %u.%03u seconds (%d %s)\n") \
+	X(24, evCapsUpToDate,           EVENT_TEXT,        "Cached VCP capabilities for %S are up to date\n") \
+	X(25, evCapsFailed,             EVENT_TEXT,        "Could not get VCP capabilities for %S: Error 0x%08x\n") \
+	X(26, evGetInputFailed,         EVENT_TEXT,        "Could not get current input: Error 0x%08x\n") \
+	X(27, evInputConfirmed,         EVENT_TEXT,        "%s confirmed input %s after %u ms (%d %s, settle time now %u ms)\n") \
+	X(28, evInputNotConfirmed,      EVENT_TEXT,        "%s did not confirm input %s after %u ms: Writing it again\n") \
+	X(29, evSetInputFailed,         EVENT_TEXT,        "Could not set input: Error 0x%08x\n") \
+	X(30, evInputNotSwitched,       EVENT_TEXT,        "%s did not switch to input %s\n") \
+	X(31, evInputUnchanged,         EVENT_TEXT,        "Current %s input is the same as requested: Not switching inputs\n") \
+	X(32, evDisplayDetected,        EVENT_BINARY_ONLY, "Detected '%S' [%S] using input %s, Product Code: 0x%04X, S/N: %s, Manufactured: %s, LUID: %u\n")
+
+#define EVENT_ENUM(id, name, flags, format) name = id,
+enum : uint16_t {
+	EVENT_LIST(EVENT_ENUM)
+};
+#undef EVENT_ENUM
+
+using namespace std;
+
+typedef struct {
+	uint16_t id;
+	uint8_t flags;
+	const char* format;
+} event_def_t;
+
+// Optional binary log of the events above. Records are built on the calling thread, which only
+// involves copying the arguments, and written by the logger thread. The file is laid out as
+// follows (little endian):
+//   header: "nvEV" magic, uint16_t version, uint16_t reserved
+//   record: uint16_t size of what follows, uint64_t time (µs since the Unix epoch), uint16_t event ID,
+//           uint32_t nVidia display ID, uint8_t number of arguments, arguments
+//   argument: uint8_t type, then a 32 or 64-bit value, or a uint16_t length and the characters
+// When the binary log is disabled, events are written to the text log, using their format.
+// Like the text log, the binary log is capped in size and rotated, with the same settings.
+class nvEventLog {
+private:
+	filesystem::path path;
+	uint64_t max_size = 0;
+	uint32_t generations = 0;
+	uint64_t log_size = 0;
+	uint32_t rotations = 0;
+	ofstream file;
+	// Must be destroyed before the file, since its thread writes to it
+	nvLogger queue{ LOGGER_MAX_RECORDS, false };
+	atomic<bool> enabled = false;
+	static void PutRaw(uint8_t* buf, size_t& pos, const void* val, size_t size);
+	static void PutValue(uint8_t* buf, size_t& pos, uint8_t type, const void* val, size_t size);
+	// Strings are truncated so that the 'left' arguments that follow are guaranteed to fit
+	static void PutString(uint8_t* buf, size_t& pos, size_t left, const char* str);
+	static void PutString(uint8_t* buf, size_t& pos, size_t left, const wchar_t* str);
+	template <typename T> static void PutArg(uint8_t* buf, size_t& pos, size_t left, T val)
+	{
+		if constexpr (is_enum_v<T>) {
+			int32_t v = (int32_t)val;
+			PutValue(buf, pos, EVENT_ARG_INT32, &v, sizeof(v));
+		} else if constexpr (is_floating_point_v<T>) {
+			float v = (float)val;
+			PutValue(buf, pos, EVENT_ARG_FLOAT, &v, sizeof(v));
+		} else if constexpr (is_integral_v<T> && sizeof(T) > sizeof(uint32_t)) {
+			uint64_t v = (uint64_t)val;
+			PutValue(buf, pos, is_signed_v<T> ? EVENT_ARG_INT64 : EVENT_ARG_UINT64, &v, sizeof(v));
+		} else if constexpr (is_integral_v<T>) {
+			uint32_t v = (uint32_t)val;
+			PutValue(buf, pos, is_signed_v<T> ? EVENT_ARG_INT32 : EVENT_ARG_UINT32, &v, sizeof(v));
+		} else if constexpr (is_convertible_v<T, const char*> || is_convertible_v<T, const wchar_t*>) {
+			PutString(buf, pos, left, val);
+		} else {
+			static_assert(sizeof(T) == 0, "Unsupported event argument type");
+		}
+	}
+	bool Create();
+	void WriteRecord(chrono::system_clock::time_point time, const char* data, size_t data_size);
+public:
+	static const event_def_t* GetEvent(uint16_t id);
+	bool Open(const filesystem::path& log_path, uint64_t max_log_size, uint32_t num_generations);
+	void Close();
+	bool IsEnabled() { return enabled.load(memory_order_relaxed); };
+	// Only meaningful once closed, since the logger thread updates it
+	uint32_t GetRotations() { return rotations; };
+	logger_stats_t GetStats() { return queue.GetStats(); };
+	template <typename... Args> void Emit(uint16_t id, uint32_t display_id, Args... args)
+	{
+		if (!enabled.load(memory_order_relaxed)) {
+			const event_def_t* ev = GetEvent(id);
+			if (ev != nullptr && (ev->flags & EVENT_BINARY_ONLY) == 0)
+				logger(ev->format, args...);
+			return;
+		}
+		uint8_t buf[LOGGER_MAX_MESSAGE];
+		size_t pos = 0, left = sizeof...(args);
+		PutRaw(buf, pos, &id, sizeof(id));
+		PutRaw(buf, pos, &display_id, sizeof(display_id));
+		buf[pos++] = (uint8_t)sizeof...(args);
+		(PutArg(buf, pos, --left, args), ...);
+		queue.Write(buf, pos);
+	}
+};
+
+extern nvEventLog event_log;
@@ -0,0 +1,101 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+
+#include <algorithm>
+
+#include "nvHybrid.hpp"
+
+// Split a hybrid brightness level into a coarse backlight target (rounded up to the next
+// backlight step) and a gamma brightness that dims down from the current backlight. Since
+// the gamma is computed against the *current* backlight rather than the target, it fills
+// in instantly while a slow backlight write is pending.
+void nvHybrid::SplitLevel(float level, float backlight, float* backlight_target, float* gamma_brightness)
+{
+	*backlight_target = min(100.0f, ceilf(level / HYBRID_BACKLIGHT_STEP) * HYBRID_BACKLIGHT_STEP);
+	*gamma_brightness = clamp(100.0f - 20.0f * (backlight - level) / HYBRID_BACKLIGHT_STEP, 80.0f, 100.0f);
+}
+
+// Take over the backlight, starting from the level that matches the current backlight and
+// gamma brightness. Fails if the monitor doesn't let us read its luminance.
+bool nvHybrid::Enable(float gamma_brightness)
+{
+	uint16_t current, max;
+
+	if (enabled)
+		return true;
+	if (!backlight->GetLuminance(&current, &max) || max == 0)
+		return false;
+
+	luminance_max = max;
+	backlight_original = backlight_current = backlight_target = 100.0f * current / max;
+	level = clamp(backlight_current - HYBRID_BACKLIGHT_STEP * (100.0f - gamma_brightness) / 20.0f, 0.0f, 100.0f);
+	written = false;
+	enabled = true;
+	return true;
+}
+
+// Give the backlight back the way we found it, and return the gamma brightness that carries the
+// level over to the gamma range, so that the brightness doesn't jump around when we're done.
+float nvHybrid::Disable()
+{
+	if (!enabled)
+		return 80.0f + level / 5.0f;
+	if (backlight_current != backlight_original)
+		backlight->SetLuminance((uint16_t)lroundf(backlight_original * luminance_max / 100.0f));
+	backlight_current = backlight_target = backlight_original;
+	enabled = false;
+	return 80.0f + level / 5.0f;
+}
+
+// Move the level by 'delta' (in the same units as the gamma brightness, so that a delta of 1.0
+// moves the level by 5%) and return the gamma brightness to apply right away
+float nvHybrid::ChangeLevel(float delta)
+{
+	float gamma_brightness;
+
+	level = clamp(level + 5.0f * delta, 0.0f, 100.0f);
+	SplitLevel(level, backlight_current, &backlight_target, &gamma_brightness);
+	return gamma_brightness;
+}
+
+// Write the backlight target to the monitor, if we haven't written it too recently. Returns 0
+// once the backlight is where it should be, in which case the gamma brightness is rebalanced
+// against it, or the number of ms to wait before calling us again.
+uint32_t nvHybrid::Update(float* gamma_brightness)
+{
+	if (!IsPending())
+		return 0;
+
+	uint64_t now = backlight->Now();
+	if (written && now - last_write < HYBRID_WRITE_INTERVAL)
+		return (uint32_t)(HYBRID_WRITE_INTERVAL - (now - last_write));
+
+	last_write = now;
+	written = true;
+	// If the backlight didn't move, the gamma is still right, but we're not done
+	if (!backlight->SetLuminance((uint16_t)lroundf(backlight_target * luminance_max / 100.0f)))
+		return HYBRID_WRITE_INTERVAL;
+	backlight_current = backlight_target;
+
+	// Now that the backlight has moved, rebalance the gamma part
+	SplitLevel(level, backlight_current, &backlight_target, gamma_brightness);
+	return 0;
+}
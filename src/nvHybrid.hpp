@@ -0,0 +1,70 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// In hybrid brightness mode, the backlight (VCP luminance) provides coarse steps of this
+// size (in percent), and the gamma ramp provides the finer steps in between. Because DDC
+// writes are slow, we don't write the luminance more often than every HYBRID_WRITE_INTERVAL ms.
+#define HYBRID_BACKLIGHT_STEP       10.0f
+#define HYBRID_WRITE_INTERVAL       250
+
+using namespace std;
+
+// Access to the backlight of a monitor. Time is also provided by the backlight, so that the
+// hybrid brightness logic can be run against a simulated monitor on a virtual clock.
+class nvBacklight {
+public:
+	virtual ~nvBacklight() {};
+	virtual bool GetLuminance(uint16_t* current, uint16_t* max) = 0;
+	virtual bool SetLuminance(uint16_t value) = 0;
+	virtual uint64_t Now() = 0;
+};
+
+// Hybrid brightness state of a display: the level (0 to 100%) we split between the backlight
+// and a gamma brightness (80 to 100%, as with the regular gamma only mode), and the backlight
+// writes that are still pending. Not thread safe: this is meant to be used from the hardware
+// worker only.
+class nvHybrid {
+private:
+	nvBacklight* backlight;
+	bool enabled = false;
+	float level = 100.0f;
+	float backlight_current = 100.0f;
+	float backlight_target = 100.0f;
+	float backlight_original = 100.0f;	// What the backlight was before we took it over
+	uint16_t luminance_max = 0;
+	uint64_t last_write = 0;
+	bool written = false;
+public:
+	static void SplitLevel(float level, float backlight, float* backlight_target, float* gamma_brightness);
+	nvHybrid(nvBacklight* backlight) : backlight(backlight) {};
+	bool Enable(float gamma_brightness);
+	float Disable();
+	float ChangeLevel(float delta);
+	uint32_t Update(float* gamma_brightness);
+	bool IsEnabled() { return enabled; };
+	bool IsPending() { return enabled && backlight_target != backlight_current; };
+	float GetLevel() { return level; };
+	float GetBacklight() { return backlight_current; };
+	float GetBacklightTarget() { return backlight_target; };
+	uint16_t GetLuminanceMax() { return luminance_max; };
+};
@@ -0,0 +1,273 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include "icons.hpp"
+#include "nvIcons.hpp"
+
+using namespace chrono;
+
+// The masks of the atlas: the border, the background, and then the 10 digits for each of the
+// positions of the digit layouts, in order
+#define MASK_BORDER                 0
+#define MASK_BACKGROUND             1
+#define MASK_DIGITS                 2
+#define MASK_POSITIONS              7
+#define MASK_MAX                    (MASK_DIGITS + 10 * MASK_POSITIONS)
+
+// The first position of each layout
+static const uint32_t layout_position[ilMax] = { 0, 2, 4 };
+
+// Add the signed area that a line covers to the left of each pixel it crosses, so that the
+// running sum of a row is the exact coverage of each of its pixels
+static void AccumulateLine(float x0, float y0, float x1, float y1, uint32_t size, float* acc)
+{
+	const uint32_t stride = size + 2;
+	float dir = 1.0f;
+
+	if (y0 == y1)
+		return;
+	if (y0 > y1) {
+		swap(x0, x1);
+		swap(y0, y1);
+		dir = -1.0f;
+	}
+	// Anything to the left or to the right of the icon only matters for the winding
+	x0 = clamp(x0, 0.0f, (float)size);
+	x1 = clamp(x1, 0.0f, (float)size);
+	const float dxdy = (x1 - x0) / (y1 - y0);
+	float x = x0;
+	if (y0 < 0.0f) {
+		x -= y0 * dxdy;
+		y0 = 0.0f;
+	}
+	y1 = min(y1, (float)size);
+
+	for (uint32_t y = (uint32_t)max(y0, 0.0f); y < size && y < y1; y++) {
+		float* line = &acc[y * stride];
+		float dy = min((float)y + 1.0f, y1) - max((float)y, y0);
+		float xnext = x + dxdy * dy, d = dy * dir;
+		float xl = min(x, xnext), xr = max(x, xnext);
+		uint32_t il = (uint32_t)xl, ir = (uint32_t)ceilf(xr);
+		if (ir <= il + 1) {
+			// The line stays within a single pixel on this row
+			float xm = 0.5f * (x + xnext) - il;
+			line[il] += d * (1.0f - xm);
+			line[il + 1] += d * xm;
+		} else {
+			// Split the trapezoid the line sweeps between the pixels it crosses
+			float s = 1.0f / (xr - xl), fl = xl - il, fr = xr - ir + 1.0f;
+			float a0 = 0.5f * s * (1.0f - fl) * (1.0f - fl), am = 0.5f * s * fr * fr;
+			line[il] += d * a0;
+			if (ir == il + 2) {
+				line[il + 1] += d * (1.0f - a0 - am);
+			} else {
+				float a1 = s * (1.5f - fl);
+				line[il + 1] += d * (a1 - a0);
+				for (uint32_t i = il + 2; i < ir - 1; i++)
+					line[i] += d * s;
+				line[ir - 1] += d * (1.0f - (a1 + (ir - il - 3) * s) - am);
+			}
+			line[ir] += d * am;
+		}
+		x = xnext;
+	}
+}
+
+// Non-zero fill of a shape, translated by (dx, dy) in viewBox units. Coverage is the exact area
+// of each pixel that the shape covers, which assumes that contours don't overlap one another.
+void nvIcons::Rasterize(uint32_t shape, float dx, float dy, uint8_t* mask)
+{
+	vector<float> acc((size_t)size * (size + 2), 0.0f);
+	float scale = size / ICON_VIEWBOX_SIZE;
+
+	auto point = [&](const float* p) {
+		return pair<float, float>((p[0] + dx - ICON_VIEWBOX_X) * scale, (p[1] + dy - ICON_VIEWBOX_Y) * scale);
+	};
+	auto add_line = [&](pair<float, float> a, pair<float, float> b) {
+		AccumulateLine(a.first, a.second, b.first, b.second, size, acc.data());
+	};
+
+	// Flatten the contours into lines
+	for (uint32_t c = 0; c < icon_shapes[shape].count; c++) {
+		auto& contour = icon_contours[icon_shapes[shape].first + c];
+		auto last = point(icon_points[contour.first]);
+		for (uint32_t i = 1; i + 2 < contour.count; i += 3) {
+			auto p0 = last, p1 = point(icon_points[contour.first + i]), p2 = point(icon_points[contour.first + i + 1]),
+				p3 = point(icon_points[contour.first + i + 2]);
+			for (int s = 1; s <= ICON_CURVE_SEGMENTS; s++) {
+				float t = (float)s / ICON_CURVE_SEGMENTS, u = 1.0f - t;
+				pair<float, float> p = {
+					u * u * u * p0.first + 3 * u * u * t * p1.first + 3 * u * t * t * p2.first + t * t * t * p3.first,
+					u * u * u * p0.second + 3 * u * u * t * p1.second + 3 * u * t * t * p2.second + t * t * t * p3.second
+				};
+				add_line(last, p);
+				last = p;
+			}
+		}
+		add_line(last, point(icon_points[contour.first]));
+	}
+
+	for (uint32_t y = 0; y < size; y++) {
+		float sum = 0.0f;
+		for (uint32_t x = 0; x < size; x++) {
+			sum += acc[y * (size + 2) + x];
+			mask[y * size + x] = (uint8_t)lroundf(min(fabsf(sum), 1.0f) * 255.0f);
+		}
+	}
+}
+
+// Rebuild the atlas if the size changed, which is the only time we allocate anything
+bool nvIcons::SetSize(uint32_t new_size)
+{
+	new_size = clamp<uint32_t>(new_size, 16, ICON_MAX_SIZE);
+	if (new_size == size)
+		return false;
+
+	auto start = steady_clock::now();
+	Clear();
+	size = new_size;
+	atlas.assign((size_t)MASK_MAX * size * size, 0);
+	Rasterize(isBorder, 0.0f, 0.0f, GetMask(MASK_BORDER));
+	Rasterize(isBackground, 0.0f, 0.0f, GetMask(MASK_BACKGROUND));
+	for (uint32_t layout = 0; layout < ilMax; layout++) {
+		for (uint32_t i = 0; i < ((layout == ilHundreds) ? 3u : 2u); i++) {
+			for (uint32_t digit = 0; digit < 10; digit++)
+				Rasterize(isDigit0 + digit, icon_digit_x[layout][i], ICON_DIGIT_Y,
+					GetMask(MASK_DIGITS + (layout_position[layout] + i) * 10 + digit));
+		}
+	}
+
+#if defined(_WIN32)
+	// The color bitmap is what we render into, before creating each icon. The mask is unused,
+	// since our icons have an alpha channel, but it still needs to be provided.
+	BITMAPINFO bmi = { 0 };
+	bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader);
+	bmi.bmiHeader.biWidth = size;
+	bmi.bmiHeader.biHeight = -(LONG)size;
+	bmi.bmiHeader.biPlanes = 1;
+	bmi.bmiHeader.biBitCount = 32;
+	bmi.bmiHeader.biCompression = BI_RGB;
+	color = CreateDIBSection(NULL, &bmi, DIB_RGB_COLORS, (void**)&bits, NULL, 0);
+	vector<uint8_t> mask_bits(((size + 15) / 16) * 2 * size, 0);
+	mask = CreateBitmap(size, size, 1, 1, mask_bits.data());
+#endif
+
+	stats.atlas_builds++;
+	stats.atlas_us = (uint32_t)duration_cast<microseconds>(steady_clock::now() - start).count();
+	stats.size = size;
+	return true;
+}
+
+// Render the icon for a level into 'out', as top-down BGRA with straight alpha. The digits show
+// the level in percent, and the border gets brighter with the level.
+void nvIcons::Render(float level, uint32_t* out)
+{
+	const uint8_t* digit_masks[3] = { nullptr };
+	uint32_t value, layout, digits[3], num_digits;
+	float shade;
+
+	level = clamp(isfinite(level) ? level : 0.0f, 0.0f, 100.0f);
+	value = (uint32_t)lroundf(level);
+	shade = level * ICON_BORDER_MAX_SHADE / 100.0f;
+	if (value == 100) {
+		layout = ilHundreds;
+		num_digits = 3;
+		digits[0] = 1; digits[1] = 0; digits[2] = 0;
+	} else {
+		num_digits = 2;
+		digits[0] = value / 10;
+		digits[1] = value % 10;
+		layout = (digits[0] == 1) ? ilTeens : ilNormal;
+	}
+	for (uint32_t i = 0; i < num_digits; i++)
+		digit_masks[i] = GetMask(MASK_DIGITS + (layout_position[layout] + i) * 10 + digits[i]);
+
+	const uint8_t* border = GetMask(MASK_BORDER);
+	const uint8_t* background = GetMask(MASK_BACKGROUND);
+	const float layers[3][3] = {
+		{ shade, shade, shade },
+		{ (ICON_BACKGROUND_COLOR >> 16) & 0xff, (ICON_BACKGROUND_COLOR >> 8) & 0xff, ICON_BACKGROUND_COLOR & 0xff },
+		{ (ICON_DIGIT_COLOR >> 16) & 0xff, (ICON_DIGIT_COLOR >> 8) & 0xff, ICON_DIGIT_COLOR & 0xff },
+	};
+	for (size_t i = 0; i < (size_t)size * size; i++) {
+		uint32_t d = 0;
+		for (uint32_t j = 0; j < num_digits; j++)
+			d += digit_masks[j][i];
+		const float coverage[3] = { border[i] / 255.0f, background[i] / 255.0f, min(d, 255u) / 255.0f };
+		// Blend the layers over one another, with straight alpha
+		float a = 0.0f, rgb[3] = { 0.0f, 0.0f, 0.0f };
+		for (int l = 0; l < 3; l++) {
+			float na = coverage[l] + a * (1.0f - coverage[l]);
+			if (na <= 0.0f)
+				continue;
+			for (int c = 0; c < 3; c++)
+				rgb[c] = (layers[l][c] * coverage[l] + rgb[c] * a * (1.0f - coverage[l])) / na;
+			a = na;
+		}
+		// Quantize through 8-bit premultiplied values, as the original icons were
+		uint32_t alpha = (uint32_t)lroundf(a * 255.0f), color[3] = { 0, 0, 0 };
+		for (int c = 0; alpha != 0 && c < 3; c++)
+			color[c] = min((uint32_t)(rgb[c] * a) * 255 / alpha, 255u);
+		out[i] = (alpha << 24) | (color[0] << 16) | (color[1] << 8) | color[2];
+	}
+}
+
+#if defined(_WIN32)
+// Icons are only created the first time a value is displayed, and belong to the cache
+HICON nvIcons::GetIcon(float level)
+{
+	uint32_t value = (uint32_t)lroundf(clamp(isfinite(level) ? level : 0.0f, 0.0f, 100.0f));
+
+	if (cache[value] != NULL) {
+		stats.cache_hits++;
+		return cache[value];
+	}
+	if (bits == nullptr)
+		return NULL;
+	Render((float)value, bits);
+	GdiFlush();
+	ICONINFO info = { .fIcon = TRUE, .hbmMask = mask, .hbmColor = color };
+	cache[value] = CreateIconIndirect(&info);
+	stats.renders++;
+	return cache[value];
+}
+#endif
+
+void nvIcons::Clear()
+{
+#if defined(_WIN32)
+	for (auto& icon : cache) {
+		if (icon != NULL)
+			DestroyIcon(icon);
+		icon = NULL;
+	}
+	if (color != NULL)
+		DeleteObject(color);
+	if (mask != NULL)
+		DeleteObject(mask);
+	color = mask = NULL;
+	bits = nullptr;
+#endif
+	size = 0;
+}
@@ -0,0 +1,73 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+#include <stdint.h>
+
+#include <vector>
+
+// Tray icons are cached for each value they can display, from 0 to 100%
+#define ICON_CACHE_SIZE             101
+// How many segments each Bézier curve gets flattened into
+#define ICON_CURVE_SEGMENTS         16
+#define ICON_MAX_SIZE               256
+
+using namespace std;
+
+typedef struct {
+	uint64_t renders;
+	uint64_t cache_hits;
+	uint32_t atlas_builds;
+	uint32_t atlas_us;          // How long the last atlas took to build
+	uint32_t size;
+} icon_stats_t;
+
+// Tray icons, rendered from the geometry of icons/*.svg (see icons.hpp), for any level. Since
+// the icons only differ by the shade of their border and their digits, we rasterize the border,
+// the background and every digit at every position once per icon size, into an atlas of
+// coverage masks, after which rendering an icon for a level is only a matter of blending the
+// masks into a buffer that we reuse. Not thread safe: this is meant to be used from the UI
+// thread only.
+class nvIcons {
+private:
+	uint32_t size = 0;
+	vector<uint8_t> atlas;
+	icon_stats_t stats = { 0 };
+#if defined(_WIN32)
+	HICON cache[ICON_CACHE_SIZE] = { 0 };
+	HBITMAP color = NULL, mask = NULL;
+	uint32_t* bits = nullptr;
+#endif
+	uint8_t* GetMask(uint32_t index) { return &atlas[(size_t)index * size * size]; };
+	void Rasterize(uint32_t shape, float dx, float dy, uint8_t* mask);
+public:
+	~nvIcons() { Clear(); };
+	bool SetSize(uint32_t new_size);
+	uint32_t GetSize() { return size; };
+	void Render(float level, uint32_t* out);
+#if defined(_WIN32)
+	HICON GetIcon(float level);
+#endif
+	void Clear();
+	const icon_stats_t& GetStats() { return stats; };
+};
@@ -0,0 +1,204 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include <string.h>
+#include <wchar.h>
+
+#include "nvBrightness.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "nvIdentity.hpp"
+#include "nvStorage.hpp"
+
+// The storage value is laid out as follows (little endian):
+//   uint8_t version, uint8_t number of display IDs, uint8_t number of LUIDs, uint8_t reserved
+//   uint32_t display_ids[]
+//   { uint32_t luid, uint32_t last_seen } luids[]
+#define IDENTITY_HEADER_SIZE        4
+#define IDENTITY_MAX_SIZE           (IDENTITY_HEADER_SIZE + 4 * IDENTITY_MAX_DISPLAY_IDS + 8 * IDENTITY_MAX_LUIDS)
+
+static __inline uint32_t Today()
+{
+	return (uint32_t)chrono::duration_cast<chrono::days>(chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// FNV-1a of the vendor, product, serial and descriptor serial. Unlike nvCache::Fingerprint(),
+// this doesn't change when the monitor gets a firmware update or a different mode list.
+// Monitors we can't read an EDID from fall back to being identified by their display ID,
+// which we also add for monitors that have no serial at all, so that two identical ones
+// don't end up sharing an entry.
+uint64_t nvIdentity::Key(nvEdid& edid, uint32_t display_id)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	auto add = [&](const void* data, size_t size) {
+		for (size_t i = 0; i < size; i++) {
+			hash ^= ((const uint8_t*)data)[i];
+			hash *= 0x100000001b3ULL;
+		}
+	};
+
+	if (!edid.IsValid())
+		return 0xffffffff00000000ULL | display_id;
+	uint16_t vendor = edid.GetVendorCode(), product = edid.GetProductCode();
+	uint32_t serial = edid.GetSerial();
+	add(&vendor, sizeof(vendor));
+	add(&product, sizeof(product));
+	add(&serial, sizeof(serial));
+	add(edid.GetSerialString().data(), edid.GetSerialString().size());
+	if (serial == 0 && edid.GetSerialString().empty())
+		add(&display_id, sizeof(display_id));
+	return hash;
+}
+
+wstring nvIdentity::GetValueName()
+{
+	wchar_t name[32];
+	swprintf(name, size(name), L"ID_%016llx", (unsigned long long)key);
+	return name;
+}
+
+bool nvIdentity::Load()
+{
+	uint8_t buf[IDENTITY_MAX_SIZE];
+	size_t size = storage->Get(GetValueName().c_str(), STORAGE_BINARY, buf, sizeof(buf));
+
+	if (size < IDENTITY_HEADER_SIZE || buf[0] != IDENTITY_VERSION || buf[1] > IDENTITY_MAX_DISPLAY_IDS ||
+		buf[2] > IDENTITY_MAX_LUIDS || size != (size_t)(IDENTITY_HEADER_SIZE + 4 * buf[1] + 8 * buf[2]))
+		return false;
+	const uint8_t* p = &buf[IDENTITY_HEADER_SIZE];
+	for (int i = 0; i < buf[1]; i++, p += 4) {
+		uint32_t id;
+		memcpy(&id, p, 4);
+		display_ids.push_back(id);
+	}
+	for (int i = 0; i < buf[2]; i++, p += 8) {
+		luid_entry e;
+		memcpy(&e.luid, p, 4);
+		memcpy(&e.last_seen, p + 4, 4);
+		luids.push_back(e);
+	}
+	return true;
+}
+
+// Import the LUIDs from the legacy NVID_{display_id} list, which we then remove. That list
+// doesn't tell when a LUID was last seen, so apart from the one in use, which gets touched
+// first, the LUIDs that are kept are the first ones of the list.
+void nvIdentity::Migrate(uint32_t display_id, uint32_t luid)
+{
+	wchar_t legacy_name[32];
+	swprintf(legacy_name, size(legacy_name), L"NVID_0x%06x", display_id);
+	wstring multi_sz = storage->ReadMultiStr(legacy_name);
+	const wchar_t* p = multi_sz.c_str();
+
+	if (*p == L'\0')
+		return;
+	for (; *p != L'\0'; p += wcslen(p) + 1)
+		luids.push_back({ (uint32_t)wcstoul(p, NULL, 10), 0 });
+	logger("Migrated %zu LUID(s) from %S\n", luids.size(), legacy_name);
+	Touch(luid);
+	Prune();
+	dirty = true;
+	if (Save())
+		storage->Delete(legacy_name);
+}
+
+void nvIdentity::Open(uint64_t identity_key, uint32_t display_id, uint32_t luid)
+{
+	key = identity_key;
+	display_ids.clear();
+	luids.clear();
+	dirty = false;
+
+	if (!Load())
+		Migrate(display_id, luid);
+	Touch(luid);
+
+	// Keep the display ID we were opened with first
+	auto it = find(display_ids.begin(), display_ids.end(), display_id);
+	if (display_ids.empty() || it != display_ids.begin()) {
+		if (it != display_ids.end())
+			display_ids.erase(it);
+		display_ids.insert(display_ids.begin(), display_id);
+		if (display_ids.size() > IDENTITY_MAX_DISPLAY_IDS)
+			display_ids.pop_back();
+		dirty = true;
+	}
+}
+
+// Drop the least recently seen LUIDs, past the ones we keep
+void nvIdentity::Prune()
+{
+	stable_sort(luids.begin(), luids.end(),
+		[](const luid_entry& a, const luid_entry& b) { return a.last_seen > b.last_seen; });
+	while (luids.size() > IDENTITY_MAX_LUIDS) {
+		logger("Pruning stale LUID %u\n", luids.back().luid);
+		luids.pop_back();
+		dirty = true;
+	}
+}
+
+// Mark a LUID as the one in use. Returns true if we didn't know about it.
+bool nvIdentity::Touch(uint32_t luid)
+{
+	if (luid == 0)
+		return false;
+
+	auto it = find_if(luids.begin(), luids.end(), [luid](const luid_entry& e) { return e.luid == luid; });
+	bool is_new = (it == luids.end());
+	if (!is_new && it == luids.begin())
+		return false;
+	if (!is_new)
+		luids.erase(it);
+	luids.insert(luids.begin(), { luid, Today() });
+	Prune();
+	dirty = true;
+	return is_new;
+}
+
+bool nvIdentity::Save()
+{
+	uint8_t buf[IDENTITY_MAX_SIZE] = { IDENTITY_VERSION, (uint8_t)display_ids.size(), (uint8_t)luids.size(), 0 };
+	uint8_t* p = &buf[IDENTITY_HEADER_SIZE];
+
+	if (!dirty || key == 0)
+		return true;
+	for (auto id : display_ids) {
+		memcpy(p, &id, 4);
+		p += 4;
+	}
+	for (auto& e : luids) {
+		memcpy(p, &e.luid, 4);
+		memcpy(p + 4, &e.last_seen, 4);
+		p += 8;
+	}
+	if (!storage->Set(GetValueName().c_str(), STORAGE_BINARY, buf, p - buf))
+		return false;
+	dirty = false;
+	return true;
+}
+
+vector<uint32_t> nvIdentity::GetLuids()
+{
+	vector<uint32_t> r;
+	for (auto& e : luids)
+		r.push_back(e.luid);
+	return r;
+}
@@ -0,0 +1,61 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "nvEdid.hpp"
+
+// How many display IDs and LUIDs we remember per monitor. LUIDs are pruned least recently
+// seen first, so that the cost of saving color settings doesn't grow with the history.
+#define IDENTITY_MAX_DISPLAY_IDS    4
+#define IDENTITY_MAX_LUIDS          4
+#define IDENTITY_VERSION            1
+
+using namespace std;
+
+// Index of the display IDs and LUIDs the nVidia driver has used for a specific monitor, keyed
+// by a fingerprint of the identity fields of its EDID, so that we can follow it through driver
+// and port reshuffles. Persisted as a small binary storage value per monitor.
+class nvIdentity {
+private:
+	struct luid_entry {
+		uint32_t luid;
+		uint32_t last_seen;     // In days since the epoch
+	};
+	uint64_t key = 0;
+	vector<uint32_t> display_ids;
+	vector<luid_entry> luids;   // Most recently seen first
+	bool dirty = false;
+	wstring GetValueName();
+	bool Load();
+	void Migrate(uint32_t display_id, uint32_t luid);
+	void Prune();
+public:
+	static uint64_t Key(nvEdid& edid, uint32_t display_id);
+	void Open(uint64_t identity_key, uint32_t display_id, uint32_t luid = 0);
+	bool Touch(uint32_t luid);
+	bool Save();
+	uint64_t GetKey() { return key; };
+	const vector<uint32_t>& GetDisplayIds() { return display_ids; };
+	vector<uint32_t> GetLuids();
+};
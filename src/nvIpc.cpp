@@ -0,0 +1,413 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#if !defined(_WIN32)
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <string.h>
+
+#include <algorithm>
+#include <sstream>
+#include <utility>
+
+#include "nvBrightness.h"
+#include "nvIpc.hpp"
+
+#if defined(_WIN32)
+static HANDLE CreatePipeInstance(const filesystem::path& path, bool first)
+{
+	// Creating the first instance with FILE_FLAG_FIRST_PIPE_INSTANCE ensures that we don't
+	// end up sharing the name with a pipe that another process created.
+	return CreateNamedPipeW(path.c_str(), PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED |
+		(first ? FILE_FLAG_FIRST_PIPE_INSTANCE : 0), PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT |
+		PIPE_REJECT_REMOTE_CLIENTS, PIPE_UNLIMITED_INSTANCES, IPC_BUFFER_SIZE, IPC_BUFFER_SIZE, 0, NULL);
+}
+
+// Wait for an overlapped operation, whether it completed right away or not. Returns false if
+// it failed, including when it was cancelled or the pipe got disconnected.
+static bool WaitForIo(HANDLE handle, OVERLAPPED* ov, BOOL started, DWORD* n)
+{
+	if (!started && GetLastError() != ERROR_IO_PENDING)
+		return false;
+	return GetOverlappedResult(handle, ov, n, TRUE);
+}
+#endif
+
+nvIpc::connection::~connection()
+{
+	if (thread.joinable())
+		thread.join();
+#if defined(_WIN32)
+	if (handle != INVALID_HANDLE_VALUE)
+		CloseHandle(handle);
+	if (read_event != NULL)
+		CloseHandle(read_event);
+	if (write_event != NULL)
+		CloseHandle(write_event);
+#else
+	if (fd >= 0)
+		close(fd);
+#endif
+}
+
+int nvIpc::Read(connection& c, char* buffer, size_t size)
+{
+#if defined(_WIN32)
+	OVERLAPPED ov = {};
+	DWORD n = 0;
+	ov.hEvent = c.read_event;
+	if (!WaitForIo(c.handle, &ov, ReadFile(c.handle, buffer, (DWORD)size, NULL, &ov), &n))
+		return -1;
+	return (int)n;
+#else
+	ssize_t n;
+	do {
+		n = recv(c.fd, buffer, size, 0);
+	} while (n < 0 && errno == EINTR);
+	return (int)n;
+#endif
+}
+
+// Replies and events may be written from different threads, so a write must not be split
+bool nvIpc::Write(connection& c, const string& data)
+{
+	lock_guard<mutex> lock(c.write_mutex);
+	size_t written = 0;
+
+	while (written < data.size()) {
+#if defined(_WIN32)
+		OVERLAPPED ov = {};
+		DWORD n = 0;
+		ov.hEvent = c.write_event;
+		if (!WaitForIo(c.handle, &ov, WriteFile(c.handle, &data[written], (DWORD)(data.size() - written), NULL, &ov), &n))
+			return false;
+#else
+		ssize_t n = send(c.fd, &data[written], data.size() - written, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+#endif
+		written += n;
+	}
+	return true;
+}
+
+// Make any pending or future I/O on the connection fail, without closing its handle
+void nvIpc::Disconnect(connection& c)
+{
+#if defined(_WIN32)
+	DisconnectNamedPipe(c.handle);
+#else
+	shutdown(c.fd, SHUT_RDWR);
+#endif
+}
+
+void nvIpc::Accept(shared_ptr<connection> c)
+{
+	lock_guard<mutex> lock(ipc_mutex);
+
+	// This is also where we get rid of the connections that are done
+	connections.remove_if([](auto& c) { return c->done.load(); });
+	if (connections.size() >= IPC_MAX_CLIENTS) {
+		Write(*c, "error too many clients\n");
+		Disconnect(*c);
+		return;
+	}
+	connections.push_back(c);
+	stats.connections++;
+	stats.max_clients = max(stats.max_clients, (uint32_t)connections.size());
+	// The connection outlives its thread, since it only gets destroyed once its thread is done
+	c->thread = jthread([this, conn = c.get()](stop_token st) { Serve(*conn, st); });
+}
+
+// Hand the requests over to the handler and append its replies
+void nvIpc::Handle(vector<ipc_request_t>& requests, string& replies)
+{
+	if (requests.empty())
+		return;
+	handler(requests);
+	for (auto& request : requests) {
+		replies += request.reply.empty() ? "error no reply" : request.reply;
+		replies += '\n';
+	}
+	requests.clear();
+	lock_guard<mutex> lock(ipc_mutex);
+	stats.batches++;
+}
+
+void nvIpc::Serve(connection& c, stop_token st)
+{
+	char data[IPC_BUFFER_SIZE];
+	string buffer, replies, line, arg;
+	vector<ipc_request_t> requests, batch;
+	size_t start, end, batch_size = 0;
+	bool in_batch = false, quit = false;
+	int n;
+
+	while (!quit && !st.stop_requested() && (n = Read(c, data, sizeof(data))) > 0) {
+		buffer.append(data, n);
+		for (start = 0; !quit && (end = buffer.find('\n', start)) != string::npos; start = end + 1) {
+			ipc_request_t request;
+			line = buffer.substr(start, end - start);
+			istringstream iss(line);
+			while (iss >> arg)
+				request.args.push_back(arg);
+			if (request.args.empty())
+				continue;
+			{
+				lock_guard<mutex> lock(ipc_mutex);
+				stats.requests++;
+			}
+			// Anything we answer here must come after the replies to the requests before it
+			const string cmd = request.args[0];
+			if (cmd == "begin" || cmd == "commit" || cmd == "subscribe" || cmd == "quit")
+				Handle(requests, replies);
+			if (cmd == "begin") {
+				if (in_batch)
+					replies += "error already in a batch\n";
+				in_batch = true;
+			} else if (cmd == "commit") {
+				if (!in_batch) {
+					replies += "error not in a batch\n";
+				} else if (batch_size > IPC_MAX_BATCH) {
+					// We still owe one reply per request
+					for (size_t i = 0; i < batch_size; i++)
+						replies += "error batch too large\n";
+				} else {
+					Handle(batch, replies);
+				}
+				batch.clear();
+				batch_size = 0;
+				in_batch = false;
+			} else if (cmd == "subscribe") {
+				c.subscribed = true;
+				replies += "ok\n";
+			} else if (cmd == "quit") {
+				quit = true;
+			} else if (in_batch) {
+				if (++batch_size <= IPC_MAX_BATCH)
+					batch.push_back(move(request));
+			} else {
+				requests.push_back(move(request));
+			}
+		}
+		buffer.erase(0, start);
+		if (buffer.size() > IPC_MAX_LINE) {
+			Handle(requests, replies);
+			replies += "error line too long\n";
+			quit = true;
+		}
+		// Everything that came in together gets handled, and answered, together
+		Handle(requests, replies);
+		if (!replies.empty() && !Write(c, replies))
+			break;
+		replies.clear();
+	}
+
+#if defined(_WIN32)
+	// Make sure the client gets our last replies before we disconnect
+	if (quit)
+		FlushFileBuffers(c.handle);
+#endif
+	Disconnect(c);
+	c.done = true;
+}
+
+void nvIpc::Listen(stop_token st)
+{
+	while (!st.stop_requested()) {
+		auto c = make_shared<connection>();
+#if defined(_WIN32)
+		HANDLE pipe = (pending != INVALID_HANDLE_VALUE) ? exchange(pending, INVALID_HANDLE_VALUE) :
+			CreatePipeInstance(path, false);
+		if (pipe == INVALID_HANDLE_VALUE) {
+			logger("IPC: Could not create pipe instance: Error 0x%08x\n", GetLastError());
+			break;
+		}
+		c->handle = pipe;
+		c->read_event = CreateEventW(NULL, TRUE, FALSE, NULL);
+		c->write_event = CreateEventW(NULL, TRUE, FALSE, NULL);
+		if (c->read_event == NULL || c->write_event == NULL) {
+			logger("IPC: Could not create events: Error 0x%08x\n", GetLastError());
+			break;
+		}
+		OVERLAPPED ov = {};
+		DWORD n;
+		ov.hEvent = c->read_event;
+		// A client that connected before we called ConnectNamedPipe() is reported as an error
+		if (!ConnectNamedPipe(pipe, &ov) && GetLastError() != ERROR_PIPE_CONNECTED &&
+			!WaitForIo(pipe, &ov, FALSE, &n))
+			continue;
+#else
+		c->fd = accept(listen_fd, NULL, NULL);
+		if (c->fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			break;
+		}
+#endif
+		if (st.stop_requested())
+			break;
+		Accept(c);
+	}
+	listening = false;
+}
+
+// Send the events to the subscribers from a thread of its own, so that a client that doesn't
+// read them can't hold up whoever notified them
+void nvIpc::Publish(stop_token st)
+{
+	unique_lock<mutex> lock(ipc_mutex);
+	string data;
+
+	while (event_cv.wait(lock, st, [this] { return !events.empty(); })) {
+		data.clear();
+		for (auto& event : events)
+			data += "event " + event + "\n";
+		events.clear();
+		auto targets = connections;
+		lock.unlock();
+		for (auto& c : targets) {
+			if (c->subscribed && !c->done)
+				Write(*c, data);
+		}
+		targets.clear();
+		lock.lock();
+	}
+}
+
+bool nvIpc::Start(const filesystem::path& ipc_path, function<void(vector<ipc_request_t>&)> handler_fn)
+{
+	Stop();
+	path = ipc_path;
+	handler = move(handler_fn);
+
+#if defined(_WIN32)
+	pending = CreatePipeInstance(path, true);
+	if (pending == INVALID_HANDLE_VALUE) {
+		logger("IPC: Could not create %S: Error 0x%08x\n", path.c_str(), GetLastError());
+		return false;
+	}
+#else
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	if (path.native().size() >= sizeof(addr.sun_path))
+		return false;
+	strcpy(addr.sun_path, path.c_str());
+	listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (listen_fd < 0)
+		return false;
+	unlink(path.c_str());
+	if (bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(listen_fd, IPC_MAX_CLIENTS) < 0) {
+		logger("IPC: Could not listen on %s: %s\n", path.c_str(), strerror(errno));
+		close(listen_fd);
+		listen_fd = -1;
+		return false;
+	}
+#endif
+
+	{
+		lock_guard<mutex> lock(ipc_mutex);
+		running = true;
+	}
+	listening = true;
+	listener = jthread([this](stop_token st) { Listen(st); });
+	publisher = jthread([this](stop_token st) { Publish(st); });
+	return true;
+}
+
+void nvIpc::Stop()
+{
+	list<shared_ptr<connection>> remaining;
+
+	if (!listener.joinable())
+		return;
+
+	// Wake the listener up
+	listener.request_stop();
+#if defined(_WIN32)
+	// By connecting to it. We may have to retry if it was in between two pipe instances.
+	while (listening) {
+		HANDLE h = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+		if (h != INVALID_HANDLE_VALUE)
+			CloseHandle(h);
+		else
+			Sleep(10);
+	}
+#else
+	shutdown(listen_fd, SHUT_RDWR);
+#endif
+	listener.join();
+#if defined(_WIN32)
+	if (pending != INVALID_HANDLE_VALUE)
+		CloseHandle(exchange(pending, INVALID_HANDLE_VALUE));
+#else
+	close(listen_fd);
+	listen_fd = -1;
+	unlink(path.c_str());
+#endif
+
+	{
+		lock_guard<mutex> lock(ipc_mutex);
+		running = false;
+		events.clear();
+		remaining.swap(connections);
+	}
+	for (auto& c : remaining) {
+		c->thread.request_stop();
+		Disconnect(*c);
+	}
+	publisher.request_stop();
+	publisher.join();
+#if defined(_WIN32)
+	// Disconnecting fails the I/O in progress, but a thread may have been about to start one
+	for (auto& c : remaining) {
+		while (!c->done) {
+			CancelIoEx(c->handle, NULL);
+			Sleep(10);
+		}
+	}
+#endif
+	// This joins the connection threads
+	remaining.clear();
+}
+
+void nvIpc::Notify(const string& event)
+{
+	lock_guard<mutex> lock(ipc_mutex);
+
+	if (!running || none_of(connections.begin(), connections.end(), [](auto& c) { return c->subscribed.load(); }))
+		return;
+	if (events.size() >= IPC_MAX_EVENTS) {
+		events.pop_front();
+		stats.events_dropped++;
+	}
+	events.push_back(event);
+	stats.events++;
+	event_cv.notify_one();
+}
+
+ipc_stats_t nvIpc::GetStats()
+{
+	lock_guard<mutex> lock(ipc_mutex);
+	return stats;
+}
@@ -0,0 +1,129 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <stdint.h>
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+// On Windows, we listen on a named pipe that only accepts local clients. Pipe names are global
+// to the machine, so the name gets suffixed with "-<session ID>", to keep the instances running
+// in other sessions (fast user switching, remote desktop) apart. Elsewhere, a UNIX socket stands
+// in for the pipe, so that the protocol can be tested.
+#define IPC_PIPE_NAME               L"\\\\.\\pipe\\nvBrightness"
+#define IPC_MAX_CLIENTS             8
+#define IPC_MAX_LINE                1024
+#define IPC_MAX_BATCH               64
+// Events that may be waiting to be sent to subscribers, before we start dropping the oldest
+#define IPC_MAX_EVENTS              256
+#define IPC_BUFFER_SIZE             4096
+
+using namespace std;
+
+typedef struct {
+	vector<string> args;
+	string reply;               // Set by the handler: "ok ..." or "error ...", which may span several lines
+} ipc_request_t;
+
+typedef struct {
+	uint64_t connections;
+	uint64_t requests;
+	uint64_t batches;           // Calls to the handler
+	uint64_t events;
+	uint64_t events_dropped;
+	uint32_t max_clients;
+} ipc_stats_t;
+
+// Local control interface. The protocol is line based, with space separated arguments, and
+// every request gets a reply, in order, so that requests can be pipelined:
+//   list                  -> "ok <count>" followed by "display <index> <level> <input> <name>" lines
+//   get <display>         -> "ok <level>"
+//   set <display> <level> -> "ok <level>", where the level is in percent, as for the tray icon
+//   input <display> <in>  -> "ok <input>", where <in> is an input name or code, home, next or prev
+//   subscribe             -> "ok", after which we send "event <brightness|input|displays> ..." lines
+//   begin ... commit      -> the requests in between are handled together, and answered on commit
+//   quit
+// <display> is an index from list, or "active". Errors are reported as "error <message>".
+// Requests that arrive together are handed over together to the handler, which runs on the
+// connection's thread and must be thread safe.
+class nvIpc {
+private:
+	// The handle remains valid until the connection is destroyed, once its thread is done
+	struct connection {
+#if defined(_WIN32)
+		// Pipe instances are opened for overlapped I/O, since synchronous I/O on a pipe handle is
+		// serialized, which would have our writes wait for the read that is always pending. Reads
+		// and writes (serialized by write_mutex) each have an event of their own.
+		HANDLE handle = INVALID_HANDLE_VALUE;
+		HANDLE read_event = NULL;
+		HANDLE write_event = NULL;
+#else
+		int fd = -1;
+#endif
+		jthread thread;
+		mutex write_mutex;
+		atomic<bool> subscribed = false;
+		atomic<bool> done = false;
+		~connection();
+	};
+	filesystem::path path;
+	function<void(vector<ipc_request_t>&)> handler;
+	mutex ipc_mutex;
+	condition_variable_any event_cv;
+	list<shared_ptr<connection>> connections;
+	deque<string> events;
+	jthread listener;
+	jthread publisher;
+	atomic<bool> listening = false;
+	bool running = false;
+#if defined(_WIN32)
+	HANDLE pending = INVALID_HANDLE_VALUE;
+#else
+	int listen_fd = -1;
+#endif
+	ipc_stats_t stats = { 0 };
+	static int Read(connection& c, char* buffer, size_t size);
+	static bool Write(connection& c, const string& data);
+	static void Disconnect(connection& c);
+	void Accept(shared_ptr<connection> c);
+	void Handle(vector<ipc_request_t>& requests, string& replies);
+	void Serve(connection& c, stop_token st);
+	void Listen(stop_token st);
+	void Publish(stop_token st);
+public:
+	~nvIpc() { Stop(); };
+	bool Start(const filesystem::path& ipc_path, function<void(vector<ipc_request_t>&)> handler_fn);
+	void Stop();
+	void Notify(const string& event);
+	ipc_stats_t GetStats();
+};
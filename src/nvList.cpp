@@ -18,6 +18,7 @@
  */
 
 #include "nvList.hpp"
+#include "nvEventLog.hpp"
 
 bool nvList::Update()
 {
@@ -33,7 +34,7 @@ bool nvList::Update()
 
 	r = NvAPI_EnumPhysicalGPUs(gpu_handles, &gpu_count);
 	if (r != NVAPI_OK) {
-		logger("NvAPI_EnumPhysicalGPUs: %d %s\n", r, NvAPI_GetErrorString(r));
+		event_log.Emit(evEnumGpusFailed, 0, r, NvAPI_GetErrorString(r));
 		goto out;
 	}
 
@@ -42,7 +43,7 @@ bool nvList::Update()
 
 		r = NvAPI_GPU_GetConnectedDisplayIds(gpu_handles[i], NULL, &display_count, 0);
 		if (r != NVAPI_OK) {
-			logger("NvAPI_GPU_GetConnectedDisplayIds[%d]: %d %s\n", i, r, NvAPI_GetErrorString(r));
+			event_log.Emit(evGetDisplayIdsFailed, 0, i, r, NvAPI_GetErrorString(r));
 			continue;
 		}
 
@@ -51,14 +52,14 @@ bool nvList::Update()
 
 		NV_GPU_DISPLAYIDS* display_ids = (NV_GPU_DISPLAYIDS*)calloc(display_count, sizeof(NV_GPU_DISPLAYIDS));
 		if (display_ids == NULL) {
-			logger("Could not allocate NV_GPU_DISPLAYIDS array\n");
+			event_log.Emit(evDisplayIdsAllocFailed, 0);
 			goto out;
 		}
 		display_ids[0].version = NV_GPU_DISPLAYIDS_VER;
 
 		r = NvAPI_GPU_GetConnectedDisplayIds(gpu_handles[i], display_ids, &display_count, 0);
 		if (r != NVAPI_OK) {
-			logger("NvAPI_GPU_GetConnectedDisplayIds[%d]: %d %s\n", i, r, NvAPI_GetErrorString(r));
+			event_log.Emit(evGetDisplayIdsFailed, 0, i, r, NvAPI_GetErrorString(r));
 		} else for (NvU32 j = 0; j < display_count; j++) {
 			bool found = false;
 			for (auto& display : displays) {
@@ -0,0 +1,239 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <string.h>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <string>
+
+#include "nvLogFile.hpp"
+
+// Map the segment that starts at 'offset', extending the file as needed
+bool nvLogFile::MapSegment(uint64_t offset)
+{
+	Unmap();
+#if defined(_WIN32)
+	uint64_t end = offset + LOGFILE_SEGMENT_SIZE;
+	mapping = CreateFileMapping(file, NULL, PAGE_READWRITE, (DWORD)(end >> 32), (DWORD)end, NULL);
+	if (mapping == NULL)
+		return false;
+	view = (uint8_t*)MapViewOfFile(mapping, FILE_MAP_WRITE, (DWORD)(offset >> 32), (DWORD)offset, LOGFILE_SEGMENT_SIZE);
+	if (view == nullptr) {
+		CloseHandle(mapping);
+		mapping = NULL;
+		return false;
+	}
+#else
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+		return false;
+	if ((uint64_t)st.st_size < offset + LOGFILE_SEGMENT_SIZE && ftruncate(fd, (off_t)(offset + LOGFILE_SEGMENT_SIZE)) != 0)
+		return false;
+	void* p = mmap(NULL, LOGFILE_SEGMENT_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, (off_t)offset);
+	if (p == MAP_FAILED)
+		return false;
+	view = (uint8_t*)p;
+#endif
+	view_offset = offset;
+	stats.segments_mapped++;
+	return true;
+}
+
+void nvLogFile::Unmap()
+{
+	if (view == nullptr)
+		return;
+#if defined(_WIN32)
+	UnmapViewOfFile(view);
+	CloseHandle(mapping);
+	mapping = NULL;
+#else
+	munmap(view, LOGFILE_SEGMENT_SIZE);
+#endif
+	view = nullptr;
+}
+
+// Text logs don't contain NULs, so the data ends after the last non NUL byte. Since the file
+// only ever gets extended by one segment, we should only have to look at the last segment, but
+// we don't assume so.
+uint64_t nvLogFile::FindEnd(uint64_t file_size)
+{
+	uint64_t offset = (file_size == 0) ? 0 : (file_size - 1) & ~((uint64_t)LOGFILE_SEGMENT_SIZE - 1);
+
+	while (MapSegment(offset)) {
+		size_t len = (size_t)min<uint64_t>(file_size - offset, LOGFILE_SEGMENT_SIZE);
+		while (len > 0 && view[len - 1] == 0)
+			len--;
+		if (len > 0 || offset == 0)
+			return offset + len;
+		offset -= LOGFILE_SEGMENT_SIZE;
+	}
+	return 0;
+}
+
+bool nvLogFile::OpenFile()
+{
+	uint64_t file_size;
+
+#if defined(_WIN32)
+	LARGE_INTEGER li;
+	file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+		OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	if (!GetFileSizeEx(file, &li)) {
+		CloseFile();
+		return false;
+	}
+	file_size = (uint64_t)li.QuadPart;
+#else
+	struct stat st;
+	fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+	if (fd < 0)
+		return false;
+	if (fstat(fd, &st) != 0) {
+		CloseFile();
+		return false;
+	}
+	file_size = (uint64_t)st.st_size;
+#endif
+
+	// Trailing NULs means that the previous session didn't close the log. If it was in the
+	// middle of a line, we terminate that line, so that the next message starts on its own.
+	// Note that FindEnd() leaves the segment that holds the last byte mapped.
+	size = FindEnd(file_size);
+	bool recovered = (size != file_size);
+	bool partial_line = recovered && size != 0 && view != nullptr && view[size - view_offset - 1] != '\n';
+	if (!MapSegment(size & ~((uint64_t)LOGFILE_SEGMENT_SIZE - 1))) {
+		CloseFile();
+		return false;
+	}
+	if (recovered)
+		stats.recovered++;
+	if (partial_line)
+		Write("\n", 1, false);
+	return true;
+}
+
+// Trim the file to the data we wrote, which requires the view and mapping to be closed first
+void nvLogFile::CloseFile()
+{
+	Unmap();
+#if defined(_WIN32)
+	if (file != INVALID_HANDLE_VALUE) {
+		LARGE_INTEGER li;
+		li.QuadPart = (LONGLONG)size;
+		if (SetFilePointerEx(file, li, NULL, FILE_BEGIN))
+			SetEndOfFile(file);
+		CloseHandle(file);
+		file = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (fd >= 0) {
+		// Nothing we can do if this fails, besides leaving NULs at the end of the log
+		(void)!ftruncate(fd, (off_t)size);
+		close(fd);
+		fd = -1;
+	}
+#endif
+}
+
+filesystem::path nvLogFile::GetGenerationPath(const filesystem::path& path, uint32_t generation)
+{
+	filesystem::path p = path;
+	p.replace_filename(path.stem().native() + filesystem::path("." + to_string(generation)).native() +
+		path.extension().native());
+	return p;
+}
+
+// Shift the older logs by one generation, dropping the oldest, and move the current one to the
+// first generation. The file must be closed.
+void nvLogFile::RotateFiles(const filesystem::path& path, uint32_t generations)
+{
+	error_code ec;
+
+	if (generations == 0) {
+		filesystem::remove(path, ec);
+		return;
+	}
+	filesystem::remove(GetGenerationPath(path, generations), ec);
+	for (uint32_t i = generations - 1; i >= 1; i--)
+		filesystem::rename(GetGenerationPath(path, i), GetGenerationPath(path, i + 1), ec);
+	filesystem::rename(path, GetGenerationPath(path, 1), ec);
+}
+
+// Called from Write(), on the logger thread, so the producers just keep queuing messages
+// while we rename the older logs.
+void nvLogFile::Rotate()
+{
+	CloseFile();
+	RotateFiles(path, generations);
+	stats.rotations++;
+	OpenFile();
+}
+
+bool nvLogFile::Open(const filesystem::path& log_path, uint64_t max_log_size, uint32_t num_generations)
+{
+	Close();
+	path = log_path;
+	max_size = max<uint64_t>(max_log_size, LOGFILE_SEGMENT_SIZE);
+	generations = min<uint32_t>(num_generations, LOGFILE_MAX_GENERATIONS);
+	if (!OpenFile())
+		return false;
+	if (size >= max_size)
+		Rotate();
+	return IsOpen();
+}
+
+bool nvLogFile::Write(const char* data, size_t len, bool can_rotate)
+{
+	if (view == nullptr)
+		return false;
+	if (can_rotate && size != 0 && size + len > max_size) {
+		Rotate();
+		if (view == nullptr)
+			return false;
+	}
+
+	while (len > 0) {
+		uint64_t pos = size - view_offset;
+		if (pos >= LOGFILE_SEGMENT_SIZE) {
+			if (!MapSegment(view_offset + LOGFILE_SEGMENT_SIZE))
+				return false;
+			pos = 0;
+		}
+		size_t n = (size_t)min<uint64_t>(len, LOGFILE_SEGMENT_SIZE - pos);
+		memcpy(&view[pos], data, n);
+		data += n;
+		len -= n;
+		size += n;
+		stats.bytes_written += n;
+	}
+	return true;
+}
+
+void nvLogFile::Close()
+{
+	CloseFile();
+}
@@ -0,0 +1,83 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <stdint.h>
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+#include <filesystem>
+
+// Log files are appended through a mapped view of this size, which must be a multiple of the
+// allocation granularity (64 KB on Windows). The default maximum size and number of older logs
+// we keep can be overridden with the LogMaxSize (in KB) and LogGenerations registry settings.
+#define LOGFILE_SEGMENT_SIZE        (64 * 1024)
+#define LOGFILE_DEFAULT_MAX_SIZE    (4 * 1024 * 1024)
+#define LOGFILE_DEFAULT_GENERATIONS 3
+#define LOGFILE_MAX_GENERATIONS     9
+
+using namespace std;
+
+typedef struct {
+	uint64_t bytes_written;
+	uint32_t segments_mapped;
+	uint32_t rotations;
+	uint32_t recovered;         // Number of times we found that the previous session didn't close the log
+} logfile_stats_t;
+
+// Size-capped log file, rotated to <name>.1<ext> ... <name>.<generations><ext> once it gets past
+// its maximum size, and written through a memory mapped segment. This means that a message is in
+// the OS' hands as soon as it has been copied, without any flush. Since the file is extended one
+// segment at a time, a log that wasn't closed properly ends with NULs, which we trim on reopen.
+// Not thread safe: this is meant to be used from the logger thread only.
+class nvLogFile {
+private:
+	filesystem::path path;
+	uint64_t max_size = LOGFILE_DEFAULT_MAX_SIZE;
+	uint32_t generations = LOGFILE_DEFAULT_GENERATIONS;
+#if defined(_WIN32)
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = NULL;
+#else
+	int fd = -1;
+#endif
+	uint8_t* view = nullptr;
+	uint64_t view_offset = 0;
+	uint64_t size = 0;
+	logfile_stats_t stats = { 0 };
+	bool MapSegment(uint64_t offset);
+	void Unmap();
+	bool OpenFile();
+	void CloseFile();
+	uint64_t FindEnd(uint64_t file_size);
+	void Rotate();
+public:
+	// Also used for the binary event log, which follows the same rotation scheme
+	static filesystem::path GetGenerationPath(const filesystem::path& path, uint32_t generation);
+	static void RotateFiles(const filesystem::path& path, uint32_t generations);
+	~nvLogFile() { Close(); };
+	bool Open(const filesystem::path& log_path, uint64_t max_log_size = LOGFILE_DEFAULT_MAX_SIZE,
+		uint32_t num_generations = LOGFILE_DEFAULT_GENERATIONS);
+	// Rotation only happens when 'can_rotate' is set, so that lines don't get split between files
+	bool Write(const char* data, size_t len, bool can_rotate = true);
+	void Close();
+	bool IsOpen() { return view != nullptr; };
+	const logfile_stats_t& GetStats() { return stats; };
+};
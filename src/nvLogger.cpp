@@ -0,0 +1,189 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "nvLogger.hpp"
+
+nvLogger::nvLogger(size_t num_records, bool report_drops)
+	: report_drops(report_drops)
+{
+	size_t size = 1;
+	while (size < num_records)
+		size <<= 1;
+	records = make_unique<record[]>(size);
+	mask = size - 1;
+	for (size_t i = 0; i < size; i++)
+		records[i].seq.store(i, memory_order_relaxed);
+}
+
+// A slot is free for position 'pos' when its sequence is 'pos', and holds the message
+// for position 'pos' when its sequence is 'pos + 1'. Returns NULL if the buffer is full.
+nvLogger::record* nvLogger::Claim()
+{
+	size_t pos = head.load(memory_order_relaxed);
+
+	while (true) {
+		record* r = &records[pos & mask];
+		size_t seq = r->seq.load(memory_order_acquire);
+		intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+		if (diff == 0) {
+			if (head.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+				return r;
+		} else if (diff < 0) {
+			dropped.fetch_add(1, memory_order_relaxed);
+			return NULL;
+		} else {
+			pos = head.load(memory_order_relaxed);
+		}
+	}
+}
+
+void nvLogger::Publish(record* r)
+{
+	// Our position is the one for which the slot was free
+	r->seq.store(r->seq.load(memory_order_relaxed) + 1, memory_order_release);
+	logged.fetch_add(1, memory_order_relaxed);
+
+	published.fetch_add(1, memory_order_seq_cst);
+	if (sleeping.load(memory_order_seq_cst))
+		published.notify_one();
+}
+
+void nvLogger::Log(const char* fmt, va_list args)
+{
+	record* r = Claim();
+	if (r == NULL)
+		return;
+
+	r->time = chrono::system_clock::now();
+	int len = vsnprintf(r->msg, sizeof(r->msg), fmt, args);
+	if (len < 0) {
+		r->msg[0] = '\0';
+		len = 0;
+	} else if ((size_t)len >= sizeof(r->msg)) {
+		truncated.fetch_add(1, memory_order_relaxed);
+		len = sizeof(r->msg) - 1;
+	}
+	r->size = len;
+	Publish(r);
+}
+
+bool nvLogger::Write(const void* data, size_t size)
+{
+	if (size > LOGGER_MAX_MESSAGE) {
+		truncated.fetch_add(1, memory_order_relaxed);
+		return false;
+	}
+	record* r = Claim();
+	if (r == NULL)
+		return false;
+
+	r->time = chrono::system_clock::now();
+	memcpy(r->msg, data, size);
+	r->size = size;
+	Publish(r);
+	return true;
+}
+
+// Hands all the published messages to the sink. Must be called with the sink mutex held.
+size_t nvLogger::Drain()
+{
+	size_t count = 0;
+
+	if (!write)
+		return 0;
+	while (true) {
+		record* r = &records[tail & mask];
+		if (r->seq.load(memory_order_acquire) != tail + 1)
+			break;
+		write(r->time, r->msg, r->size, line_start);
+		if (r->size != 0)
+			line_start = (r->msg[r->size - 1] == '\n');
+		r->seq.store(tail + mask + 1, memory_order_release);
+		tail++;
+		count++;
+	}
+
+	uint64_t d = dropped.load(memory_order_relaxed);
+	if (d != dropped_reported && report_drops) {
+		char msg[64];
+		int len = snprintf(msg, sizeof(msg), "[%llu log message(s) dropped]\n", (unsigned long long)(d - dropped_reported));
+		write(chrono::system_clock::now(), msg, (size_t)len, line_start);
+		line_start = true;
+		dropped_reported = d;
+	}
+	if (count != 0) {
+		batches++;
+		max_batch = max(max_batch, (uint32_t)count);
+		if (flush)
+			flush();
+	}
+	return count;
+}
+
+void nvLogger::Run(stop_token st)
+{
+	while (true) {
+		uint64_t val = published.load(memory_order_seq_cst);
+		{
+			lock_guard<mutex> lock(sink_mutex);
+			if (Drain() != 0)
+				continue;
+		}
+		if (st.stop_requested())
+			break;
+		// Producers that published after we read 'val' either see us sleeping, or make wait() return
+		sleeping.store(true, memory_order_seq_cst);
+		if (published.load(memory_order_seq_cst) == val && !st.stop_requested())
+			published.wait(val, memory_order_seq_cst);
+		sleeping.store(false, memory_order_relaxed);
+	}
+}
+
+void nvLogger::Start(logger_write_t write_fn, function<void()> flush_fn)
+{
+	lock_guard<mutex> lock(sink_mutex);
+
+	write = move(write_fn);
+	flush = move(flush_fn);
+	if (!thread.joinable())
+		thread = jthread([this](stop_token st) { Run(st); });
+}
+
+void nvLogger::Stop()
+{
+	if (thread.joinable()) {
+		thread.request_stop();
+		published.fetch_add(1, memory_order_seq_cst);
+		published.notify_one();
+		thread.join();
+	}
+	// Anything that was logged while we were stopping
+	lock_guard<mutex> lock(sink_mutex);
+	Drain();
+}
+
+logger_stats_t nvLogger::GetStats()
+{
+	lock_guard<mutex> lock(sink_mutex);
+	return { logged.load(), dropped.load(), truncated.load(), batches, max_batch };
+}
@@ -0,0 +1,96 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <stdarg.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+
+// Number of records in the ring buffer (must be a power of 2), and maximum size of a message
+#define LOGGER_MAX_RECORDS          1024
+#define LOGGER_MAX_MESSAGE          512
+
+using namespace std;
+
+typedef struct {
+	uint64_t logged;
+	uint64_t dropped;           // Messages lost because the ring buffer was full
+	uint64_t truncated;
+	uint64_t batches;           // Number of times the background thread woke up to write messages
+	uint32_t max_batch;         // Largest number of messages written with a single flush
+} logger_stats_t;
+
+// Receives the messages, in order, from the logger thread. Text messages are NUL terminated, and
+// 'line_start' is set when the previous message ended with a line break, which is where a timestamp
+// should be inserted. Raw records (see Write()) are passed as is, with their size.
+typedef function<void(chrono::system_clock::time_point time, const char* msg, size_t size, bool line_start)> logger_write_t;
+
+// Asynchronous logger: callers only format their message into a slot of a bounded multi-producer
+// ring buffer, without taking any lock, and a background thread hands the messages to the sink
+// (with a single flush for all the messages it picked up at once). If the buffer is full, the
+// message is dropped and counted, and the number of dropped messages is reported in the log.
+class nvLogger {
+private:
+	struct record {
+		atomic<size_t> seq;
+		chrono::system_clock::time_point time;
+		size_t size;
+		char msg[LOGGER_MAX_MESSAGE];
+	};
+	unique_ptr<record[]> records;
+	size_t mask;
+	atomic<size_t> head = 0;
+	size_t tail = 0;
+	// Producers only wake the background thread up if it is sleeping
+	atomic<uint64_t> published = 0;
+	atomic<bool> sleeping = false;
+	atomic<uint64_t> logged = 0, dropped = 0, truncated = 0;
+	uint64_t dropped_reported = 0, batches = 0;
+	uint32_t max_batch = 0;
+	mutex sink_mutex;
+	logger_write_t write;
+	function<void()> flush;
+	bool line_start = true;
+	bool report_drops;
+	jthread thread;
+	record* Claim();
+	void Publish(record* r);
+	size_t Drain();
+	void Run(stop_token st);
+public:
+	// Set 'report_drops' to false if the sink can't take a text message about dropped messages
+	nvLogger(size_t num_records = LOGGER_MAX_RECORDS, bool report_drops = true);
+	~nvLogger() { Stop(); };
+	// Starts the background thread on first call, and replaces the sink on subsequent calls.
+	// Messages that were logged before the first call are kept until then.
+	void Start(logger_write_t write_fn, function<void()> flush_fn = nullptr);
+	// Writes all the pending messages and stops the background thread
+	void Stop();
+	void Log(const char* fmt, va_list args);
+	// Queue a raw record of up to LOGGER_MAX_MESSAGE bytes
+	bool Write(const void* data, size_t size);
+	logger_stats_t GetStats();
+};
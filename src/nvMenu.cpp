@@ -0,0 +1,133 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <chrono>
+
+#include "tray.h"
+#include "nvMenu.hpp"
+
+using namespace chrono;
+
+void nvMenu::MarkDirty(struct tray_menu* item)
+{
+	if (find(dirty.begin(), dirty.end(), item) == dirty.end())
+		dirty.push_back(item);
+}
+
+void nvMenu::SetBackend(function<void()> rebuild_fn, function<bool(struct tray_menu*)> patch_fn)
+{
+	rebuild = rebuild_fn;
+	patch = patch_fn;
+	dirty.clear();
+	structure_changed = false;
+}
+
+void nvMenu::SetText(struct tray_menu* item, const wstring& text)
+{
+	if (item->text != NULL && text == item->text)
+		return;
+	auto& label = labels[item];
+	label = text;
+	item->text = label.c_str();
+	MarkDirty(item);
+}
+
+void nvMenu::SetChecked(struct tray_menu* item, bool checked)
+{
+	if (item->checked == checked)
+		return;
+	item->checked = checked;
+	MarkDirty(item);
+}
+
+void nvMenu::SetDisabled(struct tray_menu* item, bool disabled)
+{
+	if (item->disabled == disabled)
+		return;
+	item->disabled = disabled;
+	MarkDirty(item);
+}
+
+// Update a submenu to the given content. If only the text or state of its items changed, which
+// is what happens when we switch monitors or find out about their inputs, it can be patched.
+void nvMenu::SetSubmenu(struct tray_menu* parent, vector<struct tray_menu>& items, const vector<menu_item_t>& content)
+{
+	bool same_structure = (parent->submenu == items.data() && items.size() == content.size() + 1);
+
+	for (size_t i = 0; same_structure && i < content.size(); i++) {
+		// Separators and items that have an action are different kinds of menu items
+		same_structure = (items[i].cb == content[i].cb && items[i].text != NULL &&
+			(wcscmp(items[i].text, L"-") == 0) == (content[i].text == L"-"));
+	}
+
+	if (!same_structure) {
+		for (auto& item : items) {
+			labels.erase(&item);
+			dirty.erase(remove(dirty.begin(), dirty.end(), &item), dirty.end());
+		}
+		items.assign(content.size() + 1, { .text = NULL });
+		for (size_t i = 0; i < content.size(); i++) {
+			items[i] = { .disabled = content[i].disabled, .checked = content[i].checked, .cb = content[i].cb,
+				.context = content[i].context };
+			SetText(&items[i], content[i].text);
+		}
+		parent->submenu = items.data();
+		structure_changed = true;
+		return;
+	}
+
+	for (size_t i = 0; i < content.size(); i++) {
+		items[i].context = content[i].context;
+		SetText(&items[i], content[i].text);
+		SetChecked(&items[i], content[i].checked);
+		SetDisabled(&items[i], content[i].disabled);
+	}
+}
+
+void nvMenu::Commit()
+{
+	auto start = steady_clock::now();
+
+	if (!structure_changed && dirty.empty())
+		return;
+	if (!rebuild || !patch) {
+		dirty.clear();
+		structure_changed = false;
+		return;
+	}
+	stats.commits++;
+	if (structure_changed) {
+		rebuild();
+		stats.rebuilds++;
+		stats.rebuild_us += duration_cast<microseconds>(steady_clock::now() - start).count();
+	} else {
+		// Items may not be in the menu yet, in which case we have to recreate it
+		for (auto item : dirty) {
+			if (!patch(item)) {
+				rebuild();
+				stats.rebuilds++;
+				break;
+			}
+			stats.patches++;
+		}
+		stats.patch_us += duration_cast<microseconds>(steady_clock::now() - start).count();
+	}
+	dirty.clear();
+	structure_changed = false;
+}
@@ -0,0 +1,72 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+struct tray_menu;
+
+// The content of a menu item, as we want it to be
+typedef struct {
+	wstring text;
+	bool disabled;
+	bool checked;
+	void (*cb)(struct tray_menu*);
+	void* context;
+} menu_item_t;
+
+typedef struct {
+	uint64_t commits;
+	uint64_t rebuilds;
+	uint64_t patches;           // Items that were updated in place
+	uint64_t rebuild_us;
+	uint64_t patch_us;
+} menu_stats_t;
+
+// Retained model of the tray menu. Changes are only recorded when they actually modify an item,
+// after which Commit() patches the items that changed in place, unless the structure of the menu
+// changed, in which case the whole menu is recreated. Until a backend is set, changes are only
+// applied to the model. Not thread safe: this is meant to be used from the UI thread only.
+class nvMenu {
+private:
+	function<void()> rebuild;
+	function<bool(struct tray_menu*)> patch;
+	vector<struct tray_menu*> dirty;
+	// The items we set the text of point to these
+	unordered_map<const struct tray_menu*, wstring> labels;
+	bool structure_changed = false;
+	menu_stats_t stats = { 0 };
+	void MarkDirty(struct tray_menu* item);
+public:
+	void SetBackend(function<void()> rebuild_fn, function<bool(struct tray_menu*)> patch_fn);
+	void SetText(struct tray_menu* item, const wstring& text);
+	void SetChecked(struct tray_menu* item, bool checked);
+	void SetDisabled(struct tray_menu* item, bool disabled);
+	void SetSubmenu(struct tray_menu* parent, vector<struct tray_menu>& items, const vector<menu_item_t>& content);
+	void Invalidate() { structure_changed = true; };
+	void Commit();
+	const menu_stats_t& GetStats() { return stats; };
+};
@@ -33,27 +33,21 @@
 #include "registry.h"
 #include "nvBrightness.h"
 #include "nvMonitor.hpp"
+#include "nvCache.hpp"
+#include "nvTiming.hpp"
+#include "nvStorage.hpp"
+#include "nvEventLog.hpp"
 #include "vendors.hpp"
 
-#include <regex>
 #include <format>
-#include <sstream>
 #include <cassert>
+#include <algorithm>
+#include <condition_variable>
 
 #pragma comment(lib, "dxva2.lib")
 
 using namespace std::chrono;
 
-static vector<string> SplitByWhitespace(const string& s)
-{
-	istringstream iss(s);
-	vector<string> tokens;
-	string token;
-	while (iss >> token)
-		tokens.push_back(token);
-	return tokens;
-}
-
 // Using a C++ map would be nice and all, *if* C++ had maps
 // that return a default value when a key is not found...
 const char* nvMonitor::InputToString(uint8_t input)
@@ -98,6 +92,7 @@ const char* nvMonitor::InputToString(uint8_t input)
 };
 
 nvMonitor::nvMonitor(uint32_t display_id)
+	: display_id(display_id)
 {
 	NvAPI_Status r;
 	NvAPI_ShortString nv_display_name;
@@ -107,12 +102,12 @@ nvMonitor::nvMonitor(uint32_t display_id)
 	// Get the Windows display name
 	r = NvAPI_DISP_GetDisplayHandleFromDisplayId(display_id, &display_handle);
 	if (r != NVAPI_OK) {
-		logger("NvAPI_DISP_GetDisplayHandleFromDisplayId(0x%08x): %d %s\n", display_id, r, NvAPI_GetErrorString(r));
+		event_log.Emit(evGetDisplayHandleFailed, display_id, display_id, r, NvAPI_GetErrorString(r));
 		return;
 	}
 	r = NvAPI_GetAssociatedNvidiaDisplayName(display_handle, nv_display_name);
 	if (r != NVAPI_OK) {
-		logger("NvAPI_GetAssociatedNvidiaDisplayName(0x%08x): %d %s\n", display_id, r, NvAPI_GetErrorString(r));
+		event_log.Emit(evGetDisplayNameFailed, display_id, display_id, r, NvAPI_GetErrorString(r));
 		return;
 	}
 
@@ -123,19 +118,17 @@ nvMonitor::nvMonitor(uint32_t display_id)
 	GetMonitorData();
 
 	if (physical_monitors.empty()) {
-		logger("No physical monitor detected for %s\n", nv_display_name);
+		event_log.Emit(evNoPhysicalMonitor, display_id, nv_display_name);
 		return;
 	}
 
-	DWORD input = 0, max = 0;
-	steady_clock::time_point begin = steady_clock::now();
-	while (!GetVCPFeatureAndVCPFeatureReply(physical_monitors.at(0).hPhysicalMonitor, VCP_INPUT_SOURCE, NULL, &input, &max)) {
-		auto elapsed = duration_cast<milliseconds>(steady_clock::now() - begin);
-		if (elapsed.count() > VCP_FEATURE_MAX_RETRY_TIME) {
-			logger("Could not retrieve monitor input for %s: Error 0x%X\n", nv_display_name, GetLastError());
-			ParseEdid();
-			return;
-		}
+	// Parse the EDID first, since we need the monitor fingerprint to look up cached capabilities
+	ParseEdid();
+
+	uint16_t input = 0;
+	if (!GetVcpFeature(VCP_INPUT_SOURCE, &input)) {
+		event_log.Emit(evGetHomeInputFailed, display_id, nv_display_name, GetLastError());
+		return;
 	}
 
 	// Store the "home" input, i.e. the input the monitor was using when we started the app
@@ -143,19 +136,22 @@ nvMonitor::nvMonitor(uint32_t display_id)
 	if (home_input != 0) {
 		// If we could read the current input, we assume that VCP is supported
 		supports_vcp = true;
-		// Start an asynchronous task to get this monitor's available inputs
-		allowed_inputs_task = async(launch::async, &nvMonitor::GetAllowedInputs, this);
+		// Queue an asynchronous task to get this monitor's available inputs. Each display output
+		// has its own DDC bus, so we use the display name to keep probes from sharing a bus.
+		allowed_inputs_task = probe_pool.Submit([this](stop_token st) { GetAllowedInputs(st); },
+			hash<wstring_view>{}(display_name));
 	}
-
-	ParseEdid();
 }
 
 nvMonitor::~nvMonitor()
 {
-	cancel_allowed_inputs_task = true;
-	// Wait for the GetAllowedInputs() task to finish
-	if (allowed_inputs_task.valid())
-		allowed_inputs_task.get();
+	// Dequeue the GetAllowedInputs() task or, if it's running, wait for it to notice it was stopped
+	if (allowed_inputs_task != 0)
+		probe_pool.Cancel(allowed_inputs_task);
+	if (prefetch_task != 0)
+		probe_pool.Cancel(prefetch_task);
+	if (vcp_reads + vcp_cache.GetHits() != 0)
+		event_log.Emit(evVcpStats, display_id, display_name, vcp_reads, vcp_cache.GetHits());
 	DestroyPhysicalMonitors((DWORD)physical_monitors.size(), physical_monitors.data());
 }
 
@@ -219,81 +215,138 @@ bool nvMonitor::ParseEdid()
 		if (edid_registry_path[k] == L'#')
 			edid_registry_path[k] = L'\\';
 	edid_size = (size_t)GetRegistryKeySize(HKEY_LOCAL_MACHINE, edid_registry_path, REG_BINARY);
-	if (edid_size < 128) {
-		logger("Failed to read EDID for %S\n", device_id);
+	if (edid_size < EDID_BLOCK_SIZE) {
+		event_log.Emit(evEdidReadFailed, display_id, device_id);
 		return false;
 	}
-	uint8_t* edid = (uint8_t*)malloc(edid_size);
-	if (edid == NULL || !GetRegistryKey(HKEY_LOCAL_MACHINE, edid_registry_path, REG_BINARY, edid, (DWORD)edid_size))
+	edid_data.resize(edid_size);
+	if (!GetRegistryKey(HKEY_LOCAL_MACHINE, edid_registry_path, REG_BINARY, edid_data.data(), (DWORD)edid_size) ||
+		!edid.Parse(edid_data)) {
+		event_log.Emit(evEdidInvalid, display_id, device_id);
+		edid_data.clear();
 		return false;
-	char model[14] = "", serial[14] = "";
-	vendor_code = (edid[8] << 8) | edid[9];	// Big endian
-	product_code = ((uint16_t*)edid)[5];		// Little endian. Great consistency there!
-	serial_number = format("{:08x}", ((uint32_t*)edid)[3]);
+	}
+	if (!edid.HasValidChecksums())
+		event_log.Emit(evEdidChecksumMismatch, display_id, device_id);
+
+	vendor_code = edid.GetVendorCode();
+	product_code = edid.GetProductCode();
+	serial_number = format("{:08x}", edid.GetSerial());
 	// If the serial is alphanum, print it as alphanum (little endian, which is what Dell uses)
-	if (isalnum(edid[12]) && isalnum(edid[13]) && isalnum(edid[14]) && isalnum(edid[15]))
-		serial_number = format("{:c}{:c}{:c}{:c}", edid[15], edid[14], edid[13], edid[12]);
-	mfg_date = format("{:d}", edid[17] + 1990);
-	if (edid[16] != 0)
-		mfg_date += format("Q{:d}", (edid[16] / 13) + 1);
-
-	for (auto i = 0; i < 4; i++) {
-		// EDID detailed timing descriptors start at offset 54, four blocks of 18 bytes
-		const uint8_t* desc = edid + 54 + i * 18;
-		if (desc[0] != 0x00 || desc[1] != 0x00 || desc[2] != 0x00)
-			continue;
-		switch (desc[3]) {
-		case 0xfc:
-			memcpy(model, desc + 5, 13);
-			model[13] = '\0';
-			for (auto j = strlen(model) - 1; j >= 0 && isspace((unsigned char)model[j]); j--)
-				model[j] = '\0';
-			break;
-		case 0xff:
-			memcpy(serial, desc + 5, 13);
-			serial[13] = '\0';
-			for (auto j = (int)strlen(serial) - 1; j >= 0 && isspace((unsigned char)serial[j]); j--)
-				serial[j] = '\0';
-			serial_number += "/";
-			serial_number += serial;
-			break;
-		default:
-			break;
-		}
+	const uint8_t* s = &edid_data[12];
+	if (isalnum(s[0]) && isalnum(s[1]) && isalnum(s[2]) && isalnum(s[3]))
+		serial_number = format("{:c}{:c}{:c}{:c}", s[3], s[2], s[1], s[0]);
+	if (!edid.GetSerialString().empty()) {
+		serial_number += "/";
+		serial_number += edid.GetSerialString();
 	}
+	mfg_date = format("{:d}", edid.GetYear());
+	if (edid.GetWeek() != 0)
+		mfg_date += format("Q{:d}", (edid.GetWeek() / 13) + 1);
+
+	auto& range = edid.GetRangeLimits();
+	if (range.present)
+		event_log.Emit(evEdidRangeLimits, display_id, display_name, range.min_vfreq, range.max_vfreq,
+			range.min_hfreq, range.max_hfreq, range.max_pixel_clock);
+	auto& hdr = edid.GetHdrMetadata();
+	if (hdr.present)
+		event_log.Emit(evEdidHdr, display_id, display_name,
+			hdr.eotf, hdr.max_luminance, hdr.max_frame_avg, hdr.min_luminance);
 
 	vendor_name = GetVendorName(vendor_code);
-	string test_str = vendor_name + " ";
+	string model(edid.GetModel()), test_str = vendor_name + " ";
 	// Some manufacturers (Dell yet again) inconstently prefix or don't prefix
 	// their name into the model string. If that's the case, remove it.
-	if (_strnicmp(model, test_str.c_str(), test_str.size()) == 0)
-		model_name = &model[test_str.size()];
+	if (_strnicmp(model.c_str(), test_str.c_str(), test_str.size()) == 0)
+		model_name = model.substr(test_str.size());
 	else
 		model_name = model;
 
-	free(edid);
+	// Settle times are learned per model, since that's what determines how long a switch takes.
+	// Only use the EDID for this, so that the key doesn't change once we get the capabilities.
+	model = model_name.empty() ? vendor_name + "_" + to_string(product_code) : model_name;
+	settle_time_key = L"InputSettleTime_" + wstring(model.begin(), model.end());
+
+	fingerprint = nvCache::Fingerprint(edid_data, device_id);
+
 	return true;
 }
 
+// Parse a capabilities string and update the monitor data from it. This runs on the probe pool,
+// so we build the new data on the side and only swap it in under the lock. The strings of the
+// parsed capabilities are views into 'caps', so only their VCP data may be used past this call.
+bool nvMonitor::ApplyCapabilities(string_view caps, stop_token st)
+{
+	auto parsed = make_unique<nvCapabilities>();
+	if (!parsed->Parse(caps)) {
+		event_log.Emit(evCapsParseFailed, display_id, display_name);
+		return false;
+	}
+
+	// Get the allowed inputs for VCP code 0x60
+	auto vcp_inputs = parsed->GetVcpValues(VCP_INPUT_SOURCE);
+	vector<uint8_t> inputs(vcp_inputs.begin(), vcp_inputs.end());
+
+	// Oh, and you'd think *serious* display manufacturers, like Dell, would
+	// report available inputs in the proper order. But you'd think wrong...
+	stable_sort(inputs.begin(), inputs.end());
+
+	string separator, input_names;
+	for (const auto& input : inputs) {
+		input_names += separator + InputToString(input);
+		separator = ", ";
+	}
+
+	{
+		lock_guard<mutex> lock(caps_mutex);
+		// Get the model name while we're here
+		if (model_name.empty() && !parsed->GetModel().empty())
+			model_name = parsed->GetModel();
+		capabilities.swap(parsed);
+		allowed_inputs.swap(inputs);
+	}
+
+	// Don't wait for the UI thread, which may be waiting for us to be cancelled
+	if (!st.stop_requested())
+		tray_post_hotkey(hkUpdateSubmenu);
+
+	event_log.Emit(evValidInputs, display_id, model_name.c_str(), input_names.c_str());
+	return true;
+}
+
+bool nvMonitor::SupportsVcpFeature(uint8_t code)
+{
+	lock_guard<mutex> lock(caps_mutex);
+	return supports_vcp && capabilities && capabilities->SupportsVcp(code);
+}
+
 // Issuing CapabilitiesRequestAndCapabilitiesReply() can be a lengthy process and may need
-// to be reiterated multiple times before we get a valid answer. So use an async task.
-void nvMonitor::GetAllowedInputs()
+// to be reiterated multiple times before we get a valid answer. So run it from the probe pool.
+void nvMonitor::GetAllowedInputs(stop_token st)
 {
 	char* capabilities_string = NULL;
 	DWORD i = 1, size = 0;
+	string cached_capabilities;
 
 	auto physical_monitor = GetFirstPhysicalMonitor();
 	if (physical_monitor == NULL)
 		return;
 
+	// If we got the capabilities for this monitor in a previous session, use them right away.
+	// We still go through the whole discovery process below, to revalidate the cached data.
+	if (fingerprint != 0 && caps_cache.Lookup(fingerprint, cached_capabilities)) {
+		event_log.Emit(evCapsFromCache, display_id, display_name);
+		ApplyCapabilities(cached_capabilities, st);
+	}
+
 	// GetCapabilitiesStringLength() is *VERY* temperamental, so we retry up to VCP_CAPS_MAX_RETRY_TIME
 	steady_clock::time_point begin = steady_clock::now();
 	for (i = 1; !GetCapabilitiesStringLength(physical_monitor->hPhysicalMonitor, &size); i++) {
-		if (cancel_allowed_inputs_task)
+		if (st.stop_requested())
 			return;
 		auto elapsed = duration_cast<seconds>(steady_clock::now() - begin);
 		if (elapsed.count() > VCP_CAPS_MAX_RETRY_TIME) {
-			logger("Could not get VCP capabilities for %s after %d attempts: Error 0x%08x\n", display_name, i, GetLastError());
+			event_log.Emit(evCapsTimeout, display_id, display_name, i, GetLastError());
 			return;
 		}
 	}
@@ -305,54 +358,125 @@ void nvMonitor::GetAllowedInputs()
 		goto out;
 
 	if (CapabilitiesRequestAndCapabilitiesReply(physical_monitor->hPhysicalMonitor, capabilities_string, size)) {
-		if (cancel_allowed_inputs_task)
+		if (st.stop_requested())
 			goto out;
-		string capabilities = capabilities_string;
 		auto elapsed = duration_cast<milliseconds>(steady_clock::now() - begin);
+		string_view caps(capabilities_string, strnlen(capabilities_string, size));
+		event_log.Emit(evCapsRetrieved, display_id, display_name,
+			(unsigned)(elapsed.count() / 1000), (unsigned)(elapsed.count() % 1000), i, (i == 1) ? "try" : "tries");
+		if (caps == cached_capabilities)
+			event_log.Emit(evCapsUpToDate, display_id, display_name);
+		else if (ApplyCapabilities(caps, st) && fingerprint != 0)
+			caps_cache.Store(fingerprint, caps);
+		// Now that we know which VCP codes the monitor supports, read the ones we care about
+		PrefetchVcp(st);
+	} else {
+		event_log.Emit(evCapsFailed, display_id, display_name, GetLastError());
+	}
 
-		// Get the model name while we're here
-		regex model_regex(R"(model\(([^)]+)\))");
-		smatch match;
-		if (model_name == "" && regex_search(capabilities, match, model_regex))
-			model_name = match[1];
-
-		// Get the allowed inputs for VCP code 0x60
-		regex inputs_regex(R"(60\(([^)]*)\))");
-		if (regex_search(capabilities, match, inputs_regex)) {
-			string inner = match[1];
-			auto tokens = SplitByWhitespace(inner);
-			for (auto& t : tokens) {
-				try {
-					allowed_inputs.push_back((uint8_t)stoi(t, NULL, 16));
-				} catch (...) {
-					logger("Invalid monitor input value found in %s\n", inner.c_str());
-				}
-			}
+out:
+	free(capabilities_string);
+}
+
+// Read a VCP feature from the monitor (with a few retries)
+bool nvMonitor::ReadVcpFeature(uint8_t code, DWORD* current, DWORD* max)
+{
+	auto physical_monitor = GetFirstPhysicalMonitor();
+	if (physical_monitor == NULL)
+		return false;
+
+	vcp_reads++;
+	steady_clock::time_point begin = steady_clock::now();
+	while (!GetVCPFeatureAndVCPFeatureReply(physical_monitor->hPhysicalMonitor, code, NULL, current, max)) {
+		auto elapsed = duration_cast<milliseconds>(steady_clock::now() - begin);
+		if (elapsed.count() > VCP_FEATURE_MAX_RETRY_TIME)
+			return false;
+	}
+	return true;
+}
+
+// Get a VCP feature value, from our cache if we read it recently enough
+bool nvMonitor::GetVcpFeature(uint8_t code, uint16_t* current, uint16_t* max, bool force)
+{
+	DWORD c = 0, m = 0;
+	lock_guard<mutex> lock(vcp_mutex);
+
+	auto now = steady_clock::now();
+	if (force || !vcp_cache.Lookup(code, now, current, max)) {
+		if (!ReadVcpFeature(code, &c, &m)) {
+			vcp_cache.Invalidate(code);
+			return false;
 		}
+		now = steady_clock::now();
+		vcp_cache.Update(code, (uint16_t)c, (uint16_t)m, now);
+		if (code == VCP_INPUT_SOURCE)
+			known_input = (uint8_t)c;
+		if (current != NULL)
+			*current = (uint16_t)c;
+		if (max != NULL)
+			*max = (uint16_t)m;
+	}
 
+	// Don't wait until we exit to report how many DDC reads the cache saved
+	if (now - vcp_stats_time >= milliseconds(VCP_STATS_INTERVAL)) {
+		vcp_stats_time = now;
+		event_log.Emit(evVcpStats, display_id, display_name, vcp_reads, vcp_cache.GetHits());
+	}
+	return true;
+}
 
-		// Oh, and you'd think *serious* display manufacturers, like Dell, would
-		// report available inputs in the proper order. But you'd think wrong...
-		stable_sort(allowed_inputs.begin(), allowed_inputs.end());
+bool nvMonitor::SetVcpFeature(uint8_t code, uint16_t value)
+{
+	lock_guard<mutex> lock(vcp_mutex);
 
-		if (!cancel_allowed_inputs_task)
-			tray_simulate_hottkey(hkUpdateSubmenu);
+	auto physical_monitor = GetFirstPhysicalMonitor();
+	if (physical_monitor == NULL)
+		return false;
 
-		string separator, inputs;
-		for (const auto& input : allowed_inputs) {
-			inputs += separator + InputToString(input);
-			separator = ", ";
-		}
-		logger("Retrieved %S VCP capabilities in %u.%03u seconds (%d %s)\n", display_name,
-			(unsigned)(elapsed.count() / 1000), (unsigned)(elapsed.count() % 1000), i, (i == 1) ? "try" : "tries");
-		logger("%s Valid input(s): %s\n", model_name.c_str(), inputs.c_str());
+	// Monitors are free to ignore or adjust what we write, so don't assume anything about the new value
+	vcp_cache.Invalidate(code);
+	return SetVCPFeature(physical_monitor->hPhysicalMonitor, code, value);
+}
 
-	} else {
-		logger("Could not get VCP capabilities for %S: Error 0x%08x\n", display_name, GetLastError());
+// Read all the VCP codes we are interested in (and that the monitor supports) in one go
+void nvMonitor::PrefetchVcp(stop_token st)
+{
+	if (!supports_vcp)
+		return;
+
+	for (auto code : nvVcpCache::GetPrefetchCodes()) {
+		if (st.stop_requested())
+			break;
+		if (code != VCP_INPUT_SOURCE && !SupportsVcpFeature(code))
+			continue;
+		GetVcpFeature(code, NULL);
+	}
+}
+
+// Drop all cached VCP values (e.g. when the monitor may have been power cycled), and read them
+// again once the monitor has had time to wake up, so that the UI doesn't pay for it
+void nvMonitor::InvalidateVcp()
+{
+	{
+		lock_guard<mutex> lock(vcp_mutex);
+		vcp_cache.InvalidateAll();
+		confirmed_input = 0;
 	}
+	if (!supports_vcp)
+		return;
 
-out:
-	free(capabilities_string);
+	// Replace the prefetch we may have scheduled earlier. This must not be done under the lock,
+	// as cancelling a running prefetch waits for it to be done with the VCP values.
+	uint64_t task = prefetch_task.exchange(0);
+	if (task != 0)
+		probe_pool.Cancel(task);
+	prefetch_task = probe_pool.Submit([this](stop_token st) {
+		mutex delay_mutex;
+		condition_variable_any delay_cv;
+		unique_lock<mutex> lock(delay_mutex);
+		delay_cv.wait_for(lock, st, milliseconds(VCP_PREFETCH_DELAY), [] { return false; });
+		PrefetchVcp(st);
+	}, hash<wstring_view>{}(display_name));
 }
 
 uint8_t nvMonitor::GetMonitorInput()
@@ -360,30 +484,96 @@ uint8_t nvMonitor::GetMonitorInput()
 	if (!supports_vcp)
 		return 0;
 
-	DWORD current = 0, max = 0;
-	auto physical_monitor = GetFirstPhysicalMonitor();
-	if (physical_monitor == NULL)
+	uint16_t current = 0;
+	if (!GetVcpFeature(VCP_INPUT_SOURCE, &current)) {
+		event_log.Emit(evGetInputFailed, display_id, GetLastError());
 		return 0;
-
-	// Read the current input (with a few retries)
-	steady_clock::time_point begin = steady_clock::now();
-	while (!GetVCPFeatureAndVCPFeatureReply(physical_monitor->hPhysicalMonitor, VCP_INPUT_SOURCE, NULL, &current, &max)) {
-		auto elapsed = duration_cast<milliseconds>(steady_clock::now() - begin);
-		if (elapsed.count() > VCP_FEATURE_MAX_RETRY_TIME) {
-			logger("Could not get current input: Error 0x%08x\n", GetLastError());
-			return 0;
-		}
 	}
 
 	return (uint8_t)current;
 }
 
-uint8_t nvMonitor::SetMonitorInput(uint8_t requested)
+// Read the input back until the monitor confirms the switch, and write it again if it doesn't
+// confirm in time, since plenty of monitors silently ignore the first write after waking up.
+// The time it takes for the switch to be confirmed is fed back into the settle time we use
+// for this model. If 'max_verify_time' (in ms) isn't 0, we give up once it has elapsed, even
+// if the monitor might still confirm later. Returns the input if confirmed, 0 otherwise.
+uint8_t nvMonitor::VerifyMonitorInput(uint8_t input, uint32_t max_verify_time)
+{
+	uint16_t current = 0;
+	string model = GetModelName();
+	steady_clock::time_point deadline = steady_clock::now() + milliseconds(max_verify_time);
+	auto remaining = [&]() -> uint32_t {
+		if (max_verify_time == 0)
+			return UINT32_MAX;
+		auto now = steady_clock::now();
+		return (now >= deadline) ? 0 : (uint32_t)duration_cast<milliseconds>(deadline - now).count();
+	};
+
+	if (settle_time == 0) {
+		if (!settle_time_key.empty())
+			settle_time = storage->Read32(settle_time_key.c_str());
+		if (settle_time == 0)
+			settle_time = VCP_INPUT_SETTLE_TIME;
+	}
+
+	for (int write = 1; write <= VCP_INPUT_MAX_WRITES; write++) {
+		steady_clock::time_point written = steady_clock::now();
+		uint32_t timeout = min(2 * settle_time + 500, (uint32_t)VCP_INPUT_MAX_SETTLE_TIME);
+		// Don't poll before the switch is likely to be done, as DDC traffic during an
+		// input switch can make some monitors abort it
+		Sleep(min(settle_time * 3 / 4, remaining()));
+		uint32_t elapsed;
+		do {
+			if (GetVcpFeature(VCP_INPUT_SOURCE, &current, NULL, true) && current == input) {
+				elapsed = (uint32_t)duration_cast<milliseconds>(steady_clock::now() - written).count();
+				// Exponentially weighted moving average, with a weight of 1/4 for the new sample
+				settle_time = clamp((3 * settle_time + elapsed) / 4,
+					(uint32_t)VCP_INPUT_MIN_SETTLE_TIME, (uint32_t)VCP_INPUT_MAX_SETTLE_TIME);
+				if (!settle_time_key.empty())
+					storage->Write32(settle_time_key.c_str(), settle_time);
+				event_log.Emit(evInputConfirmed, display_id, model.c_str(),
+					InputToString(input), elapsed, write, (write == 1) ? "write" : "writes", settle_time);
+				return input;
+			}
+			if (remaining() == 0) {
+				// Let the caller come back to it later, rather than write the input again
+				elapsed = (uint32_t)duration_cast<milliseconds>(steady_clock::now() - written).count();
+				event_log.Emit(evInputNotConfirmed, display_id, model.c_str(), InputToString(input), elapsed);
+				return 0;
+			}
+			Sleep(min((uint32_t)VCP_INPUT_POLL_INTERVAL, remaining()));
+			elapsed = (uint32_t)duration_cast<milliseconds>(steady_clock::now() - written).count();
+		} while (elapsed < timeout);
+		if (write == VCP_INPUT_MAX_WRITES)
+			break;
+		event_log.Emit(evInputNotConfirmed, display_id, model.c_str(), InputToString(input), elapsed);
+		if (!SetVcpFeature(VCP_INPUT_SOURCE, input)) {
+			event_log.Emit(evSetInputFailed, display_id, GetLastError());
+			break;
+		}
+	}
+	event_log.Emit(evInputNotSwitched, display_id, model.c_str(), InputToString(input));
+	return 0;
+}
+
+uint8_t nvMonitor::SetMonitorInput(uint8_t requested, bool verify, uint32_t max_verify_time)
 {
 	if (!supports_vcp)
 		return 0;
 
+	// Time each phase of the switch, for the report we produce on exit
+	switch_timing_t timing = { { 0 }, requested, 0 };
+	string model = GetModelName();
+	steady_clock::time_point mark = steady_clock::now();
+	auto lap = [&](int phase) {
+		auto now = steady_clock::now();
+		timing.us[phase] = (uint32_t)duration_cast<microseconds>(now - mark).count();
+		mark = now;
+	};
+
 	uint8_t ret = 0, current = GetMonitorInput();
+	lap(tpRead);
 
 	auto physical_monitor = GetFirstPhysicalMonitor();
 	if (physical_monitor == NULL)
@@ -395,6 +585,7 @@ uint8_t nvMonitor::SetMonitorInput(uint8_t requested)
 		return 0;
 
 	if (requested == VCP_INPUT_NEXT || requested == VCP_INPUT_PREVIOUS) {
+		lock_guard<mutex> lock(caps_mutex);
 		if (allowed_inputs.size() == 0 || current == 0)
 			return 0;
 		auto pos = lower_bound(allowed_inputs.begin(), allowed_inputs.end(), current) - allowed_inputs.begin();
@@ -402,23 +593,39 @@ uint8_t nvMonitor::SetMonitorInput(uint8_t requested)
 		pos = (pos + ((requested == VCP_INPUT_NEXT) ? +1 : -1)) % allowed_inputs.size();
 		requested = allowed_inputs.at(pos);
 	}
+	lap(tpCompute);
 
 	if (current == requested) {
-		logger("Current %s input is the same as requested: Not switching inputs\n", model_name.c_str());
+		event_log.Emit(evInputUnchanged, display_id, model.c_str());
 		ret = requested;
+		if (verify)
+			confirmed_input = ret;
 	} else {
-		if (!SetVCPFeature(physical_monitor->hPhysicalMonitor, VCP_INPUT_SOURCE, requested))
-			logger("Could not set input: Error 0x%08x\n", GetLastError());
+		confirmed_input = 0;
+		if (!SetVcpFeature(VCP_INPUT_SOURCE, requested))
+			event_log.Emit(evSetInputFailed, display_id, GetLastError());
 		else
 			ret = requested;
+		lap(tpWrite);
+		if (ret != 0 && verify) {
+			ret = VerifyMonitorInput(requested, max_verify_time);
+			confirmed_input = ret;
+			lap(tpVerify);
+		}
 	}
 
+	if (ret != 0)
+		known_input = ret;
+	timing.result = ret;
+	switch_timing.Record(model.empty() ? "Unknown" : model, timing);
 	return ret;
 }
 
+// These use the last input we know of, rather than read it, since they are meant for the UI
 uint8_t nvMonitor::GetNextInput()
 {
-	auto index = find(allowed_inputs.begin(), allowed_inputs.end(), GetMonitorInput());
+	lock_guard<mutex> lock(caps_mutex);
+	auto index = find(allowed_inputs.begin(), allowed_inputs.end(), known_input.load());
 	if (index == allowed_inputs.end())
 		return 0;
 	return allowed_inputs[(index - allowed_inputs.begin() + 1) % allowed_inputs.size()];
@@ -426,7 +633,8 @@ uint8_t nvMonitor::GetNextInput()
 
 uint8_t nvMonitor::GetPrevInput()
 {
-	auto index = find(allowed_inputs.begin(), allowed_inputs.end(), GetMonitorInput());
+	lock_guard<mutex> lock(caps_mutex);
+	auto index = find(allowed_inputs.begin(), allowed_inputs.end(), known_input.load());
 	if (index == allowed_inputs.end())
 		return 0;
 	return allowed_inputs[((index - allowed_inputs.begin()) + allowed_inputs.size() - 1) % allowed_inputs.size()];
@@ -26,33 +26,75 @@
 #include <physicalmonitorenumerationapi.h>
 
 #include "nvapi.h"
+#include "nvCapabilities.hpp"
+#include "nvEdid.hpp"
+#include "nvPool.hpp"
+#include "nvVcpCache.hpp"
 
 #include <string>
 #include <vector>
-#include <future>
+#include <stop_token>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <chrono>
 
 // How long we may retry GetVCPFeatureAndVCPFeatureReply(), in ms
 #define VCP_FEATURE_MAX_RETRY_TIME      500
 
+// How long we let a monitor wake up before we read its VCP values again, and how often we
+// report how many DDC reads the VCP cache saved, in ms
+#define VCP_PREFETCH_DELAY              3000
+#define VCP_STATS_INTERVAL              (60 * 60 * 1000)
+
+// Input switch verification: the default time a monitor takes to settle on a new input (we
+// learn the actual value per model), how often we poll for confirmation once we expect the
+// switch to be done, and how many times we write the input before giving up. In ms.
+#define VCP_INPUT_SETTLE_TIME           1000
+#define VCP_INPUT_MIN_SETTLE_TIME       100
+#define VCP_INPUT_MAX_SETTLE_TIME       5000
+#define VCP_INPUT_POLL_INTERVAL         100
+#define VCP_INPUT_MAX_WRITES            3
+
 using namespace std;
 
 class nvMonitor {
 private:
 	HMONITOR monitor_handle = NULL;
 	vector<PHYSICAL_MONITOR> physical_monitors;
+	// These get replaced by the probe pool while the UI and worker threads use them
 	vector<uint8_t> allowed_inputs;
+	unique_ptr<nvCapabilities> capabilities;
+	mutex caps_mutex;
+	vector<uint8_t> edid_data;
+	nvEdid edid;
 	bool supports_vcp = false;
-	bool cancel_allowed_inputs_task = false;
-	future<void> allowed_inputs_task;
-	void GetAllowedInputs();
+	uint64_t allowed_inputs_task = 0;
+	atomic<uint64_t> prefetch_task = 0;
+	nvVcpCache vcp_cache;
+	mutex vcp_mutex;
+	uint32_t vcp_reads = 0;
+	chrono::steady_clock::time_point vcp_stats_time = chrono::steady_clock::now();
+	uint32_t settle_time = 0;
+	wstring settle_time_key;
+	// The last input we read or switched to, so that the UI can use it without any DDC access
+	atomic<uint8_t> known_input = 0;
+	// The last input the monitor confirmed it switched to, since its VCP values were invalidated
+	atomic<uint8_t> confirmed_input = 0;
+	bool ReadVcpFeature(uint8_t code, DWORD* current, DWORD* max);
+	void GetAllowedInputs(stop_token st);
+	bool ApplyCapabilities(string_view caps, stop_token st);
+	uint8_t VerifyMonitorInput(uint8_t input, uint32_t max_verify_time);
 protected:
+	uint32_t display_id;
 	uint16_t vendor_code = 0;
 	uint16_t product_code = 0;
 	string vendor_name;
-	string model_name;
+	string model_name;          // Can be updated from the capabilities, under caps_mutex
 	string serial_number;
 	string mfg_date;
 	uint8_t home_input = 0;
+	uint64_t fingerprint = 0;
 	wchar_t display_name[sizeof(NvAPI_ShortString)] = { 0 };
 	wchar_t device_id[128] = { 0 };
 	wchar_t device_name[128] = { 0 };
@@ -64,11 +106,20 @@ public:
 	bool ParseEdid();
 	wchar_t* GetDeviceId() { return device_id; };
 	uint8_t GetHomeInput() { return home_input; };
+	uint8_t GetConfirmedInput() { return confirmed_input; };
+	string GetModelName() { lock_guard<mutex> lock(caps_mutex); return model_name; };
 	uint8_t GetNextInput();
 	uint8_t GetPrevInput();
 	uint8_t GetMonitorInput();
-	uint8_t SetMonitorInput(uint8_t);
+	bool GetVcpFeature(uint8_t code, uint16_t* current, uint16_t* max = NULL, bool force = false);
+	bool SetVcpFeature(uint8_t code, uint16_t value);
+	void PrefetchVcp(stop_token st = {});
+	void SetProbePriority(int priority) { if (allowed_inputs_task != 0) probe_pool.SetPriority(allowed_inputs_task, priority); };
+	void InvalidateVcp();
+	uint8_t SetMonitorInput(uint8_t input, bool verify = false, uint32_t max_verify_time = 0);
 	PHYSICAL_MONITOR* GetFirstPhysicalMonitor() { return (physical_monitors.size() == 0) ? NULL : &physical_monitors[0]; };
 	bool SupportsVCP() { return supports_vcp; };
-	size_t GetNumberOfInputs() { return allowed_inputs.size(); };
+	nvEdid& GetEdid() { return edid; };
+	bool SupportsVcpFeature(uint8_t code);
+	size_t GetNumberOfInputs() { lock_guard<mutex> lock(caps_mutex); return allowed_inputs.size(); };
 };
@@ -0,0 +1,95 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <math.h>
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PIXELS_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "nvPixels.hpp"
+
+void nvPixels::GetFixedFactors(float offset, float scale, uint16_t* fixed_offset, bool* negative, uint16_t* fixed_scale)
+{
+	offset = isfinite(offset) ? clamp(offset, -1.0f, 1.0f) : 0.0f;
+	scale = isfinite(scale) ? clamp(scale, 0.0f, 1.0f) : 1.0f;
+	*negative = (offset < 0.0f);
+	*fixed_offset = (uint16_t)lroundf(fabsf(offset) * PIXEL_FIXED_ONE);
+	*fixed_scale = (uint16_t)lroundf(scale * PIXEL_FIXED_ONE);
+}
+
+// c' = min(max(((c * scale + 128) >> 8) +/- ((a * offset + 128) >> 8), 0), a)
+// None of the products can exceed 255 * 256, so all of this fits in unsigned 16-bit lanes.
+void nvPixels::AdjustBrightnessScalar(uint32_t* pixels, size_t count, float offset, float scale)
+{
+	uint16_t fixed_offset, fixed_scale;
+	bool negative;
+
+	GetFixedFactors(offset, scale, &fixed_offset, &negative, &fixed_scale);
+	for (size_t i = 0; i < count; i++) {
+		uint32_t p = pixels[i], a = p >> 24, o = (a * fixed_offset + 128) >> 8, r = p & 0xff000000;
+		for (uint32_t shift = 0; shift < 24; shift += 8) {
+			int32_t c = (int32_t)((((p >> shift) & 0xff) * fixed_scale + 128) >> 8);
+			c = negative ? c - (int32_t)o : c + (int32_t)o;
+			r |= (uint32_t)clamp<int32_t>(c, 0, (int32_t)a) << shift;
+		}
+		pixels[i] = r;
+	}
+}
+
+void nvPixels::AdjustBrightness(uint32_t* pixels, size_t count, float offset, float scale)
+{
+#if defined(PIXELS_USE_SSE2)
+	uint16_t fixed_offset, fixed_scale;
+	bool negative;
+	size_t i = 0;
+
+	GetFixedFactors(offset, scale, &fixed_offset, &negative, &fixed_scale);
+	const __m128i zero = _mm_setzero_si128(), round = _mm_set1_epi16(128);
+	const __m128i alpha_mask = _mm_set1_epi32((int)0xff000000);
+	const __m128i vscale = _mm_set1_epi16((short)fixed_scale), voffset = _mm_set1_epi16((short)fixed_offset);
+	for (; i + 4 <= count; i += 4) {
+		__m128i p = _mm_loadu_si128((const __m128i*)&pixels[i]);
+		// Replicate the alpha of each pixel into all of its bytes
+		__m128i a = _mm_srli_epi32(p, 24);
+		a = _mm_or_si128(a, _mm_slli_epi32(a, 8));
+		a = _mm_or_si128(a, _mm_slli_epi32(a, 16));
+		// Scale the channels and compute the offsets, on two pixels at a time
+		__m128i lo = _mm_unpacklo_epi8(p, zero), hi = _mm_unpackhi_epi8(p, zero);
+		lo = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(lo, vscale), round), 8);
+		hi = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(hi, vscale), round), 8);
+		__m128i olo = _mm_unpacklo_epi8(a, zero), ohi = _mm_unpackhi_epi8(a, zero);
+		olo = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(olo, voffset), round), 8);
+		ohi = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(ohi, voffset), round), 8);
+		// Everything is <= 255 at this stage, so packing doesn't saturate, and the
+		// saturated add/subtract followed by the min with alpha gives us the clamping.
+		__m128i c = _mm_packus_epi16(lo, hi), o = _mm_packus_epi16(olo, ohi);
+		c = negative ? _mm_subs_epu8(c, o) : _mm_adds_epu8(c, o);
+		c = _mm_min_epu8(c, a);
+		c = _mm_or_si128(_mm_andnot_si128(alpha_mask, c), _mm_and_si128(alpha_mask, p));
+		_mm_storeu_si128((__m128i*)&pixels[i], c);
+	}
+	if (i < count)
+		AdjustBrightnessScalar(&pixels[i], count - i, offset, scale);
+#else
+	AdjustBrightnessScalar(pixels, count, offset, scale);
+#endif
+}
@@ -0,0 +1,42 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Brightness adjustments are done in 8.8 fixed point, so that the SIMD and scalar versions
+// produce the exact same pixels.
+#define PIXEL_FIXED_ONE             256
+
+using namespace std;
+
+// Operations on 32-bit premultiplied BGRA pixels, as found in the DIB sections that GDI and
+// the theme API draw into. These are portable, so that they can be validated on any platform.
+class nvPixels {
+private:
+	static void GetFixedFactors(float offset, float scale, uint16_t* fixed_offset, bool* negative, uint16_t* fixed_scale);
+public:
+	// Scale the color channels, then add 'offset' (as a fraction of full intensity, which is
+	// the alpha of each pixel since colors are premultiplied). Alpha is left untouched and
+	// colors are clamped to [0, alpha], so that pixels remain valid premultiplied values.
+	static void AdjustBrightness(uint32_t* pixels, size_t count, float offset, float scale = 1.0f);
+	// The reference implementation, which AdjustBrightness() must match bit for bit
+	static void AdjustBrightnessScalar(uint32_t* pixels, size_t count, float offset, float scale = 1.0f);
+};
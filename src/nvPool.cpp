@@ -0,0 +1,149 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <exception>
+
+#include "nvBrightness.h"
+#include "nvPool.hpp"
+
+nvPool::~nvPool()
+{
+	unique_lock<mutex> lock(pool_mutex);
+	stats.cancelled += queue.size();
+	queue.clear();
+	for (auto& [id, source] : running)
+		source.request_stop();
+	lock.unlock();
+	// The jthread destructors request stop and join
+	workers.clear();
+}
+
+// Highest priority task (oldest first for the same priority) whose bus isn't already busy.
+// Must be called with the mutex held.
+vector<nvPool::task>::iterator nvPool::NextTask()
+{
+	auto next = queue.end();
+	for (auto it = queue.begin(); it != queue.end(); it++) {
+		if (bus_usage[it->bus] >= max_per_bus)
+			continue;
+		if (next == queue.end() || it->priority < next->priority ||
+			(it->priority == next->priority && it->id < next->id))
+			next = it;
+	}
+	return next;
+}
+
+void nvPool::Worker(stop_token st)
+{
+	unique_lock<mutex> lock(pool_mutex);
+
+	while (true) {
+		idle++;
+		bool has_work = work_cv.wait(lock, st, [this] { return NextTask() != queue.end(); });
+		idle--;
+		if (!has_work)
+			break;
+		auto it = NextTask();
+		task t = move(*it);
+		queue.erase(it);
+		stop_source source;
+		running[t.id] = source;
+		bus_usage[t.bus]++;
+		stats.running++;
+		stats.queued = (uint32_t)queue.size();
+		lock.unlock();
+
+		// A task that throws must not take the worker, and the bus it holds, down with it
+		bool failed = true;
+		try {
+			t.fn(source.get_token());
+			failed = false;
+		} catch (const exception& e) {
+			logger("Probe pool: Task %llu failed: %s\n", (unsigned long long)t.id, e.what());
+		} catch (...) {
+			logger("Probe pool: Task %llu failed\n", (unsigned long long)t.id);
+		}
+
+		lock.lock();
+		running.erase(t.id);
+		bus_usage[t.bus]--;
+		stats.running--;
+		if (failed)
+			stats.failed++;
+		else
+			stats.completed++;
+		done_cv.notify_all();
+		// A task on the bus we just released may now be able to run
+		work_cv.notify_all();
+	}
+}
+
+uint64_t nvPool::Submit(function<void(stop_token)> fn, size_t bus, int priority)
+{
+	lock_guard<mutex> lock(pool_mutex);
+
+	uint64_t id = next_id++;
+	queue.push_back({ id, priority, bus, move(fn) });
+	stats.queued = (uint32_t)queue.size();
+	stats.max_queued = max(stats.max_queued, stats.queued);
+	if (idle == 0 && workers.size() < max_threads) {
+		workers.emplace_back([this](stop_token st) { Worker(st); });
+		stats.threads = (uint32_t)workers.size();
+	}
+	work_cv.notify_one();
+	return id;
+}
+
+// Only applies to tasks that haven't started yet
+void nvPool::SetPriority(uint64_t id, int priority)
+{
+	lock_guard<mutex> lock(pool_mutex);
+
+	for (auto& t : queue)
+		if (t.id == id)
+			t.priority = priority;
+}
+
+// Remove a task from the queue or, if it is already running, ask it to stop and wait until
+// it has. Must not be called from the task itself.
+void nvPool::Cancel(uint64_t id)
+{
+	unique_lock<mutex> lock(pool_mutex);
+
+	for (auto it = queue.begin(); it != queue.end(); it++) {
+		if (it->id == id) {
+			queue.erase(it);
+			stats.queued = (uint32_t)queue.size();
+			stats.cancelled++;
+			return;
+		}
+	}
+	auto r = running.find(id);
+	if (r == running.end())
+		return;
+	r->second.request_stop();
+	stats.cancelled++;
+	done_cv.wait(lock, [&] { return !running.contains(id); });
+}
+
+pool_stats_t nvPool::GetStats()
+{
+	lock_guard<mutex> lock(pool_mutex);
+	return stats;
+}
@@ -0,0 +1,83 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+// Task priorities (lower runs first)
+#define POOL_PRIORITY_HIGH          0
+#define POOL_PRIORITY_NORMAL        1
+// Maximum number of worker threads, and number of tasks that may use the same I2C bus at once
+#define POOL_MAX_THREADS            4
+#define POOL_MAX_TASKS_PER_BUS      1
+
+using namespace std;
+
+typedef struct {
+	uint32_t threads;
+	uint32_t running;
+	uint32_t queued;
+	uint32_t max_queued;
+	uint64_t completed;
+	uint64_t cancelled;
+	uint64_t failed;
+} pool_stats_t;
+
+// Process-wide pool for the slow hardware probes (such as retrieving VCP capabilities). Tasks
+// are cooperative: they get a stop_token they must poll, which lets Cancel() return promptly.
+// Worker threads are only created when there is no idle thread to pick up a new task.
+class nvPool {
+private:
+	struct task {
+		uint64_t id;
+		int priority;
+		size_t bus;
+		function<void(stop_token)> fn;
+	};
+	mutex pool_mutex;
+	condition_variable_any work_cv;
+	condition_variable_any done_cv;
+	vector<task> queue;
+	map<uint64_t, stop_source> running;
+	map<size_t, uint32_t> bus_usage;
+	vector<jthread> workers;
+	uint32_t max_threads, max_per_bus, idle = 0;
+	uint64_t next_id = 1;
+	pool_stats_t stats = { 0 };
+	vector<task>::iterator NextTask();
+	void Worker(stop_token st);
+public:
+	nvPool(uint32_t max_threads = POOL_MAX_THREADS, uint32_t max_per_bus = POOL_MAX_TASKS_PER_BUS)
+		: max_threads(max_threads), max_per_bus(max_per_bus) {};
+	~nvPool();
+	uint64_t Submit(function<void(stop_token)> fn, size_t bus, int priority = POOL_PRIORITY_NORMAL);
+	void SetPriority(uint64_t id, int priority);
+	void Cancel(uint64_t id);
+	pool_stats_t GetStats();
+};
+
+extern nvPool probe_pool;
@@ -0,0 +1,329 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <math.h>
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+
+#include "nvBrightness.h"
+#include "nvScheduler.hpp"
+
+#if !defined(M_PI)
+#define M_PI 3.14159265358979323846
+#endif
+
+static bool LocalTime(time_t t, struct tm* tm)
+{
+#if defined(_WIN32)
+	return (localtime_s(tm, &t) == 0);
+#else
+	return (localtime_r(&t, tm) != NULL);
+#endif
+}
+
+static time_t UtcTime(struct tm* tm)
+{
+#if defined(_WIN32)
+	return _mkgmtime(tm);
+#else
+	return timegm(tm);
+#endif
+}
+
+// Whether the local time 't' already occurred an hour before, when the clocks went back
+static bool IsRepeatedTime(time_t t, const struct tm& tm)
+{
+	struct tm prev;
+	// Don't rely on tm_isdst, since some zones, such as Europe/Dublin, have a negative DST
+	return LocalTime(t - 3600, &prev) && prev.tm_mday == tm.tm_mday &&
+		prev.tm_hour == tm.tm_hour && prev.tm_min == tm.tm_min;
+}
+
+// Local time for the given date, normalized, so that the hour or day may overflow
+static time_t MakeLocalTime(const struct tm& base, int day_offset, int hour, int minute)
+{
+	struct tm tm = base;
+	tm.tm_mday += day_offset;
+	tm.tm_hour = hour;
+	tm.tm_min = minute;
+	tm.tm_sec = 0;
+	tm.tm_isdst = -1;
+	return mktime(&tm);
+}
+
+// Parse a cron field ("*", "5", "1-5", "*/15", "0-30/10" or a list of these) into a bitmask
+static bool ParseField(const wstring& field, int min, int max, uint64_t* mask)
+{
+	wstringstream ss(field);
+	wstring item;
+
+	*mask = 0;
+	while (getline(ss, item, L',')) {
+		int start = min, end = max, step = 1;
+		size_t slash = item.find(L'/');
+		if (slash != wstring::npos) {
+			step = (int)wcstol(item.c_str() + slash + 1, NULL, 10);
+			item.resize(slash);
+		}
+		if (item != L"*") {
+			wchar_t* p;
+			start = end = wcstol(item.c_str(), &p, 10);
+			if (*p == L'-')
+				end = wcstol(p + 1, &p, 10);
+			else if (slash != wstring::npos)
+				end = max;
+			if (*p != 0 || p == item.c_str())
+				return false;
+		}
+		if (step <= 0 || start < min || end > max || start > end)
+			return false;
+		for (int i = start; i <= end; i += step)
+			*mask |= 1ULL << i;
+	}
+	return (*mask != 0);
+}
+
+bool nvScheduler::ParseCron(const vector<wstring>& fields, schedule_rule_t& rule)
+{
+	uint64_t mask[5];
+	static const int range[5][2] = { { 0, 59 }, { 0, 23 }, { 1, 31 }, { 1, 12 }, { 0, 7 } };
+
+	for (int i = 0; i < 5; i++)
+		if (!ParseField(fields[i], range[i][0], range[i][1], &mask[i]))
+			return false;
+	rule.minutes = mask[0];
+	rule.hours = (uint32_t)mask[1];
+	rule.days = (uint32_t)mask[2];
+	rule.months = (uint16_t)mask[3];
+	// Both 0 and 7 are Sunday
+	rule.weekdays = (uint8_t)((mask[4] | (mask[4] >> 7)) & 0x7f);
+	rule.any_day = (fields[2] == L"*");
+	rule.any_weekday = (fields[4] == L"*");
+	return true;
+}
+
+// As with cron, if both the day of the month and the day of the week are restricted, either one
+// matching is enough.
+bool nvScheduler::Matches(const schedule_rule_t& rule, const struct tm& tm)
+{
+	bool day = (rule.days >> tm.tm_mday) & 1, weekday = (rule.weekdays >> tm.tm_wday) & 1;
+
+	if (!((rule.months >> (tm.tm_mon + 1)) & 1))
+		return false;
+	if (!rule.any_day && !rule.any_weekday)
+		return day || weekday;
+	return day && weekday;
+}
+
+// Sunrise or sunset, in minutes from midnight UTC, per the NOAA General Solar Position equations.
+// Returns false if the sun doesn't rise or set on that day.
+bool nvScheduler::GetSolarMinutes(int year, int month, int day, double latitude, double longitude,
+	bool sunrise, double* utc_minutes)
+{
+	struct tm tm = { .tm_mday = day, .tm_mon = month - 1, .tm_year = year - 1900 };
+	UtcTime(&tm);
+	double g = 2.0 * M_PI / 365.0 * tm.tm_yday;
+	double eqtime = 229.18 * (0.000075 + 0.001868 * cos(g) - 0.032077 * sin(g) -
+		0.014615 * cos(2 * g) - 0.040849 * sin(2 * g));
+	double decl = 0.006918 - 0.399912 * cos(g) + 0.070257 * sin(g) - 0.006758 * cos(2 * g) +
+		0.000907 * sin(2 * g) - 0.002697 * cos(3 * g) + 0.00148 * sin(3 * g);
+	double lat = latitude * M_PI / 180.0;
+	// 90.833° accounts for the refraction and the size of the solar disk
+	double cos_ha = cos(90.833 * M_PI / 180.0) / (cos(lat) * cos(decl)) - tan(lat) * tan(decl);
+	if (cos_ha < -1.0 || cos_ha > 1.0)
+		return false;
+	double ha = acos(cos_ha) * 180.0 / M_PI;
+	*utc_minutes = 720.0 - 4.0 * (longitude + (sunrise ? ha : -ha)) - eqtime;
+	return true;
+}
+
+// The time of a solar rule on the given local date
+bool nvScheduler::GetSolarTime(const schedule_rule_t& rule, const struct tm& date, time_t* t)
+{
+	double minutes;
+	struct tm tm = { .tm_mday = date.tm_mday, .tm_mon = date.tm_mon, .tm_year = date.tm_year };
+
+	if (!GetSolarMinutes(date.tm_year + 1900, date.tm_mon + 1, date.tm_mday, latitude, longitude,
+		rule.sunrise, &minutes))
+		return false;
+	*t = UtcTime(&tm) + (time_t)llround((minutes + rule.offset) * 60.0);
+	return true;
+}
+
+// The first occurrence of a rule after 'after', or 0 if there is none within SCHEDULE_MAX_DAYS
+time_t nvScheduler::GetNext(const schedule_rule_t& rule, time_t after)
+{
+	struct tm tm;
+	time_t t;
+
+	if (rule.solar) {
+		// Start from the day before, since the UTC date may differ from the local one
+		for (int day = -1; day <= SCHEDULE_MAX_DAYS; day++) {
+			if (!LocalTime(after, &tm))
+				return 0;
+			tm.tm_mday += day;
+			tm.tm_isdst = -1;
+			mktime(&tm);
+			if (GetSolarTime(rule, tm, &t) && t > after)
+				return t;
+		}
+		return 0;
+	}
+
+	// Skip whole days, then whole hours, that don't match. Around DST transitions, mktime()
+	// may resolve an ambiguous local time to the wrong side, so always make some progress.
+	t = after - (after % 60) + 60;
+	while (t - after < SCHEDULE_MAX_DAYS * 86400LL) {
+		if (!LocalTime(t, &tm))
+			return 0;
+		if (!Matches(rule, tm))
+			t = max(MakeLocalTime(tm, 1, 0, 0), t + 60);
+		else if (!((rule.hours >> tm.tm_hour) & 1))
+			t = max(MakeLocalTime(tm, 0, tm.tm_hour + 1, 0), t + 60);
+		else if (!((rule.minutes >> tm.tm_min) & 1))
+			t += 60;
+		else if (IsRepeatedTime(t, tm))
+			t += 60;
+		else
+			return t;
+	}
+	return 0;
+}
+
+// The last occurrence of a rule at or before 'before', or 0 if there is none
+time_t nvScheduler::GetPrevious(const schedule_rule_t& rule, time_t before)
+{
+	struct tm tm;
+	time_t t;
+
+	if (rule.solar) {
+		for (int day = 1; day >= -SCHEDULE_MAX_DAYS; day--) {
+			if (!LocalTime(before, &tm))
+				return 0;
+			tm.tm_mday += day;
+			tm.tm_isdst = -1;
+			mktime(&tm);
+			if (GetSolarTime(rule, tm, &t) && t <= before)
+				return t;
+		}
+		return 0;
+	}
+
+	t = before - (before % 60);
+	while (before - t < SCHEDULE_MAX_DAYS * 86400LL) {
+		if (!LocalTime(t, &tm))
+			return 0;
+		if (!Matches(rule, tm))
+			t = min(MakeLocalTime(tm, 0, 0, 0) - 60, t - 60);
+		else if (!((rule.hours >> tm.tm_hour) & 1))
+			t = min(MakeLocalTime(tm, 0, tm.tm_hour, 0) - 60, t - 60);
+		else if (!((rule.minutes >> tm.tm_min) & 1))
+			t -= 60;
+		else
+			return t;
+	}
+	return 0;
+}
+
+// Returns the number of valid rules. Invalid ones are logged and ignored.
+size_t nvScheduler::Parse(const wstring& schedule)
+{
+	wstringstream ss(schedule);
+	wstring text, field;
+
+	rules.clear();
+	while (getline(ss, text, L';')) {
+		vector<wstring> fields;
+		wstringstream fs(text);
+		while (fs >> field)
+			fields.push_back(field);
+		if (fields.empty())
+			continue;
+
+		schedule_rule_t rule = { };
+		wchar_t* end;
+		bool valid = (fields.size() == 3 || fields.size() == 7);
+		if (valid) {
+			rule.display = fields.front();
+			rule.level = wcstof(fields.back().c_str(), &end);
+			valid = (*end == 0 && rule.level >= 0.0f && rule.level <= 100.0f);
+		}
+		if (valid && fields.size() == 3) {
+			rule.solar = true;
+			rule.sunrise = (fields[1].compare(0, 7, L"sunrise") == 0);
+			size_t len = rule.sunrise ? 7 : 6;
+			valid = (rule.sunrise || fields[1].compare(0, 6, L"sunset") == 0) && has_location;
+			if (valid && fields[1].size() > len) {
+				rule.offset = wcstol(&fields[1][len], &end, 10);
+				valid = (*end == 0 && (fields[1][len] == L'+' || fields[1][len] == L'-'));
+			}
+		} else if (valid) {
+			valid = ParseCron(vector<wstring>(fields.begin() + 1, fields.end() - 1), rule);
+		}
+		if (!valid) {
+			logger("Schedule: Ignoring invalid rule '%S'%s\n", &text[text.find_first_not_of(L" \t")],
+				(fields.size() == 3 && !has_location) ? " (no location set)" : "");
+			continue;
+		}
+		rules.push_back(rule);
+	}
+	stats.rules = (uint32_t)rules.size();
+	return rules.size();
+}
+
+// Apply the levels that should currently be in effect, which is what the latest rule that
+// occurred says, and schedule the next occurrence of every rule. This is what we do on
+// startup, as well as whenever we may have missed some occurrences, such as after a suspend.
+void nvScheduler::Resync(time_t now, function<void(const wstring& display, float level)> apply)
+{
+	map<wstring, pair<time_t, float>> latest;
+	time_t t;
+
+	wheel.Reset(now);
+	for (size_t i = 0; i < rules.size(); i++) {
+		t = GetPrevious(rules[i], now);
+		if (t != 0 && t >= latest[rules[i].display].first)
+			latest[rules[i].display] = { t, rules[i].level };
+		t = GetNext(rules[i], now);
+		if (t != 0)
+			wheel.Add(i, t);
+	}
+	// Rules for every display come first, so that the ones for a specific display that
+	// occurred more recently can override them
+	auto all = latest.find(L"*");
+	if (all != latest.end() && all->second.first != 0)
+		apply(all->first, all->second.second);
+	for (auto& [display, last] : latest) {
+		if (display != L"*" && last.first != 0 && (all == latest.end() || last.first > all->second.first))
+			apply(display, last.second);
+	}
+	stats.resyncs++;
+}
+
+void nvScheduler::Advance(time_t now, function<void(const wstring& display, float level)> apply)
+{
+	wheel.Advance(now, [&](uint64_t id, int64_t expiry) {
+		apply(rules[id].display, rules[id].level);
+		stats.fired++;
+		time_t next = GetNext(rules[id], (time_t)expiry);
+		if (next != 0)
+			wheel.Add(id, next);
+	});
+}
@@ -0,0 +1,88 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "nvTimerWheel.hpp"
+
+// How far we look for the next (or previous) occurrence of a rule, in days
+#define SCHEDULE_MAX_DAYS           366
+
+using namespace std;
+
+typedef struct {
+	wstring display;            // Device ID, or "*" for every display
+	bool solar;
+	bool sunrise;
+	int32_t offset;             // In minutes, for solar rules
+	uint64_t minutes;           // Bitmasks of the cron fields
+	uint32_t hours;
+	uint32_t days;
+	uint16_t months;
+	uint8_t weekdays;
+	bool any_day;
+	bool any_weekday;
+	float level;
+} schedule_rule_t;
+
+typedef struct {
+	uint32_t rules;
+	uint64_t fired;
+	uint32_t resyncs;
+} schedule_stats_t;
+
+// Time of day brightness schedule. The Schedule registry setting is a list of rules separated
+// by ';', each of the form "<display> <when> <level>", where <display> is a device ID or '*' for
+// every display, <level> is a brightness level in percent and <when> is either a cron expression
+// (minute hour day-of-month month day-of-week, in local time), or sunrise or sunset, with an
+// optional offset in minutes, such as "sunset-30". Solar rules are computed from the Latitude
+// and Longitude settings. For instance: "* 0 7 * * 1-5 80; * sunset-30 40".
+// Local times that are skipped when the clocks go forward never occur, and the ones that are
+// repeated when the clocks go back only occur once.
+// All times are in seconds since the epoch, and provided by the caller, so that the scheduler
+// can be run against a virtual clock.
+class nvScheduler {
+private:
+	vector<schedule_rule_t> rules;
+	nvTimerWheel wheel;
+	double latitude = 0.0, longitude = 0.0;
+	bool has_location = false;
+	schedule_stats_t stats = { 0 };
+	bool ParseCron(const vector<wstring>& fields, schedule_rule_t& rule);
+	bool Matches(const schedule_rule_t& rule, const struct tm& tm);
+	bool GetSolarTime(const schedule_rule_t& rule, const struct tm& date, time_t* t);
+	time_t GetNext(const schedule_rule_t& rule, time_t after);
+	time_t GetPrevious(const schedule_rule_t& rule, time_t before);
+public:
+	static bool GetSolarMinutes(int year, int month, int day, double latitude, double longitude,
+		bool sunrise, double* utc_minutes);
+	void SetLocation(double lat, double lon) { latitude = lat; longitude = lon; has_location = true; };
+	size_t Parse(const wstring& schedule);
+	void Resync(time_t now, function<void(const wstring& display, float level)> apply);
+	void Advance(time_t now, function<void(const wstring& display, float level)> apply);
+	time_t GetNextTime() { return (wheel.Size() == 0) ? 0 : (time_t)wheel.NextExpiry(); };
+	const schedule_stats_t& GetStats() { return stats; };
+	const wheel_stats_t& GetWheelStats() { return wheel.GetStats(); };
+};
@@ -0,0 +1,366 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include "registry.h"
+#endif
+#include <string.h>
+#include <wchar.h>
+
+#include <fstream>
+
+#include "nvBrightness.h"
+#include "nvCache.hpp"
+#include "nvStorage.hpp"
+
+// The storage file is laid out as follows (little endian, with native wchar_t key names):
+//   header: "nvST" magic, uint16_t version, uint16_t sizeof(wchar_t), uint32_t number of values
+//   value:  uint32_t key size, uint32_t type, uint32_t data size, key, data
+//   footer: uint32_t CRC of everything that precedes it
+static const char storage_magic[4] = { 'n', 'v', 'S', 'T' };
+#define STORAGE_HEADER_SIZE         12
+#define STORAGE_MAX_FILE_SIZE       (16 * 1024 * 1024)
+
+template <typename T> static __inline void Append(vector<uint8_t>& buf, T val)
+{
+	uint8_t* p = (uint8_t*)&val;
+	buf.insert(buf.end(), p, p + sizeof(T));
+}
+
+int32_t nvStorage::Read32(const wchar_t* key)
+{
+	int32_t val = 0;
+	Get(key, STORAGE_DWORD, &val, sizeof(val));
+	return val;
+}
+
+bool nvStorage::Write32(const wchar_t* key, int32_t val)
+{
+	return Set(key, STORAGE_DWORD, &val, sizeof(val));
+}
+
+wstring nvStorage::ReadStr(const wchar_t* key)
+{
+	wchar_t str[512 + 1] = { 0 };
+	Get(key, STORAGE_SZ, str, sizeof(str) - sizeof(wchar_t));
+	return wstring(str);
+}
+
+bool nvStorage::WriteStr(const wchar_t* key, const wchar_t* val)
+{
+	return Set(key, STORAGE_SZ, val, wcslen(val) * sizeof(wchar_t));
+}
+
+// Multi strings are returned with their NUL separators and double NUL terminator
+wstring nvStorage::ReadMultiStr(const wchar_t* key)
+{
+	wchar_t multi_str[512 + 2] = { 0 };
+	Get(key, STORAGE_MULTI_SZ, multi_str, sizeof(multi_str) - 2 * sizeof(wchar_t));
+	size_t len;
+	for (len = 0; multi_str[len] != 0; len += wcslen(&multi_str[len]) + 1);
+	return wstring(multi_str, len + 1);
+}
+
+bool nvStorage::WriteMultiStr(const wchar_t* key, const wchar_t* val)
+{
+	size_t len;
+	for (len = 0; val[len] != 0; len += wcslen(&val[len]) + 1);
+	return Set(key, STORAGE_MULTI_SZ, val, (len + 1) * sizeof(wchar_t));
+}
+
+// Write a set of DWORD values that live under the same (existing) key path
+bool nvStorage::Write32Batch(const wchar_t* path, span<const storage_dword_t> values)
+{
+	nvStorageBatch batch(this);
+	bool r = true;
+	for (auto& v : values)
+		r = Write32((wstring(path) + L"\\" + v.name).c_str(), v.value) && r;
+	return r;
+}
+
+size_t nvMemoryStorage::Get(const wchar_t* key, uint32_t type, void* dest, size_t dest_size)
+{
+	lock_guard<mutex> lock(storage_mutex);
+
+	stats.reads++;
+	if (dest != NULL)
+		memset(dest, 0, dest_size);
+	auto it = values.find(key);
+	if (it == values.end() || it->second.type != type)
+		return 0;
+	size_t size = min(dest_size, it->second.data.size());
+	if (dest != NULL)
+		memcpy(dest, it->second.data.data(), size);
+	return (dest == NULL) ? it->second.data.size() : size;
+}
+
+bool nvMemoryStorage::Set(const wchar_t* key, uint32_t type, const void* src, size_t src_size)
+{
+	lock_guard<mutex> lock(storage_mutex);
+
+	stats.writes++;
+	values[key] = { type, vector<uint8_t>((const uint8_t*)src, (const uint8_t*)src + src_size) };
+	return true;
+}
+
+bool nvMemoryStorage::Delete(const wchar_t* key)
+{
+	lock_guard<mutex> lock(storage_mutex);
+
+	stats.writes++;
+	values.erase(key);
+	return true;
+}
+
+bool nvFileStorage::Open(const filesystem::path& file_path)
+{
+	lock_guard<mutex> lock(storage_mutex);
+	error_code ec;
+
+	path = file_path;
+	values.clear();
+	dirty = false;
+
+	auto size = filesystem::file_size(path, ec);
+	if (ec)
+		return false;
+	if (size < STORAGE_HEADER_SIZE + 4 || size > STORAGE_MAX_FILE_SIZE) {
+		logger("Discarding storage: Invalid size (%llu bytes)\n", (unsigned long long)size);
+		return false;
+	}
+
+	vector<uint8_t> buf((size_t)size);
+	ifstream file(path, ios::binary);
+	if (!file.read((char*)buf.data(), buf.size()))
+		return false;
+
+	uint16_t version, wchar_size;
+	uint32_t count, crc;
+	memcpy(&version, &buf[4], sizeof(version));
+	memcpy(&wchar_size, &buf[6], sizeof(wchar_size));
+	memcpy(&count, &buf[8], sizeof(count));
+	memcpy(&crc, &buf[buf.size() - 4], sizeof(crc));
+	if (memcmp(buf.data(), storage_magic, sizeof(storage_magic)) != 0 || version != STORAGE_VERSION ||
+		wchar_size != sizeof(wchar_t) || crc != nvCache::Crc32(buf.data(), buf.size() - 4)) {
+		logger("Discarding storage: Invalid header or CRC\n");
+		return false;
+	}
+
+	size_t pos = STORAGE_HEADER_SIZE, end = buf.size() - 4;
+	for (uint32_t i = 0; i < count; i++) {
+		uint32_t key_size, type, data_size;
+		if (pos + 12 > end)
+			break;
+		memcpy(&key_size, &buf[pos], 4);
+		memcpy(&type, &buf[pos + 4], 4);
+		memcpy(&data_size, &buf[pos + 8], 4);
+		pos += 12;
+		if (key_size % sizeof(wchar_t) != 0 || key_size > end - pos || data_size > end - pos - key_size)
+			break;
+		wstring key(key_size / sizeof(wchar_t), L'\0');
+		memcpy(key.data(), &buf[pos], key_size);
+		pos += key_size;
+		values[key] = { type, vector<uint8_t>(&buf[pos], &buf[pos] + data_size) };
+		pos += data_size;
+	}
+	return true;
+}
+
+bool nvFileStorage::Set(const wchar_t* key, uint32_t type, const void* src, size_t src_size)
+{
+	dirty = true;
+	return nvMemoryStorage::Set(key, type, src, src_size);
+}
+
+bool nvFileStorage::Delete(const wchar_t* key)
+{
+	dirty = true;
+	return nvMemoryStorage::Delete(key);
+}
+
+bool nvFileStorage::Flush()
+{
+	lock_guard<mutex> lock(storage_mutex);
+	vector<uint8_t> buf;
+	error_code ec;
+
+	if (!dirty || path.empty())
+		return true;
+
+	buf.insert(buf.end(), storage_magic, storage_magic + sizeof(storage_magic));
+	Append<uint16_t>(buf, STORAGE_VERSION);
+	Append<uint16_t>(buf, (uint16_t)sizeof(wchar_t));
+	Append<uint32_t>(buf, (uint32_t)values.size());
+	for (auto& [key, v] : values) {
+		Append<uint32_t>(buf, (uint32_t)(key.size() * sizeof(wchar_t)));
+		Append<uint32_t>(buf, v.type);
+		Append<uint32_t>(buf, (uint32_t)v.data.size());
+		buf.insert(buf.end(), (const uint8_t*)key.data(), (const uint8_t*)(key.data() + key.size()));
+		buf.insert(buf.end(), v.data.begin(), v.data.end());
+	}
+	Append<uint32_t>(buf, nvCache::Crc32(buf.data(), buf.size()));
+
+	auto tmp_path = path;
+	tmp_path += ".tmp";
+	{
+		ofstream file(tmp_path, ios::binary | ios::trunc);
+		if (!file.write((const char*)buf.data(), buf.size())) {
+			logger("Could not write storage\n");
+			return false;
+		}
+	}
+	filesystem::rename(tmp_path, path, ec);
+	if (ec) {
+		logger("Could not update storage: %s\n", ec.message().c_str());
+		filesystem::remove(tmp_path, ec);
+		return false;
+	}
+	stats.flushes++;
+	dirty = false;
+	return true;
+}
+
+#if defined(_WIN32)
+// Returns the handle of the key that holds value 'key', along with the name of the value.
+// Short key names are values of HKCU\SOFTWARE\<Company>\<Application>, which gets created
+// if needed, whereas the keys for full paths must already exist.
+HKEY nvRegistryStorage::OpenKey(const wchar_t* key, wstring& path, const wchar_t** value_name)
+{
+	HKEY hKey = NULL;
+	LONG s;
+
+	const wchar_t* p = wcsrchr(key, L'\\');
+	if (p == NULL) {
+		if (COMPANY_NAME == NULL || COMPANY_NAME[0] == L'\0' || APPLICATION_NAME == NULL || APPLICATION_NAME[0] == L'\0')
+			return NULL;
+		path = wstring(L"SOFTWARE\\") + COMPANY_NAME + L"\\" + APPLICATION_NAME;
+		*value_name = key;
+	} else {
+		path = wstring(key, p - key);
+		*value_name = p + 1;
+	}
+
+	if (batch_depth != 0) {
+		auto it = keys.find(path);
+		if (it != keys.end()) {
+			stats.cached_opens++;
+			return it->second;
+		}
+	}
+
+	stats.syscalls++;
+	if (p == NULL)
+		s = RegCreateKeyEx(HKEY_CURRENT_USER, path.c_str(), 0, NULL, 0, KEY_QUERY_VALUE | KEY_SET_VALUE, NULL, &hKey, NULL);
+	else
+		s = RegOpenKeyEx(HKEY_CURRENT_USER, path.c_str(), 0, KEY_QUERY_VALUE | KEY_SET_VALUE, &hKey);
+	if (s != ERROR_SUCCESS)
+		return NULL;
+	if (batch_depth != 0)
+		keys[path] = hKey;
+	return hKey;
+}
+
+// Outside of a batch, keys are closed right away. Within a batch, a key that we failed to
+// access is closed and dropped from the cache (e.g. it may have been deleted under us).
+void nvRegistryStorage::ReleaseKey(const wstring& path, HKEY hKey, bool failed)
+{
+	if (batch_depth != 0) {
+		if (!failed)
+			return;
+		keys.erase(path);
+	}
+	stats.syscalls++;
+	RegCloseKey(hKey);
+}
+
+size_t nvRegistryStorage::Get(const wchar_t* key, uint32_t type, void* dest, size_t dest_size)
+{
+	lock_guard<mutex> lock(storage_mutex);
+	const wchar_t* value_name;
+	DWORD dwType = REG_NONE, dwSize = (DWORD)dest_size;
+	wstring path;
+
+	stats.reads++;
+	if (dest != NULL)
+		memset(dest, 0, dest_size);
+	HKEY hKey = OpenKey(key, path, &value_name);
+	if (hKey == NULL)
+		return 0;
+	stats.syscalls++;
+	LONG s = RegQueryValueEx(hKey, value_name, NULL, &dwType, (LPBYTE)dest, &dwSize);
+	ReleaseKey(path, hKey, s != ERROR_SUCCESS && s != ERROR_FILE_NOT_FOUND && s != ERROR_MORE_DATA);
+	if (s != ERROR_SUCCESS || dwType != type) {
+		if (dest != NULL)
+			memset(dest, 0, dest_size);
+		return 0;
+	}
+	return dwSize;
+}
+
+bool nvRegistryStorage::Set(const wchar_t* key, uint32_t type, const void* src, size_t src_size)
+{
+	lock_guard<mutex> lock(storage_mutex);
+	const wchar_t* value_name;
+	wstring path;
+
+	stats.writes++;
+	HKEY hKey = OpenKey(key, path, &value_name);
+	if (hKey == NULL)
+		return false;
+	stats.syscalls++;
+	LONG s = RegSetValueEx(hKey, value_name, 0, type, (const BYTE*)src, (DWORD)src_size);
+	ReleaseKey(path, hKey, s != ERROR_SUCCESS);
+	return (s == ERROR_SUCCESS);
+}
+
+bool nvRegistryStorage::Delete(const wchar_t* key)
+{
+	lock_guard<mutex> lock(storage_mutex);
+	const wchar_t* value_name;
+	wstring path;
+
+	stats.writes++;
+	HKEY hKey = OpenKey(key, path, &value_name);
+	if (hKey == NULL)
+		return false;
+	stats.syscalls++;
+	LONG s = RegDeleteValue(hKey, value_name);
+	ReleaseKey(path, hKey, s != ERROR_SUCCESS && s != ERROR_FILE_NOT_FOUND);
+	return (s == ERROR_SUCCESS || s == ERROR_FILE_NOT_FOUND);
+}
+
+void nvRegistryStorage::BeginBatch()
+{
+	lock_guard<mutex> lock(storage_mutex);
+	batch_depth++;
+}
+
+void nvRegistryStorage::EndBatch()
+{
+	lock_guard<mutex> lock(storage_mutex);
+	if (batch_depth != 0 && --batch_depth != 0)
+		return;
+	for (auto& [path, hKey] : keys) {
+		stats.syscalls++;
+		RegCloseKey(hKey);
+	}
+	keys.clear();
+}
+#endif
@@ -0,0 +1,149 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <stdint.h>
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+
+// Value types, which match the registry ones
+#define STORAGE_SZ                  1
+#define STORAGE_BINARY              3
+#define STORAGE_DWORD               4
+#define STORAGE_MULTI_SZ            7
+
+#define STORAGE_VERSION             1
+
+using namespace std;
+
+typedef struct {
+	const wchar_t* name;
+	int32_t value;
+} storage_dword_t;
+
+typedef struct {
+	uint64_t reads;
+	uint64_t writes;
+	uint64_t flushes;
+	uint64_t syscalls;          // OS calls issued by the backend (key open/close, value query/set/delete)
+	uint64_t cached_opens;      // Key opens that were avoided by reusing a handle from a batch
+} storage_stats_t;
+
+// Key/value storage for our persistent data, with the same semantics as the registry.h
+// helpers: a key name without a backslash is a value of the application key, whereas
+// a key name with backslashes is a full path under HKEY_CURRENT_USER, of which the registry
+// parent key must exist for writes to succeed, and reading a value that doesn't exist (or that has
+// a different type) returns zero/empty data.
+class nvStorage {
+protected:
+	storage_stats_t stats = { 0 };
+public:
+	virtual ~nvStorage() {};
+	// Returns the size of the data read, or 0 if the value doesn't exist or has a different type
+	virtual size_t Get(const wchar_t* key, uint32_t type, void* dest, size_t dest_size) = 0;
+	virtual bool Set(const wchar_t* key, uint32_t type, const void* src, size_t src_size) = 0;
+	virtual bool Delete(const wchar_t* key) = 0;
+	virtual bool Flush() { return true; };
+	// See nvStorageBatch below. Batches can be nested.
+	virtual void BeginBatch() {};
+	virtual void EndBatch() {};
+	const storage_stats_t& GetStats() { return stats; };
+	int32_t Read32(const wchar_t* key);
+	bool Write32(const wchar_t* key, int32_t val);
+	wstring ReadStr(const wchar_t* key);
+	bool WriteStr(const wchar_t* key, const wchar_t* val);
+	wstring ReadMultiStr(const wchar_t* key);
+	bool WriteMultiStr(const wchar_t* key, const wchar_t* val);
+	// Write a set of DWORD values under the full key path 'path'. As with any other full path, the
+	// registry key must already exist, since we never create keys outside of our application key
+	// (the nVidia driver is the one that creates the Color keys of the LUIDs it knows about).
+	bool Write32Batch(const wchar_t* path, span<const storage_dword_t> values);
+};
+
+// In-memory storage, mostly for tests and benchmarks
+class nvMemoryStorage : public nvStorage {
+protected:
+	struct value {
+		uint32_t type;
+		vector<uint8_t> data;
+	};
+	mutex storage_mutex;
+	map<wstring, value> values;
+public:
+	size_t Get(const wchar_t* key, uint32_t type, void* dest, size_t dest_size) override;
+	bool Set(const wchar_t* key, uint32_t type, const void* src, size_t src_size) override;
+	bool Delete(const wchar_t* key) override;
+	size_t GetNumberOfValues() { return values.size(); };
+};
+
+// In-memory storage, backed by a file that gets rewritten as a whole (through a temporary file
+// and a rename, so that it's never left half written) when flushed or destroyed.
+class nvFileStorage : public nvMemoryStorage {
+private:
+	filesystem::path path;
+	bool dirty = false;
+public:
+	~nvFileStorage() { Flush(); };
+	bool Open(const filesystem::path& file_path);
+	bool Set(const wchar_t* key, uint32_t type, const void* src, size_t src_size) override;
+	bool Delete(const wchar_t* key) override;
+	bool Flush() override;
+};
+
+#if defined(_WIN32)
+// The Windows registry. Outside of a batch, every access opens and closes its key (which is what
+// the registry.h helpers do), whereas within a batch, the key handles are kept open, per parent
+// path, until the outermost batch ends or an access through that handle fails.
+class nvRegistryStorage : public nvStorage {
+private:
+	mutex storage_mutex;
+	map<wstring, HKEY> keys;
+	uint32_t batch_depth = 0;
+	HKEY OpenKey(const wchar_t* key, wstring& path, const wchar_t** value_name);
+	void ReleaseKey(const wstring& path, HKEY hKey, bool failed);
+public:
+	~nvRegistryStorage() { EndBatch(); };
+	size_t Get(const wchar_t* key, uint32_t type, void* dest, size_t dest_size) override;
+	bool Set(const wchar_t* key, uint32_t type, const void* src, size_t src_size) override;
+	bool Delete(const wchar_t* key) override;
+	void BeginBatch() override;
+	void EndBatch() override;
+};
+#endif
+
+// Scoped batch of storage accesses, which lets the backend reuse whatever it had to open for
+// the previous accesses, e.g. when reading or writing multiple values that share the same key.
+class nvStorageBatch {
+	nvStorage* s;
+public:
+	nvStorageBatch(nvStorage* s) : s(s) { s->BeginBatch(); };
+	~nvStorageBatch() { s->EndBatch(); };
+	nvStorageBatch(const nvStorageBatch&) = delete;
+	nvStorageBatch& operator=(const nvStorageBatch&) = delete;
+};
+
+extern nvStorage* storage;
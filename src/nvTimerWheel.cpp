@@ -0,0 +1,129 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+
+#include "nvTimerWheel.hpp"
+
+#define WHEEL_MASK                  (WHEEL_SLOTS - 1)
+#define WHEEL_RANGE(level)          (1LL << (WHEEL_SLOT_BITS * ((level) + 1)))
+
+void nvTimerWheel::Insert(const timer& t)
+{
+	int64_t delta = t.expiry - current;
+	int64_t expiry = t.expiry;
+	int level;
+
+	if (delta <= 0) {
+		due.push_back(t);
+		return;
+	}
+	for (level = 0; level < WHEEL_LEVELS - 1 && delta >= WHEEL_RANGE(level); level++);
+	// Park the timers that are out of range as far as we can. They get reinserted on cascade.
+	if (delta >= WHEEL_RANGE(WHEEL_LEVELS - 1))
+		expiry = current + WHEEL_RANGE(WHEEL_LEVELS - 1) - 1;
+	slots[level][(expiry >> (WHEEL_SLOT_BITS * level)) & WHEEL_MASK].push_back(t);
+}
+
+// Ticking through a long suspend would take a while, so we just reinsert everything instead
+void nvTimerWheel::Rebuild(int64_t now, vector<timer>& expired)
+{
+	vector<timer> timers;
+
+	for (auto& level : slots) {
+		for (auto& slot : level) {
+			timers.insert(timers.end(), slot.begin(), slot.end());
+			slot.clear();
+		}
+	}
+	current = now;
+	for (auto& t : timers) {
+		if (t.expiry <= now)
+			expired.push_back(t);
+		else
+			Insert(t);
+	}
+	stats.rebuilds++;
+}
+
+void nvTimerWheel::Reset(int64_t now)
+{
+	for (auto& level : slots)
+		for (auto& slot : level)
+			slot.clear();
+	due.clear();
+	current = now;
+	count = 0;
+}
+
+void nvTimerWheel::Add(uint64_t id, int64_t expiry)
+{
+	Insert({ id, expiry });
+	count++;
+	stats.added++;
+}
+
+// Expire every timer that is due by 'now', in order of expiry. The callback is only invoked
+// once the wheel is up to date, so it may add timers.
+void nvTimerWheel::Advance(int64_t now, function<void(uint64_t id, int64_t expiry)> expired_fn)
+{
+	vector<timer> expired;
+
+	expired.swap(due);
+	if (now - current >= WHEEL_RANGE(1)) {
+		Rebuild(now, expired);
+	} else while (current < now) {
+		current++;
+		// When a level wraps around, the matching slot of the level above moves down
+		for (int level = 1; level < WHEEL_LEVELS; level++) {
+			if (((current >> (WHEEL_SLOT_BITS * (level - 1))) & WHEEL_MASK) != 0)
+				break;
+			vector<timer> cascade;
+			cascade.swap(slots[level][(current >> (WHEEL_SLOT_BITS * level)) & WHEEL_MASK]);
+			stats.cascaded += cascade.size();
+			for (auto& t : cascade)
+				Insert(t);
+		}
+		auto& slot = slots[0][current & WHEEL_MASK];
+		expired.insert(expired.end(), slot.begin(), slot.end());
+		slot.clear();
+		// Cascading may have found timers that expire right now
+		expired.insert(expired.end(), due.begin(), due.end());
+		due.clear();
+	}
+
+	stable_sort(expired.begin(), expired.end(), [](auto& a, auto& b) { return a.expiry < b.expiry; });
+	count -= expired.size();
+	stats.expired += expired.size();
+	for (auto& t : expired)
+		expired_fn(t.id, t.expiry);
+}
+
+// The earliest expiry of all the timers, or INT64_MAX if there are none
+int64_t nvTimerWheel::NextExpiry()
+{
+	int64_t next = INT64_MAX;
+
+	for (auto& t : due)
+		next = min(next, t.expiry);
+	for (auto& level : slots)
+		for (auto& slot : level)
+			for (auto& t : slot)
+				next = min(next, t.expiry);
+	return next;
+}
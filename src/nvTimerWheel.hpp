@@ -0,0 +1,65 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include <functional>
+#include <vector>
+
+// A tick is a second. Each level of the wheel covers WHEEL_SLOTS times the range of the one
+// below, so that 4 levels of 64 slots cover about 194 days. Timers that are further away than
+// that get parked in the last level, and reinserted when they cascade from it.
+#define WHEEL_LEVELS                4
+#define WHEEL_SLOT_BITS             6
+#define WHEEL_SLOTS                 (1 << WHEEL_SLOT_BITS)
+
+using namespace std;
+
+typedef struct {
+	uint64_t added;
+	uint64_t expired;
+	uint64_t cascaded;          // Timers that moved down a level
+	uint64_t rebuilds;          // Advances that were too large to tick through
+} wheel_stats_t;
+
+// Hierarchical timer wheel: adding a timer and ticking are O(1), except for the cascades
+// from the upper levels, which happen once every WHEEL_SLOTS ticks at most. This is meant to
+// be driven from a single OS timer, set to NextExpiry().
+class nvTimerWheel {
+private:
+	struct timer {
+		uint64_t id;
+		int64_t expiry;
+	};
+	vector<timer> slots[WHEEL_LEVELS][WHEEL_SLOTS];
+	vector<timer> due;          // Timers that had already expired when they were added
+	int64_t current = 0;
+	size_t count = 0;
+	wheel_stats_t stats = { 0 };
+	void Insert(const timer& t);
+	void Rebuild(int64_t now, vector<timer>& expired);
+public:
+	void Reset(int64_t now);
+	void Add(uint64_t id, int64_t expiry);
+	void Advance(int64_t now, function<void(uint64_t id, int64_t expiry)> expired_fn);
+	int64_t NextExpiry();
+	size_t Size() { return count; };
+	const wheel_stats_t& GetStats() { return stats; };
+};
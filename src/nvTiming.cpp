@@ -0,0 +1,121 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+
+#include <algorithm>
+#include <fstream>
+
+#include "nvBrightness.h"
+#include "nvTiming.hpp"
+
+const char* nvTiming::phase_name[tpMax] = { "read", "compute", "write", "verify" };
+
+uint32_t nvTiming::Total(const switch_timing_t& t)
+{
+	uint32_t total = 0;
+	for (auto us : t.us)
+		total += us;
+	return total;
+}
+
+// Nearest-rank percentile. Sorts the values.
+uint32_t nvTiming::Percentile(vector<uint32_t>& values, uint32_t p)
+{
+	if (values.empty())
+		return 0;
+	sort(values.begin(), values.end());
+	size_t rank = (p * values.size() + 99) / 100;
+	return values[(rank == 0) ? 0 : rank - 1];
+}
+
+void nvTiming::Record(const string& model, const switch_timing_t& t)
+{
+	lock_guard<mutex> lock(timing_mutex);
+
+	auto& v = samples[model];
+	if (v.size() >= TIMING_MAX_SAMPLES)
+		v.erase(v.begin());
+	v.push_back(t);
+}
+
+// Log a p50/p90/p99/max table (in ms) of each phase, for each model
+void nvTiming::LogReport()
+{
+	lock_guard<mutex> lock(timing_mutex);
+	vector<uint32_t> values;
+
+	for (auto& [model, v] : samples) {
+		uint32_t failed = 0;
+		for (auto& t : v)
+			failed += (t.result == 0) ? 1 : 0;
+		logger("Input switch timings for %s (%zu attempts, %u failed):\n", model.c_str(), v.size(), failed);
+		logger("  %-8s %9s %9s %9s %9s\n", "phase", "p50", "p90", "p99", "max");
+		for (int phase = 0; phase <= tpMax; phase++) {
+			values.clear();
+			for (auto& t : v)
+				values.push_back((phase == tpMax) ? Total(t) : t.us[phase]);
+			logger("  %-8s %9.1f %9.1f %9.1f %9.1f\n", (phase == tpMax) ? "total" : phase_name[phase],
+				Percentile(values, 50) / 1000.0f, Percentile(values, 90) / 1000.0f,
+				Percentile(values, 99) / 1000.0f, values.back() / 1000.0f);
+		}
+	}
+}
+
+// Dump all the samples as JSON, with durations in µs
+bool nvTiming::Dump(const filesystem::path& path)
+{
+	lock_guard<mutex> lock(timing_mutex);
+
+	if (samples.empty())
+		return true;
+
+	ofstream file(path, ios::trunc);
+	if (!file)
+		return false;
+	file << "{\n  \"input_switch\": {";
+	const char* separator = "\n";
+	for (auto& [model, v] : samples) {
+		file << separator << "    \"";
+		// Model names come from the monitor, so escape anything that isn't safe in a JSON string.
+		// They aren't necessarily valid UTF-8, so bytes above 0x7f are escaped as Latin-1.
+		for (auto c : model) {
+			if (c == '"' || c == '\\') {
+				file << '\\' << c;
+			} else if ((unsigned char)c < 0x20 || (unsigned char)c >= 0x80) {
+				char escaped[8];
+				snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char)c);
+				file << escaped;
+			} else {
+				file << c;
+			}
+		}
+		file << "\": [";
+		for (size_t i = 0; i < v.size(); i++) {
+			file << ((i == 0) ? "\n" : ",\n") << "      { \"requested\": " << (int)v[i].requested
+				<< ", \"result\": " << (int)v[i].result;
+			for (int phase = 0; phase < tpMax; phase++)
+				file << ", \"" << phase_name[phase] << "\": " << v[i].us[phase];
+			file << " }";
+		}
+		file << "\n    ]";
+		separator = ",\n";
+	}
+	file << "\n  }\n}\n";
+	return !file.fail();
+}
@@ -0,0 +1,64 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Maximum number of samples we keep per monitor model (older ones get dropped)
+#define TIMING_MAX_SAMPLES          256
+
+using namespace std;
+
+// The phases of an input switch
+enum {
+	tpRead = 0,         // Read the current input
+	tpCompute,          // Work out the input to switch to
+	tpWrite,            // Write the new input
+	tpVerify,           // Read back the input to confirm the switch
+	tpMax
+};
+
+typedef struct {
+	uint32_t us[tpMax];	// Duration of each phase, in µs
+	uint8_t requested;
+	uint8_t result;
+} switch_timing_t;
+
+// Collects the timings of every input switch attempt, per monitor model, so that we can
+// report which displays are slow to switch and where the time goes.
+class nvTiming {
+private:
+	mutex timing_mutex;
+	map<string, vector<switch_timing_t>> samples;
+	static uint32_t Total(const switch_timing_t& t);
+public:
+	static uint32_t Percentile(vector<uint32_t>& values, uint32_t p);
+	static const char* phase_name[tpMax];
+	void Record(const string& model, const switch_timing_t& t);
+	void LogReport();
+	bool Dump(const filesystem::path& path);
+};
+
+extern nvTiming switch_timing;
@@ -0,0 +1,76 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "nvBrightness.h"
+#include "nvVcpCache.hpp"
+
+using namespace std::chrono;
+
+// The VCP codes we prefetch, and for how long (in ms) we trust a value we read from the
+// monitor. The input and power mode can be changed from the monitor's OSD, so we don't
+// want to trust those for too long. Values for any other VCP code are never cached.
+static const struct {
+	uint8_t code;
+	uint32_t freshness;
+} vcp_freshness[] = {
+	{ VCP_INPUT_SOURCE, 5000 },
+	{ VCP_LUMINANCE, 30000 },
+	{ VCP_CONTRAST, 30000 },
+	{ VCP_POWER_MODE, 5000 },
+};
+
+uint32_t nvVcpCache::GetFreshness(uint8_t code)
+{
+	for (auto& f : vcp_freshness)
+		if (f.code == code)
+			return f.freshness;
+	return 0;
+}
+
+vector<uint8_t> nvVcpCache::GetPrefetchCodes()
+{
+	vector<uint8_t> codes;
+	for (auto& f : vcp_freshness)
+		codes.push_back(f.code);
+	return codes;
+}
+
+// Returns true if we read the value recently enough to trust it
+bool nvVcpCache::Lookup(uint8_t code, steady_clock::time_point now, uint16_t* current, uint16_t* max)
+{
+	auto& entry = entries[code];
+	if (!entry.valid || duration_cast<milliseconds>(now - entry.timestamp).count() >= GetFreshness(code))
+		return false;
+	hits++;
+	if (current != NULL)
+		*current = entry.current;
+	if (max != NULL)
+		*max = entry.max;
+	return true;
+}
+
+void nvVcpCache::Update(uint8_t code, uint16_t current, uint16_t max, steady_clock::time_point now)
+{
+	entries[code] = { true, current, max, now };
+}
+
+void nvVcpCache::InvalidateAll()
+{
+	for (auto& entry : entries)
+		entry.valid = false;
+}
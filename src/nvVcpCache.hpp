@@ -0,0 +1,47 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include <chrono>
+#include <vector>
+
+using namespace std;
+
+// Cached VCP values of a monitor, each of which we trust for a time that depends on its VCP
+// code (see vcp_freshness[]). Not thread safe: the monitor serializes access to its cache.
+class nvVcpCache {
+private:
+	struct {
+		bool valid;
+		uint16_t current;
+		uint16_t max;
+		chrono::steady_clock::time_point timestamp;
+	} entries[256] = {};
+	uint32_t hits = 0;
+public:
+	static uint32_t GetFreshness(uint8_t code);
+	static vector<uint8_t> GetPrefetchCodes();
+	bool Lookup(uint8_t code, chrono::steady_clock::time_point now, uint16_t* current, uint16_t* max);
+	void Update(uint8_t code, uint16_t current, uint16_t max, chrono::steady_clock::time_point now);
+	void Invalidate(uint8_t code) { entries[code].valid = false; };
+	void InvalidateAll();
+	uint32_t GetHits() { return hits; };
+};
@@ -0,0 +1,167 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+
+#include "nvWorker.hpp"
+
+using namespace chrono;
+
+void nvWorker::Start(function<void(worker_command_t&)> run_fn, function<void()> notify_fn, bool run_synchronously)
+{
+	Stop();
+	run = move(run_fn);
+	notify = move(notify_fn);
+	synchronous = run_synchronously;
+	if (!synchronous)
+		thread = jthread([this](stop_token st) { Worker(st); });
+}
+
+// Run the commands that are still queued, then stop the thread. Completions that haven't been
+// picked up are discarded, and the notify function is no longer called.
+void nvWorker::Stop()
+{
+	if (thread.joinable()) {
+		thread.request_stop();
+		thread.join();
+	}
+	lock_guard<mutex> lock(worker_mutex);
+	completed.clear();
+	notify = nullptr;
+}
+
+// A brightness change can be folded into one for the same display that hasn't started yet,
+// a new level replaces the one that is queued, and the commands that apply to every display
+// get folded into an identical one. The queued command counts the posts it absorbed, for
+// callers that keep track of how many completions they expect. Must be called with the
+// mutex held.
+bool nvWorker::Merge(const worker_command_t& cmd)
+{
+	for (auto& queued : queue) {
+		if (queued.command != cmd.command || queued.display != cmd.display)
+			continue;
+		switch (cmd.command) {
+		case wcChangeBrightness:
+			queued.delta += cmd.delta;
+			break;
+		case wcSetLevel:
+			queued.level = cmd.level;
+			break;
+		case wcUpdateBacklight:
+		case wcFlushSettings:
+		case wcRestoreGamma:
+		case wcRestoreInput:
+		case wcUpdateDisplays:
+		case wcRestoreBacklight:
+			break;
+		default:
+			continue;
+		}
+		queued.merged++;
+		return true;
+	}
+	return false;
+}
+
+// Must be called with the mutex held, which gets released while the command runs
+void nvWorker::Run(worker_command_t& cmd, unique_lock<mutex>& lock)
+{
+	auto start = steady_clock::now();
+
+	lock.unlock();
+	{
+		// Only needed when running synchronously, where commands may come from several threads
+		lock_guard<mutex> run_lock(run_mutex);
+		run(cmd);
+	}
+	lock.lock();
+
+	auto end = steady_clock::now();
+	cmd.wait_us = (uint32_t)duration_cast<microseconds>(start - cmd.posted).count();
+	cmd.run_us = (uint32_t)duration_cast<microseconds>(end - start).count();
+	stats.completed++;
+	stats.max_wait_us = max(stats.max_wait_us, cmd.wait_us);
+	if (cmd.run_us > stats.max_run_us) {
+		stats.max_run_us = cmd.run_us;
+		stats.max_run_command = cmd.command;
+	}
+	if (!notify)
+		return;
+	completed.push_back(cmd);
+	// One notification is enough for the UI thread to pick up everything that has completed
+	if (!notified) {
+		notified = true;
+		lock.unlock();
+		notify();
+		lock.lock();
+	}
+}
+
+void nvWorker::Worker(stop_token st)
+{
+	unique_lock<mutex> lock(worker_mutex);
+
+	while (true) {
+		// Whatever is queued when we are asked to stop still gets run
+		work_cv.wait(lock, st, [this] { return !queue.empty(); });
+		if (queue.empty())
+			break;
+		worker_command_t cmd = queue.front();
+		queue.pop_front();
+		Run(cmd, lock);
+	}
+}
+
+void nvWorker::Post(worker_command_t cmd)
+{
+	unique_lock<mutex> lock(worker_mutex);
+
+	cmd.posted = steady_clock::now();
+	cmd.merged = 0;
+	stats.posted++;
+	if (synchronous) {
+		Run(cmd, lock);
+		return;
+	}
+	if (Merge(cmd)) {
+		stats.merged++;
+		return;
+	}
+	queue.push_back(cmd);
+	stats.max_queued = max(stats.max_queued, (uint32_t)queue.size());
+	work_cv.notify_one();
+}
+
+bool nvWorker::GetCompleted(worker_command_t* cmd)
+{
+	lock_guard<mutex> lock(worker_mutex);
+
+	if (completed.empty()) {
+		notified = false;
+		return false;
+	}
+	*cmd = completed.front();
+	completed.pop_front();
+	return true;
+}
+
+worker_stats_t nvWorker::GetStats()
+{
+	lock_guard<mutex> lock(worker_mutex);
+	return stats;
+}
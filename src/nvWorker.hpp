@@ -0,0 +1,105 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+
+using namespace std;
+
+class nvDisplay;
+
+// Hardware worker commands
+enum {
+	wcChangeBrightness = 0,     // Apply a brightness delta to a display and submit its gamma ramp
+	wcUpdateBacklight,          // Write the pending hybrid backlight changes
+	wcFlushSettings,            // Write the color settings that changed
+	wcRestoreGamma,             // Re-apply the gamma ramps, after a display change
+	wcSetInput,                 // Switch the input of a display
+	wcRestoreInput,             // Switch every display back to its home input, and verify it
+	wcUpdateDisplays,           // Re-enumerate the displays
+	wcIpcRequests,              // Handle a set of IPC requests, all at once
+	wcSetLevel,                 // Set the brightness level of a display, or of every display
+	wcRestoreBacklight,         // Give the displays in hybrid mode their original backlight back
+	wcMax
+};
+
+typedef struct {
+	uint32_t command;
+	nvDisplay* display;         // nullptr for commands that apply to every display
+	float delta;
+	uint8_t input;
+	bool verify;
+	void* context;              // Command specific
+	float level;                // Target for wcSetLevel, set by the worker for wcChangeBrightness
+	// Set by the worker
+	uint32_t result;            // Command specific
+	uint32_t merged;            // Number of later posts that were folded into this command
+	chrono::steady_clock::time_point posted;
+	uint32_t wait_us;
+	uint32_t run_us;
+} worker_command_t;
+
+typedef struct {
+	uint64_t posted;
+	uint64_t merged;            // Commands that were folded into one that was already queued
+	uint64_t completed;
+	uint32_t max_queued;
+	uint32_t max_wait_us;
+	uint32_t max_run_us;
+	uint32_t max_run_command;
+} worker_stats_t;
+
+// Single thread that performs all the slow hardware accesses (DDC/CI, NvAPI, display
+// enumeration), one command at a time, so that the UI thread never has to wait on them.
+// Since displays are never freed, commands can reference them directly. Once a command has
+// completed, it gets queued back, and the notify function is called, for the UI thread to
+// pick up the result with GetCompleted(). With 'synchronous' set, commands are run directly
+// from Post(), which is how things were done before and is useful for comparison.
+class nvWorker {
+private:
+	mutex worker_mutex;
+	mutex run_mutex;
+	condition_variable_any work_cv;
+	deque<worker_command_t> queue;
+	deque<worker_command_t> completed;
+	jthread thread;
+	function<void(worker_command_t&)> run;
+	function<void()> notify;
+	bool synchronous = false;
+	bool notified = false;
+	worker_stats_t stats = { 0 };
+	bool Merge(const worker_command_t& cmd);
+	void Run(worker_command_t& cmd, unique_lock<mutex>& lock);
+	void Worker(stop_token st);
+public:
+	~nvWorker() { Stop(); };
+	void Start(function<void(worker_command_t&)> run_fn, function<void()> notify_fn, bool run_synchronously = false);
+	void Stop();
+	void Post(worker_command_t cmd);
+	bool GetCompleted(worker_command_t* cmd);
+	worker_stats_t GetStats();
+};
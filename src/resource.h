@@ -3,33 +3,12 @@
 // Used by nvBrightness.rc
 //
 #define IDI_ICON                        1
-#define IDI_ICON_00                     100
-#define IDI_ICON_05                     101
-#define IDI_ICON_10                     102
-#define IDI_ICON_15                     103
-#define IDI_ICON_20                     104
-#define IDI_ICON_25                     105
-#define IDI_ICON_30                     106
-#define IDI_ICON_35                     107
-#define IDI_ICON_40                     108
-#define IDI_ICON_45                     109
-#define IDI_ICON_50                     110
-#define IDI_ICON_55                     111
-#define IDI_ICON_60                     112
-#define IDI_ICON_65                     113
-#define IDI_ICON_70                     114
-#define IDI_ICON_75                     115
-#define IDI_ICON_80                     116
-#define IDI_ICON_85                     117
-#define IDI_ICON_90                     118
-#define IDI_ICON_95                     119
-#define IDI_ICON_100                    120
 
 // Next default values for new objects
 //
 #ifdef APSTUDIO_INVOKED
 #ifndef APSTUDIO_READONLY_SYMBOLS
-#define _APS_NEXT_RESOURCE_VALUE        121
+#define _APS_NEXT_RESOURCE_VALUE        100
 #define _APS_NEXT_COMMAND_VALUE         40001
 #define _APS_NEXT_CONTROL_VALUE         1000
 #define _APS_NEXT_SYMED_VALUE           101
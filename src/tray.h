@@ -25,12 +25,20 @@
 
 #pragma once
 
+#if defined(_WIN32)
 #include <windows.h>
 #include <dwmapi.h>
 #include <shellapi.h>
 #include <dbt.h>
 
 #pragma comment(lib, "dwmapi.lib")
+#else
+// Elsewhere, only the menu definitions are available, so that the menu model can be tested
+#include <stdbool.h>
+#include <wchar.h>
+typedef void* HICON;
+typedef unsigned int UINT;
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -60,8 +68,12 @@ struct tray_menu {
 	void* context;
 
 	struct tray_menu* submenu;
+
+	// Set by tray_update(), for tray_update_item()
+	UINT id;
 };
 
+#if defined(_WIN32)
 typedef bool (*hotkey_cb)(WPARAM, LPARAM);
 
 static void tray_update(struct tray* tray);
@@ -171,6 +183,7 @@ static HMENU _tray_menu(struct tray_menu* m, UINT* id) {
 				item.fState |= MFS_CHECKED;
 			}
 			item.wID = *id;
+			m->id = *id;
 			item.dwTypeData = (LPWSTR)m->text;
 			item.dwItemData = (ULONG_PTR)m;
 
@@ -253,6 +266,13 @@ static void tray_simulate_hottkey(int id) {
 		SendMessage(hwnd, WM_HOTKEY, (WPARAM)id, NULL);
 }
 
+// Same as tray_simulate_hottkey(), but safe to call from any thread, since it doesn't wait
+// for the hotkey to be processed.
+static void tray_post_hotkey(int id) {
+	if (hwnd)
+		PostMessage(hwnd, WM_HOTKEY, (WPARAM)id, 0);
+}
+
 static int tray_loop(int blocking) {
 	MSG msg;
 	if (blocking) {
@@ -268,16 +288,34 @@ static int tray_loop(int blocking) {
 	return 0;
 }
 
+// Only update the icon, which is all that changes when the brightness does.
+// Icons belong to the caller, who is expected to keep them alive while in use.
+static void tray_update_icon(struct tray* tray) {
+	if (nid.hIcon == tray->icon)
+		return;
+	nid.hIcon = tray->icon;
+	Shell_NotifyIcon(NIM_MODIFY, &nid);
+}
+
+// Update the text and state of a single item in place, rather than recreating the whole menu.
+// The menu must have been created by tray_update() with the same structure.
+static bool tray_update_item(struct tray_menu* m) {
+	if (hmenu == NULL || m->id == 0)
+		return false;
+	MENUITEMINFO item = {
+		.cbSize = sizeof(MENUITEMINFO), .fMask = MIIM_STATE | MIIM_STRING,
+	};
+	item.fState = (m->disabled ? MFS_DISABLED : 0) | (m->checked ? MFS_CHECKED : 0);
+	item.dwTypeData = (LPWSTR)m->text;
+	return SetMenuItemInfo(hmenu, m->id, FALSE, &item);
+}
+
 static void tray_update(struct tray* tray) {
 	HMENU prevmenu = hmenu;
 	UINT id = ID_TRAY_FIRST;
 	hmenu = _tray_menu(tray->menu, &id);
 	SendMessage(hwnd, WM_INITMENUPOPUP, (WPARAM)hmenu, 0);
-	if (nid.hIcon) {
-		DestroyIcon(nid.hIcon);
-	}
-	nid.hIcon = tray->icon;
-	Shell_NotifyIcon(NIM_MODIFY, &nid);
+	tray_update_icon(tray);
 
 	if (prevmenu != NULL) {
 		DestroyMenu(prevmenu);
@@ -286,15 +324,14 @@ static void tray_update(struct tray* tray) {
 
 static void tray_exit() {
 	Shell_NotifyIcon(NIM_DELETE, &nid);
-	if (nid.hIcon != 0) {
-		DestroyIcon(nid.hIcon);
-	}
+	nid.hIcon = 0;
 	if (hmenu != 0) {
 		DestroyMenu(hmenu);
 	}
 	PostQuitMessage(0);
 	UnregisterClass(class_name, GetModuleHandle(NULL));
 }
+#endif /* _WIN32 */
 
 #ifdef __cplusplus
 }
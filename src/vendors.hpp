@@ -44,16 +44,26 @@
  * for the end-user, such "Applied Creative Technology", to only report their abbreviation.
  * Or, when the 3 letter code is well known (e.g. "American Megatrends" = "AMI") we just
  * kept the 3 letter code (or removed the entry altogether if the 3 letter code is the same).
+ *
+ * The vendor_table[] below is generated by tools/gen_vendors.py from the names we maintain
+ * in tools/vendors_overrides.txt, so edit these (and rerun the script) rather than this file.
  */
 
 #pragma once
 
-#include <map>
+#include <stdint.h>
+
 #include <string>
+#include <string_view>
 
 using namespace std;
 
-static const pair<const string, const string> values[] = {
+typedef struct {
+	char code[4];
+	string_view name;
+} vendor_t;
+
+static constexpr vendor_t vendor_table[] = {
 	{ "AAA", "Avolites" },
 	{ "AAE", "Anatek" },
 	{ "AAM", "Aava" },
@@ -69,7 +79,7 @@ static const pair<const string, const string> values[] = {
 	{ "ABV", "AdvResearch" },
 	{ "ACA", "Ariel" },
 	{ "ACB", "Aculab" },
-	{ "ACC", "Accton " },
+	{ "ACC", "Accton" },
 	{ "ACD", "Aweta" },
 	{ "ACE", "Actek" },
 	{ "ACG", "Cambridge" },
@@ -171,7 +181,6 @@ static const pair<const string, const string> values[] = {
 	{ "ANL", "Analogix" },
 	{ "ANO", "Anorad" },
 	{ "ANP", "AndrewNet" },
-	{ "ANR", "ANR" },
 	{ "ANS", "Ansel" },
 	{ "ANT", "Ace" },
 	{ "ANV", "ANTVR" },
@@ -315,7 +324,6 @@ static const pair<const string, const string> values[] = {
 	{ "BNO", "Bang&Olufsen" },
 	{ "BNS", "Boulder" },
 	{ "BOB", "RainyOrchard" },
-	{ "BOE", "BOE" },
 	{ "BOI", "NingboBoigle" },
 	{ "BPD", "MicroSolutions" },
 	{ "BPS", "Barco" },
@@ -774,7 +782,7 @@ static const pair<const string, const string> values[] = {
 	{ "FIS", "FlyIt" },
 	{ "FIT", "Feature" },
 	{ "FJC", "Fujitsu" },
-	{ "FJS", "Fujitsu " },
+	{ "FJS", "Fujitsu" },
 	{ "FJT", "FJTieman" },
 	{ "FLE", "ADTI" },
 	{ "FLI", "Faroudja" },
@@ -1037,7 +1045,6 @@ static const pair<const string, const string> values[] = {
 	{ "ION", "InsideOut" },
 	{ "IOS", "IODS" },
 	{ "IOT", "IOTech" },
-	{ "IPC", "IPC" },
 	{ "IPI", "IPMI" },
 	{ "IPN", "Performance" },
 	{ "IPP", "IPPower" },
@@ -1463,7 +1470,6 @@ static const pair<const string, const string> values[] = {
 	{ "NMP", "Nokia" },
 	{ "NMV", "NEC" },
 	{ "NMX", "Neomagic" },
-	{ "NNC", "NNC" },
 	{ "NOD", "3NOD" },
 	{ "NOE", "NordicEye" },
 	{ "NOI", "NorthInvent" },
@@ -2027,7 +2033,6 @@ static const pair<const string, const string> values[] = {
 	{ "TDM", "Tandem" },
 	{ "TDP", "3DPerception" },
 	{ "TDS", "TriData" },
-	{ "TDT", "TDT" },
 	{ "TDV", "TDVision" },
 	{ "TDY", "Tandy" },
 	{ "TEA", "Teac" },
@@ -2311,7 +2316,6 @@ static const pair<const string, const string> values[] = {
 	{ "XMI", "Xiaomi" },
 	{ "XMM", "C3PO" },
 	{ "XNT", "XNTech" },
-	{ "XOC", "XOC" },
 	{ "XQU", "SVA-DAV" },
 	{ "XRC", "Xircom" },
 	{ "XRO", "Xoro" },
@@ -2346,7 +2350,6 @@ static const pair<const string, const string> values[] = {
 	{ "ZRN", "Zoran" },
 	{ "ZSE", "ZDS" },
 	{ "ZTC", "ZyDAS" },
-	{ "ZTE", "ZTE" },
 	{ "ZTI", "Zoom" },
 	{ "ZTM", "ZT" },
 	{ "ZTT", "Z3" },
@@ -2358,17 +2361,52 @@ static const pair<const string, const string> values[] = {
 	{ "ZZZ", "Boca" },
 };
 
-static map vendors(begin(values), end(values));
+// PNP IDs are 3 letters, packed as 5-bit values ('A' = 1) into 15 bits, big endian
+static constexpr uint16_t PackVendorCode(const char* code)
+{
+	return (uint16_t)(((code[0] - 'A' + 1) & 0x1f) << 10 | ((code[1] - 'A' + 1) & 0x1f) << 5 | ((code[2] - 'A' + 1) & 0x1f));
+}
+
+static constexpr size_t VendorPoolSize()
+{
+	size_t size = 1;
+	for (auto& v : vendor_table)
+		size += v.name.size() + 1;
+	return size;
+}
+
+// All the vendor names, NUL terminated, in a single string pool, along with a table indexed
+// by the packed PNP ID that gives the offset of the name in the pool (0 being the empty
+// string at the start of the pool, for unknown IDs). This is all built at compile time.
+typedef struct {
+	uint16_t offset[1 << 15];
+	char pool[VendorPoolSize()];
+} vendor_index_t;
+
+static_assert(VendorPoolSize() <= UINT16_MAX, "Vendor string pool is too large for 16-bit offsets");
+
+inline constexpr vendor_index_t vendor_index = [] {
+	vendor_index_t index = {};
+	size_t pos = 1;
+	for (auto& v : vendor_table) {
+		index.offset[PackVendorCode(v.code)] = (uint16_t)pos;
+		for (auto c : v.name)
+			index.pool[pos++] = c;
+		index.pool[pos++] = '\0';
+	}
+	return index;
+}();
 
 static inline const string GetVendorName(uint16_t vendor_id)
 {
+	vendor_id &= 0x7fff;
+	if (vendor_index.offset[vendor_id] != 0)
+		return string(&vendor_index.pool[vendor_index.offset[vendor_id]]);
+
 	char vendor_code[4];
 	vendor_code[0] = ((vendor_id >> 10) & 0x1F) + 'A' - 1;
 	vendor_code[1] = ((vendor_id >> 5) & 0x1F) + 'A' - 1;
 	vendor_code[2] = (vendor_id & 0x1F) + 'A' - 1;
 	vendor_code[3] = '\0';
-
-	if (vendors.find(vendor_code) != vendors.end())
-		return vendors[vendor_code];
 	return string(vendor_code);
 }
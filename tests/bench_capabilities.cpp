@@ -0,0 +1,41 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.hpp"
+#include "nvCapabilities.hpp"
+
+int main(int argc, char** argv)
+{
+	int iterations = BenchIterations(argc, argv, 20000);
+	auto corpus = ReadCorpus("capabilities");
+	nvCapabilities caps;
+	size_t bytes = 0, codes = 0;
+
+	auto start = chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++) {
+		for (auto& [name, input] : corpus) {
+			caps.Parse(input);
+			codes += caps.GetNumberOfVcpCodes();
+			bytes += input.size();
+		}
+	}
+	double us = ElapsedUs(start);
+	printf("%zu string(s) x %d: %.3f us per string, %.1f MB/s (%zu VCP codes)\n", corpus.size(), iterations,
+		us / ((double)iterations * corpus.size()), bytes / us, codes);
+	return 0;
+}
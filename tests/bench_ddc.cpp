@@ -0,0 +1,84 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+// Round trips and (virtual) time per DDC/CI operation against the simulated monitor, with the
+// delays from the specs, and the lowest delays that still work for a monitor that replies
+// after a given time, which is what we'd want to learn per model.
+#include "test.hpp"
+#include "nvDdc.hpp"
+
+static void Report(const char* name, nvDdcSimulator& sim, nvDdcEngine& ddc, int operations, uint64_t start)
+{
+	auto& stats = ddc.GetStats();
+	printf("  %-14s %5.2f round trip(s), %7.1f ms per operation (%u null, %u retries)\n", name,
+		(double)stats.writes / operations, (double)(sim.Now() - start) / operations, stats.null_replies, stats.retries);
+}
+
+static void Run(const char* title, const ddc_timing_t& timing, uint32_t monitor_delay, int iterations)
+{
+	string caps;
+	for (auto& [name, input] : ReadCorpus("capabilities"))
+		if (name == "dell_u2720q.txt")
+			caps = input;
+	nvDdcSimulator sim(caps, monitor_delay);
+	nvDdcEngine ddc(&sim, timing);
+	uint16_t current;
+	uint64_t start;
+
+	printf("%s (reply %u ms, set %u ms, caps %u ms, inter command %u ms):\n", title, timing.vcp_reply_delay,
+		timing.vcp_set_delay, timing.caps_reply_delay, timing.inter_command_delay);
+	sim.SetVcp(0x10, 50, 100);
+	start = sim.Now();
+	ddc.ResetStats();
+	for (int i = 0; i < iterations; i++)
+		ddc.GetVcpFeature(0x10, &current, NULL);
+	Report("Get VCP", sim, ddc, iterations, start);
+	start = sim.Now();
+	ddc.ResetStats();
+	for (int i = 0; i < iterations; i++)
+		ddc.SetVcpFeature(0x10, (uint16_t)(i % 100));
+	Report("Set VCP", sim, ddc, iterations, start);
+	start = sim.Now();
+	ddc.ResetStats();
+	for (int i = 0; i < iterations; i++)
+		ddc.GetCapabilities(caps);
+	Report("Capabilities", sim, ddc, iterations, start);
+}
+
+int main(int argc, char** argv)
+{
+	int iterations = BenchIterations(argc, argv, 100);
+	const uint32_t monitor_delay = 20;
+
+	Run("Specs", nvDdcEngine::default_timing, monitor_delay, iterations);
+
+	// Find the lowest reply delay that doesn't get null messages from this monitor
+	nvDdcSimulator sim("", monitor_delay);
+	nvDdcEngine ddc(&sim);
+	uint32_t reply_delay;
+	uint16_t current;
+	sim.SetVcp(0x10, 50, 100);
+	for (reply_delay = 0; reply_delay < ddc.default_timing.vcp_reply_delay; reply_delay++) {
+		ddc.SetTiming({ reply_delay, 0, reply_delay, 0 });
+		ddc.ResetStats();
+		if (ddc.GetVcpFeature(0x10, &current, NULL) && ddc.GetStats().null_replies == 0)
+			break;
+	}
+	Run("Learned", { reply_delay, reply_delay, reply_delay, 0 }, monitor_delay, iterations);
+	return 0;
+}
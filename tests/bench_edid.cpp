@@ -0,0 +1,41 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.hpp"
+#include "nvEdid.hpp"
+
+int main(int argc, char** argv)
+{
+	int iterations = BenchIterations(argc, argv, 100000);
+	auto corpus = ReadCorpus("edid");
+	nvEdid edid;
+	size_t blocks = 0, ouis = 0;
+
+	auto start = chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++) {
+		for (auto& [name, data] : corpus) {
+			edid.Parse(span<const uint8_t>((const uint8_t*)data.data(), data.size()));
+			blocks += edid.GetNumberOfBlocks();
+			ouis += edid.GetVsdbOuis().size();
+		}
+	}
+	double us = ElapsedUs(start);
+	printf("%zu EDID(s) x %d: %.3f us per EDID, %.1f ns per block (%zu OUIs)\n", corpus.size(), iterations,
+		us / ((double)iterations * corpus.size()), us * 1000.0 / blocks, ouis);
+	return 0;
+}
@@ -0,0 +1,105 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdarg.h>
+#include <time.h>
+
+#include <mutex>
+#include <thread>
+
+#include "test.hpp"
+#include "nvLogger.hpp"
+
+// Caller side latency of the asynchronous logger, against what logger() used to do: format,
+// timestamp, write and flush, all under a lock. Both write to /dev/null, so that we measure
+// our own overhead rather than the disk's.
+static nvLogger async_logger;
+static mutex sync_mutex;
+static FILE* sync_file;
+
+static void AsyncLog(const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	async_logger.Log(format, args);
+	va_end(args);
+}
+
+static void SyncLog(const char* format, ...)
+{
+	lock_guard<mutex> lock(sync_mutex);
+	char msg[LOGGER_MAX_MESSAGE], timestamp[64];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(msg, sizeof(msg), format, args);
+	va_end(args);
+	time_t t = time(NULL);
+	strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %X", localtime(&t));
+	fprintf(sync_file, "%s: %s", timestamp, msg);
+	fflush(sync_file);
+}
+
+template <typename F> static void Measure(const char* name, int num_threads, int iterations, F log)
+{
+	vector<vector<double>> latencies(num_threads);
+	vector<thread> threads;
+
+	for (int t = 0; t < num_threads; t++)
+		threads.emplace_back([&, t] {
+			for (int i = 0; i < iterations; i++) {
+				auto start = chrono::steady_clock::now();
+				log("Thread %d message %d: Display %s switched to input %s\n", t, i, "\\\\.\\DISPLAY1", "HDMI 1");
+				latencies[t].push_back(ElapsedUs(start) * 1000.0);
+				// Leave the logger thread a chance to keep up, as real callers do
+				if (i % 64 == 0)
+					this_thread::sleep_for(chrono::microseconds(50));
+			}
+		});
+	for (auto& t : threads)
+		t.join();
+	vector<double> all;
+	for (auto& l : latencies)
+		all.insert(all.end(), l.begin(), l.end());
+	sort(all.begin(), all.end());
+	printf("%s: p50 %.0f ns, p99 %.0f ns, max %.0f ns\n", name, all[all.size() / 2], all[all.size() * 99 / 100], all.back());
+}
+
+int main(int argc, char** argv)
+{
+	int iterations = BenchIterations(argc, argv, 20000);
+	const int num_threads = 4;
+	FILE* async_file = fopen("/dev/null", "w");
+	sync_file = fopen("/dev/null", "w");
+	if (async_file == NULL || sync_file == NULL)
+		return 1;
+
+	async_logger.Start([async_file](chrono::system_clock::time_point, const char* msg, size_t size, bool line_start) {
+		if (line_start)
+			fputs("TS: ", async_file);
+		fwrite(msg, 1, size, async_file);
+	}, [async_file] { fflush(async_file); });
+	Measure("mutex + flush", num_threads, iterations, SyncLog);
+	Measure("async", num_threads, iterations, AsyncLog);
+	async_logger.Stop();
+	auto stats = async_logger.GetStats();
+	printf("logged %llu, dropped %llu, %llu batches (max %u)\n", (unsigned long long)stats.logged,
+		(unsigned long long)stats.dropped, (unsigned long long)stats.batches, stats.max_batch);
+	fclose(async_file);
+	fclose(sync_file);
+	return 0;
+}
@@ -0,0 +1,102 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.hpp"
+#include "tray.h"
+#include "nvMenu.hpp"
+
+static void Select(struct tray_menu*) {}
+static void Switch(struct tray_menu*) {}
+
+// Fake backend, where a rebuild inserts every item, as _tray_menu() does, and a patch updates one
+static struct tray_menu top[] = { { L"Brightness +", false, false, Switch }, { L"-" }, { L"Input controls" },
+	{ L"Resume to Home", true }, { L"Pause", false, false, Switch }, { NULL } };
+static uint64_t inserted = 0, patched = 0;
+static volatile size_t sink;
+
+static void Insert(struct tray_menu* m, UINT* id)
+{
+	for (; m != NULL && m->text != NULL; m++) {
+		sink = wcslen(m->text);
+		m->id = (*id)++;
+		inserted++;
+		Insert(m->submenu, id);
+	}
+}
+
+static void Rebuild()
+{
+	UINT id = 1000;
+	Insert(top, &id);
+}
+
+static bool Patch(struct tray_menu* m)
+{
+	if (m->id == 0)
+		return false;
+	sink = wcslen(m->text);
+	patched++;
+	return true;
+}
+
+static vector<menu_item_t> Inputs(int displays, int active, int input)
+{
+	vector<menu_item_t> content = { { L"Active display:", true } };
+	for (int i = 0; i < displays; i++)
+		content.push_back({ L"Display " + to_wstring(i), false, i == active, Select, (void*)(intptr_t)i });
+	content.push_back({ L"-" });
+	content.push_back({ L"Next input (DP" + to_wstring(input % 3) + L")", false, false, Switch });
+	content.push_back({ L"Prev input (DP" + to_wstring((input + 2) % 3) + L")", false, false, Switch });
+	return content;
+}
+
+// Refresh the menu as we do on monitor switches, probe completions and input switches, by
+// either recreating it every time, or patching it
+int main(int argc, char** argv)
+{
+	int iterations = BenchIterations(argc, argv, 100000);
+
+	for (int displays : { 1, 4, 16 }) {
+		for (bool retained : { false, true }) {
+			vector<struct tray_menu> inputs = { { NULL } };
+			int active = 0, input = 0;
+			nvMenu menu;
+
+			inserted = patched = 0;
+			menu.SetBackend(Rebuild, Patch);
+			menu.SetSubmenu(&top[2], inputs, Inputs(displays, active, input));
+			menu.Commit();
+			auto start = chrono::steady_clock::now();
+			for (int i = 0; i < iterations; i++) {
+				if (i % 4 == 0)
+					active = (active + 1) % displays;
+				else if (i % 4 == 1)
+					input++;
+				menu.SetSubmenu(&top[2], inputs, Inputs(displays, active, input));
+				if (!retained)
+					menu.Invalidate();
+				menu.Commit();
+			}
+			double us = ElapsedUs(start);
+			printf("%2d display(s), %-8s: %.2f us and %.1f items inserted, %.2f patched per update\n",
+				displays, retained ? "patched" : "rebuilt", us / iterations,
+				(double)inserted / iterations, (double)patched / iterations);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,48 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <random>
+
+#include "test.hpp"
+#include "nvPixels.hpp"
+
+// Darken a 1080p surface of random premultiplied pixels, as the dark menus do
+int main(int argc, char** argv)
+{
+	int iterations = BenchIterations(argc, argv, 50);
+	vector<uint32_t> surface(1920 * 1080);
+	mt19937 rng(42);
+
+	for (auto& p : surface) {
+		uint32_t a = rng() & 0xff;
+		p = (a << 24) | ((rng() % (a + 1)) * 0x010101);
+	}
+	for (bool simd : { false, true }) {
+		auto start = chrono::steady_clock::now();
+		for (int i = 0; i < iterations; i++) {
+			if (simd)
+				nvPixels::AdjustBrightness(surface.data(), surface.size(), -0.78f);
+			else
+				nvPixels::AdjustBrightnessScalar(surface.data(), surface.size(), -0.78f);
+		}
+		double us = ElapsedUs(start) / iterations;
+		printf("%s: %.3f ms per 1080p surface, %.0f Mpixel/s\n", simd ? "SIMD  " : "scalar",
+			us / 1000.0, surface.size() / us);
+	}
+	return 0;
+}
@@ -0,0 +1,72 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.hpp"
+#include "nvStorage.hpp"
+
+// The values SaveColorSettings() writes for a monitor with 4 LUIDs, plus a few settings
+static void WriteSettings(nvStorage& s, int i)
+{
+	for (uint32_t luid = 0; luid < 4; luid++) {
+		wstring path = L"Software\\NVIDIA Corporation\\Global\\NVTweak\\Devices\\" + to_wstring(luid) + L"-0\\Color";
+		const storage_dword_t values[] = { { L"3538946", i }, { L"3538947", i + 1 }, { L"3538948", i + 2 } };
+		s.Write32Batch(path.c_str(), values);
+	}
+	s.Write32(L"Brightness", i);
+	s.WriteStr(L"ActiveDisplay", L"\\\\?\\DISPLAY#DEL4123#5&1a2b3c4d&0&UID4352");
+}
+
+int main(int argc, char** argv)
+{
+	int iterations = BenchIterations(argc, argv, 20000);
+	auto path = filesystem::temp_directory_path() /
+		("nv_bench_storage_" + to_string(chrono::steady_clock::now().time_since_epoch().count()) + ".bin");
+	int32_t sum = 0;
+
+	nvMemoryStorage memory;
+	auto start = chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++) {
+		WriteSettings(memory, i);
+		sum += memory.Read32(L"Brightness");
+	}
+	double memory_us = ElapsedUs(start);
+
+	// Flushing after every save is the worst case for the file storage
+	int flushes = max(iterations / 100, 1);
+	nvFileStorage file;
+	file.Open(path);
+	start = chrono::steady_clock::now();
+	for (int i = 0; i < flushes; i++) {
+		WriteSettings(file, i);
+		file.Flush();
+	}
+	double file_us = ElapsedUs(start);
+
+	start = chrono::steady_clock::now();
+	for (int i = 0; i < flushes; i++) {
+		nvFileStorage reopened;
+		reopened.Open(path);
+		sum += reopened.Read32(L"Brightness");
+	}
+	double open_us = ElapsedUs(start);
+
+	printf("memory: %.2f us per save (%d), file: %.1f us per save + flush, %.1f us per open (%d, %d)\n",
+		memory_us / iterations, iterations, file_us / flushes, open_us / flushes, flushes, (int)(sum & 0));
+	filesystem::remove(path);
+	return 0;
+}
@@ -0,0 +1,78 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <random>
+
+#include "test.hpp"
+#include "nvTimerWheel.hpp"
+
+// Schedule and expire timers with the wheel, against a multimap, which is what we'd use otherwise
+int main(int argc, char** argv)
+{
+	int iterations = BenchIterations(argc, argv, 10);
+	const int timers = 100000;
+
+	for (int i = 0; i < iterations; i++) {
+		mt19937_64 rng(i);
+		nvTimerWheel wheel;
+		multimap<int64_t, uint64_t> reference;
+		uint64_t wheel_count = 0, reference_count = 0;
+		vector<int64_t> expiries(timers);
+
+		for (auto& e : expiries)
+			e = 1 + (int64_t)(rng() % 86400);
+
+		auto start = chrono::steady_clock::now();
+		wheel.Reset(0);
+		for (int j = 0; j < timers; j++)
+			wheel.Add(j, expiries[j]);
+		for (int64_t now = 0; now <= 86400 * 2; now++) {
+			wheel.Advance(now, [&](uint64_t id, int64_t expiry) {
+				wheel_count++;
+				// Reschedule half of them, as daily rules do
+				if (id % 2 == 0 && expiry < 86400)
+					wheel.Add(id, expiry + 86400);
+			});
+		}
+		double wheel_us = ElapsedUs(start);
+
+		start = chrono::steady_clock::now();
+		for (int j = 0; j < timers; j++)
+			reference.insert({ expiries[j], j });
+		for (int64_t now = 0; now <= 86400 * 2; now++) {
+			while (!reference.empty() && reference.begin()->first <= now) {
+				auto [expiry, id] = *reference.begin();
+				reference.erase(reference.begin());
+				reference_count++;
+				if (id % 2 == 0 && expiry < 86400)
+					reference.insert({ expiry + 86400, id });
+			}
+		}
+		double reference_us = ElapsedUs(start);
+
+		if (wheel_count != reference_count) {
+			fprintf(stderr, "Mismatch: %llu != %llu\n", (unsigned long long)wheel_count,
+				(unsigned long long)reference_count);
+			return 1;
+		}
+		if (i == iterations - 1)
+			printf("%d timers over 2 days of seconds: wheel %.0f us, multimap %.0f us\n",
+				timers, wheel_us, reference_us);
+	}
+	return 0;
+}
@@ -0,0 +1,50 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.hpp"
+#include "vendors.hpp"
+
+// Compare the compile time table against the std::map lookup it replaced
+int main(int argc, char** argv)
+{
+	int iterations = BenchIterations(argc, argv, 100);
+	size_t chars = 0;
+
+	auto start = chrono::steady_clock::now();
+	map<string, string> vendors;
+	for (auto& v : vendor_table)
+		vendors.emplace(v.code, v.name);
+	double init_us = ElapsedUs(start);
+
+	start = chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++)
+		for (auto& v : vendor_table)
+			chars += vendors.find(string(v.code))->second.size();
+	double map_us = ElapsedUs(start);
+
+	start = chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++)
+		for (auto& v : vendor_table)
+			chars += GetVendorName(PackVendorCode(v.code)).size();
+	double table_us = ElapsedUs(start);
+
+	double lookups = (double)iterations * size(vendor_table);
+	printf("%zu vendors x %d: map %.1f ns per lookup (%.1f us to build), table %.1f ns per lookup (%zu)\n",
+		size(vendor_table), iterations, map_us * 1000.0 / lookups, init_us, table_us * 1000.0 / lookups, chars);
+	return 0;
+}
@@ -0,0 +1,43 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.hpp"
+#include "nvCapabilities.hpp"
+
+// Parse anything, then walk the whole model, so that bad views or indexes get noticed
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+	static nvCapabilities caps;
+	size_t sum = 0;
+
+	caps.Parse(string_view((const char*)data, size));
+	sum += caps.GetProtocol().size() + caps.GetType().size() + caps.GetModel().size() + caps.GetMccsVersion().size();
+	for (auto cmd : caps.GetCommands())
+		sum += cmd;
+	size_t num_vcp = 0;
+	for (int code = 0; code < 256; code++) {
+		if (!caps.SupportsVcp((uint8_t)code))
+			continue;
+		num_vcp++;
+		for (auto value : caps.GetVcpValues((uint8_t)code))
+			sum += value;
+	}
+	if (num_vcp != caps.GetNumberOfVcpCodes())
+		abort();
+	return (int)(sum & 0);
+}
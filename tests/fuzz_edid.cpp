@@ -0,0 +1,46 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.hpp"
+#include "nvEdid.hpp"
+
+// Parse anything, then walk everything we report, so that bad views or indexes get noticed
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+	static nvEdid edid;
+	size_t sum = 0;
+
+	if (!edid.Parse(span<const uint8_t>(data, size)))
+		return 0;
+	if (edid.GetNumberOfBlocks() == 0 || edid.GetNumberOfBlocks() > EDID_MAX_BLOCKS ||
+		edid.GetNumberOfBlocks() * EDID_BLOCK_SIZE > size)
+		abort();
+	for (auto c : edid.GetModel())
+		sum += c;
+	for (auto c : edid.GetSerialString())
+		sum += c;
+	for (auto oui : edid.GetVsdbOuis())
+		sum += oui;
+	for (auto tag : edid.GetDisplayIdBlocks())
+		sum += tag;
+	auto& hdr = edid.GetHdrMetadata();
+	if (hdr.max_luminance < 0.0f || hdr.min_luminance < 0.0f || hdr.min_luminance > hdr.max_luminance)
+		abort();
+	sum += edid.GetRangeLimits().max_vfreq + edid.GetColorimetry();
+	return (int)(sum & 0);
+}
@@ -0,0 +1,76 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+// Standalone driver for the libFuzzer style targets, for when we aren't building with
+// libFuzzer: replay every file of the corpus, then run a bounded number of deterministic
+// random mutations of them (bit flips, byte changes, truncation and splicing). Meant to be
+// run with NV_SANITIZE, which is what turns memory errors into failures.
+
+#include <random>
+
+#include "test.hpp"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+#define FUZZ_ITERATIONS             100000
+
+int main(int argc, char** argv)
+{
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <corpus directory> [iterations]\n", argv[0]);
+		return 2;
+	}
+	auto corpus = ReadCorpus(argv[1]);
+	int iterations = (argc > 2) ? atoi(argv[2]) : FUZZ_ITERATIONS;
+	mt19937 rng(0x6e76);
+
+	if (corpus.empty())
+		corpus.emplace_back("empty", "");
+	for (auto& [name, input] : corpus)
+		LLVMFuzzerTestOneInput((const uint8_t*)input.data(), input.size());
+	for (int i = 0; i < iterations; i++) {
+		string input = corpus[rng() % corpus.size()].second;
+		for (int n = 1 + rng() % 8; n > 0; n--) {
+			size_t pos = input.empty() ? 0 : rng() % input.size();
+			switch (rng() % 5) {
+			case 0:
+				if (!input.empty())
+					input[pos] ^= (char)(1 << (rng() % 8));
+				break;
+			case 1:
+				if (!input.empty())
+					input[pos] = (char)rng();
+				break;
+			case 2:
+				input.resize(pos);
+				break;
+			case 3:
+				input.insert(pos, 1, "()0123456789ABCDEF \xff"[rng() % 20]);
+				break;
+			default:
+				// Splice the tail of another input
+				auto& other = corpus[rng() % corpus.size()].second;
+				input = input.substr(0, pos) + other.substr(other.empty() ? 0 : rng() % other.size());
+				break;
+			}
+		}
+		LLVMFuzzerTestOneInput((const uint8_t*)input.data(), input.size());
+	}
+	printf("%zu corpus input(s), %d mutation(s): OK\n", corpus.size(), iterations);
+	return 0;
+}
@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+#
+# nvBrightness - nVidia Control Panel brightness at your fingertips
+#
+# Copyright © 2025 Pete Batard <pete@akeo.ie>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""Regenerate the EDID corpus of tests/data/edid.
+
+We don't ship EDIDs dumped from actual monitors, but these follow the layout
+of the ones such monitors report: a 4K office monitor with a CTA-861 block and
+HDR10, an OLED TV with HDMI Forum, Dolby Vision and BT.2020 support, a high
+refresh gaming monitor with both a CTA-861 and a DisplayID extension, a plain
+1080p monitor with no extension, as well as broken ones. test_edid.cpp checks
+the values defined here.
+
+Usage: gen_edid_corpus.py
+"""
+
+import os
+
+OUT_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'data', 'edid')
+
+
+def checksum(block):
+    """Set the last byte so that the block adds up to 0 (mod 256)."""
+    block[-1] = (-sum(block[:-1])) & 0xff
+    return block
+
+
+def pnp(vendor):
+    """Pack a 3 letter PNP ID, big endian."""
+    code = 0
+    for c in vendor:
+        code = (code << 5) | (ord(c) - ord('A') + 1)
+    return [code >> 8, code & 0xff]
+
+
+def descriptor(tag, payload):
+    d = [0, 0, 0, tag, 0] + list(payload)
+    return d + [0x20] * (18 - len(d))
+
+
+def text(tag, s):
+    s = s.encode('ascii')
+    if len(s) < 13:
+        s += b'\n'
+    return descriptor(tag, s)
+
+
+def range_limits(min_v, max_v, min_h, max_h, max_clock_mhz, flags=0):
+    """Display range limits. For EDID 1.4, the flags tell to add 255 to the rates."""
+    return [0, 0, 0, 0xfd, flags, min_v, max_v, min_h, max_h, max_clock_mhz // 10, 0x00, 0x0a] + [0x20] * 6
+
+
+def dtd(pixel_clock_10khz, h, v):
+    """A detailed timing descriptor, with just enough filled in to not be mistaken for a descriptor."""
+    return [pixel_clock_10khz & 0xff, pixel_clock_10khz >> 8, h & 0xff, 0x00, (h >> 8) << 4,
+            v & 0xff, 0x00, (v >> 8) << 4] + [0] * 10
+
+
+def base_block(vendor, product, serial, week, year, descriptors, extensions, revision=4):
+    b = [0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00]
+    b += pnp(vendor) + [product & 0xff, product >> 8]
+    b += list(serial.to_bytes(4, 'little')) + [week, year - 1990, 1, revision]
+    b += [0xb5, 0x3c, 0x22, 0x78, 0x3a] + [0] * 10        # Input, size, gamma, features, chromaticity
+    b += [0] * 3 + [0x01] * 16                               # Established and standard timings
+    for d in descriptors:
+        b += d
+    b += [extensions, 0]
+    assert len(b) == 128
+    return checksum(b)
+
+
+def cta_block(data_blocks, flags=0xf0):
+    payload = []
+    for tag, data in data_blocks:
+        payload += [(tag << 5) | len(data)] + list(data)
+    b = [0x02, 0x03, 4 + len(payload), flags] + payload
+    b += [0] * (128 - len(b))
+    return checksum(b)
+
+
+def displayid_block(data_blocks, version=0x13):
+    payload = []
+    for tag, data in data_blocks:
+        payload += [tag, 0, len(data)] + list(data)
+    section = [version, len(payload), 0x03, 0] + payload
+    section.append((-sum(section)) & 0xff)
+    b = [0x70] + section
+    b += [0] * (128 - len(b))
+    return checksum(b)
+
+
+def vsdb(oui, data):
+    return (3, [oui & 0xff, (oui >> 8) & 0xff, oui >> 16] + list(data))
+
+
+def extended(tag, data):
+    return (7, [tag] + list(data))
+
+
+def hdr_static(eotf, max_cv, avg_cv, min_cv):
+    return extended(0x06, [eotf, 0x01, max_cv, avg_cv, min_cv])
+
+
+CORPUS = {
+    # 3840x2160 @ 60 Hz office monitor
+    'dell_u2720q.bin': base_block('DEL', 0xa0f3, 0x4c413331, 12, 2021, [
+        dtd(53307, 3840, 2160),
+        text(0xff, 'F8KXR83'),
+        text(0xfc, 'DELL U2720Q'),
+        range_limits(24, 76, 30, 135, 600),
+    ], 1) + cta_block([
+        vsdb(0x000c03, [0x10, 0x00, 0x38, 0x78]),
+        extended(0x05, [0xc1, 0x00]),
+        hdr_static(0x05, 0, 0, 0),
+    ]),
+    # OLED TV
+    'lg_oled.bin': base_block('GSM', 0xc0a2, 0x01010101, 1, 2022, [
+        dtd(59400, 3840, 2160),
+        range_limits(24, 120, 30, 255, 1200),
+        text(0xfc, 'LG TV SSCR2'),
+        descriptor(0x10, []),
+    ], 1) + cta_block([
+        vsdb(0x000c03, [0x10, 0x00, 0xb8, 0x3c, 0x2f, 0xc0, 0x80]),
+        vsdb(0xc45dd8, [0x01, 0x78, 0x8a, 0x03]),
+        extended(0x01, [0x46, 0xd0, 0x00, 0x49, 0x02, 0x45, 0xa8, 0x41, 0x5a, 0xa6]),
+        extended(0x05, [0xc3, 0x80]),
+        hdr_static(0x07, 0x60, 0x51, 0x00),
+    ]),
+    # 1440p @ 360 Hz, which needs the EDID 1.4 range offsets, with a DisplayID section
+    'gaming_360hz.bin': base_block('AUS', 0x27c2, 0, 40, 2023, [
+        dtd(64225, 2560, 1440),
+        range_limits(48, 105, 30, 255, 1300, flags=0x0a),
+        text(0xfc, 'PG27AQN'),
+        text(0xff, 'N9LMQS012345'),
+    ], 2) + cta_block([
+        vsdb(0x000c03, [0x10, 0x00, 0x38, 0x78]),
+        hdr_static(0x05, 0x5a, 0x4a, 0x10),
+    ]) + displayid_block([
+        (0x03, [0x00] * 20),
+        (0x26, [0x00] * 6),
+    ]),
+    # Plain 1080p monitor, with no serial at all
+    'office_1080p.bin': base_block('HWP', 0x3032, 0, 0xff, 2019, [
+        dtd(14850, 1920, 1080),
+        range_limits(50, 76, 30, 82, 170),
+        text(0xfc, 'HP P24 G4'),
+        descriptor(0x10, []),
+    ], 0, revision=3),
+}
+
+# A CTA block with a bad checksum, which we must ignore, and an EDID that is shorter than it says
+broken_cta = bytearray(b for b in CORPUS['dell_u2720q.bin'])
+broken_cta[130] ^= 0x01
+CORPUS['bad_checksum.bin'] = list(broken_cta)
+CORPUS['truncated.bin'] = CORPUS['lg_oled.bin'][:128]
+
+
+def main():
+    os.makedirs(OUT_DIR, exist_ok=True)
+    for name, data in sorted(CORPUS.items()):
+        assert len(data) % 128 == 0
+        with open(os.path.join(OUT_DIR, name), 'wb') as f:
+            f.write(bytes(data))
+        print(f'{name}: {len(data) // 128} block(s)')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,76 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Minimal test helpers: CHECK() reports failures and keeps going, and TEST_RESULT()
+// turns the failure count into an exit code for ctest.
+inline int test_failures = 0;
+
+#define CHECK(cond) do { if (!(cond)) { fprintf(stderr, "%s:%d: CHECK(%s) failed\n", \
+	__FILE__, __LINE__, #cond); test_failures++; } } while (0)
+#define CHECK_EQ(a, b) do { auto _a = (a); auto _b = (b); if ((long long)_a != (long long)_b) { \
+	fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, \
+	#a, #b, (long long)_a, (long long)_b); test_failures++; } } while (0)
+#define TEST_RESULT() (printf("%s\n", (test_failures == 0) ? "OK" : "FAILED"), (test_failures == 0) ? 0 : 1)
+
+// Relative paths are relative to tests/data, so that tests and benchmarks can be run from anywhere
+static inline std::filesystem::path TestData(const std::filesystem::path& path)
+{
+	return std::filesystem::path(NV_TEST_DATA) / path;
+}
+
+// Read all the files of a corpus directory, sorted by name
+static inline std::vector<std::pair<std::string, std::string>> ReadCorpus(const std::filesystem::path& dir)
+{
+	std::vector<std::pair<std::string, std::string>> corpus;
+	for (auto& entry : std::filesystem::directory_iterator(TestData(dir))) {
+		if (!entry.is_regular_file())
+			continue;
+		std::ifstream f(entry.path(), std::ios::binary);
+		corpus.emplace_back(entry.path().filename().string(), std::string(std::istreambuf_iterator<char>(f), {}));
+	}
+	sort(corpus.begin(), corpus.end());
+	return corpus;
+}
+
+// Benchmarks take their number of iterations as their only argument
+static inline int BenchIterations(int argc, char** argv, int default_iterations)
+{
+	return (argc > 1) ? std::max(atoi(argv[1]), 1) : default_iterations;
+}
+
+static inline double ElapsedUs(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,202 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "test.hpp"
+#include "nvCache.hpp"
+
+// Same layout as nvCache.cpp
+#define CACHE_HEADER_SIZE           12
+#define CACHE_ENTRY_HEADER_SIZE     22
+
+template <typename T> static void Put(vector<uint8_t>& buf, T val)
+{
+	uint8_t* p = (uint8_t*)&val;
+	buf.insert(buf.end(), p, p + sizeof(T));
+}
+
+struct test_entry {
+	uint64_t key;
+	uint64_t timestamp;
+	string data;
+};
+
+// Build a cache file by hand, so that we control the timestamps and can damage it
+static vector<uint8_t> BuildCache(const vector<test_entry>& entries, uint16_t version = CACHE_VERSION)
+{
+	vector<uint8_t> buf = { 'n', 'v', 'B', 'C' };
+	Put<uint16_t>(buf, version);
+	Put<uint16_t>(buf, (uint16_t)entries.size());
+	Put<uint32_t>(buf, nvCache::Crc32(buf.data(), buf.size()));
+	for (auto& e : entries) {
+		Put<uint64_t>(buf, e.key);
+		Put<uint64_t>(buf, e.timestamp);
+		Put<uint16_t>(buf, (uint16_t)e.data.size());
+		Put<uint32_t>(buf, nvCache::Crc32(e.data.data(), e.data.size()));
+		buf.insert(buf.end(), e.data.begin(), e.data.end());
+	}
+	return buf;
+}
+
+static void WriteFile(const filesystem::path& path, const vector<uint8_t>& data)
+{
+	ofstream f(path, ios::binary | ios::trunc);
+	f.write((const char*)data.data(), data.size());
+}
+
+static string Caps(int i)
+{
+	return "(prot(monitor)type(lcd)model(TEST" + to_string(i) + ")vcp(10 12 60(0F 11)))";
+}
+
+int main()
+{
+	auto dir = filesystem::temp_directory_path() /
+		("nv_test_cache_" + to_string(chrono::steady_clock::now().time_since_epoch().count()));
+	filesystem::create_directories(dir);
+	auto path = dir / "caps.bin";
+	string data;
+
+	// The standard check value of CRC-32
+	CHECK_EQ(nvCache::Crc32("123456789", 9), 0xcbf43926);
+
+	{
+		// Round trip, through a new instance
+		nvCache cache;
+		CHECK(!cache.Open(path));
+		CHECK(!cache.Lookup(1, data));
+		CHECK(cache.Store(1, Caps(1)));
+		CHECK(cache.Store(2, Caps(2)));
+		CHECK(cache.Store(1, Caps(3)));
+		CHECK(cache.Lookup(1, data) && data == Caps(3));
+		nvCache reopened;
+		CHECK(reopened.Open(path));
+		CHECK(reopened.Lookup(1, data) && data == Caps(3));
+		CHECK(reopened.Lookup(2, data) && data == Caps(2));
+		CHECK(!reopened.Lookup(3, data));
+		CHECK(!filesystem::exists(path.string() + ".tmp"));
+	}
+
+	{
+		// A cache that wasn't opened doesn't store anything
+		nvCache cache;
+		CHECK(!cache.Store(1, Caps(1)));
+	}
+
+	{
+		// Oversized entries are rejected, but the limit itself is fine
+		nvCache cache;
+		cache.Open(path);
+		CHECK(!cache.Store(4, string(CACHE_MAX_ENTRY_SIZE + 1, 'x')));
+		CHECK(!cache.Lookup(4, data));
+		CHECK(cache.Store(4, string(CACHE_MAX_ENTRY_SIZE, 'x')));
+		nvCache reopened;
+		CHECK(reopened.Open(path));
+		CHECK(reopened.Lookup(4, data) && data.size() == CACHE_MAX_ENTRY_SIZE);
+		// An entry that claims to be over the limit ends the parsing of the file
+		test_entry big = { 5, 1, string(CACHE_MAX_ENTRY_SIZE + 1, 'x') };
+		WriteFile(path, BuildCache({ { 1, 1, Caps(1) }, big, { 6, 1, Caps(6) } }));
+		CHECK(reopened.Open(path));
+		CHECK(reopened.Lookup(1, data) && data == Caps(1));
+		CHECK(!reopened.Lookup(5, data));
+		CHECK(!reopened.Lookup(6, data));
+	}
+
+	{
+		nvCache cache;
+
+		// Stale version
+		WriteFile(path, BuildCache({ { 1, 1, Caps(1) } }, CACHE_VERSION + 1));
+		CHECK(!cache.Open(path));
+		CHECK(!cache.Lookup(1, data));
+
+		// Corrupt header
+		auto buf = BuildCache({ { 1, 1, Caps(1) } });
+		buf[6] ^= 0x01;
+		WriteFile(path, buf);
+		CHECK(!cache.Open(path));
+		CHECK(!cache.Lookup(1, data));
+		buf = BuildCache({ { 1, 1, Caps(1) } });
+		buf[0] = 'x';
+		WriteFile(path, buf);
+		CHECK(!cache.Open(path));
+
+		// Truncated header, and a file that's too large to be ours
+		WriteFile(path, vector<uint8_t>(CACHE_HEADER_SIZE - 1, 0));
+		CHECK(!cache.Open(path));
+		WriteFile(path, vector<uint8_t>(CACHE_MAX_FILE_SIZE + 1, 0));
+		CHECK(!cache.Open(path));
+
+		// A corrupt entry only takes itself down
+		buf = BuildCache({ { 1, 1, Caps(1) }, { 2, 1, Caps(2) }, { 3, 1, Caps(3) } });
+		buf[CACHE_HEADER_SIZE + 2 * CACHE_ENTRY_HEADER_SIZE + Caps(1).size() + 5] ^= 0x20;
+		WriteFile(path, buf);
+		CHECK(cache.Open(path));
+		CHECK(cache.Lookup(1, data) && data == Caps(1));
+		CHECK(!cache.Lookup(2, data));
+		CHECK(cache.Lookup(3, data) && data == Caps(3));
+
+		// Whereas a truncated one takes down whatever follows it
+		buf = BuildCache({ { 1, 1, Caps(1) }, { 2, 1, Caps(2) } });
+		buf.resize(buf.size() - 1);
+		WriteFile(path, buf);
+		CHECK(cache.Open(path));
+		CHECK(cache.Lookup(1, data));
+		CHECK(!cache.Lookup(2, data));
+	}
+
+	{
+		// Eviction at the limit: the entry that was stored the longest ago goes first
+		vector<test_entry> entries;
+		for (int i = 0; i < CACHE_MAX_ENTRIES; i++)
+			entries.push_back({ (uint64_t)(100 + i), (uint64_t)(1000 + (i * 7) % CACHE_MAX_ENTRIES), Caps(i) });
+		WriteFile(path, BuildCache(entries));
+		nvCache cache;
+		CHECK(cache.Open(path));
+		for (auto& e : entries)
+			CHECK(cache.Lookup(e.key, data) && data == e.data);
+
+		// Entry 100 is the oldest (timestamp 1000), but storing the same data again refreshes it,
+		// so the next one (timestamp 1001, since 23 * 7 = 161 = 1 modulo 32) gets evicted instead
+		CHECK(cache.Store(100, Caps(0)));
+		CHECK(cache.Store(1, Caps(1)));
+		CHECK(cache.Lookup(100, data));
+		CHECK(cache.Lookup(1, data));
+		CHECK(!cache.Lookup(123, data));
+		// Then timestamp 1002 (14 * 7 = 98 = 2 modulo 32)
+		CHECK(cache.Store(2, Caps(2)));
+		CHECK(!cache.Lookup(114, data));
+		// Updating an existing entry doesn't evict anything
+		CHECK(cache.Store(2, Caps(3)));
+		CHECK(cache.Lookup(1, data));
+
+		nvCache reopened;
+		CHECK(reopened.Open(path));
+		CHECK(reopened.Lookup(1, data) && data == Caps(1));
+		CHECK(reopened.Lookup(2, data) && data == Caps(3));
+		size_t found = 0;
+		for (int i = 0; i < CACHE_MAX_ENTRIES; i++)
+			found += reopened.Lookup(100 + i, data) ? 1 : 0;
+		CHECK_EQ(found, CACHE_MAX_ENTRIES - 2);
+	}
+
+	filesystem::remove_all(dir);
+	return TEST_RESULT();
+}
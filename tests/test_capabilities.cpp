@@ -0,0 +1,104 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.hpp"
+#include "nvCapabilities.hpp"
+
+static bool ValuesAre(nvCapabilities& caps, uint8_t code, vector<uint8_t> expected)
+{
+	auto values = caps.GetVcpValues(code);
+	return vector<uint8_t>(values.begin(), values.end()) == expected;
+}
+
+int main()
+{
+	nvCapabilities caps;
+
+	for (auto& [name, input] : ReadCorpus("capabilities")) {
+		// Every string of the corpus must be usable, whatever the level of compliance
+		if (!caps.Parse(input)) {
+			fprintf(stderr, "%s: parsing failed\n", name.c_str());
+			test_failures++;
+		}
+	}
+
+	CHECK(caps.Parse("(prot(monitor)type(lcd)model(U2720Q)cmds(01 02 03 07 0C E3 F3)vcp(02 04 05 08 10 12 "
+		"14(05 08 0B 0C) 16 18 1A 52 60( 0F 11 1B) AA(01 02) D6(01 04 05))mccs_ver(2.1)mswhql(1))"));
+	CHECK(caps.GetProtocol() == "monitor");
+	CHECK(caps.GetType() == "lcd");
+	CHECK(caps.GetModel() == "U2720Q");
+	CHECK(caps.GetMccsVersion() == "2.1");
+	CHECK_EQ(caps.GetCommands().size(), 7);
+	CHECK_EQ(caps.GetCommands()[6], 0xf3);
+	CHECK_EQ(caps.GetNumberOfVcpCodes(), 14);
+	CHECK(caps.SupportsVcp(0x10));
+	CHECK(!caps.SupportsVcp(0x62));
+	CHECK(ValuesAre(caps, 0x60, { 0x0f, 0x11, 0x1b }));
+	CHECK(ValuesAre(caps, 0x14, { 0x05, 0x08, 0x0b, 0x0c }));
+	CHECK(ValuesAre(caps, 0x10, {}));
+
+	// Reparsing must not keep anything from the previous string
+	CHECK(caps.Parse("(prot(monitor)type(LCD)model(LG)cmds(01020307 0C)vcp(0210121416(0104050708)60(1112 0F)D6(0104))mccs_ver(2.2)"));
+	CHECK(caps.GetModel() == "LG");
+	CHECK_EQ(caps.GetCommands().size(), 5);
+	CHECK_EQ(caps.GetNumberOfVcpCodes(), 7);
+	CHECK(!caps.SupportsVcp(0x04) && caps.SupportsVcp(0x14));
+	CHECK(ValuesAre(caps, 0x16, { 0x01, 0x04, 0x05, 0x07, 0x08 }));
+	CHECK(ValuesAre(caps, 0x60, { 0x11, 0x12, 0x0f }));
+	CHECK(ValuesAre(caps, 0xd6, { 0x01, 0x04 }));
+
+	// No enclosing parentheses, unterminated groups and trailing data after a NUL
+	CHECK(caps.Parse(string_view("model( Foo )vcp(10 60(0F 11", 27)));
+	CHECK(caps.GetModel() == "Foo");
+	CHECK(ValuesAre(caps, 0x60, { 0x0f, 0x11 }));
+	CHECK(caps.Parse(string_view("(model(A)vcp(10))\0vcp(12)", 26)));
+	CHECK(!caps.SupportsVcp(0x12));
+
+	// Junk in the vcp list skips the rest of the group, but not the groups that follow
+	CHECK(caps.Parse("(vcp(10 zz 12)model(B))"));
+	CHECK(caps.SupportsVcp(0x10) && !caps.SupportsVcp(0x12));
+	CHECK(caps.GetModel() == "B");
+
+	// Nothing of use
+	CHECK(!caps.Parse(""));
+	CHECK(!caps.Parse("(prot(monitor)mswhql(1))"));
+	CHECK(!caps.Parse("(((("));
+
+	// The value pool is bounded, and values that don't fit are dropped
+	string big = "vcp(";
+	for (int code = 0; code < 8; code++) {
+		char hex[8];
+		snprintf(hex, sizeof(hex), "%02X(", 0xe0 + code);
+		big += hex;
+		for (int v = 0; v < 255; v++) {
+			snprintf(hex, sizeof(hex), "%02X ", v);
+			big += hex;
+		}
+		big += ")";
+	}
+	big += ")";
+	CHECK(caps.Parse(big));
+	CHECK_EQ(caps.GetNumberOfVcpCodes(), 8);
+	size_t total = 0;
+	for (int code = 0; code < 8; code++)
+		total += caps.GetVcpValues(0xe0 + code).size();
+	CHECK_EQ(total, CAPS_MAX_VCP_VALUES);
+	CHECK_EQ(caps.GetVcpValues(0xe0)[254], 254);
+
+	return TEST_RESULT();
+}
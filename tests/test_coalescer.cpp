@@ -0,0 +1,137 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <math.h>
+
+#include "test.hpp"
+#include "nvCoalescer.hpp"
+
+using namespace std::chrono;
+
+static bool Near(float a, float b)
+{
+	return fabsf(a - b) < 0.001f;
+}
+
+// Steps keep their size until the hold has lasted HOTKEY_ACCEL_DELAY, and then ease in to the
+// full acceleration over HOTKEY_ACCEL_RAMP
+static void TestAcceleration()
+{
+	nvCoalescer c;
+	auto t0 = steady_clock::now();
+
+	c.Add(L"A", 1.0f, t0);
+	CHECK(Near(c.GetFactor(t0), 1.0f));
+	CHECK(Near(c.GetFactor(t0 + milliseconds(HOTKEY_ACCEL_DELAY)), 1.0f));
+	CHECK(Near(c.GetFactor(t0 + milliseconds(HOTKEY_ACCEL_DELAY + HOTKEY_ACCEL_RAMP / 2)), 1.75f));
+	CHECK(Near(c.GetFactor(t0 + milliseconds(HOTKEY_ACCEL_DELAY + HOTKEY_ACCEL_RAMP)), 4.0f));
+	CHECK(Near(c.GetFactor(t0 + seconds(60)), 4.0f));
+
+	// Repeats within HOTKEY_REPEAT_GAP keep the hold going, and their steps grow
+	auto t = t0;
+	for (int i = 0; i < 100; i++) {
+		t += milliseconds(30);
+		c.Add(L"A", 1.0f, t);
+	}
+	auto changes = c.Take(t);
+	CHECK_EQ(changes.size(), 1);
+	CHECK(changes[L"A"] > 200.0f && changes[L"A"] < 202.0f * 4.0f);
+
+	// Changing direction, changing display, or letting go of the key starts over
+	t += milliseconds(30);
+	c.Add(L"A", -1.0f, t);
+	CHECK(Near(c.Take(t)[L"A"], -1.0f));
+	t += milliseconds(HOTKEY_ACCEL_DELAY + HOTKEY_ACCEL_RAMP);
+	c.Add(L"A", -1.0f, t - milliseconds(30));
+	c.Add(L"B", -1.0f, t);
+	changes = c.Take(t);
+	CHECK(Near(changes[L"B"], -1.0f));
+	t += milliseconds(HOTKEY_REPEAT_GAP);
+	c.Add(L"B", -1.0f, t);
+	CHECK(Near(c.Take(t)[L"B"], -1.0f));
+
+	// The acceleration is a percentage, from 100 (none) to HOTKEY_MAX_ACCELERATION
+	c.SetAcceleration(100);
+	CHECK(Near(c.GetFactor(t + seconds(60)), 1.0f));
+	c.SetAcceleration(50);
+	CHECK(Near(c.GetFactor(t + seconds(60)), 1.0f));
+	c.SetAcceleration(200);
+	CHECK(Near(c.GetFactor(t + milliseconds(HOTKEY_ACCEL_DELAY + HOTKEY_ACCEL_RAMP / 2)), 1.25f));
+	c.SetAcceleration(100000);
+	CHECK(Near(c.GetFactor(t + seconds(60)), HOTKEY_MAX_ACCELERATION / 100.0f));
+}
+
+// Changes get applied at most once per frame, and the rates are reported once per window
+static void TestRates()
+{
+	nvCoalescer c;
+	auto t0 = steady_clock::now();
+	uint32_t events, applies;
+
+	CHECK_EQ(c.GetNextDelay(t0 + seconds(10)), 0);
+	CHECK(!c.GetRates(t0 + seconds(10), &events, &applies));
+
+	// 50 events in 500 ms, applied every other event
+	auto t = t0 + seconds(10);
+	auto start = t;
+	for (int i = 0; i < 50; i++) {
+		c.Add(L"A", 1.0f, t);
+		if (c.IsFrameDue(t))
+			c.Take(t);
+		t += milliseconds(10);
+	}
+	c.Take(t);
+	CHECK(!c.HasPending());
+	CHECK(!c.GetRates(t, &events, &applies));
+
+	// We keep ticking at the frame rate while the key may still be held
+	CHECK_EQ(c.GetNextDelay(t), HOTKEY_FRAME_INTERVAL);
+	CHECK_EQ(c.GetNextDelay(start + milliseconds(HOTKEY_RATE_WINDOW - 100)), HOTKEY_FRAME_INTERVAL);
+	CHECK(!c.GetRates(start + milliseconds(HOTKEY_RATE_WINDOW - 100), &events, &applies));
+
+	t = start + milliseconds(HOTKEY_RATE_WINDOW);
+	CHECK(c.GetRates(t, &events, &applies));
+	CHECK_EQ(events, 50);
+	auto& stats = c.GetStats();
+	CHECK_EQ(applies, stats.applies);
+	CHECK(applies >= 25 && applies <= 34);
+	CHECK_EQ(stats.events, 50);
+	CHECK_EQ(stats.max_events_per_sec, 50);
+	CHECK_EQ(stats.max_applies_per_sec, applies);
+
+	// The window only gets reported once, and we go idle
+	CHECK(!c.GetRates(t + seconds(5), &events, &applies));
+	CHECK_EQ(c.GetNextDelay(t + seconds(5)), 0);
+
+	// Once the hold is over, we only need to be called back at the end of the window. A
+	// quieter window (1 event over 2 s) doesn't lower the maximums.
+	t += seconds(5);
+	c.Add(L"A", 1.0f, t);
+	c.Take(t);
+	CHECK_EQ(c.GetNextDelay(t + milliseconds(HOTKEY_REPEAT_GAP)), HOTKEY_RATE_WINDOW - HOTKEY_REPEAT_GAP);
+	CHECK(c.GetRates(t + milliseconds(2 * HOTKEY_RATE_WINDOW), &events, &applies));
+	CHECK_EQ(events, 0);
+	CHECK_EQ(stats.max_events_per_sec, 50);
+}
+
+int main()
+{
+	TestAcceleration();
+	TestRates();
+	return TEST_RESULT();
+}
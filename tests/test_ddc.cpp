@@ -0,0 +1,113 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.hpp"
+#include "nvDdc.hpp"
+
+static const string caps_string = "(prot(monitor)type(lcd)model(U2720Q)cmds(01 02 03 07 0C E3 F3)vcp(02 04 05 08 10 12 "
+	"14(05 08 0B 0C) 16 18 1A 52 60(0F 11 1B) AA(01 02) D6(01 04 05))mccs_ver(2.1))";
+
+int main()
+{
+	// "Get VCP brightness" from the DDC/CI specs: 6E 51 82 01 10 AC
+	const uint8_t request[] = { DDC_HOST_ADDRESS, 0x82, DDC_OP_VCP_REQUEST, 0x10 };
+	CHECK_EQ(nvDdcEngine::Checksum(DDC_DEST_ADDRESS, request), 0xac);
+
+	{
+		nvDdcSimulator sim(caps_string);
+		nvDdcEngine ddc(&sim);
+		uint16_t current = 0, max = 0;
+
+		sim.SetVcp(0x10, 50, 100);
+		sim.SetVcp(0x60, 0x0f, 0x1b);
+		CHECK(ddc.GetVcpFeature(0x60, &current, &max));
+		CHECK_EQ(current, 0x0f);
+		CHECK_EQ(max, 0x1b);
+		// One round trip, with only the mandated reply delay
+		CHECK_EQ(ddc.GetStats().writes, 1);
+		CHECK_EQ(ddc.GetStats().reads, 1);
+		CHECK_EQ(sim.Now(), ddc.default_timing.vcp_reply_delay);
+
+		// The next command must wait for the inter command delay
+		CHECK(ddc.SetVcpFeature(0x10, 20));
+		CHECK_EQ(sim.GetVcp(0x10), 20);
+		CHECK_EQ(sim.Now(), ddc.default_timing.vcp_reply_delay + ddc.default_timing.inter_command_delay);
+		CHECK(ddc.GetVcpFeature(0x10, &current, NULL));
+		CHECK_EQ(current, 20);
+
+		// Unsupported codes get a reply with an error result, which is not worth retrying
+		ddc.ResetStats();
+		CHECK(!ddc.GetVcpFeature(0x99, &current, &max));
+		CHECK_EQ(ddc.GetStats().retries, 0);
+
+		// Capabilities come in 32 byte fragments, terminated by an empty one
+		string caps;
+		ddc.ResetStats();
+		CHECK(ddc.GetCapabilities(caps));
+		CHECK(caps == caps_string);
+		CHECK_EQ(ddc.GetStats().writes, (caps_string.size() + DDC_CAPS_FRAGMENT_SIZE - 1) / DDC_CAPS_FRAGMENT_SIZE + 1);
+		CHECK_EQ(ddc.GetStats().retries, 0);
+		CHECK_EQ(ddc.GetStats().null_replies, 0);
+	}
+
+	{
+		// Corrupted replies must be detected and retried
+		nvDdcSimulator sim(caps_string);
+		nvDdcEngine ddc(&sim);
+		uint16_t current = 0;
+		string caps;
+
+		sim.SetCorruption(3);
+		sim.SetVcp(0x10, 50, 100);
+		for (int i = 0; i < 10; i++) {
+			CHECK(ddc.GetVcpFeature(0x10, &current, NULL));
+			CHECK_EQ(current, 50);
+		}
+		CHECK(ddc.GetCapabilities(caps));
+		CHECK(caps == caps_string);
+		CHECK(ddc.GetStats().checksum_errors != 0);
+		CHECK_EQ(ddc.GetStats().retries, ddc.GetStats().checksum_errors);
+	}
+
+	{
+		// A monitor that is slower than our delays replies with null messages, until we give up
+		nvDdcSimulator sim(caps_string, 60);
+		nvDdcEngine ddc(&sim);
+		uint16_t current = 0;
+
+		sim.SetVcp(0x10, 50, 100);
+		CHECK(!ddc.GetVcpFeature(0x10, &current, NULL));
+		CHECK_EQ(ddc.GetStats().null_replies, DDC_MAX_RETRIES + 1);
+		// But we get there with the proper timing
+		ddc.SetTiming({ 60, 50, 60, 50 });
+		ddc.ResetStats();
+		CHECK(ddc.GetVcpFeature(0x10, &current, NULL));
+		CHECK_EQ(ddc.GetStats().null_replies, 0);
+	}
+
+	{
+		// Some monitors NUL terminate their capabilities
+		nvDdcSimulator sim(string("(vcp(10))\0\0", 11));
+		nvDdcEngine ddc(&sim);
+		string caps;
+		CHECK(ddc.GetCapabilities(caps));
+		CHECK(caps == "(vcp(10))");
+	}
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,92 @@
+#!/usr/bin/env python3
+#
+# nvBrightness - nVidia Control Panel brightness at your fingertips
+#
+# Copyright © 2025 Pete Batard <pete@akeo.ie>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""Run tools/decode_events.py against an event log written by test_eventlog.
+
+Usage: test_decode_events.py TEST_EVENTLOG DECODE_EVENTS
+"""
+
+import json
+import os
+import subprocess
+import sys
+import tempfile
+
+failures = 0
+
+
+def check(cond, what):
+    global failures
+    if not cond:
+        print(f"FAILED: {what}", file=sys.stderr)
+        failures += 1
+
+
+def main():
+    test_eventlog, decode_events = sys.argv[1:3]
+    path = os.path.join(tempfile.gettempdir(), f"nv_test_decode_events_{os.getpid()}.evl")
+    check(subprocess.run([test_eventlog, "--write", path], timeout=10).returncode == 0, "write log")
+
+    def decode(*args):
+        r = subprocess.run([sys.executable, decode_events] + list(args) + [path],
+                           capture_output=True, text=True, encoding="utf-8", timeout=10)
+        return r.returncode, r.stdout.splitlines()
+
+    # Text output is "<date> <time> [<display>] <event>: <message>"
+    rc, lines = decode()
+    check(rc == 0, "text exit")
+    check([line.split(" ", 2)[2] for line in lines] == [
+        "[0x00001001] evHybridEnabled: Using hybrid brightness for DELL U2720Q (luminance: 35/50)",
+        "[0x00001001] evBrightnessChanged: Brightness set to 42.5",
+        "[0x00001002] evValidInputs: U2720Q Valid input(s): DP1, HDMI1",
+        "[0x00001002] evEdidHdr: LG HDR 4K HDR: EOTF 0x02, 600 cd/m² max, 400 cd/m² max average, "
+        "0.0500 cd/m² min",
+        "[0x00001001] evBrightnessChanged: Brightness set to 45.0"], "text")
+
+    rc, lines = decode("--json")
+    check(rc == 0, "json exit")
+    records = [json.loads(line) for line in lines]
+    check([(r["event"], r["display"]) for r in records] == [
+        ("evHybridEnabled", "0x00001001"), ("evBrightnessChanged", "0x00001001"),
+        ("evValidInputs", "0x00001002"), ("evEdidHdr", "0x00001002"),
+        ("evBrightnessChanged", "0x00001001")], "json events")
+    check(records[0]["args"] == ["DELL U2720Q", 35, 50], "json string and integers")
+    check(records[1]["args"] == [42.5], "json float")
+    check(records[3]["args"][:4] == ["LG HDR 4K", 2, 600.0, 400.0], "json mixed")
+    check(all(a["time"] <= b["time"] for a, b in zip(records, records[1:])), "json time order")
+
+    rc, lines = decode("--event", "evBrightnessChanged", "--display", "0x1001")
+    check(rc == 0 and len(lines) == 2 and all("evBrightnessChanged" in line for line in lines), "filters")
+
+    # Stats are sorted by count, and carry the number of displays each event was seen on
+    rc, lines = decode("--stats")
+    check(rc == 0, "stats exit")
+    check(lines[0] == "5 event(s)", "stats total")
+    rows = [line.split()[:5] for line in lines[2:]]
+    check(rows == [["evBrightnessChanged", "2", "40.0", "-", "1"], ["evHybridEnabled", "1", "20.0", "-", "1"],
+                   ["evValidInputs", "1", "20.0", "-", "1"], ["evEdidHdr", "1", "20.0", "-", "1"]], "stats")
+
+    os.remove(path)
+    print("OK" if failures == 0 else "FAILED")
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,156 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <math.h>
+
+#include "test.hpp"
+#include "nvEdid.hpp"
+
+// The corpus comes from gen_edid_corpus.py, which defines the values checked here
+static span<const uint8_t> Bytes(const string& s)
+{
+	return span<const uint8_t>((const uint8_t*)s.data(), s.size());
+}
+
+static bool Near(float a, float b)
+{
+	return fabsf(a - b) <= 0.01f * fmaxf(1.0f, fabsf(b));
+}
+
+int main()
+{
+	map<string, string> corpus;
+	for (auto& [name, data] : ReadCorpus("edid"))
+		corpus[name] = data;
+	CHECK_EQ(corpus.size(), 6);
+
+	nvEdid edid;
+
+	// Office monitor, with a CTA-861 extension
+	CHECK(edid.Parse(Bytes(corpus["dell_u2720q.bin"])));
+	CHECK(edid.HasValidChecksums());
+	CHECK_EQ(edid.GetNumberOfBlocks(), 2);
+	CHECK_EQ(edid.GetVendorCode(), 0x10ac);
+	CHECK_EQ(edid.GetProductCode(), 0xa0f3);
+	CHECK_EQ(edid.GetSerial(), 0x4c413331);
+	CHECK_EQ(edid.GetWeek(), 12);
+	CHECK_EQ(edid.GetYear(), 2021);
+	CHECK_EQ(edid.GetVersion(), 1);
+	CHECK_EQ(edid.GetRevision(), 4);
+	CHECK(edid.GetModel() == "DELL U2720Q");
+	CHECK(edid.GetSerialString() == "F8KXR83");
+	auto& range = edid.GetRangeLimits();
+	CHECK(range.present);
+	CHECK_EQ(range.min_vfreq, 24);
+	CHECK_EQ(range.max_vfreq, 76);
+	CHECK_EQ(range.min_hfreq, 30);
+	CHECK_EQ(range.max_hfreq, 135);
+	CHECK_EQ(range.max_pixel_clock, 600);
+	CHECK(edid.HasCta());
+	CHECK_EQ(edid.GetCtaFlags(), 0xf0);
+	CHECK_EQ(edid.GetColorimetry(), 0x0c1);
+	CHECK_EQ(edid.GetVsdbOuis().size(), 1);
+	CHECK(edid.HasVsdb(EDID_OUI_HDMI));
+	CHECK(!edid.HasVsdb(EDID_OUI_HDMI_FORUM));
+	auto& hdr = edid.GetHdrMetadata();
+	CHECK(hdr.present);
+	CHECK_EQ(hdr.eotf, 0x05);
+	CHECK_EQ(hdr.metadata, 0x01);
+	CHECK(hdr.max_luminance == 0.0f && hdr.max_frame_avg == 0.0f && hdr.min_luminance == 0.0f);
+	CHECK_EQ(edid.GetDisplayIdVersion(), 0);
+
+	// TV, with HDMI Forum, Dolby Vision (a video VSDB) and luminance values
+	CHECK(edid.Parse(Bytes(corpus["lg_oled.bin"])));
+	CHECK(edid.HasValidChecksums());
+	CHECK_EQ(edid.GetVendorCode(), 0x1e6d);
+	CHECK(edid.GetModel() == "LG TV SSCR2");
+	CHECK(edid.GetSerialString().empty());
+	CHECK_EQ(edid.GetRangeLimits().max_vfreq, 120);
+	CHECK_EQ(edid.GetRangeLimits().max_hfreq, 255);
+	CHECK_EQ(edid.GetVsdbOuis().size(), 3);
+	CHECK(edid.HasVsdb(EDID_OUI_HDMI) && edid.HasVsdb(EDID_OUI_HDMI_FORUM) && edid.HasVsdb(EDID_OUI_DOLBY));
+	CHECK_EQ(edid.GetColorimetry(), 0x8c3);
+	CHECK_EQ(edid.GetHdrMetadata().eotf, 0x07);
+	CHECK(Near(edid.GetHdrMetadata().max_luminance, 400.0f));
+	CHECK(Near(edid.GetHdrMetadata().max_frame_avg, 289.1f));
+	CHECK(edid.GetHdrMetadata().min_luminance == 0.0f);
+
+	// Gaming monitor, which needs the EDID 1.4 range offsets, and has a DisplayID extension
+	CHECK(edid.Parse(Bytes(corpus["gaming_360hz.bin"])));
+	CHECK(edid.HasValidChecksums());
+	CHECK_EQ(edid.GetNumberOfBlocks(), 3);
+	CHECK_EQ(edid.GetVendorCode(), 0x06b3);
+	CHECK_EQ(edid.GetSerial(), 0);
+	CHECK(edid.GetSerialString() == "N9LMQS012345");
+	CHECK_EQ(edid.GetRangeLimits().min_vfreq, 48);
+	CHECK_EQ(edid.GetRangeLimits().max_vfreq, 360);
+	CHECK_EQ(edid.GetRangeLimits().max_hfreq, 510);
+	CHECK_EQ(edid.GetRangeLimits().max_pixel_clock, 1300);
+	CHECK(Near(edid.GetHdrMetadata().max_luminance, 351.2f));
+	CHECK(Near(edid.GetHdrMetadata().max_frame_avg, 248.0f));
+	CHECK(Near(edid.GetHdrMetadata().min_luminance, 0.01382f));
+	CHECK_EQ(edid.GetDisplayIdVersion(), 0x13);
+	auto blocks = edid.GetDisplayIdBlocks();
+	CHECK(vector<uint8_t>(blocks.begin(), blocks.end()) == vector<uint8_t>({ 0x03, 0x26 }));
+
+	// EDID 1.3, no extension and no serial whatsoever
+	CHECK(edid.Parse(Bytes(corpus["office_1080p.bin"])));
+	CHECK(edid.HasValidChecksums());
+	CHECK_EQ(edid.GetNumberOfBlocks(), 1);
+	CHECK_EQ(edid.GetRevision(), 3);
+	CHECK_EQ(edid.GetSerial(), 0);
+	CHECK(edid.GetSerialString().empty());
+	CHECK(edid.GetModel() == "HP P24 G4");
+	CHECK(!edid.HasCta());
+	CHECK(!edid.GetHdrMetadata().present);
+	CHECK(edid.GetVsdbOuis().empty());
+
+	// An extension that fails its checksum is reported, and none of its content used
+	CHECK(edid.Parse(Bytes(corpus["bad_checksum.bin"])));
+	CHECK(!edid.HasValidChecksums());
+	CHECK(edid.GetModel() == "DELL U2720Q");
+	CHECK(!edid.HasCta());
+	CHECK(!edid.HasVsdb(EDID_OUI_HDMI));
+
+	// Advertising more extensions than we got
+	CHECK(edid.Parse(Bytes(corpus["truncated.bin"])));
+	CHECK_EQ(edid.GetNumberOfBlocks(), 1);
+	CHECK(!edid.HasCta());
+
+	// A DisplayID section that fails its own checksum, in an otherwise valid block
+	string displayid = corpus["gaming_360hz.bin"];
+	displayid[2 * EDID_BLOCK_SIZE + 6]++;
+	displayid[3 * EDID_BLOCK_SIZE - 1]--;
+	CHECK(nvEdid::IsChecksumValid(Bytes(displayid).subspan(2 * EDID_BLOCK_SIZE, EDID_BLOCK_SIZE)));
+	CHECK(edid.Parse(Bytes(displayid)));
+	CHECK(!edid.HasValidChecksums());
+	CHECK(edid.HasCta());
+
+	// Reparsing must not keep anything from the previous EDID
+	CHECK(edid.Parse(Bytes(corpus["office_1080p.bin"])));
+	CHECK_EQ(edid.GetDisplayIdVersion(), 0);
+	CHECK(edid.GetDisplayIdBlocks().empty());
+
+	// Not an EDID
+	CHECK(!edid.Parse(Bytes(corpus["office_1080p.bin"].substr(0, 127))));
+	CHECK(!edid.IsValid());
+	CHECK(!edid.Parse(Bytes(string(EDID_BLOCK_SIZE, '\0'))));
+	CHECK(!edid.Parse({}));
+
+	return TEST_RESULT();
+}
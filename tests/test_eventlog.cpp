@@ -0,0 +1,154 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "test.hpp"
+#include "nvEventLog.hpp"
+#include "nvLogFile.hpp"
+
+// Same layout as nvEventLog.cpp
+#define HEADER_SIZE                 8
+#define RECORD_HEADER_SIZE          17
+
+static string ReadFile(const filesystem::path& path)
+{
+	ifstream f(path, ios::binary);
+	return string(istreambuf_iterator<char>(f), {});
+}
+
+// Walk the records of a log, and return the float argument of each of them, which is all
+// the events we log here have
+static vector<float> ReadValues(const filesystem::path& path)
+{
+	vector<float> values;
+	string data = ReadFile(path);
+
+	CHECK(data.size() >= HEADER_SIZE && data.compare(0, 4, "nvEV") == 0);
+	for (size_t pos = HEADER_SIZE; pos < data.size(); ) {
+		uint16_t size, id;
+		float value;
+		CHECK(pos + 2 <= data.size());
+		memcpy(&size, &data[pos], sizeof(size));
+		CHECK(pos + 2 + size <= data.size());
+		CHECK_EQ(size, RECORD_HEADER_SIZE - 2 + 1 + sizeof(float));
+		if (size != RECORD_HEADER_SIZE - 2 + 1 + sizeof(float))
+			break;
+		memcpy(&id, &data[pos + 10], sizeof(id));
+		CHECK_EQ(id, evBrightnessChanged);
+		CHECK_EQ(data[pos + RECORD_HEADER_SIZE], EVENT_ARG_FLOAT);
+		memcpy(&value, &data[pos + RECORD_HEADER_SIZE + 1], sizeof(value));
+		values.push_back(value);
+		pos += 2 + size;
+	}
+	return values;
+}
+
+// The events that test_decode_events.py checks tools/decode_events.py against
+static void EmitSamples(nvEventLog& log)
+{
+	log.Emit(evHybridEnabled, 0x1001, L"DELL U2720Q", 35, 50);
+	log.Emit(evBrightnessChanged, 0x1001, 42.5f);
+	log.Emit(evValidInputs, 0x1002, "U2720Q", "DP1, HDMI1");
+	log.Emit(evEdidHdr, 0x1002, L"LG HDR 4K", 2, 600.0f, 400.0f, 0.05f);
+	log.Emit(evBrightnessChanged, 0x1001, 45.0f);
+}
+
+int main(int argc, char** argv)
+{
+	if (argc == 3 && strcmp(argv[1], "--write") == 0) {
+		nvEventLog log;
+		if (!log.Open(argv[2], LOGFILE_DEFAULT_MAX_SIZE, 0))
+			return 1;
+		EmitSamples(log);
+		log.Close();
+		return 0;
+	}
+
+	auto dir = filesystem::temp_directory_path() /
+		("nv_test_eventlog_" + to_string(chrono::steady_clock::now().time_since_epoch().count()));
+	filesystem::create_directories(dir);
+	auto path = dir / "test.evl";
+	const uint64_t max_size = 2048;
+	const int num_events = 600;
+
+	{
+		// The log gets rotated before it goes over its maximum size, without splitting records,
+		// and only the newest generations are kept
+		nvEventLog log;
+		CHECK(log.Open(path, max_size, 2));
+		for (int i = 0; i < num_events; i++)
+			log.Emit(evBrightnessChanged, 0x1001, (float)i);
+		log.Close();
+		CHECK(log.GetRotations() >= 3);
+		CHECK(filesystem::exists(nvLogFile::GetGenerationPath(path, 2)));
+		CHECK(!filesystem::exists(nvLogFile::GetGenerationPath(path, 3)));
+		vector<float> all;
+		for (uint32_t g : { 2, 1, 0 }) {
+			auto p = (g == 0) ? path : nvLogFile::GetGenerationPath(path, g);
+			CHECK(filesystem::file_size(p) <= max_size);
+			auto values = ReadValues(p);
+			CHECK(!values.empty());
+			all.insert(all.end(), values.begin(), values.end());
+		}
+		for (size_t i = 0; i < all.size(); i++)
+			CHECK(all[i] == (float)(num_events - all.size() + i));
+	}
+
+	{
+		// Reopening appends to the current log, and rotates it first if it's full
+		auto values = ReadValues(path);
+		nvEventLog log;
+		CHECK(log.Open(path, max_size, 2));
+		log.Emit(evBrightnessChanged, 0x1001, -1.0f);
+		log.Close();
+		auto appended = ReadValues(path);
+		CHECK_EQ(appended.size(), values.size() + 1);
+		CHECK(appended.back() == -1.0f);
+		CHECK_EQ(log.GetRotations(), 0);
+
+		CHECK(log.Open(path, LOGFILE_DEFAULT_MAX_SIZE, 2));
+		for (int i = 0; i < (int)max_size / 20; i++)
+			log.Emit(evBrightnessChanged, 0x1001, (float)i);
+		log.Close();
+		auto full = ReadValues(path);
+		CHECK(filesystem::file_size(path) > max_size);
+
+		CHECK(log.Open(path, max_size, 2));
+		log.Close();
+		CHECK_EQ(log.GetRotations(), 1);
+		CHECK(ReadValues(path).empty());
+		CHECK(ReadValues(nvLogFile::GetGenerationPath(path, 1)) == full);
+	}
+
+	{
+		// A log from an incompatible version is started over
+		string data = ReadFile(nvLogFile::GetGenerationPath(path, 1));
+		data[4] = (char)(EVENT_LOG_VERSION + 1);
+		ofstream(path, ios::binary | ios::trunc).write(data.data(), data.size());
+		nvEventLog log;
+		CHECK(log.Open(path, max_size, 0));
+		log.Emit(evBrightnessChanged, 0x1001, 7.0f);
+		log.Close();
+		CHECK(ReadValues(path) == vector<float>({ 7.0f }));
+	}
+
+	filesystem::remove_all(dir);
+	return TEST_RESULT();
+}
@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+#
+# nvBrightness - nVidia Control Panel brightness at your fingertips
+#
+# Copyright © 2025 Pete Batard <pete@akeo.ie>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""Check that tools/gen_vendors.py gives back src/vendors.hpp from a PNP ID registry export.
+
+Usage: test_gen_vendors.py GEN_VENDORS PNP_ID_LIST.csv
+"""
+
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+failures = 0
+
+
+def check(cond, what):
+    global failures
+    if not cond:
+        print(f"FAILED: {what}", file=sys.stderr)
+        failures += 1
+
+
+def main():
+    gen_vendors, pnp = sys.argv[1:3]
+    header = os.path.join(os.path.dirname(os.path.dirname(os.path.abspath(gen_vendors))), "src", "vendors.hpp")
+    with open(header, "rb") as f:
+        expected = f.read()
+
+    with tempfile.TemporaryDirectory() as tmp:
+        output = os.path.join(tmp, "vendors.hpp")
+        shutil.copyfile(header, output)
+
+        def gen(registry, *args):
+            r = subprocess.run([sys.executable, gen_vendors, "--pnp", registry, "--output", output] + list(args),
+                               capture_output=True, text=True, timeout=60)
+            return r.returncode, r.stdout.splitlines()
+
+        # Every vendor of the registry has been reviewed, so the table doesn't change
+        rc, report = gen(pnp, "--dry-run")
+        check(rc == 0, "dry run exit")
+        check(report[-1].endswith(" entries: 0 added, 0 removed, 0 changed"), "dry run report")
+        check(not any("no override" in line for line in report), "no unreviewed IDs")
+
+        # And regenerating the header must not change a single byte of it
+        rc, report = gen(pnp)
+        check(rc == 0, "generation exit")
+        with open(output, "rb") as f:
+            check(f.read() == expected, "generated header")
+
+        # An unknown company gets reported with a suggested name, and is only added on request
+        with open(pnp, encoding="utf-8") as f:
+            rows = f.read()
+        extended = os.path.join(tmp, "pnp.csv")
+        with open(extended, "w", encoding="utf-8") as f:
+            f.write(rows + '"The Example Displays Company, Ltd.",ZZX\n')
+        rc, report = gen(extended, "--dry-run")
+        check(rc == 0 and "  ZZX\tExample\t# The Example Displays Company, Ltd." in report, "unreviewed report")
+        rc, report = gen(extended, "--add-new")
+        check(rc == 0 and "+ ZZX 'Example'" in report, "added report")
+        with open(output, encoding="utf-8") as f:
+            check('\t{ "ZZX", "Example" },\n' in f.read(), "added entry")
+
+    print("OK" if failures == 0 else "FAILED")
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,144 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+
+#include "test.hpp"
+#include "nvDdc.hpp"
+#include "nvHybrid.hpp"
+
+#define VCP_LUMINANCE 0x10
+
+static const string caps_string = "(prot(monitor)type(lcd)model(TEST)cmds(01 02 03 F3)vcp(10 12 60(0F 11))mccs_ver(2.1))";
+
+// A backlight that goes through the DDC/CI engine, to the simulated monitor
+class ddcBacklight : public nvBacklight {
+	nvDdcSimulator& sim;
+	nvDdcEngine ddc;
+public:
+	ddcBacklight(nvDdcSimulator& sim) : sim(sim), ddc(&sim) {};
+	bool GetLuminance(uint16_t* current, uint16_t* max) override { return ddc.GetVcpFeature(VCP_LUMINANCE, current, max); };
+	bool SetLuminance(uint16_t value) override { return ddc.SetVcpFeature(VCP_LUMINANCE, value); };
+	uint64_t Now() override { return sim.Now(); };
+};
+
+// The brightness we end up with, in percent of the hybrid range, when the gamma brightness
+// dims the backlight. This must be the level, whatever the backlight step is.
+static float Effective(float backlight, float gamma_brightness)
+{
+	return backlight - HYBRID_BACKLIGHT_STEP * (100.0f - gamma_brightness) / 20.0f;
+}
+
+int main()
+{
+	float target, gamma_brightness, previous = -1.0f;
+
+	// Once the backlight has reached its target, the split must cover the whole range with no
+	// jumps, the backlight must never be below the level, and the gamma must stay in range
+	for (int i = 0; i <= 1000; i++) {
+		float level = i / 10.0f;
+		nvHybrid::SplitLevel(level, 100.0f, &target, &gamma_brightness);
+		nvHybrid::SplitLevel(level, target, &target, &gamma_brightness);
+		CHECK(target >= level && target - level < HYBRID_BACKLIGHT_STEP);
+		CHECK_EQ(lroundf(target) % lroundf(HYBRID_BACKLIGHT_STEP), 0);
+		CHECK(gamma_brightness >= 80.0f && gamma_brightness <= 100.0f);
+		CHECK(fabsf(Effective(target, gamma_brightness) - level) < 0.001f);
+		CHECK(Effective(target, gamma_brightness) > previous);
+		previous = Effective(target, gamma_brightness);
+	}
+	// While a backlight write is pending, the gamma compensates as much as it can
+	nvHybrid::SplitLevel(55.0f, 70.0f, &target, &gamma_brightness);
+	CHECK_EQ(lroundf(target), 60);
+	CHECK_EQ(lroundf(gamma_brightness), 80);
+	nvHybrid::SplitLevel(65.0f, 70.0f, &target, &gamma_brightness);
+	CHECK_EQ(lroundf(gamma_brightness), 90);
+
+	{
+		// A monitor that doesn't report its luminance can't be used
+		nvDdcSimulator sim(caps_string);
+		ddcBacklight backlight(sim);
+		nvHybrid hybrid(&backlight);
+		CHECK(!hybrid.Enable(100.0f));
+		CHECK(!hybrid.IsEnabled());
+	}
+
+	{
+		nvDdcSimulator sim(caps_string);
+		ddcBacklight backlight(sim);
+		nvHybrid hybrid(&backlight);
+
+		// We start from the level that matches the backlight and the gamma brightness
+		sim.SetVcp(VCP_LUMINANCE, 35, 50);
+		CHECK(hybrid.Enable(90.0f));
+		CHECK_EQ(lroundf(hybrid.GetLevel()), 65);
+		CHECK(!hybrid.IsPending());
+
+		// Within the current backlight step, only the gamma changes
+		CHECK_EQ(lroundf(hybrid.ChangeLevel(1.0f)), 100);
+		CHECK_EQ(lroundf(hybrid.GetLevel()), 70);
+		CHECK(!hybrid.IsPending());
+		CHECK_EQ(hybrid.Update(&gamma_brightness), 0);
+		CHECK_EQ(sim.GetVcp(VCP_LUMINANCE), 35);
+
+		// Going below it takes a backlight write, which is done right away the first time
+		CHECK_EQ(lroundf(hybrid.ChangeLevel(-2.0f)), 80);
+		CHECK(hybrid.IsPending());
+		uint64_t written = sim.Now();
+		CHECK_EQ(hybrid.Update(&gamma_brightness), 0);
+		CHECK_EQ(sim.GetVcp(VCP_LUMINANCE), 30);
+		CHECK_EQ(lroundf(gamma_brightness), 100);
+		CHECK(!hybrid.IsPending());
+
+		// But not more often than every HYBRID_WRITE_INTERVAL
+		hybrid.ChangeLevel(-2.0f);
+		CHECK(sim.Now() - written < HYBRID_WRITE_INTERVAL);
+		CHECK_EQ(hybrid.Update(&gamma_brightness), HYBRID_WRITE_INTERVAL - (sim.Now() - written));
+		CHECK_EQ(sim.GetVcp(VCP_LUMINANCE), 30);
+		sim.Delay((uint32_t)(HYBRID_WRITE_INTERVAL - (sim.Now() - written)));
+		CHECK_EQ(hybrid.Update(&gamma_brightness), 0);
+		CHECK_EQ(sim.GetVcp(VCP_LUMINANCE), 25);
+
+		// A write that fails is retried, and the gamma keeps compensating in the meantime
+		sim.SetConnected(false);
+		sim.Delay(HYBRID_WRITE_INTERVAL);
+		gamma_brightness = hybrid.ChangeLevel(-2.0f);
+		CHECK_EQ(lroundf(gamma_brightness), 80);
+		CHECK_EQ(hybrid.Update(&gamma_brightness), HYBRID_WRITE_INTERVAL);
+		CHECK(hybrid.IsPending());
+		CHECK_EQ(lroundf(hybrid.GetBacklight()), 50);
+		CHECK_EQ(lroundf(hybrid.GetBacklightTarget()), 40);
+		sim.SetConnected(true);
+		CHECK(hybrid.Update(&gamma_brightness) != 0);
+		CHECK_EQ(sim.GetVcp(VCP_LUMINANCE), 25);
+		sim.Delay(HYBRID_WRITE_INTERVAL);
+		CHECK_EQ(hybrid.Update(&gamma_brightness), 0);
+		CHECK_EQ(sim.GetVcp(VCP_LUMINANCE), 20);
+		CHECK_EQ(lroundf(gamma_brightness), 100);
+		CHECK(!hybrid.IsPending());
+
+		// Giving the backlight back restores it, and carries the level over to the gamma range
+		CHECK_EQ(lroundf(hybrid.Disable()), 88);
+		CHECK(!hybrid.IsEnabled());
+		CHECK_EQ(sim.GetVcp(VCP_LUMINANCE), 35);
+		CHECK_EQ(hybrid.Update(&gamma_brightness), 0);
+		CHECK_EQ(sim.GetVcp(VCP_LUMINANCE), 35);
+	}
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,122 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <math.h>
+#include <string.h>
+
+#include "test.hpp"
+#include "nvIcons.hpp"
+
+// The tray icons used to be the icons/*.ico resources, which we keep as references, and which
+// the rendered icons must match within these tolerances, per premultiplied channel. Most of
+// the larger differences are in the antialiased corners of the border, which the references
+// shade darker, and in the edges of the digits at 16 and 24 px.
+#define MAX_MEAN_ERROR              1.5
+#define MAX_ERROR                   32.0
+#define MAX_ERROR_OVER_8            5.0     // In percent of the channels
+
+// The uncompressed 32-bit images of an .ico, as top-down BGRA, by size
+static map<uint32_t, vector<uint8_t>> ReadIcon(const filesystem::path& path)
+{
+	map<uint32_t, vector<uint8_t>> images;
+	ifstream f(path, ios::binary);
+	string ico((istreambuf_iterator<char>(f)), {});
+	auto u16 = [&](size_t pos) { return (uint32_t)(uint8_t)ico[pos] | ((uint32_t)(uint8_t)ico[pos + 1] << 8); };
+	auto u32 = [&](size_t pos) { return u16(pos) | (u16(pos + 2) << 16); };
+
+	if (ico.size() < 6)
+		return images;
+	for (uint32_t i = 0; i < u16(4) && 6 + 16 * (i + 1) <= ico.size(); i++) {
+		size_t offset = u32(6 + 16 * i + 12);
+		// PNG images start with their signature rather than a BITMAPINFOHEADER
+		if (offset + 40 > ico.size() || ico.compare(offset, 4, "\x89PNG") == 0 || u16(offset + 14) != 32)
+			continue;
+		uint32_t size = u32(offset + 4);
+		size_t bits = offset + u32(offset);
+		if (bits + (size_t)size * size * 4 > ico.size())
+			continue;
+		auto& image = images[size];
+		// Bitmaps are bottom-up
+		for (uint32_t y = 0; y < size; y++)
+			image.insert(image.end(), &ico[bits + (size_t)(size - 1 - y) * size * 4],
+				&ico[bits + (size_t)(size - y) * size * 4]);
+	}
+	return images;
+}
+
+int main()
+{
+	nvIcons icons;
+	vector<uint32_t> rendered(ICON_MAX_SIZE * ICON_MAX_SIZE), other(ICON_MAX_SIZE * ICON_MAX_SIZE);
+	uint32_t compared = 0;
+
+	for (int level = 0; level <= 100; level += 5) {
+		char name[16];
+		snprintf(name, sizeof(name), "%02d.ico", level);
+		auto images = ReadIcon(TestData("icons") / name);
+		CHECK(images.size() >= 5);
+		for (auto& [size, reference] : images) {
+			icons.SetSize(size);
+			icons.Render((float)level, rendered.data());
+			double sum = 0.0, max_error = 0.0;
+			uint32_t over_8 = 0;
+			for (uint32_t i = 0; i < size * size; i++) {
+				const uint8_t* r = &reference[i * 4];
+				uint32_t p = rendered[i];
+				for (int c = 0; c < 4; c++) {
+					double e = (c == 3) ? fabs((double)r[3] - (p >> 24)) :
+						fabs((double)r[c] * r[3] - (double)((p >> (8 * c)) & 0xff) * (p >> 24)) / 255.0;
+					sum += e;
+					max_error = max(max_error, e);
+					over_8 += (e > 8.0);
+				}
+			}
+			double mean = sum / (size * size * 4), percent_over_8 = 100.0 * over_8 / (size * size * 4);
+			if (mean > MAX_MEAN_ERROR || max_error > MAX_ERROR || percent_over_8 > MAX_ERROR_OVER_8) {
+				fprintf(stderr, "%s at %u px: mean error %.2f, max %.1f, %.2f%% over 8\n", name, size,
+					mean, max_error, percent_over_8);
+				test_failures++;
+			}
+			compared++;
+		}
+	}
+	CHECK_EQ(compared, 21 * 6);
+
+	// Levels are rounded to what the digits can show, and the border follows the level
+	icons.SetSize(32);
+	icons.Render(99.6f, rendered.data());
+	icons.Render(100.0f, other.data());
+	CHECK(memcmp(rendered.data(), other.data(), 32 * 32 * 4) != 0);
+	icons.Render(NAN, rendered.data());
+	icons.Render(0.0f, other.data());
+	CHECK(memcmp(rendered.data(), other.data(), 32 * 32 * 4) == 0);
+	icons.Render(150.0f, rendered.data());
+	icons.Render(100.0f, other.data());
+	CHECK(memcmp(rendered.data(), other.data(), 32 * 32 * 4) == 0);
+
+	// The atlas only gets rebuilt when the size actually changes
+	uint32_t builds = icons.GetStats().atlas_builds;
+	CHECK(!icons.SetSize(32));
+	CHECK(icons.SetSize(8));
+	CHECK_EQ(icons.GetSize(), 16);
+	CHECK(icons.SetSize(1024));
+	CHECK_EQ(icons.GetSize(), ICON_MAX_SIZE);
+	CHECK_EQ(icons.GetStats().atlas_builds, builds + 2);
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,132 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <string.h>
+
+#include "test.hpp"
+#include "nvIdentity.hpp"
+#include "nvStorage.hpp"
+
+// A minimal EDID base block, with the identity fields nvIdentity::Key() uses
+static vector<uint8_t> MakeEdid(uint16_t product, uint32_t serial, const char* serial_string)
+{
+	vector<uint8_t> edid = { 0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x10, 0xac,
+		(uint8_t)product, (uint8_t)(product >> 8),
+		(uint8_t)serial, (uint8_t)(serial >> 8), (uint8_t)(serial >> 16), (uint8_t)(serial >> 24) };
+	edid.resize(EDID_BLOCK_SIZE);
+	if (serial_string != nullptr) {
+		edid[54 + 3] = 0xff;
+		memcpy(&edid[54 + 5], serial_string, strlen(serial_string));
+		edid[54 + 5 + strlen(serial_string)] = '\n';
+	}
+	uint8_t sum = 0;
+	for (size_t i = 0; i < EDID_BLOCK_SIZE - 1; i++)
+		sum += edid[i];
+	edid[EDID_BLOCK_SIZE - 1] = (uint8_t)-sum;
+	return edid;
+}
+
+static uint64_t Key(const vector<uint8_t>& data, uint32_t display_id)
+{
+	nvEdid edid;
+	edid.Parse(data);
+	return nvIdentity::Key(edid, display_id);
+}
+
+int main()
+{
+	nvMemoryStorage memory_storage;
+	storage = &memory_storage;
+
+	// Same model, different serials
+	CHECK(Key(MakeEdid(0x4123, 1, nullptr), 0x1000) != Key(MakeEdid(0x4123, 2, nullptr), 0x1000));
+	CHECK(Key(MakeEdid(0x4123, 0, "ABC"), 0x1000) != Key(MakeEdid(0x4123, 0, "ABD"), 0x1000));
+	CHECK(Key(MakeEdid(0x4123, 1, nullptr), 0x1000) != Key(MakeEdid(0x4124, 1, nullptr), 0x1000));
+	// A monitor with a serial keeps its key whatever port it is connected to
+	CHECK_EQ(Key(MakeEdid(0x4123, 1, nullptr), 0x1000), Key(MakeEdid(0x4123, 1, nullptr), 0x2000));
+	CHECK_EQ(Key(MakeEdid(0x4123, 0, "ABC"), 0x1000), Key(MakeEdid(0x4123, 0, "ABC"), 0x2000));
+	// Whereas identical monitors without any serial must not collide
+	CHECK(Key(MakeEdid(0x4123, 0, nullptr), 0x1000) != Key(MakeEdid(0x4123, 0, nullptr), 0x2000));
+	CHECK_EQ(Key(MakeEdid(0x4123, 0, nullptr), 0x1000), Key(MakeEdid(0x4123, 0, nullptr), 0x1000));
+	// No EDID
+	CHECK_EQ(Key({}, 0x1000), 0xffffffff00001000ULL);
+
+	// Touching a fresh identity records the LUID
+	nvIdentity id;
+	uint64_t key = Key(MakeEdid(0x4123, 1, nullptr), 0x1000);
+	id.Open(key, 0x1000);
+	CHECK(id.GetDisplayIds() == vector<uint32_t>({ 0x1000 }));
+	CHECK(id.GetLuids().empty());
+	CHECK(!id.Touch(0));
+	CHECK(id.Touch(11));
+	CHECK(id.GetLuids() == vector<uint32_t>({ 11 }));
+	CHECK(!id.Touch(11));
+	CHECK(id.Touch(22));
+	CHECK(!id.Touch(11));
+	CHECK(id.GetLuids() == vector<uint32_t>({ 11, 22 }));
+	CHECK(id.Save());
+	CHECK_EQ(memory_storage.GetNumberOfValues(), 1);
+
+	// Least recently seen LUIDs are pruned
+	for (uint32_t luid = 30; luid < 35; luid++)
+		CHECK(id.Touch(luid));
+	CHECK(id.GetLuids() == vector<uint32_t>({ 34, 33, 32, 31 }));
+	CHECK(id.Save());
+
+	// Reopening, through another display ID
+	nvIdentity id2;
+	id2.Open(key, 0x2000);
+	CHECK(id2.GetDisplayIds() == vector<uint32_t>({ 0x2000, 0x1000 }));
+	CHECK(id2.GetLuids() == vector<uint32_t>({ 34, 33, 32, 31 }));
+	CHECK(!id2.Touch(32));
+	CHECK(id2.GetLuids() == vector<uint32_t>({ 32, 34, 33, 31 }));
+
+	// Migration of a legacy LUID list, which gets removed
+	CHECK(storage->WriteMultiStr(L"NVID_0x003000", L"5\0" L"6\0"));
+	nvIdentity id3;
+	id3.Open(Key(MakeEdid(0x5555, 7, nullptr), 0x3000), 0x3000);
+	CHECK(id3.GetLuids() == vector<uint32_t>({ 5, 6 }));
+	CHECK_EQ(memory_storage.GetNumberOfValues(), 2);
+	CHECK(id3.Touch(7));
+	CHECK(id3.GetLuids() == vector<uint32_t>({ 7, 5, 6 }));
+
+	// A longer legacy list gets pruned, but never of the LUID in use
+	CHECK(storage->WriteMultiStr(L"NVID_0x004000", L"1\0" L"2\0" L"3\0" L"4\0" L"5\0" L"9\0"));
+	nvIdentity id4;
+	id4.Open(Key(MakeEdid(0x5555, 8, nullptr), 0x4000), 0x4000, 9);
+	CHECK(id4.GetLuids() == vector<uint32_t>({ 9, 1, 2, 3 }));
+	CHECK_EQ(storage->ReadMultiStr(L"NVID_0x004000")[0], L'\0');
+
+	// LUIDs are pruned by when they were last seen, whatever their order in storage
+	uint64_t key5 = Key(MakeEdid(0x5555, 9, nullptr), 0x5000);
+	uint32_t stored[] = { 0x5000, 41, 100, 42, 300, 43, 200, 44, 50 };
+	uint8_t buf[4 + sizeof(stored)] = { IDENTITY_VERSION, 1, 4, 0 };
+	memcpy(&buf[4], stored, sizeof(stored));
+	wchar_t name[32];
+	swprintf(name, size(name), L"ID_%016llx", (unsigned long long)key5);
+	CHECK(storage->Set(name, STORAGE_BINARY, buf, sizeof(buf)));
+	nvIdentity id5;
+	id5.Open(key5, 0x5000, 45);
+	CHECK(id5.GetLuids() == vector<uint32_t>({ 45, 42, 43, 41 }));
+	CHECK(id5.Save());
+	nvIdentity id6;
+	id6.Open(key5, 0x5000);
+	CHECK(id6.GetLuids() == vector<uint32_t>({ 45, 42, 43, 41 }));
+
+	return TEST_RESULT();
+}
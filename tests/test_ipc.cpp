@@ -0,0 +1,251 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <mutex>
+
+#include "test.hpp"
+#include "nvIpc.hpp"
+
+// A stand-in for what nvBrightness.cpp answers, with two displays
+static nvIpc ipc;
+static mutex display_mutex;
+static float levels[2] = { 50.0f, 60.0f };
+static string inputs[2] = { "HDMI1", "DP1" };
+static vector<size_t> batch_sizes;
+
+static string Level(int display)
+{
+	char s[32];
+	snprintf(s, sizeof(s), "%.1f", levels[display]);
+	return s;
+}
+
+static void Handler(vector<ipc_request_t>& requests)
+{
+	lock_guard<mutex> lock(display_mutex);
+
+	batch_sizes.push_back(requests.size());
+	for (auto& r : requests) {
+		auto& args = r.args;
+		int display = (args.size() >= 2) ? ((args[1] == "active") ? 0 : atoi(args[1].c_str())) : -1;
+		if (args[0] == "list" && args.size() == 1) {
+			r.reply = "ok 2\ndisplay 0 " + Level(0) + " " + inputs[0] + " DELL U2720Q\n" +
+				"display 1 " + Level(1) + " " + inputs[1] + " LG HDR 4K";
+		} else if (display < 0 || display > 1 || (args[1] != "active" && !isdigit(args[1][0]))) {
+			r.reply = "error invalid display";
+		} else if (args[0] == "get" && args.size() == 2) {
+			r.reply = "ok " + Level(display);
+		} else if (args[0] == "set" && args.size() == 3) {
+			levels[display] = clamp(strtof(args[2].c_str(), NULL), 0.0f, 100.0f);
+			r.reply = "ok " + Level(display);
+			ipc.Notify("brightness " + to_string(display) + " " + Level(display));
+		} else if (args[0] == "input" && args.size() == 3) {
+			inputs[display] = args[2];
+			r.reply = "ok " + args[2];
+			ipc.Notify("input " + to_string(display) + " " + args[2]);
+		} else {
+			r.reply = "error invalid request";
+		}
+	}
+}
+
+static int Connect(const filesystem::path& path)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	strcpy(addr.sun_path, path.c_str());
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd >= 0 && connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+		close(fd);
+		fd = -1;
+	}
+	return fd;
+}
+
+static void Send(int fd, const string& data)
+{
+	CHECK_EQ(send(fd, data.data(), data.size(), MSG_NOSIGNAL), data.size());
+}
+
+// Returns the next line, "<timeout>" if nothing came within 2 seconds, or "<closed>"
+static string ReadLine(int fd, string& buffer)
+{
+	char data[1024];
+	size_t end;
+
+	while ((end = buffer.find('\n')) == string::npos) {
+		struct pollfd p = { .fd = fd, .events = POLLIN };
+		if (poll(&p, 1, 2000) <= 0)
+			return "<timeout>";
+		ssize_t n = recv(fd, data, sizeof(data), 0);
+		if (n <= 0)
+			return "<closed>";
+		buffer.append(data, n);
+	}
+	string line = buffer.substr(0, end);
+	buffer.erase(0, end + 1);
+	return line;
+}
+
+static vector<string> ReadLines(int fd, string& buffer, size_t count)
+{
+	vector<string> lines;
+	for (size_t i = 0; i < count; i++)
+		lines.push_back(ReadLine(fd, buffer));
+	return lines;
+}
+
+static void TestProtocol(const filesystem::path& path)
+{
+	string buffer;
+	int fd = Connect(path);
+	CHECK(fd >= 0);
+
+	Send(fd, "list\n");
+	CHECK(ReadLines(fd, buffer, 3) == vector<string>({ "ok 2", "display 0 50.0 HDMI1 DELL U2720Q",
+		"display 1 60.0 DP1 LG HDR 4K" }));
+
+	// Pipelined requests are answered in order, and handed over together
+	batch_sizes.clear();
+	Send(fd, "get 0\nset 1 25\n\nget active\nfoo 0\nget 7\n");
+	CHECK(ReadLines(fd, buffer, 5) == vector<string>({ "ok 50.0", "ok 25.0", "ok 50.0", "error invalid request",
+		"error invalid display" }));
+	CHECK(batch_sizes == vector<size_t>({ 5 }));
+
+	// Requests may also be split anywhere
+	Send(fd, "ge");
+	this_thread::sleep_for(chrono::milliseconds(10));
+	Send(fd, "t 1\n");
+	CHECK(ReadLine(fd, buffer) == "ok 25.0");
+
+	// Batches
+	batch_sizes.clear();
+	Send(fd, "get 0\nbegin\nset 0 10\nset 1 20\ncommit\ncommit\nbegin\nbegin\ncommit\n");
+	CHECK(ReadLines(fd, buffer, 5) == vector<string>({ "ok 50.0", "ok 10.0", "ok 20.0", "error not in a batch",
+		"error already in a batch" }));
+	CHECK(batch_sizes == vector<size_t>({ 1, 2 }));
+	string batch;
+	for (int i = 0; i <= IPC_MAX_BATCH; i++)
+		batch += "get 0\n";
+	Send(fd, "begin\n" + batch + "commit\n");
+	auto lines = ReadLines(fd, buffer, IPC_MAX_BATCH + 1);
+	CHECK(all_of(lines.begin(), lines.end(), [](auto& l) { return l == "error batch too large"; }));
+
+	// Replies are flushed before we disconnect on quit
+	Send(fd, "get 1\nquit\nget 1\n");
+	CHECK(ReadLine(fd, buffer) == "ok 20.0");
+	CHECK(ReadLine(fd, buffer) == "<closed>");
+	close(fd);
+
+	// Lines that never end
+	fd = Connect(path);
+	buffer.clear();
+	Send(fd, "get 0\n" + string(IPC_MAX_LINE + 1, 'x'));
+	CHECK(ReadLine(fd, buffer) == "ok 10.0");
+	CHECK(ReadLine(fd, buffer) == "error line too long");
+	CHECK(ReadLine(fd, buffer) == "<closed>");
+	close(fd);
+}
+
+// Events must get to a subscriber that is only waiting for them, which means that they get
+// written while the server has a read pending on the same connection
+static void TestEvents(const filesystem::path& path)
+{
+	string watch_buffer, buffer;
+	int watcher = Connect(path), fd = Connect(path);
+
+	Send(watcher, "subscribe\n");
+	CHECK(ReadLine(watcher, watch_buffer) == "ok");
+	Send(fd, "set 0 42\ninput 1 HDMI2\n");
+	CHECK(ReadLines(fd, buffer, 2) == vector<string>({ "ok 42.0", "ok HDMI2" }));
+	CHECK(ReadLine(watcher, watch_buffer) == "event brightness 0 42.0");
+	CHECK(ReadLine(watcher, watch_buffer) == "event input 1 HDMI2");
+	// Non subscribers get none
+	Send(fd, "get 0\n");
+	CHECK(ReadLine(fd, buffer) == "ok 42.0");
+	// And a subscriber can keep making requests, with the events interleaved with the replies
+	Send(watcher, "set 1 5\n");
+	auto lines = ReadLines(watcher, watch_buffer, 2);
+	sort(lines.begin(), lines.end());
+	CHECK(lines == vector<string>({ "event brightness 1 5.0", "ok 5.0" }));
+	close(watcher);
+	close(fd);
+}
+
+static void TestLimits(const filesystem::path& path)
+{
+	vector<int> fds;
+	string buffer;
+
+	// Give the server a chance to reap the connections of the previous tests
+	this_thread::sleep_for(chrono::milliseconds(50));
+	for (int i = 0; i < IPC_MAX_CLIENTS; i++) {
+		fds.push_back(Connect(path));
+		Send(fds.back(), "get 0\n");
+		buffer.clear();
+		CHECK(ReadLine(fds.back(), buffer) == "ok 42.0");
+	}
+	int fd = Connect(path);
+	buffer.clear();
+	CHECK(ReadLine(fd, buffer) == "error too many clients");
+	CHECK(ReadLine(fd, buffer) == "<closed>");
+	close(fd);
+	auto stats = ipc.GetStats();
+	CHECK_EQ(stats.max_clients, IPC_MAX_CLIENTS);
+	CHECK(stats.events >= 3);
+	// Stopping with idle clients connected must not wait for them
+	auto start = chrono::steady_clock::now();
+	ipc.Stop();
+	CHECK(ElapsedUs(start) < 1000000.0);
+	for (auto fd : fds) {
+		buffer.clear();
+		CHECK(ReadLine(fd, buffer) == "<closed>");
+		close(fd);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	// With --serve <path>, just serve until stdin gets closed, for the nvbctl.py test
+	if (argc == 3 && strcmp(argv[1], "--serve") == 0) {
+		if (!ipc.Start(argv[2], Handler))
+			return 1;
+		printf("ready\n");
+		fflush(stdout);
+		string line;
+		while (getline(cin, line));
+		ipc.Stop();
+		return 0;
+	}
+
+	auto path = filesystem::temp_directory_path() /
+		("nv_test_ipc_" + to_string(chrono::steady_clock::now().time_since_epoch().count()));
+	CHECK(ipc.Start(path, Handler));
+	TestProtocol(path);
+	TestEvents(path);
+	TestLimits(path);
+	CHECK(!filesystem::exists(path));
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,268 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <signal.h>
+#include <stdarg.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <sstream>
+#include <thread>
+
+#include "test.hpp"
+#include "nvLogFile.hpp"
+#include "nvLogger.hpp"
+
+static filesystem::path dir;
+
+static string ReadFile(const filesystem::path& path)
+{
+	ifstream f(path, ios::binary);
+	return string(istreambuf_iterator<char>(f), {});
+}
+
+// Lines look like "T<thread> N<number> <padding>.", which we check for, and we return the
+// (thread, number) pairs in the order they were found
+static vector<pair<int, int>> ReadLines(const filesystem::path& path, int* bad_lines)
+{
+	vector<pair<int, int>> r;
+	string data = ReadFile(path), line;
+
+	CHECK(data.find('\0') == string::npos);
+	CHECK(data.empty() || data.back() == '\n');
+	stringstream ss(data);
+	while (getline(ss, line)) {
+		int t, n;
+		if (sscanf(line.c_str(), "T%d N%d ", &t, &n) == 2 && line.back() == '.')
+			r.emplace_back(t, n);
+		else
+			(*bad_lines)++;
+	}
+	return r;
+}
+
+static void TestWrites()
+{
+	auto path = dir / "write.log";
+	nvLogFile log;
+	string expected;
+
+	CHECK(log.Open(path));
+	CHECK(log.IsOpen());
+	// Odd sizes, so that writes straddle the segment boundaries
+	for (int i = 0; expected.size() < 3 * LOGFILE_SEGMENT_SIZE; i++) {
+		string line = "Line " + to_string(i) + string(i % 97, '-') + "\n";
+		CHECK(log.Write(line.data(), line.size()));
+		expected += line;
+	}
+	CHECK_EQ(log.GetStats().bytes_written, expected.size());
+	CHECK(log.GetStats().segments_mapped >= 3);
+	log.Close();
+	CHECK(!log.IsOpen());
+	CHECK(!log.Write("x", 1));
+	// The file is trimmed to what was written
+	CHECK(ReadFile(path) == expected);
+
+	// Reopening appends
+	CHECK(log.Open(path));
+	CHECK(log.Write("More\n", 5));
+	log.Close();
+	CHECK(ReadFile(path) == expected + "More\n");
+	CHECK_EQ(log.GetStats().recovered, 0);
+}
+
+static void TestRotation()
+{
+	auto path = dir / "rotate.log";
+	nvLogFile log;
+	char line[128];
+
+	CHECK(log.Open(path, LOGFILE_SEGMENT_SIZE, 2));
+	for (int i = 0; i < 10000; i++) {
+		int len = snprintf(line, sizeof(line), "T0 N%d %.*s.\n", i, i % 50, "..................................................");
+		// Split the line, as the logger sink does for timestamps, which must not rotate in the middle
+		CHECK(log.Write(line, 3, true));
+		CHECK(log.Write(line + 3, len - 3, false));
+	}
+	uint32_t rotations = log.GetStats().rotations;
+	CHECK(rotations >= 4);
+	log.Close();
+
+	CHECK(filesystem::exists(dir / "rotate.1.log"));
+	CHECK(filesystem::exists(dir / "rotate.2.log"));
+	CHECK(!filesystem::exists(dir / "rotate.3.log"));
+	// The kept logs hold complete lines, in sequence, from the oldest to the current one, and
+	// only go over their maximum size by the part of a line that can't be rotated
+	int bad_lines = 0, next = -1;
+	for (auto name : { "rotate.2.log", "rotate.1.log", "rotate.log" }) {
+		CHECK(filesystem::file_size(dir / name) <= LOGFILE_SEGMENT_SIZE + sizeof(line));
+		for (auto& [t, n] : ReadLines(dir / name, &bad_lines)) {
+			CHECK(next < 0 || n == next);
+			next = n + 1;
+		}
+	}
+	CHECK_EQ(bad_lines, 0);
+	CHECK_EQ(next, 10000);
+
+	// A log that is already too large is rotated when opened
+	nvLogFile log2;
+	string big(LOGFILE_SEGMENT_SIZE, 'x');
+	big.back() = '\n';
+	CHECK(log2.Open(dir / "big.log"));
+	CHECK(log2.Write(big.data(), big.size()));
+	log2.Close();
+	CHECK(log2.Open(dir / "big.log", LOGFILE_SEGMENT_SIZE, 0));
+	CHECK_EQ(log2.GetStats().rotations, 1);
+	log2.Close();
+	CHECK_EQ(filesystem::file_size(dir / "big.log"), 0);
+	CHECK(!filesystem::exists(dir / "big.1.log"));
+}
+
+// What a session that didn't close the log leaves behind: the data, then NULs up to the end
+// of the last segment. Reopening trims the NULs and terminates the partial line.
+static void TestRecovery()
+{
+	auto path = dir / "recover.log";
+	{
+		string data = "Line 1\nPartial";
+		data.resize(LOGFILE_SEGMENT_SIZE + 10, '\0');
+		ofstream f(path, ios::binary);
+		f.write(data.data(), data.size());
+	}
+	nvLogFile log;
+	CHECK(log.Open(path));
+	CHECK_EQ(log.GetStats().recovered, 1);
+	CHECK(log.Write("Line 2\n", 7));
+	log.Close();
+	CHECK(ReadFile(path) == "Line 1\nPartial\nLine 2\n");
+}
+
+// Kill writers at random points, which is as bad as it gets short of a power loss, and check
+// that whatever they wrote is still there, without holes, once the log has been recovered
+static void TestCrashConsistency()
+{
+	auto path = dir / "crash.log";
+	const int rounds = 10;
+
+	for (int round = 0; round < rounds; round++) {
+		pid_t pid = fork();
+		if (pid == 0) {
+			nvLogFile log;
+			char line[128];
+			if (!log.Open(path, 256 * 1024, 2))
+				_exit(1);
+			for (int i = 0; ; i++) {
+				int len = snprintf(line, sizeof(line), "T%d N%d xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx.\n", round, i);
+				log.Write(line, 3, true);
+				log.Write(line + 3, len - 3, false);
+			}
+		}
+		CHECK(pid > 0);
+		this_thread::sleep_for(chrono::milliseconds(5 + round * 2));
+		kill(pid, SIGKILL);
+		waitpid(pid, NULL, 0);
+	}
+
+	nvLogFile log;
+	CHECK(log.Open(path, 256 * 1024, 2));
+	CHECK(log.Write("T99 N0 clean close.\n", 20));
+	log.Close();
+
+	// At most one line per kill gets cut, and every round's lines are in sequence
+	int bad_lines = 0, lines = 0;
+	map<int, int> next;
+	for (auto name : { "crash.2.log", "crash.1.log", "crash.log" }) {
+		for (auto& [t, n] : ReadLines(dir / name, &bad_lines)) {
+			CHECK(next.count(t) == 0 || n == next[t]);
+			next[t] = n + 1;
+			lines++;
+		}
+	}
+	CHECK(bad_lines <= rounds);
+	CHECK(lines > rounds);
+	CHECK_EQ(next[99], 1);
+}
+
+// Producers at full speed, through the logger thread, with small logs that keep rotating. They
+// only yield once in a while, so that the logger thread gets to run on single CPU machines.
+static void TestHighRate()
+{
+	const int num_threads = 4, num_messages = 50000;
+	nvLogFile log;
+	nvLogger logger;
+
+	CHECK(log.Open(dir / "rate.log", LOGFILE_SEGMENT_SIZE, 3));
+	logger.Start([&log](chrono::system_clock::time_point, const char* msg, size_t size, bool line_start) {
+		log.Write(msg, size, line_start);
+	});
+	vector<thread> threads;
+	auto log_line = [&logger](const char* format, ...) {
+		va_list args;
+		va_start(args, format);
+		logger.Log(format, args);
+		va_end(args);
+	};
+	for (int t = 0; t < num_threads; t++)
+		threads.emplace_back([&log_line, t] {
+			for (int i = 0; i < num_messages; i++) {
+				log_line("T%d N%d payload payload payload payload.\n", t, i);
+				if (i % 256 == 0)
+					this_thread::yield();
+			}
+		});
+	for (auto& t : threads)
+		t.join();
+	logger.Stop();
+	auto stats = logger.GetStats();
+	CHECK(log.GetStats().rotations > 0);
+	log.Close();
+
+	// Each thread's lines are in order, and the current log ends with the last ones logged
+	int bad_lines = 0;
+	uint64_t lines = 0;
+	vector<int> last(num_threads, -1);
+	for (auto name : { "rate.3.log", "rate.2.log", "rate.1.log", "rate.log" }) {
+		for (auto& [t, n] : ReadLines(dir / name, &bad_lines)) {
+			CHECK(t >= 0 && t < num_threads && n > last[t]);
+			last[t] = n;
+			lines++;
+		}
+	}
+	// Drop reports are the only other lines
+	CHECK(bad_lines == 0 || stats.dropped != 0);
+	CHECK(lines <= stats.logged);
+	for (int t = 0; t < num_threads; t++)
+		CHECK(stats.dropped != 0 || last[t] == num_messages - 1);
+}
+
+int main()
+{
+	dir = filesystem::temp_directory_path() /
+		("nv_test_logfile_" + to_string(chrono::steady_clock::now().time_since_epoch().count()));
+	filesystem::create_directories(dir);
+
+	TestWrites();
+	TestRotation();
+	TestRecovery();
+	TestCrashConsistency();
+	TestHighRate();
+
+	filesystem::remove_all(dir);
+	return TEST_RESULT();
+}
@@ -0,0 +1,171 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdarg.h>
+#include <string.h>
+
+#include <mutex>
+#include <thread>
+
+#include "test.hpp"
+#include "nvLogger.hpp"
+
+typedef struct {
+	string msg;
+	bool line_start;
+} message_t;
+
+// Sink that records everything it gets
+class Sink {
+public:
+	mutex m;
+	vector<message_t> messages;
+	int flushes = 0;
+	logger_write_t Write() {
+		return [this](chrono::system_clock::time_point, const char* msg, size_t size, bool line_start) {
+			lock_guard<mutex> lock(m);
+			messages.push_back({ string(msg, size), line_start });
+		};
+	}
+	function<void()> Flush() { return [this] { lock_guard<mutex> lock(m); flushes++; }; }
+};
+
+static void Log(nvLogger& logger, const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	logger.Log(format, args);
+	va_end(args);
+}
+
+int main()
+{
+	// Messages logged before the sink is set are kept, and delivered in order
+	{
+		Sink sink;
+		nvLogger logger;
+		Log(logger, "early %d\n", 1);
+		Log(logger, "partial ");
+		Log(logger, "line\n");
+		logger.Start(sink.Write(), sink.Flush());
+		logger.Stop();
+		CHECK_EQ(sink.messages.size(), 3);
+		CHECK(sink.messages[0].msg == "early 1\n" && sink.messages[0].line_start);
+		CHECK(sink.messages[1].msg == "partial " && sink.messages[1].line_start);
+		CHECK(sink.messages[2].msg == "line\n" && !sink.messages[2].line_start);
+		CHECK(sink.flushes >= 1);
+	}
+
+	// A full ring drops the messages that don't fit, and says so once it has room again
+	{
+		Sink sink;
+		nvLogger logger(8);
+		for (int i = 0; i < 20; i++)
+			Log(logger, "msg %d\n", i);
+		auto stats = logger.GetStats();
+		CHECK_EQ(stats.logged, 8);
+		CHECK_EQ(stats.dropped, 12);
+		logger.Start(sink.Write());
+		logger.Stop();
+		CHECK_EQ(sink.messages.size(), 9);
+		CHECK(sink.messages[7].msg == "msg 7\n");
+		CHECK(sink.messages[8].msg == "[12 log message(s) dropped]\n");
+		// The ring is usable again
+		Log(logger, "after\n");
+		logger.Stop();
+		CHECK(sink.messages.back().msg == "after\n");
+		CHECK_EQ(logger.GetStats().dropped, 12);
+	}
+
+	// Unless the sink can't take text
+	{
+		Sink sink;
+		nvLogger logger(4, false);
+		for (int i = 0; i < 6; i++)
+			CHECK(logger.Write(&i, sizeof(i)) == (i < 4));
+		logger.Start(sink.Write());
+		logger.Stop();
+		CHECK_EQ(sink.messages.size(), 4);
+		CHECK(sink.messages[3].msg == string("\x03\x00\x00\x00", 4));
+	}
+
+	// Oversized messages
+	{
+		Sink sink;
+		nvLogger logger;
+		string big(LOGGER_MAX_MESSAGE * 2, 'x');
+		Log(logger, "%s", big.c_str());
+		CHECK(!logger.Write(big.data(), LOGGER_MAX_MESSAGE + 1));
+		CHECK(logger.Write(big.data(), LOGGER_MAX_MESSAGE));
+		logger.Start(sink.Write());
+		logger.Stop();
+		CHECK_EQ(logger.GetStats().truncated, 2);
+		CHECK(logger.GetStats().batches != 0);
+		CHECK_EQ(sink.messages.size(), 2);
+		CHECK_EQ(sink.messages[0].msg.size(), LOGGER_MAX_MESSAGE - 1);
+		CHECK_EQ(sink.messages[1].msg.size(), LOGGER_MAX_MESSAGE);
+	}
+
+	// Concurrent producers, against a slow sink: whatever isn't dropped is delivered, in the
+	// order each producer logged it, and everything is drained on exit (here by the destructor)
+	{
+		const int num_threads = 4, num_messages = 20000;
+		Sink sink;
+		uint64_t logged = 0, dropped = 0;
+		{
+			nvLogger logger(64);
+			logger.Start([&](chrono::system_clock::time_point t, const char* msg, size_t size, bool line_start) {
+				if (sink.messages.size() % 1000 == 0)
+					this_thread::sleep_for(chrono::milliseconds(1));
+				sink.Write()(t, msg, size, line_start);
+			});
+			vector<thread> threads;
+			for (int t = 0; t < num_threads; t++)
+				threads.emplace_back([&logger, t] {
+					for (int i = 0; i < num_messages; i++)
+						Log(logger, "T%d N%d\n", t, i);
+				});
+			for (auto& t : threads)
+				t.join();
+			auto stats = logger.GetStats();
+			logged = stats.logged;
+			dropped = stats.dropped;
+		}
+		CHECK_EQ(logged + dropped, num_threads * num_messages);
+		vector<int> last(num_threads, -1);
+		uint64_t received = 0, reported_drops = 0;
+		for (auto& m : sink.messages) {
+			int t, n;
+			unsigned long long d;
+			if (sscanf(m.msg.c_str(), "T%d N%d", &t, &n) == 2 && t >= 0 && t < num_threads) {
+				CHECK(n > last[t]);
+				last[t] = n;
+				received++;
+			} else if (sscanf(m.msg.c_str(), "[%llu log message(s) dropped]", &d) == 1) {
+				reported_drops += d;
+			} else {
+				CHECK(false);
+			}
+			CHECK(m.line_start);
+		}
+		CHECK_EQ(received, logged);
+		CHECK_EQ(reported_drops, dropped);
+	}
+
+	return TEST_RESULT();
+}
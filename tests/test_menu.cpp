@@ -0,0 +1,137 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.hpp"
+#include "tray.h"
+#include "nvMenu.hpp"
+
+static void Select(struct tray_menu*) {}
+static void Switch(struct tray_menu*) {}
+
+// Fake backend, which numbers the items on rebuild, as tray_update() does, and records patches
+static struct tray_menu top[] = { { L"Brightness +", false, false, Switch }, { L"-" }, { L"Input controls" },
+	{ L"Resume to Home", true }, { L"Pause", false, false, Switch }, { NULL } };
+static vector<struct tray_menu*> patched;
+static int rebuilds = 0;
+
+static void Number(struct tray_menu* m, UINT* id)
+{
+	for (; m != NULL && m->text != NULL; m++) {
+		m->id = (*id)++;
+		Number(m->submenu, id);
+	}
+}
+
+static void Rebuild()
+{
+	UINT id = 1000;
+	Number(top, &id);
+	rebuilds++;
+}
+
+static bool Patch(struct tray_menu* m)
+{
+	if (m->id == 0)
+		return false;
+	patched.push_back(m);
+	return true;
+}
+
+static vector<menu_item_t> Inputs(int displays, int active, const wstring& next)
+{
+	vector<menu_item_t> content = { { L"Active display:", true } };
+	for (int i = 0; i < displays; i++)
+		content.push_back({ L"Display " + to_wstring(i), false, i == active, Select, (void*)(intptr_t)i });
+	content.push_back({ L"-" });
+	content.push_back({ L"Next input (" + next + L")", false, false, Switch });
+	return content;
+}
+
+int main()
+{
+	vector<struct tray_menu> inputs = { { NULL } };
+	nvMenu menu;
+
+	// Without a backend, only the model is updated
+	menu.SetSubmenu(&top[2], inputs, Inputs(2, 0, L"DP1"));
+	menu.Commit();
+	CHECK(top[2].submenu == inputs.data());
+	CHECK_EQ(inputs.size(), 6);
+	CHECK(wcscmp(inputs[1].text, L"Display 0") == 0 && inputs[1].checked);
+	CHECK_EQ(menu.GetStats().commits, 0);
+
+	menu.SetBackend(Rebuild, Patch);
+	menu.Invalidate();
+	menu.Commit();
+	CHECK_EQ(rebuilds, 1);
+	CHECK_EQ(inputs[0].id, 1003);
+
+	// Nothing changed, so there's nothing to do
+	menu.SetSubmenu(&top[2], inputs, Inputs(2, 0, L"DP1"));
+	menu.SetText(&top[3], L"Resume to Home");
+	menu.SetDisabled(&top[3], true);
+	menu.Commit();
+	CHECK_EQ(menu.GetStats().commits, 1);
+
+	// Switching displays only patches the two items that changed
+	menu.SetSubmenu(&top[2], inputs, Inputs(2, 1, L"DP1"));
+	menu.Commit();
+	CHECK_EQ(rebuilds, 1);
+	CHECK(patched == vector<struct tray_menu*>({ &inputs[1], &inputs[2] }));
+	CHECK(!inputs[1].checked && inputs[2].checked);
+
+	// The labels are owned by the model, and an item that's changed twice is patched once
+	patched.clear();
+	wstring label = L"Resume to Home (HDMI1)";
+	menu.SetText(&top[3], label);
+	label = L"Something else";
+	menu.SetDisabled(&top[3], false);
+	menu.SetSubmenu(&top[2], inputs, Inputs(2, 1, L"DP2"));
+	menu.Commit();
+	CHECK(patched == vector<struct tray_menu*>({ &top[3], &inputs[4] }));
+	CHECK(wcscmp(top[3].text, L"Resume to Home (HDMI1)") == 0 && !top[3].disabled);
+	CHECK(wcscmp(inputs[4].text, L"Next input (DP2)") == 0);
+	CHECK_EQ(menu.GetStats().patches, 4);
+
+	// A new display changes the structure, and so does an item turning into a separator.
+	// Pending changes to items that go away must not be applied.
+	patched.clear();
+	menu.SetText(&inputs[1], L"Renamed");
+	menu.SetSubmenu(&top[2], inputs, Inputs(3, 1, L"DP2"));
+	menu.Commit();
+	CHECK_EQ(rebuilds, 2);
+	CHECK(patched.empty());
+	CHECK(top[2].submenu == inputs.data() && inputs.size() == 7);
+	auto content = Inputs(3, 1, L"DP2");
+	content[3] = { L"-" };
+	content[4] = { L"Display 2", false, false, Select };
+	menu.SetSubmenu(&top[2], inputs, content);
+	menu.Commit();
+	CHECK_EQ(rebuilds, 3);
+
+	// Items that the backend doesn't know about yet force a rebuild
+	top[4].id = 0;
+	menu.SetText(&top[4], L"Resume");
+	menu.Commit();
+	CHECK_EQ(rebuilds, 4);
+	CHECK(top[4].id != 0);
+	CHECK_EQ(menu.GetStats().rebuilds, 4);
+	CHECK_EQ(menu.GetStats().commits, 6);
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+#
+# nvBrightness - nVidia Control Panel brightness at your fingertips
+#
+# Copyright © 2025 Pete Batard <pete@akeo.ie>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""Run tools/nvbctl.py against the nvIpc UNIX socket server of test_ipc.
+
+Usage: test_nvbctl.py TEST_IPC NVBCTL
+"""
+
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+failures = 0
+
+
+def check(cond, what):
+    global failures
+    if not cond:
+        print(f"FAILED: {what}", file=sys.stderr)
+        failures += 1
+
+
+def main():
+    test_ipc, nvbctl = sys.argv[1:3]
+    path = os.path.join(tempfile.gettempdir(), f"nv_test_nvbctl_{os.getpid()}")
+    server = subprocess.Popen([test_ipc, "--serve", path], stdin=subprocess.PIPE, stdout=subprocess.PIPE, text=True)
+    check(server.stdout.readline().strip() == "ready", "server start")
+
+    def ctl(*args, stdin=None):
+        r = subprocess.run([sys.executable, nvbctl, "--socket", path] + list(args), input=stdin,
+                           capture_output=True, text=True, timeout=10)
+        return r.returncode, r.stdout.splitlines()
+
+    check(ctl("list") == (0, ["ok 2", "display 0 50.0 HDMI1 DELL U2720Q", "display 1 60.0 DP1 LG HDR 4K"]), "list")
+    check(ctl("get", "active") == (0, ["ok 50.0"]), "get")
+    check(ctl("get", "9") == (1, ["error invalid display"]), "get error")
+    check(ctl("set", "1", "30") == (0, ["ok 30.0"]), "set")
+    check(ctl("set", "0", "10", "1", "20") == (0, ["ok 10.0", "ok 20.0"]), "batched set")
+    check(ctl("input", "0", "DP2") == (0, ["ok DP2"]), "input")
+    check(ctl("raw", stdin="get 0\nbegin\nget 1\ncommit\nlist\n") ==
+          (0, ["ok 10.0", "ok 20.0", "ok 2", "display 0 10.0 DP2 DELL U2720Q", "display 1 20.0 DP1 LG HDR 4K"]), "raw")
+
+    # watch runs until interrupted, and must get the events of the changes made by others
+    watch = subprocess.Popen([sys.executable, nvbctl, "--socket", path, "watch"], stdout=subprocess.PIPE, text=True)
+    check(watch.stdout.readline().strip() == "ok", "subscribe")
+    ctl("set", "0", "75")
+    ctl("input", "1", "HDMI2")
+    check(watch.stdout.readline().strip() == "event brightness 0 75.0", "brightness event")
+    check(watch.stdout.readline().strip() == "event input 1 HDMI2", "input event")
+    watch.terminate()
+    watch.wait()
+
+    server.stdin.close()
+    check(server.wait(timeout=10) == 0, "server exit")
+    print("OK" if failures == 0 else "FAILED")
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,83 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <math.h>
+#include <string.h>
+
+#include <random>
+
+#include "test.hpp"
+#include "nvPixels.hpp"
+
+int main()
+{
+	const vector<float> offsets = { -1.0f, -0.78f, -0.35f, -0.2f, -0.001f, 0.0f, 0.2f, 0.35f, 1.0f, 2.0f, NAN };
+	const vector<float> scales = { 0.0f, 0.5f, 0.9f, 1.0f };
+	vector<uint32_t> valid, random(100003);
+	mt19937 rng(42);
+
+	// Every valid premultiplied (color, alpha) pair, plus an invalid pixel, with a count that
+	// leaves a tail for the SIMD version to handle
+	for (uint32_t a = 0; a < 256; a++)
+		for (uint32_t c = 0; c <= a; c++)
+			valid.push_back((a << 24) | (c << 16) | (((c * 7) % (a + 1)) << 8) | (a - c));
+	valid.push_back(0x12345678);
+	for (auto& p : random)
+		p = rng();
+
+	for (auto& source : { valid, random }) {
+		for (float offset : offsets) {
+			for (float scale : scales) {
+				auto simd = source, scalar = source;
+				nvPixels::AdjustBrightness(simd.data(), simd.size(), offset, scale);
+				nvPixels::AdjustBrightnessScalar(scalar.data(), scalar.size(), offset, scale);
+				CHECK(memcmp(simd.data(), scalar.data(), simd.size() * sizeof(uint32_t)) == 0);
+				// Alpha is untouched, and colors never exceed it
+				size_t invalid = 0;
+				for (size_t i = 0; i < simd.size(); i++) {
+					uint32_t alpha = simd[i] >> 24;
+					invalid += (alpha != (source[i] >> 24) || (simd[i] & 0xff) > alpha ||
+						((simd[i] >> 8) & 0xff) > alpha || ((simd[i] >> 16) & 0xff) > alpha);
+				}
+				CHECK_EQ(invalid, 0);
+			}
+		}
+	}
+
+	// On opaque pixels, this is what the GDI+ color matrix we used to apply did, to within one
+	for (float offset : { -0.78f, -0.2f, 0.35f, 1.0f }) {
+		int max_difference = 0;
+		for (uint32_t c = 0; c < 256; c++) {
+			uint32_t p = 0xff000000 | c;
+			nvPixels::AdjustBrightness(&p, 1, offset);
+			int expected = (int)fmin(fmax(c + offset * 255.0f, 0.0f), 255.0f);
+			max_difference = max(max_difference, abs((int)(p & 0xff) - expected));
+		}
+		CHECK(max_difference <= 1);
+	}
+
+	// Valid pixels don't change for an offset of 0 and a scale of 1, and empty buffers are fine
+	valid.pop_back();
+	auto copy = valid;
+	nvPixels::AdjustBrightness(copy.data(), copy.size(), 0.0f);
+	CHECK(copy == valid);
+	nvPixels::AdjustBrightness(nullptr, 0, 0.5f);
+	nvPixels::AdjustBrightnessScalar(nullptr, 0, 0.5f);
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,181 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+
+#include "test.hpp"
+#include "nvPool.hpp"
+
+static bool WaitFor(function<bool()> cond, chrono::milliseconds timeout = chrono::seconds(10))
+{
+	auto start = chrono::steady_clock::now();
+	while (!cond()) {
+		if (chrono::steady_clock::now() - start > timeout)
+			return false;
+		this_thread::sleep_for(chrono::milliseconds(1));
+	}
+	return true;
+}
+
+// Tasks run highest priority first and, for the same priority, in the order they were submitted
+static void TestPriority()
+{
+	nvPool pool(1);
+	promise<void> release;
+	shared_future<void> released = release.get_future().share();
+	mutex order_mutex;
+	vector<int> order;
+	auto record = [&](int n) { return [&, n](stop_token) { lock_guard<mutex> lock(order_mutex); order.push_back(n); }; };
+
+	// The only thread is held by the first task, so that everything after it gets queued
+	pool.Submit([released](stop_token) { released.wait(); }, 0);
+	CHECK(WaitFor([&] { return pool.GetStats().running == 1; }));
+	pool.Submit(record(1), 1);
+	pool.Submit(record(2), 2, POOL_PRIORITY_HIGH);
+	pool.Submit(record(3), 3);
+	uint64_t id = pool.Submit(record(4), 4);
+	pool.Submit(record(5), 5, POOL_PRIORITY_HIGH);
+	pool.SetPriority(id, POOL_PRIORITY_HIGH);
+	CHECK_EQ(pool.GetStats().queued, 5);
+	release.set_value();
+
+	CHECK(WaitFor([&] { return pool.GetStats().completed == 6; }));
+	CHECK(order == vector<int>({ 2, 4, 5, 1, 3 }));
+	auto stats = pool.GetStats();
+	CHECK_EQ(stats.threads, 1);
+	CHECK_EQ(stats.max_queued, 5);
+	CHECK_EQ(stats.queued, 0);
+}
+
+// Tasks on the same bus never overlap, while tasks on different buses run side by side
+static void TestBusLimits()
+{
+	nvPool pool(4, 1);
+	atomic<int> running[2] = { 0, 0 }, max_running[2] = { 0, 0 };
+
+	for (int i = 0; i < 8; i++) {
+		pool.Submit([&, bus = i % 2](stop_token) {
+			int n = ++running[bus];
+			int m = max_running[bus];
+			while (n > m && !max_running[bus].compare_exchange_weak(m, n));
+			this_thread::sleep_for(chrono::milliseconds(5));
+			running[bus]--;
+		}, i % 2);
+	}
+	CHECK(WaitFor([&] { return pool.GetStats().completed == 8; }));
+	CHECK_EQ(max_running[0].load(), 1);
+	CHECK_EQ(max_running[1].load(), 1);
+
+	// Both tasks can only finish if they are running at the same time
+	atomic<int> started = 0;
+	atomic<bool> overlapped[2] = { false, false };
+	for (int bus = 0; bus < 2; bus++) {
+		pool.Submit([&, bus](stop_token) {
+			started++;
+			overlapped[bus] = WaitFor([&] { return started == 2; }, chrono::seconds(5));
+		}, bus);
+	}
+	CHECK(WaitFor([&] { return pool.GetStats().completed == 10; }));
+	CHECK(overlapped[0] && overlapped[1]);
+	CHECK(pool.GetStats().threads <= 4);
+}
+
+// Cancelling a running task asks it to stop and waits for it, while a queued task never runs
+static void TestCancel()
+{
+	nvPool pool(1);
+	atomic<bool> started = false, stopped = false, ran = false;
+
+	uint64_t running_id = pool.Submit([&](stop_token st) {
+		started = true;
+		while (!st.stop_requested())
+			this_thread::sleep_for(chrono::milliseconds(1));
+		stopped = true;
+	}, 0);
+	uint64_t queued_id = pool.Submit([&](stop_token) { ran = true; }, 1);
+	CHECK(WaitFor([&] { return started.load(); }));
+
+	pool.Cancel(queued_id);
+	CHECK_EQ(pool.GetStats().queued, 0);
+	pool.Cancel(running_id);
+	CHECK(stopped);
+	// Cancelling a task that is already gone does nothing
+	pool.Cancel(running_id);
+	pool.Cancel(12345);
+	auto stats = pool.GetStats();
+	CHECK_EQ(stats.cancelled, 2);
+	CHECK_EQ(stats.running, 0);
+	CHECK(WaitFor([&] { return pool.GetStats().completed == 1; }));
+	CHECK(!ran);
+}
+
+// A task that throws is accounted for, and doesn't hold on to its bus or its thread
+static void TestFailure()
+{
+	nvPool pool(1);
+	atomic<bool> ran = false;
+
+	pool.Submit([](stop_token) { throw runtime_error("probe failed"); }, 0);
+	pool.Submit([](stop_token) { throw 42; }, 0);
+	pool.Submit([&](stop_token) { ran = true; }, 0);
+	CHECK(WaitFor([&] { return ran.load(); }));
+	CHECK(WaitFor([&] { return pool.GetStats().completed == 1; }));
+	auto stats = pool.GetStats();
+	CHECK_EQ(stats.failed, 2);
+	CHECK_EQ(stats.running, 0);
+	CHECK_EQ(stats.threads, 1);
+}
+
+// Destroying the pool stops the running tasks and drops the queued ones, without waiting
+// for anything else
+static void TestDestruction()
+{
+	atomic<int> started = 0, stopped = 0, ran = 0;
+	auto start = chrono::steady_clock::now();
+	{
+		nvPool pool(2);
+		for (int bus = 0; bus < 2; bus++) {
+			pool.Submit([&](stop_token st) {
+				started++;
+				while (!st.stop_requested())
+					this_thread::sleep_for(chrono::milliseconds(1));
+				stopped++;
+			}, bus);
+		}
+		for (int i = 0; i < 4; i++)
+			pool.Submit([&](stop_token) { ran++; }, i % 2);
+		CHECK(WaitFor([&] { return started == 2; }));
+		start = chrono::steady_clock::now();
+	}
+	CHECK(chrono::steady_clock::now() - start < chrono::seconds(1));
+	CHECK_EQ(stopped.load(), 2);
+	CHECK_EQ(ran.load(), 0);
+}
+
+int main()
+{
+	TestPriority();
+	TestBusLimits();
+	TestCancel();
+	TestFailure();
+	TestDestruction();
+	return TEST_RESULT();
+}
@@ -0,0 +1,155 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <math.h>
+#include <time.h>
+
+#include "test.hpp"
+#include "nvScheduler.hpp"
+
+typedef vector<pair<wstring, float>> applied_t;
+
+static time_t Local(int year, int month, int day, int hour, int minute)
+{
+	struct tm tm = { .tm_min = minute, .tm_hour = hour, .tm_mday = day, .tm_mon = month - 1,
+		.tm_year = year - 1900, .tm_isdst = -1 };
+	return mktime(&tm);
+}
+
+static string Format(time_t t)
+{
+	char str[32];
+	struct tm tm;
+	localtime_r(&t, &tm);
+	strftime(str, sizeof(str), "%m-%d %H:%M", &tm);
+	return str;
+}
+
+// Run the scheduler from its next occurrence, the way the main loop does
+static vector<string> Run(nvScheduler& scheduler, int count, applied_t& applied)
+{
+	vector<string> times;
+	time_t last = 0;
+
+	for (int i = 0; i < count && scheduler.GetNextTime() != 0; i++) {
+		time_t now = scheduler.GetNextTime();
+		CHECK(now > last);
+		last = now;
+		times.push_back(Format(now));
+		scheduler.Advance(now, [&](const wstring& display, float level) { applied.push_back({ display, level }); });
+	}
+	return times;
+}
+
+static void TestSolar()
+{
+	double minutes;
+
+	// Dublin sunset on the summer solstice is around 21:57 IST, and New York sunrise on the
+	// winter one around 07:16 EST
+	CHECK(nvScheduler::GetSolarMinutes(2025, 6, 21, 53.35, -6.26, false, &minutes));
+	CHECK(fabs(minutes - (20 * 60 + 57)) <= 2.0);
+	CHECK(nvScheduler::GetSolarMinutes(2025, 12, 21, 40.71, -74.0, true, &minutes));
+	CHECK(fabs(minutes - (12 * 60 + 16)) <= 2.0);
+	// No sunrise or sunset during the polar day or night
+	CHECK(!nvScheduler::GetSolarMinutes(2025, 6, 21, 78.2, 15.6, true, &minutes));
+	CHECK(!nvScheduler::GetSolarMinutes(2025, 12, 21, 78.2, 15.6, false, &minutes));
+}
+
+static void TestWeek()
+{
+	nvScheduler scheduler;
+	applied_t applied;
+	auto apply = [&](const wstring& display, float level) { applied.push_back({ display, level }); };
+
+	scheduler.SetLocation(53.35, -6.26);
+	CHECK_EQ(scheduler.Parse(L"* 0 7 * * 1-5 80; * sunset-30 40; DEV1 */15 22-23 * * * 10; bad; "
+		L"* 0 25 * * * 5; DEV2 sunrise 50"), 4);
+	CHECK_EQ(scheduler.GetStats().rules, 4);
+	// Solar rules are invalid without a location
+	nvScheduler nowhere;
+	CHECK_EQ(nowhere.Parse(L"* sunset 40; * sunrise+x 10; * 0 7 * * 1-5 80"), 1);
+
+	// On Monday at noon, the 07:00 rule is more recent than DEV1 at 23:45 on Sunday and than
+	// sunrise, so only it applies
+	time_t now = Local(2025, 6, 16, 12, 0);
+	scheduler.Resync(now, apply);
+	CHECK_EQ(applied.size(), 1);
+	CHECK(applied.size() == 1 && applied[0] == make_pair(wstring(L"*"), 80.0f));
+	CHECK(Format(scheduler.GetNextTime()) == "06-16 21:24");
+
+	applied.clear();
+	time_t end = now + 7 * 86400;
+	while (scheduler.GetNextTime() != 0 && scheduler.GetNextTime() <= end) {
+		now = scheduler.GetNextTime();
+		scheduler.Advance(now, apply);
+	}
+	map<wstring, int> fired;
+	for (auto& [display, level] : applied)
+		fired[display + L"/" + to_wstring((int)level)]++;
+	CHECK_EQ(fired[L"DEV1/10"], 7 * 8);
+	CHECK_EQ(fired[L"DEV2/50"], 7);
+	CHECK_EQ(fired[L"*/40"], 7);
+	CHECK_EQ(fired[L"*/80"], 5);
+	CHECK_EQ(scheduler.GetStats().fired, applied.size());
+}
+
+static void TestDst()
+{
+	nvScheduler scheduler;
+	applied_t applied;
+	auto apply = [&](const wstring& display, float level) { applied.push_back({ display, level }); };
+
+	CHECK_EQ(scheduler.Parse(L"* 30 1-2 * * * 1; * 0 3 * * 0 2"), 2);
+
+	// The clocks go forward at 01:00 on March 30th, so there's no 01:30 that day
+	scheduler.Resync(Local(2025, 3, 29, 12, 0), apply);
+	auto times = Run(scheduler, 8, applied);
+	CHECK(times == vector<string>({ "03-30 02:30", "03-30 03:00", "03-31 01:30", "03-31 02:30",
+		"04-01 01:30", "04-01 02:30", "04-02 01:30", "04-02 02:30" }));
+
+	// They go back at 02:00 on October 26th, and 01:30 only fires once, the first time round
+	scheduler.Resync(Local(2025, 10, 25, 12, 0), apply);
+	time_t first = scheduler.GetNextTime();
+	times = Run(scheduler, 8, applied);
+	CHECK(times == vector<string>({ "10-26 01:30", "10-26 02:30", "10-26 03:00", "10-27 01:30",
+		"10-27 02:30", "10-28 01:30", "10-28 02:30", "10-29 01:30" }));
+	CHECK_EQ(first, Local(2025, 10, 26, 0, 30) + 3600);
+
+	// After a suspend, only the latest rule is applied, and the wheel is rebuilt from there
+	applied.clear();
+	time_t now = Local(2025, 11, 1, 12, 0) + 17;
+	scheduler.Resync(now, apply);
+	CHECK_EQ(applied.size(), 1);
+	CHECK(applied.size() == 1 && applied[0].second == 1.0f);
+	CHECK(Format(scheduler.GetNextTime()) == "11-02 01:30");
+	CHECK_EQ(scheduler.GetStats().resyncs, 3);
+}
+
+int main()
+{
+	// Use Irish time, with its rules spelled out so that we don't depend on tzdata
+	setenv("TZ", "GMT0IST,M3.5.0/1,M10.5.0", 1);
+	tzset();
+
+	TestSolar();
+	TestWeek();
+	TestDst();
+
+	return TEST_RESULT();
+}
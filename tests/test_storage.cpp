@@ -0,0 +1,150 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <string.h>
+
+#include "test.hpp"
+#include "nvStorage.hpp"
+
+static vector<uint8_t> ReadFile(const filesystem::path& path)
+{
+	ifstream f(path, ios::binary);
+	return vector<uint8_t>(istreambuf_iterator<char>(f), {});
+}
+
+static void WriteFile(const filesystem::path& path, const vector<uint8_t>& data)
+{
+	ofstream f(path, ios::binary | ios::trunc);
+	f.write((const char*)data.data(), data.size());
+}
+
+// The semantics all backends must share
+static void TestSemantics(nvStorage& s)
+{
+	uint8_t buf[16];
+
+	CHECK_EQ(s.Read32(L"Missing"), 0);
+	CHECK(s.ReadStr(L"Missing").empty());
+	CHECK_EQ(s.ReadMultiStr(L"Missing").size(), 1);
+
+	CHECK(s.Write32(L"Dword", -42));
+	CHECK_EQ(s.Read32(L"Dword"), -42);
+	CHECK(s.WriteStr(L"String", L"DISPLAY1"));
+	CHECK(s.ReadStr(L"String") == L"DISPLAY1");
+	CHECK(s.WriteMultiStr(L"Multi", L"12\0" L"345\0"));
+	CHECK(s.ReadMultiStr(L"Multi") == wstring(L"12\0" L"345\0", 8));
+	CHECK(s.Set(L"Binary", STORAGE_BINARY, "\x01\x02\x03", 3));
+	CHECK_EQ(s.Get(L"Binary", STORAGE_BINARY, buf, sizeof(buf)), 3);
+	CHECK(memcmp(buf, "\x01\x02\x03", 3) == 0);
+	CHECK_EQ(s.Get(L"Binary", STORAGE_BINARY, buf, 2), 2);
+
+	// Reading a value with a different type gives nothing, as with the registry
+	CHECK_EQ(s.Read32(L"String"), 0);
+	CHECK(s.ReadStr(L"Dword").empty());
+	CHECK_EQ(s.Get(L"Dword", STORAGE_BINARY, buf, sizeof(buf)), 0);
+
+	// Overwriting with a different type
+	CHECK(s.WriteStr(L"Dword", L"x"));
+	CHECK_EQ(s.Read32(L"Dword"), 0);
+	CHECK(s.ReadStr(L"Dword") == L"x");
+
+	CHECK(s.Delete(L"Dword"));
+	CHECK(s.ReadStr(L"Dword").empty());
+
+	const storage_dword_t values[] = { { L"Brightness", 50 }, { L"Contrast", 60 } };
+	CHECK(s.Write32Batch(L"Software\\Color\\1", values));
+	CHECK_EQ(s.Read32(L"Software\\Color\\1\\Brightness"), 50);
+	CHECK_EQ(s.Read32(L"Software\\Color\\1\\Contrast"), 60);
+}
+
+int main()
+{
+	auto dir = filesystem::temp_directory_path() /
+		("nv_test_storage_" + to_string(chrono::steady_clock::now().time_since_epoch().count()));
+	filesystem::create_directories(dir);
+	auto path = dir / "storage.bin";
+
+	nvMemoryStorage memory;
+	TestSemantics(memory);
+	CHECK_EQ(memory.GetNumberOfValues(), 5);
+	CHECK(memory.GetStats().reads != 0 && memory.GetStats().writes != 0);
+
+	// File storage, which must not exist yet
+	{
+		nvFileStorage file;
+		CHECK(!file.Open(path));
+		TestSemantics(file);
+		CHECK(!filesystem::exists(path));
+		CHECK(file.Flush());
+		CHECK(filesystem::exists(path));
+		CHECK_EQ(file.GetStats().flushes, 1);
+		// Nothing changed, so nothing to write
+		CHECK(file.Flush());
+		CHECK_EQ(file.GetStats().flushes, 1);
+		CHECK(file.Write32(L"Last", 7));
+	}
+	// Destroying the storage flushes it, and the snapshot gets renamed over the file
+	CHECK(!filesystem::exists(path.string() + ".tmp"));
+	{
+		nvFileStorage file;
+		CHECK(file.Open(path));
+		CHECK_EQ(file.GetNumberOfValues(), 6);
+		CHECK_EQ(file.Read32(L"Last"), 7);
+		CHECK(file.ReadStr(L"String") == L"DISPLAY1");
+		CHECK(file.ReadMultiStr(L"Multi") == wstring(L"12\0" L"345\0", 8));
+		CHECK_EQ(file.Read32(L"Software\\Color\\1\\Contrast"), 60);
+	}
+
+	// A snapshot that was left half written by a crash doesn't affect the current file
+	auto good = ReadFile(path);
+	WriteFile(path.string() + ".tmp", vector<uint8_t>(good.begin(), good.begin() + good.size() / 2));
+	{
+		nvFileStorage file;
+		CHECK(file.Open(path));
+		CHECK_EQ(file.Read32(L"Last"), 7);
+		CHECK(file.Write32(L"Last", 8));
+		CHECK(file.Flush());
+	}
+	CHECK(!filesystem::exists(path.string() + ".tmp"));
+
+	// Corrupted and truncated files are discarded as a whole, rather than partially used
+	good = ReadFile(path);
+	for (size_t i = 0; i < good.size(); i += 7) {
+		auto bad = good;
+		bad[i] ^= 0x20;
+		WriteFile(path, bad);
+		nvFileStorage file;
+		CHECK(!file.Open(path));
+		CHECK_EQ(file.GetNumberOfValues(), 0);
+	}
+	for (size_t size : { (size_t)0, (size_t)4, good.size() / 2, good.size() - 1 }) {
+		WriteFile(path, vector<uint8_t>(good.begin(), good.begin() + size));
+		nvFileStorage file;
+		CHECK(!file.Open(path));
+		CHECK_EQ(file.GetNumberOfValues(), 0);
+	}
+	WriteFile(path, good);
+	{
+		nvFileStorage file;
+		CHECK(file.Open(path));
+		CHECK_EQ(file.Read32(L"Last"), 8);
+	}
+
+	filesystem::remove_all(dir);
+	return TEST_RESULT();
+}
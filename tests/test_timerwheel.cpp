@@ -0,0 +1,107 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <random>
+
+#include "test.hpp"
+#include "nvTimerWheel.hpp"
+
+// Check the wheel against a multimap, with timers that span every level, jumps that are large
+// enough to trigger a rebuild, and timers that get added from the expiry callback.
+static void TestAgainstReference(uint64_t seed)
+{
+	mt19937_64 rng(seed);
+
+	for (int round = 0; round < 50; round++) {
+		nvTimerWheel wheel;
+		multimap<int64_t, uint64_t> reference;
+		int64_t now = rng() % 100000;
+		uint64_t next_id = 0;
+
+		wheel.Reset(now);
+		for (; next_id < 300; next_id++) {
+			int64_t expiry = now + (int64_t)(rng() % ((round % 2) ? 40000000ULL : 20000ULL));
+			wheel.Add(next_id, expiry);
+			reference.insert({ expiry, next_id });
+		}
+		while (!reference.empty()) {
+			CHECK_EQ(wheel.NextExpiry(), reference.begin()->first);
+			now += (rng() % 4 == 0) ? (int64_t)(rng() % 10000000) : (int64_t)(rng() % 100);
+			int64_t last = INT64_MIN;
+			wheel.Advance(now, [&](uint64_t id, int64_t expiry) {
+				CHECK(expiry <= now);
+				CHECK(expiry >= last);
+				last = expiry;
+				auto it = reference.find(expiry);
+				while (it != reference.end() && it->first == expiry && it->second != id)
+					it++;
+				CHECK(it != reference.end() && it->first == expiry);
+				if (it != reference.end() && it->first == expiry)
+					reference.erase(it);
+				if (rng() % 3 == 0) {
+					int64_t readd = now + 1 + (int64_t)(rng() % 5000);
+					wheel.Add(next_id, readd);
+					reference.insert({ readd, next_id++ });
+				}
+			});
+			CHECK(reference.empty() || reference.begin()->first > now);
+			CHECK_EQ(wheel.Size(), reference.size());
+			if (test_failures != 0)
+				return;
+		}
+		CHECK_EQ(wheel.NextExpiry(), INT64_MAX);
+		auto& stats = wheel.GetStats();
+		CHECK_EQ(stats.added, next_id);
+		CHECK_EQ(stats.expired, next_id);
+		if (round % 2)
+			CHECK(stats.rebuilds > 0);
+	}
+}
+
+int main()
+{
+	nvTimerWheel wheel;
+	vector<uint64_t> expired;
+
+	// Timers that are already due expire on the next advance, even if time didn't move
+	wheel.Reset(1000);
+	wheel.Add(1, 900);
+	wheel.Add(2, 1000);
+	wheel.Add(3, 1001);
+	CHECK_EQ(wheel.NextExpiry(), 900);
+	wheel.Advance(1000, [&](uint64_t id, int64_t) { expired.push_back(id); });
+	CHECK(expired == vector<uint64_t>({ 1, 2 }));
+	CHECK_EQ(wheel.Size(), 1);
+	wheel.Advance(1001, [&](uint64_t id, int64_t) { expired.push_back(id); });
+	CHECK(expired == vector<uint64_t>({ 1, 2, 3 }));
+
+	// Timers far beyond the range of the wheel are parked, and don't expire early
+	expired.clear();
+	wheel.Reset(0);
+	wheel.Add(7, INT64_C(1) << 40);
+	for (int64_t now = 1; now < (INT64_C(1) << 40); now <<= 1)
+		wheel.Advance(now, [&](uint64_t id, int64_t) { expired.push_back(id); });
+	CHECK(expired.empty());
+	wheel.Advance(INT64_C(1) << 40, [&](uint64_t id, int64_t) { expired.push_back(id); });
+	CHECK(expired == vector<uint64_t>({ 7 }));
+
+	TestAgainstReference(1);
+	TestAgainstReference(0x5eed);
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,107 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.hpp"
+#include "nvTiming.hpp"
+
+static string ReadFile(const filesystem::path& path)
+{
+	ifstream f(path, ios::binary);
+	return string(istreambuf_iterator<char>(f), {});
+}
+
+// Nearest-rank: the smallest value that at least p% of the values are less than or equal to
+static void TestPercentile()
+{
+	vector<uint32_t> values;
+	CHECK_EQ(nvTiming::Percentile(values, 50), 0);
+
+	values = { 7 };
+	CHECK_EQ(nvTiming::Percentile(values, 0), 7);
+	CHECK_EQ(nvTiming::Percentile(values, 99), 7);
+
+	values = { 40, 10, 30, 20 };
+	CHECK_EQ(nvTiming::Percentile(values, 0), 10);
+	CHECK_EQ(nvTiming::Percentile(values, 25), 10);
+	CHECK_EQ(nvTiming::Percentile(values, 26), 20);
+	CHECK_EQ(nvTiming::Percentile(values, 50), 20);
+	CHECK_EQ(nvTiming::Percentile(values, 51), 30);
+	CHECK_EQ(nvTiming::Percentile(values, 100), 40);
+	// The values get sorted
+	CHECK(values == vector<uint32_t>({ 10, 20, 30, 40 }));
+
+	values.clear();
+	for (uint32_t i = 100; i >= 1; i--)
+		values.push_back(i);
+	CHECK_EQ(nvTiming::Percentile(values, 50), 50);
+	CHECK_EQ(nvTiming::Percentile(values, 90), 90);
+	CHECK_EQ(nvTiming::Percentile(values, 99), 99);
+	values.push_back(1000);
+	CHECK_EQ(nvTiming::Percentile(values, 99), 100);
+	CHECK_EQ(nvTiming::Percentile(values, 100), 1000);
+}
+
+static void TestDump()
+{
+	auto path = filesystem::temp_directory_path() / ("nv_test_timing_" + to_string(rand()) + ".json");
+
+	// Nothing to dump
+	nvTiming empty;
+	CHECK(empty.Dump(path));
+	CHECK(!filesystem::exists(path));
+
+	// Model names are whatever the monitor says, so they must be escaped, including bytes that
+	// don't make valid UTF-8
+	nvTiming timing;
+	timing.Record("DELL \"U2720Q\"\\", { { 1, 2, 3, 4 }, 0x0f, 0x0f });
+	timing.Record("Caf\xe9\t\x7f", { { 10, 20, 30, 40 }, 0x11, 0 });
+	CHECK(timing.Dump(path));
+	CHECK(ReadFile(path) ==
+		"{\n"
+		"  \"input_switch\": {\n"
+		"    \"Caf\\u00e9\\u0009\x7f\": [\n"
+		"      { \"requested\": 17, \"result\": 0, \"read\": 10, \"compute\": 20, \"write\": 30, \"verify\": 40 }\n"
+		"    ],\n"
+		"    \"DELL \\\"U2720Q\\\"\\\\\": [\n"
+		"      { \"requested\": 15, \"result\": 15, \"read\": 1, \"compute\": 2, \"write\": 3, \"verify\": 4 }\n"
+		"    ]\n"
+		"  }\n"
+		"}\n");
+
+	// Only the most recent samples are kept
+	nvTiming capped;
+	for (uint32_t i = 0; i < TIMING_MAX_SAMPLES + 10; i++)
+		capped.Record("M", { { i, 0, 0, 0 }, 1, 1 });
+	CHECK(capped.Dump(path));
+	string json = ReadFile(path);
+	size_t count = 0;
+	for (size_t pos = 0; (pos = json.find("\"requested\"", pos)) != string::npos; pos++)
+		count++;
+	CHECK_EQ(count, TIMING_MAX_SAMPLES);
+	CHECK(json.find("\"read\": 9,") == string::npos);
+	CHECK(json.find("\"read\": 10,") != string::npos);
+	CHECK(json.find("\"read\": " + to_string(TIMING_MAX_SAMPLES + 9) + ",") != string::npos);
+	filesystem::remove(path);
+}
+
+int main()
+{
+	TestPercentile();
+	TestDump();
+	return TEST_RESULT();
+}
@@ -0,0 +1,80 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.hpp"
+#include "nvBrightness.h"
+#include "nvVcpCache.hpp"
+
+using namespace std::chrono;
+
+int main()
+{
+	nvVcpCache cache;
+	auto t0 = steady_clock::now();
+	uint16_t current = 0, max = 0;
+
+	// Nothing is cached until it has been read
+	CHECK(!cache.Lookup(VCP_LUMINANCE, t0, &current, &max));
+	cache.Update(VCP_LUMINANCE, 40, 100, t0);
+	cache.Update(VCP_INPUT_SOURCE, 0x0f, 0, t0);
+	CHECK(cache.Lookup(VCP_LUMINANCE, t0, &current, &max));
+	CHECK_EQ(current, 40);
+	CHECK_EQ(max, 100);
+	CHECK(cache.Lookup(VCP_INPUT_SOURCE, t0, NULL, NULL));
+
+	// The input can be changed from the OSD, so it doesn't stay fresh as long as the luminance
+	CHECK_EQ(nvVcpCache::GetFreshness(VCP_INPUT_SOURCE), 5000);
+	CHECK_EQ(nvVcpCache::GetFreshness(VCP_LUMINANCE), 30000);
+	CHECK(cache.Lookup(VCP_INPUT_SOURCE, t0 + milliseconds(4999), &current, NULL));
+	CHECK_EQ(current, 0x0f);
+	CHECK(!cache.Lookup(VCP_INPUT_SOURCE, t0 + milliseconds(5000), NULL, NULL));
+	CHECK(cache.Lookup(VCP_LUMINANCE, t0 + milliseconds(29999), NULL, NULL));
+	CHECK(!cache.Lookup(VCP_LUMINANCE, t0 + milliseconds(30000), NULL, NULL));
+	CHECK(!cache.Lookup(VCP_LUMINANCE, t0 + hours(1), NULL, NULL));
+
+	// A new read restarts the freshness window
+	cache.Update(VCP_INPUT_SOURCE, 0x11, 0, t0 + milliseconds(6000));
+	CHECK(cache.Lookup(VCP_INPUT_SOURCE, t0 + milliseconds(10999), &current, NULL));
+	CHECK_EQ(current, 0x11);
+	CHECK(!cache.Lookup(VCP_INPUT_SOURCE, t0 + milliseconds(11000), NULL, NULL));
+
+	// Codes that aren't in the freshness table are never served from the cache
+	CHECK_EQ(nvVcpCache::GetFreshness(0x14), 0);
+	cache.Update(0x14, 5, 11, t0);
+	CHECK(!cache.Lookup(0x14, t0, NULL, NULL));
+
+	// Every code we trust gets prefetched
+	auto codes = nvVcpCache::GetPrefetchCodes();
+	CHECK_EQ(codes.size(), 4);
+	for (auto code : codes)
+		CHECK(nvVcpCache::GetFreshness(code) != 0);
+
+	// Invalidation, of one code or of all of them
+	cache.Update(VCP_CONTRAST, 70, 100, t0);
+	cache.Update(VCP_POWER_MODE, 1, 5, t0);
+	cache.Invalidate(VCP_CONTRAST);
+	CHECK(!cache.Lookup(VCP_CONTRAST, t0, NULL, NULL));
+	CHECK(cache.Lookup(VCP_POWER_MODE, t0, NULL, NULL));
+	cache.InvalidateAll();
+	CHECK(!cache.Lookup(VCP_POWER_MODE, t0, NULL, NULL));
+	CHECK(!cache.Lookup(VCP_LUMINANCE, t0, NULL, NULL));
+
+	// Only the lookups that saved a read count as hits
+	CHECK_EQ(cache.GetHits(), 6);
+	return TEST_RESULT();
+}
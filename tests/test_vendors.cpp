@@ -0,0 +1,63 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "test.hpp"
+#include "vendors.hpp"
+
+// The lookup that vendors.hpp used before the table was built at compile time
+static string GetVendorNameFromMap(const map<string, string>& vendors, uint16_t vendor_id)
+{
+	char vendor_code[4];
+	vendor_id &= 0x7fff;
+	vendor_code[0] = ((vendor_id >> 10) & 0x1F) + 'A' - 1;
+	vendor_code[1] = ((vendor_id >> 5) & 0x1F) + 'A' - 1;
+	vendor_code[2] = (vendor_id & 0x1F) + 'A' - 1;
+	vendor_code[3] = '\0';
+	auto it = vendors.find(vendor_code);
+	return (it == vendors.end()) ? string(vendor_code) : it->second;
+}
+
+int main()
+{
+	map<string, string> vendors;
+	string_view previous;
+
+	for (auto& v : vendor_table) {
+		// Sorted, with no duplicates, as gen_vendors.py generates it
+		CHECK(previous < v.code);
+		previous = v.code;
+		CHECK(!v.name.empty() && v.name != v.code);
+		vendors.emplace(v.code, v.name);
+	}
+	CHECK_EQ(vendors.size(), size(vendor_table));
+
+	// Every possible 16-bit ID, including the ones with the reserved top bit set
+	int mismatches = 0;
+	for (uint32_t id = 0; id <= UINT16_MAX; id++) {
+		string expected = GetVendorNameFromMap(vendors, (uint16_t)id);
+		if (GetVendorName((uint16_t)id) != expected && mismatches++ < 10)
+			fprintf(stderr, "0x%04x: '%s' != '%s'\n", id, GetVendorName((uint16_t)id).c_str(), expected.c_str());
+	}
+	CHECK_EQ(mismatches, 0);
+
+	CHECK(GetVendorName(PackVendorCode("DEL")) == "Dell");
+	CHECK(GetVendorName(PackVendorCode("IBM")) == "IBM");
+	CHECK(GetVendorName(0) == "@@@");
+
+	return TEST_RESULT();
+}
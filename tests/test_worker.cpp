@@ -0,0 +1,124 @@
+/*
+ * nvBrightness - nVidia Control Panel brightness at your fingertips
+ *
+ * Copyright © 2025 Pete Batard <pete@akeo.ie>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <atomic>
+#include <future>
+
+#include "test.hpp"
+#include "nvWorker.hpp"
+
+// The worker only ever passes display pointers around
+class nvDisplay {};
+
+int main()
+{
+	nvDisplay displays[2];
+	promise<void> release;
+	shared_future<void> released = release.get_future().share();
+	atomic<int> notifications = 0;
+	vector<worker_command_t> completed;
+	nvWorker worker;
+
+	// The first command holds the worker, so that everything after it gets queued
+	worker.Start([released](worker_command_t& cmd) {
+		if (cmd.command == wcRestoreGamma)
+			released.wait();
+		cmd.result = cmd.command;
+	}, [&notifications] { notifications++; });
+	worker.Post({ .command = wcRestoreGamma });
+	this_thread::sleep_for(chrono::milliseconds(20));
+
+	// Display updates posted while one is queued are folded into it, and say how many
+	for (int i = 0; i < 3; i++)
+		worker.Post({ .command = wcUpdateDisplays });
+	for (int i = 0; i < 5; i++)
+		worker.Post({ .command = wcChangeBrightness, .display = &displays[0], .delta = 1.0f });
+	worker.Post({ .command = wcChangeBrightness, .display = &displays[1], .delta = -2.0f });
+	worker.Post({ .command = wcSetLevel, .display = &displays[1], .level = 10.0f });
+	worker.Post({ .command = wcSetLevel, .display = &displays[1], .level = 20.0f });
+	// Input switches are never merged
+	worker.Post({ .command = wcSetInput, .display = &displays[0], .input = 0x0f });
+	worker.Post({ .command = wcSetInput, .display = &displays[0], .input = 0x11 });
+	release.set_value();
+
+	worker_command_t cmd;
+	auto start = chrono::steady_clock::now();
+	while (completed.size() < 7 && chrono::steady_clock::now() - start < chrono::seconds(10)) {
+		if (worker.GetCompleted(&cmd))
+			completed.push_back(cmd);
+		else
+			this_thread::sleep_for(chrono::milliseconds(1));
+	}
+	worker.Stop();
+	CHECK(notifications > 0);
+	auto stats = worker.GetStats();
+	CHECK_EQ(stats.posted, 14);
+	CHECK_EQ(stats.merged, 7);
+	CHECK_EQ(stats.completed, 7);
+	CHECK_EQ(stats.max_queued, 6);
+
+	// Completions come back in order, and account for every post
+	vector<uint32_t> commands;
+	uint32_t total = 0;
+	for (auto& c : completed) {
+		commands.push_back(c.command);
+		CHECK_EQ(c.result, c.command);
+		total += 1 + c.merged;
+	}
+	CHECK(commands == vector<uint32_t>({ wcRestoreGamma, wcUpdateDisplays, wcChangeBrightness, wcChangeBrightness,
+		wcSetLevel, wcSetInput, wcSetInput }));
+	CHECK_EQ(total, stats.posted);
+
+	// Which is what the UI thread relies on to know when the last display update is done
+	int pending_display_updates = 3;
+	for (auto& c : completed)
+		if (c.command == wcUpdateDisplays)
+			pending_display_updates -= 1 + (int)c.merged;
+	CHECK_EQ(pending_display_updates, 0);
+
+	for (auto& c : completed) {
+		if (c.command == wcChangeBrightness && c.display == &displays[0]) {
+			CHECK_EQ(c.merged, 4);
+			CHECK(c.delta == 5.0f);
+		} else if (c.command == wcChangeBrightness) {
+			CHECK_EQ(c.merged, 0);
+			CHECK(c.delta == -2.0f);
+		} else if (c.command == wcSetLevel) {
+			CHECK_EQ(c.merged, 1);
+			CHECK(c.level == 20.0f);
+		} else if (c.command == wcSetInput) {
+			CHECK_EQ(c.merged, 0);
+		}
+	}
+
+	// Synchronous mode runs commands from Post(), and never merges
+	nvWorker sync_worker;
+	int runs = 0;
+	sync_worker.Start([&runs](worker_command_t& cmd) { runs++; cmd.result = 1; }, [] {}, true);
+	for (int i = 0; i < 3; i++)
+		sync_worker.Post({ .command = wcUpdateDisplays });
+	CHECK_EQ(runs, 3);
+	int sync_completed = 0;
+	while (sync_worker.GetCompleted(&cmd)) {
+		CHECK_EQ(cmd.merged, 0);
+		sync_completed++;
+	}
+	CHECK_EQ(sync_completed, 3);
+
+	return TEST_RESULT();
+}
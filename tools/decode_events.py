@@ -0,0 +1,182 @@
+#!/usr/bin/env python3
+#
+# nvBrightness - nVidia Control Panel brightness at your fingertips
+#
+# Copyright © 2025 Pete Batard <pete@akeo.ie>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""Decode the binary event log (nvBrightness.evl) that is produced when the
+BinaryLog registry setting is enabled.
+
+The event IDs, names and formats are read from the EVENT_LIST of
+src/nvEventLog.hpp, so this tool must be used with the header that matches
+the version of the application that produced the log.
+
+Usage: decode_events.py [--header nvEventLog.hpp] [--json] [--stats]
+                        [--event NAME_OR_ID] [--display ID] nvBrightness.evl
+"""
+
+import argparse
+import datetime
+import json
+import os
+import re
+import struct
+import sys
+
+MAGIC = b"nvEV"
+VERSION = 1
+HEADER_SIZE = 8
+
+DEFAULT_HEADER = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "src", "nvEventLog.hpp")
+EVENT_RE = re.compile(r'^\s*X\(\s*(\d+)\s*,\s*(\w+)\s*,\s*(\w+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)')
+# printf conversions, of which we drop the length modifiers, and turn %S into %s
+CONV_RE = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)(?:hh|h|ll|l|z|I64)?([diuxXfcsS%])")
+
+
+def load_events(path):
+    events = {}
+    with open(path, encoding="utf-8") as f:
+        for line in f:
+            m = EVENT_RE.match(line)
+            if m is None:
+                continue
+            fmt = m.group(4).encode("utf-8").decode("unicode_escape").encode("latin-1").decode("utf-8")
+            events[int(m.group(1))] = {"name": m.group(2), "flags": m.group(3), "format": fmt}
+    if not events:
+        sys.exit(f"No events found in {path}")
+    return events
+
+
+def render(fmt, args):
+    def conv(m):
+        flags, spec = m.group(1), m.group(2)
+        if spec == "%":
+            return "%%"
+        return "%" + flags + ("s" if spec == "S" else spec)
+    try:
+        return CONV_RE.sub(conv, fmt) % tuple(args)
+    except (TypeError, ValueError):
+        return fmt.rstrip("\n") + " " + repr(args) + "\n"
+
+
+def read_args(data, pos, count):
+    args = []
+    for _ in range(count):
+        t = chr(data[pos])
+        pos += 1
+        if t in "iu":
+            args.append(struct.unpack_from("<i" if t == "i" else "<I", data, pos)[0])
+            pos += 4
+        elif t in "IU":
+            args.append(struct.unpack_from("<q" if t == "I" else "<Q", data, pos)[0])
+            pos += 8
+        elif t == "f":
+            args.append(struct.unpack_from("<f", data, pos)[0])
+            pos += 4
+        elif t == "s":
+            n = struct.unpack_from("<H", data, pos)[0]
+            args.append(data[pos + 2:pos + 2 + n].decode("utf-8", "replace"))
+            pos += 2 + n
+        elif t == "S":
+            n = struct.unpack_from("<H", data, pos)[0]
+            args.append(data[pos + 2:pos + 2 + 2 * n].decode("utf-16-le", "replace"))
+            pos += 2 + 2 * n
+        else:
+            raise ValueError(f"unknown argument type {t!r}")
+    return args
+
+
+def records(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) < HEADER_SIZE or data[:4] != MAGIC:
+        sys.exit(f"{path} is not an nvBrightness event log")
+    version = struct.unpack_from("<H", data, 4)[0]
+    if version != VERSION:
+        sys.exit(f"{path} is version {version}, but this tool only supports version {VERSION}")
+    pos = HEADER_SIZE
+    while pos + 2 <= len(data):
+        size = struct.unpack_from("<H", data, pos)[0]
+        end = pos + 2 + size
+        if size < 15 or end > len(data):
+            # A record that was being written when the application (or the system) died
+            print(f"Truncated record at offset {pos}", file=sys.stderr)
+            break
+        us, event_id, display_id, argc = struct.unpack_from("<QHIB", data, pos + 2)
+        try:
+            args = read_args(data[:end], pos + 17, argc)
+        except (ValueError, struct.error, IndexError):
+            print(f"Invalid record at offset {pos}", file=sys.stderr)
+            args = []
+        yield us, event_id, display_id, args
+        pos = end
+
+
+def timestamp(us):
+    return datetime.datetime.fromtimestamp(us / 1e6).strftime("%Y-%m-%d %H:%M:%S.%f")[:-3]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode an nvBrightness binary event log")
+    parser.add_argument("log", help="binary event log (nvBrightness.evl)")
+    parser.add_argument("--header", default=DEFAULT_HEADER, help="nvEventLog.hpp to read the events from")
+    parser.add_argument("--json", action="store_true", help="output one JSON object per event")
+    parser.add_argument("--stats", action="store_true", help="only output per-event statistics")
+    parser.add_argument("--event", action="append", help="only decode this event (name or ID)")
+    parser.add_argument("--display", type=lambda s: int(s, 0), help="only decode events for this display ID")
+    opts = parser.parse_args()
+
+    events = load_events(opts.header)
+    wanted = None
+    if opts.event:
+        names = {e["name"]: i for i, e in events.items()}
+        wanted = {int(e, 0) if e[0].isdigit() else names.get(e, -1) for e in opts.event}
+
+    stats = {}
+    for us, event_id, display_id, args in records(opts.log):
+        if wanted is not None and event_id not in wanted:
+            continue
+        if opts.display is not None and display_id != opts.display:
+            continue
+        ev = events.get(event_id, {"name": f"event{event_id}", "format": ""})
+        if opts.stats:
+            s = stats.setdefault(event_id, {"count": 0, "first": us, "last": us, "displays": set()})
+            s["count"] += 1
+            s["last"] = us
+            s["displays"].add(display_id)
+        elif opts.json:
+            print(json.dumps({"time": us, "event": ev["name"], "id": event_id,
+                              "display": f"0x{display_id:08x}", "args": args}, ensure_ascii=False))
+        else:
+            msg = render(ev["format"], args) if ev["format"] else f"{args}\n"
+            print(f"{timestamp(us)} [0x{display_id:08x}] {ev['name']}: {msg}", end="")
+
+    if opts.stats:
+        total = sum(s["count"] for s in stats.values())
+        print(f"{total} event(s)")
+        print(f"{'Event':<28}{'Count':>8}{'%':>7}{'Rate/h':>12}  {'Displays':>8}  First - Last")
+        for event_id, s in sorted(stats.items(), key=lambda kv: -kv[1]["count"]):
+            name = events.get(event_id, {"name": f"event{event_id}"})["name"]
+            hours = (s["last"] - s["first"]) / 3.6e9
+            # A rate over less than a minute doesn't tell us much
+            rate = f"{s['count'] / hours:.1f}" if hours >= 1 / 60 else "-"
+            print(f"{name:<28}{s['count']:>8}{100.0 * s['count'] / total:>7.1f} {rate:>11}  {len(s['displays']):>8}  "
+                  f"{timestamp(s['first'])} - {timestamp(s['last'])}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,236 @@
+#!/usr/bin/env python3
+#
+# nvBrightness - nVidia Control Panel brightness at your fingertips
+#
+# Copyright © 2025 Pete Batard <pete@akeo.ie>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""Regenerate src/icons.hpp, which holds the geometry that the tray icons are
+rendered from, from the SVGs of the icons directory.
+
+The SVGs for each 5% of brightness all share the same frame and digit glyphs,
+so we extract the frame from 00.svg, the glyph of each digit from whichever
+icon has it, and where the digits go from 00.svg (two digits), 10.svg (two
+digits, starting with a narrow 1) and 100.svg (three digits). All the paths
+are converted to contours made of absolute cubic Bézier segments.
+
+The shade of the frame border is checked to be proportional to the level, as
+the renderer only needs the shade at 100%.
+
+Usage: gen_icons.py [--dry-run]
+"""
+
+import argparse
+import os
+import re
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+ICONS = os.path.join(ROOT, "icons")
+HEADER = os.path.join(ROOT, "src", "icons.hpp")
+
+GROUP = re.compile(r'<g id="(\w+)" transform="(\w+)\(([^)]*)\)">(.*?)</g>', re.S)
+PATH = re.compile(r'<path fill="#([0-9a-fA-F]{6})" d="([^"]*)"')
+VIEWBOX = re.compile(r'viewBox="([^"]*)"')
+TOKEN = re.compile(r"[MmLlHhVvCcSsZz]|[-+]?(?:\d+\.?\d*|\.\d+)(?:[eE][-+]?\d+)?")
+POSITIONS = ("hundreds", "tens", "ones")
+
+
+def read_svg(level):
+    with open(os.path.join(ICONS, f"{level:02d}.svg"), encoding="utf-8") as f:
+        svg = f.read()
+    groups = {}
+    for gid, kind, args, body in GROUP.findall(svg):
+        values = [float(v) for v in re.split(r"[ ,]+", args.strip())]
+        if kind == "translate":
+            matrix = (1.0, 0.0, 0.0, 1.0, values[0], values[1] if len(values) > 1 else 0.0)
+        elif kind == "matrix":
+            matrix = tuple(values)
+        else:
+            sys.exit(f"{level:02d}.svg: Unsupported transform '{kind}'")
+        groups[gid] = (matrix, PATH.findall(body))
+    return [float(v) for v in VIEWBOX.search(svg).group(1).split()], groups
+
+
+def parse_path(d):
+    """Return the contours of an SVG path, as lists of points, that start with the first
+    point of the contour, followed by 3 points for each cubic segment."""
+    tokens = TOKEN.findall(d)
+    contours, contour = [], None
+    x = y = sx = sy = 0.0
+    last_ctrl = None
+    cmd, i = None, 0
+
+    def num():
+        nonlocal i
+        i += 1
+        return float(tokens[i - 1])
+
+    def line_to(nx, ny):
+        contour.extend([(x + (nx - x) / 3, y + (ny - y) / 3), (x + 2 * (nx - x) / 3, y + 2 * (ny - y) / 3), (nx, ny)])
+
+    while i < len(tokens):
+        if tokens[i].isalpha():
+            cmd = tokens[i]
+            i += 1
+        elif cmd is None:
+            sys.exit(f"Invalid path data: {d}")
+        rel = cmd.islower()
+        ox, oy = (x, y) if rel else (0.0, 0.0)
+        c = cmd.upper()
+        ctrl = None
+        if c == "M":
+            x, y = ox + num(), oy + num()
+            sx, sy = x, y
+            contour = [(x, y)]
+            contours.append(contour)
+            # Subsequent pairs are implicit line-tos
+            cmd = "l" if rel else "L"
+        elif c == "Z":
+            if (x, y) != (sx, sy):
+                line_to(sx, sy)
+            x, y = sx, sy
+        elif c in "LHV":
+            nx = ox + num() if c != "V" else x
+            ny = oy + num() if c != "H" else y
+            line_to(nx, ny)
+            x, y = nx, ny
+        elif c == "C":
+            x1, y1, x2, y2, nx, ny = ox + num(), oy + num(), ox + num(), oy + num(), ox + num(), oy + num()
+            contour.extend([(x1, y1), (x2, y2), (nx, ny)])
+            x, y, ctrl = nx, ny, (x2, y2)
+        elif c == "S":
+            x1, y1 = (2 * x - last_ctrl[0], 2 * y - last_ctrl[1]) if last_ctrl else (x, y)
+            x2, y2, nx, ny = ox + num(), oy + num(), ox + num(), oy + num()
+            contour.extend([(x1, y1), (x2, y2), (nx, ny)])
+            x, y, ctrl = nx, ny, (x2, y2)
+        last_ctrl = ctrl
+    for contour in contours:
+        if contour[-1] != contour[0]:
+            x, y = contour[-1]
+            line_to(*contour[0])
+    return contours
+
+
+def transform(contours, m):
+    return [[(m[0] * x + m[2] * y + m[4], m[1] * x + m[3] * y + m[5]) for x, y in c] for c in contours]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--dry-run", action="store_true", help="don't write the header")
+    args = parser.parse_args()
+
+    viewbox, frame_svg = read_svg(0)
+    frame_matrix, frame_paths = frame_svg["frame"]
+    if len(frame_paths) != 2:
+        sys.exit("00.svg: Expected the frame to have a border and a background")
+    border = transform(parse_path(frame_paths[0][1]), frame_matrix)
+    background = transform(parse_path(frame_paths[1][1]), frame_matrix)
+    background_color = int(frame_paths[1][0], 16)
+
+    glyphs, digit_color, layouts, shades = {}, None, {}, {}
+    for level in range(0, 101, 5):
+        vb, groups = read_svg(level)
+        if vb != viewbox:
+            sys.exit(f"{level:02d}.svg: Unexpected viewBox")
+        shades[level] = int(groups["frame"][1][0][0][:2], 16)
+        digits = str(level).zfill(2)
+        positions = POSITIONS[-len(digits):]
+        layout = tuple(groups[p][0][4] for p in positions)
+        key = "hundreds" if len(digits) == 3 else ("teens" if digits[0] == "1" else "normal")
+        if layouts.setdefault(key, layout) != layout:
+            sys.exit(f"{level:02d}.svg: Inconsistent digit positions for '{key}'")
+        for digit, position in zip(digits, positions):
+            matrix, paths = groups[position]
+            digit_color = int(paths[0][0], 16)
+            contours = [c for _, d in paths for c in parse_path(d)]
+            if glyphs.setdefault(digit, contours) != contours:
+                sys.exit(f"{level:02d}.svg: Glyph for '{digit}' differs from the other icons")
+            y = matrix[5]
+    if sorted(glyphs) != [str(d) for d in range(10)]:
+        sys.exit("Missing digit glyphs")
+    for level, shade in shades.items():
+        if abs(shade - shades[100] * level / 100) > 1:
+            sys.exit(f"{level:02d}.svg: Frame shade 0x{shade:02x} isn't proportional to the level")
+
+    points, contours, shapes = [], [], []
+    for shape in [border, background] + [glyphs[str(d)] for d in range(10)]:
+        shapes.append((len(contours), len(shape)))
+        for contour in shape:
+            contours.append((len(points), len(contour)))
+            points.extend(contour)
+
+    def fmt(v):
+        s = f"{v:.4f}".rstrip("0")
+        return s + ("0f" if s.endswith(".") else "f")
+
+    out = []
+    out.append("/*\n * nvBrightness - nVidia Control Panel brightness at your fingertips\n *\n"
+               " * Copyright © 2025 Pete Batard <pete@akeo.ie>\n *\n"
+               " * This program is free software: you can redistribute it and/or modify\n"
+               " * it under the terms of the GNU General Public License as published by\n"
+               " * the Free Software Foundation, either version 3 of the License, or\n"
+               " * (at your option) any later version.\n *\n"
+               " * This program is distributed in the hope that it will be useful,\n"
+               " * but WITHOUT ANY WARRANTY; without even the implied warranty of\n"
+               " * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the\n"
+               " * GNU General Public License for more details.\n *\n"
+               " * You should have received a copy of the GNU General Public License\n"
+               " * along with this program.  If not, see <http://www.gnu.org/licenses/>.\n */\n\n")
+    out.append("// Geometry of the tray icons, generated by tools/gen_icons.py from icons/*.svg, so edit\n"
+               "// these (and rerun the script) rather than this file. Coordinates are in viewBox units.\n\n")
+    out.append("#pragma once\n\n#include <stdint.h>\n\n")
+    out.append(f"#define ICON_VIEWBOX_X              {fmt(viewbox[0])}\n")
+    out.append(f"#define ICON_VIEWBOX_Y              {fmt(viewbox[1])}\n")
+    out.append(f"#define ICON_VIEWBOX_SIZE           {fmt(viewbox[2])}\n")
+    out.append(f"// The border shade is proportional to the level, and this is its value at 100%\n")
+    out.append(f"#define ICON_BORDER_MAX_SHADE       0x{shades[100]:02x}\n")
+    out.append(f"#define ICON_BACKGROUND_COLOR       0x{background_color:06x}\n")
+    out.append(f"#define ICON_DIGIT_COLOR            0x{digit_color:06x}\n")
+    out.append(f"#define ICON_DIGIT_Y                {fmt(y)}\n\n")
+    out.append("// Shapes\nenum {\n\tisBorder = 0,\n\tisBackground,\n\tisDigit0,\n\tisMax = isDigit0 + 10\n};\n\n")
+    out.append("// Digit layouts\nenum {\n\tilNormal = 0,               // Two digits\n"
+               "\tilTeens,                    // Two digits, starting with a narrow 1\n"
+               "\tilHundreds,                 // Three digits\n\tilMax\n};\n\n")
+    out.append("typedef struct {\n\tuint16_t first;\n\tuint16_t count;\n} icon_range_t;\n\n")
+    out.append("// Where the digits go, from left to right\nstatic constexpr float icon_digit_x[ilMax][3] = {\n")
+    for key in ("normal", "teens", "hundreds"):
+        out.append("\t{ " + ", ".join(fmt(x) for x in layouts[key]) + " },\n")
+    out.append("};\n\n")
+    out.append("// The contours of each shape\nstatic constexpr icon_range_t icon_shapes[isMax] = {\n")
+    for first, count in shapes:
+        out.append(f"\t{{ {first}, {count} }},\n")
+    out.append("};\n\n")
+    out.append("// The points of each contour\nstatic constexpr icon_range_t icon_contours[] = {\n")
+    for first, count in contours:
+        out.append(f"\t{{ {first}, {count} }},\n")
+    out.append("};\n\n")
+    out.append("// Each contour is a start point, followed by the 2 control points and the end point of each\n"
+               "// of its cubic Bézier segments\nstatic constexpr float icon_points[][2] = {\n")
+    for x, y in points:
+        out.append(f"\t{{ {fmt(x)}, {fmt(y)} }},\n")
+    out.append("};\n")
+    text = "".join(out)
+
+    print(f"{len(shapes)} shapes, {len(contours)} contours, {len(points)} points")
+    if not args.dry_run:
+        with open(HEADER, "w", encoding="utf-8", newline="\n") as f:
+            f.write(text)
+
+
+if __name__ == "__main__":
+    main()
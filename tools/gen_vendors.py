@@ -0,0 +1,191 @@
+#!/usr/bin/env python3
+#
+# nvBrightness - nVidia Control Panel brightness at your fingertips
+#
+# Copyright © 2025 Pete Batard <pete@akeo.ie>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""Regenerate the vendor table of src/vendors.hpp.
+
+Inputs:
+  - A local copy of the UEFI PNP ID registry, as the CSV export from
+    https://uefi.org/PNP_ID_List (columns: Company, PNP ID, Approved On Date).
+    This is optional: without it, the table is rebuilt from the overrides only.
+  - tools/vendors_overrides.txt, which holds our condensed vendor names (see the
+    comment at the top of src/vendors.hpp for the rules) as "CODE<TAB>Name" lines.
+    A name of "-" means that the 3 letter code should be reported as is, and
+    anything after a '#' is a comment, which is carried over to the header.
+
+PNP IDs that have no override are listed in the report, along with a suggested
+condensed name, but are only added to the table with --add-new, since the names
+are meant to be reviewed by a human. A diff against the current table is always
+printed, and nothing gets written with --dry-run.
+
+Usage: gen_vendors.py [--pnp PNP_ID_List.csv] [--add-new] [--dry-run]
+"""
+
+import argparse
+import csv
+import os
+import re
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+HEADER = os.path.join(ROOT, "src", "vendors.hpp")
+OVERRIDES = os.path.join(ROOT, "tools", "vendors_overrides.txt")
+
+TABLE_START = "static constexpr vendor_t vendor_table[] = {\n"
+TABLE_END = "};\n"
+ENTRY = re.compile(r'^\t\{ "([A-Z@]{3})", "((?:[^"\\]|\\.)*)" \},(?:\t// (.*))?$')
+CODE = re.compile(r"^[A-Z@]{3}$")
+
+# Words that don't help identifying a company, and that we drop when suggesting names
+NOISE = {"inc", "inc.", "ltd", "ltd.", "llc", "co", "co.", "corp", "corp.", "corporation", "company",
+         "gmbh", "ag", "sa", "s.a.", "bv", "b.v.", "plc", "limited", "the", "&", "and", "of"}
+
+
+def read_table(path):
+    """Return the {code: name} table from a generated header, along with the text around it."""
+    with open(path, encoding="utf-8", newline="") as f:
+        text = f.read()
+    start = text.index(TABLE_START) + len(TABLE_START)
+    end = text.index(TABLE_END, start)
+    table = {}
+    for line in text[start:end].splitlines():
+        m = ENTRY.match(line)
+        if m is None:
+            sys.exit(f"Unexpected line in {path}: {line!r}")
+        table[m.group(1)] = m.group(2).encode().decode("unicode_escape").encode("latin-1").decode()
+    return table, text[:start], text[end:]
+
+
+def read_overrides(path):
+    """Return the {code: name} overrides, and the {code: comment} comments."""
+    overrides = {}
+    comments = {}
+    with open(path, encoding="utf-8") as f:
+        for n, line in enumerate(f, 1):
+            line = line.rstrip("\r\n")
+            if line.strip() == "" or line.startswith("#"):
+                continue
+            code, sep, name = line.partition("\t")
+            name, _, comment = name.partition("#")
+            name = name.strip()
+            if comment.strip() != "":
+                comments[code] = comment.strip()
+            if sep == "" or not CODE.match(code) or name == "":
+                sys.exit(f"{path}:{n}: Invalid override: {line!r}")
+            if code in overrides:
+                sys.exit(f"{path}:{n}: Duplicate override for {code}")
+            overrides[code] = name
+    return overrides, comments
+
+
+def read_pnp(path):
+    """Return the {code: company} registry, and the latest approval date in it."""
+    pnp = {}
+    latest = ""
+    with open(path, encoding="utf-8-sig", newline="") as f:
+        reader = csv.reader(f)
+        header = [h.strip().lower() for h in next(reader)]
+        try:
+            code_col = next(i for i, h in enumerate(header) if "pnp" in h)
+            company_col = next(i for i, h in enumerate(header) if "company" in h)
+        except StopIteration:
+            sys.exit(f"{path}: Could not find the 'Company' and 'PNP ID' columns")
+        date_col = next((i for i, h in enumerate(header) if "date" in h), None)
+        for row in reader:
+            if len(row) <= max(code_col, company_col):
+                continue
+            code = row[code_col].strip().upper()
+            if not CODE.match(code):
+                continue
+            pnp[code] = " ".join(row[company_col].split())
+            if date_col is not None and date_col < len(row):
+                # Dates are MM/DD/YYYY
+                m = re.match(r"(\d+)/(\d+)/(\d{4})", row[date_col].strip())
+                if m:
+                    latest = max(latest, f"{m.group(3)}.{int(m.group(1)):02d}.{int(m.group(2)):02d}")
+    return pnp, latest
+
+
+def suggest(company):
+    """Suggest a condensed name: the first word of the company name that isn't noise."""
+    for word in re.split(r"[\s,()]+", company):
+        if word.lower() not in NOISE and word != "":
+            return word.strip(".")
+    return company
+
+
+def escape(name):
+    return "".join(f"\\{c}" if c in '"\\' else c for c in name)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Regenerate the vendor table of src/vendors.hpp")
+    parser.add_argument("--pnp", help="local copy of the UEFI PNP ID registry (CSV)")
+    parser.add_argument("--overrides", default=OVERRIDES, help="condensed names (default: %(default)s)")
+    parser.add_argument("--output", default=HEADER, help="header to update (default: %(default)s)")
+    parser.add_argument("--add-new", action="store_true", help="add PNP IDs that have no override, with a suggested name")
+    parser.add_argument("--dry-run", action="store_true", help="only print the report")
+    args = parser.parse_args()
+
+    current, before, after = read_table(args.output)
+    overrides, comments = read_overrides(args.overrides)
+    pnp, latest = read_pnp(args.pnp) if args.pnp else ({}, "")
+
+    table = {}
+    for code, name in overrides.items():
+        # Codes that resolve to themselves are left out, since that's what we report by default
+        if name != "-" and name != code:
+            table[code] = name
+    unreviewed = sorted(code for code in pnp if code not in overrides)
+    missing = sorted(code for code in overrides if pnp and code not in pnp)
+    for code in unreviewed:
+        if args.add_new:
+            table[code] = suggest(pnp[code])
+
+    # Diff report
+    added = sorted(code for code in table if code not in current)
+    removed = sorted(code for code in current if code not in table)
+    changed = sorted(code for code in table if code in current and table[code] != current[code])
+    for code in added:
+        print(f"+ {code} {table[code]!r}")
+    for code in removed:
+        print(f"- {code} {current[code]!r}")
+    for code in changed:
+        print(f"~ {code} {current[code]!r} -> {table[code]!r}")
+    if unreviewed and not args.add_new:
+        print(f"\n{len(unreviewed)} PNP ID(s) have no override (use --add-new to add them as suggested):")
+        for code in unreviewed:
+            print(f"  {code}\t{suggest(pnp[code])}\t# {pnp[code]}")
+    if missing:
+        print(f"\n{len(missing)} override(s) are not in the PNP registry (kept): {' '.join(missing[:20])}" +
+              (" ..." if len(missing) > 20 else ""))
+    print(f"\n{len(table)} entries: {len(added)} added, {len(removed)} removed, {len(changed)} changed")
+
+    if args.dry_run:
+        return
+    if latest:
+        before = re.sub(r"up to \d{4}\.\d{2}\.\d{2}", f"up to {latest}", before)
+    body = "".join(f'\t{{ "{code}", "{escape(table[code])}" }},' +
+                   (f"\t// {comments[code]}" if code in comments else "") + "\n" for code in sorted(table))
+    with open(args.output, "w", encoding="utf-8", newline="") as f:
+        f.write(before + body + after)
+
+
+if __name__ == "__main__":
+    main()
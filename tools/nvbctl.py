@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+#
+# nvBrightness - nVidia Control Panel brightness at your fingertips
+#
+# Copyright © 2025 Pete Batard <pete@akeo.ie>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""Control a running nvBrightness instance through its IPC interface, which is
+enabled with the EnableIPC registry setting.
+
+Usage: nvbctl.py [--pipe NAME | --socket PATH] list
+       nvbctl.py get DISPLAY
+       nvbctl.py set DISPLAY LEVEL [DISPLAY LEVEL ...]
+       nvbctl.py input DISPLAY INPUT
+       nvbctl.py watch
+       nvbctl.py raw < requests.txt
+
+DISPLAY is an index, as reported by list, or "active". LEVEL is in percent of
+the range that can be covered. INPUT is an input name (HDMI1, DP2, ...), a VCP
+input code, or one of home, next or prev. When more than one display is set,
+the changes are applied together, as a single batch. With raw, the requests
+(see src/nvIpc.hpp) are read from stdin and sent in one go, after which the
+replies are printed.
+"""
+
+import argparse
+import os
+import socket
+import sys
+
+PIPE_NAME = r"\\.\pipe\nvBrightness"
+CONTROL_REQUESTS = ("begin", "commit", "quit")
+
+
+def default_pipe():
+    """The pipe of the nvBrightness instance running in our session"""
+    # nvBrightness suffixes its pipe name with the ID of its session
+    session_id = 0
+    if os.name == "nt":
+        import ctypes
+        from ctypes import wintypes
+        sid = wintypes.DWORD()
+        if ctypes.windll.kernel32.ProcessIdToSessionId(os.getpid(), ctypes.byref(sid)):
+            session_id = sid.value
+    return f"{PIPE_NAME}-{session_id}"
+
+
+class Connection:
+    def __init__(self, pipe=None, path=None):
+        if path is not None:
+            self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+            self.sock.connect(path)
+            self.reader = self.sock.makefile("rb")
+            self.write = self.sock.sendall
+        else:
+            # Named pipes can be opened as regular files
+            self.pipe = open(pipe, "r+b", buffering=0)
+            self.reader = self.pipe
+            self.write = self.pipe.write
+
+    def send(self, requests):
+        self.write("".join(f"{r}\n" for r in requests).encode())
+
+    def readline(self, events=False):
+        """Read a line, skipping events unless we asked for them"""
+        while True:
+            line = self.reader.readline()
+            if not line:
+                sys.exit("Connection closed by nvBrightness")
+            line = line.decode(errors="replace").rstrip("\r\n")
+            if events or not line.startswith("event "):
+                return line
+
+    def reply(self, request):
+        """Read the reply to a request, which spans several lines for list"""
+        lines = [self.readline()]
+        words = lines[0].split()
+        if request.split()[0] == "list" and words[0] == "ok":
+            lines += [self.readline() for _ in range(int(words[1]))]
+        return lines
+
+
+def run(conn, requests):
+    """Send the requests in one go, then print the replies. Returns False on error."""
+    conn.send(requests)
+    ok = True
+    for request in requests:
+        if not request.split() or request.split()[0] in CONTROL_REQUESTS:
+            continue
+        lines = conn.reply(request)
+        ok &= lines[0].startswith("ok")
+        for line in lines:
+            print(line)
+    return ok
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Control nvBrightness through its IPC interface")
+    group = parser.add_mutually_exclusive_group()
+    group.add_argument("--pipe", help="named pipe to connect to (default: the one of our session)")
+    group.add_argument("--socket", help="UNIX socket to connect to instead")
+    parser.add_argument("command", choices=["list", "get", "set", "input", "watch", "raw"])
+    parser.add_argument("args", nargs="*")
+    opts = parser.parse_args()
+
+    expected = {"list": 0, "get": 1, "input": 2, "watch": 0, "raw": 0}
+    if opts.command == "set":
+        if len(opts.args) == 0 or len(opts.args) % 2 != 0:
+            parser.error("set needs DISPLAY LEVEL pairs")
+    elif len(opts.args) != expected[opts.command]:
+        parser.error(f"{opts.command} needs {expected[opts.command]} argument(s)")
+
+    try:
+        conn = Connection(opts.pipe or default_pipe(), opts.socket)
+    except OSError as e:
+        sys.exit(f"Could not connect to nvBrightness: {e}")
+
+    if opts.command == "watch":
+        run(conn, ["subscribe"])
+        try:
+            while True:
+                print(conn.readline(events=True), flush=True)
+        except KeyboardInterrupt:
+            return
+    if opts.command == "raw":
+        requests = [line.strip() for line in sys.stdin if line.strip()]
+    elif opts.command == "set":
+        pairs = [f"set {d} {l}" for d, l in zip(opts.args[::2], opts.args[1::2])]
+        requests = ["begin"] + pairs + ["commit"] if len(pairs) > 1 else pairs
+    else:
+        requests = [" ".join([opts.command] + opts.args)]
+    if not run(conn, requests + ["quit"]):
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()